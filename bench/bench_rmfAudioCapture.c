@@ -0,0 +1,2249 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file bench_rmfAudioCapture.c
+*
+* Micro-benchmarks of the capture path.
+*
+* Built by `make bench` with optimisation and linked against the same HAL library as
+* the test binary. Every benchmark runs its warmup repetitions, which are discarded,
+* then its measured repetitions, and reports the time per operation in nanoseconds
+* as minimum, median, mean, 90th and 99th percentile, maximum and standard deviation.
+*
+* | Benchmark | Operation |
+* | --------- | --------- |
+* | `callback_dispatch` | Indirect call of a counting buffer ready callback |
+* | `callback_metered` | Buffer ready callback with level metering and drift tracking, as in the tests |
+* | `callback_copy` | Buffer ready callback copying the buffer out, as an in-process consumer must |
+* | `callback_copy_fanout` | Buffer ready callback copying the buffer out for each of two consumers |
+* | `callback_pool_fanout` | Buffer ready callback copying the buffer once into a pool buffer referenced by two consumers |
+* | `pool_acquire_release` | One pool buffer acquired and released |
+* | `shm_publish` | One callback buffer published to the shared memory ring with no reader |
+* | `shm_readers_<n>` | One callback buffer read by one of n readers with the writer unpaced, the aggregate read rate |
+* | `shm_latency_readers_<n>` | Publish to read latency of each buffer with n readers, paced at 20 kHz |
+* | `shm_process_readers_1` | As `shm_readers_1` with the reader a forked process attached through /proc/<pid>/fd |
+* | `shm_latency_process_readers_1` | As `shm_latency_readers_1` with the reader a forked process |
+* | `convert_<format>` | One frame converted to a mono float sample |
+* | `meter_s16_stereo` | One callback buffer metered |
+* | `flac_s16_stereo` | One callback buffer compressed |
+* | `wav_write` | Ten seconds of 16 bit stereo 48 kHz audio written as a WAV file |
+* | `hal_open_close` | RMF_AudioCapture_Open() and RMF_AudioCapture_Close() |
+* | `hal_start` | RMF_AudioCapture_Start() call |
+* | `hal_first_callback` | RMF_AudioCapture_Start() to the first buffer ready callback |
+* | `hal_stop` | RMF_AudioCapture_Stop() call |
+* | `hal_delivery_interval` | Time between buffer ready callbacks during steady state capture |
+* | `hal_timestamp_delay` | Capture time of a buffer to the entry of the timestamped callback, see rmfAudioCapture_timestamp.h |
+* | `timeline_event_off` | One timeline event with the timeline off, see capture_timeline.h |
+* | `timeline_event` | One timeline event recorded |
+*
+* Results are written as `benchmark` records to the metrics stream (see capture_metrics.h),
+* stdout unless -o selects another, and as a table on stderr.
+*
+* The coalescing sweeps capture for -s seconds at each batch size with a metering consumer,
+* as a background loudness monitor would run, and report what the capture costs rather than
+* a time per operation: process CPU time per second of audio, consumer calls, wakeups and
+* context switches per second. `hal_coalesce` batches in the mock HAL (INPUT_PRIMARY_COALESCE),
+* `async_coalesce` in the adapter of capture_async.h. They are written as `coalesce` records.
+*
+* `settings_sweep` captures for -s seconds at each point of a grid of threshold and fifoSize
+* values and reports the callback rate, the CPU time per second of audio, the jitter of the
+* callback intervals and the effective latency, the mean time audio waits in the HAL FIFO
+* by Little's law from the fifoDepth of RMF_AudioCapture_GetStatus(). The consumer then stalls
+* once for BENCH_SWEEP_STALL_MS and the overflows the stall caused are counted. The points are
+* written as `sweep` records, as a table on stderr and, with -c, as CSV.
+*
+* `session_scaling` ramps from 1 to -n concurrent consumers, capturing for -s seconds at each
+* step. Each consumer is a thread fed by a HAL session, as a room or picture in picture would be.
+* The HAL offers one session per capture type, so the step opens a session of each type in turn,
+* up to as many as the HAL opens, and the further consumers share them. Each step reports the
+* throughput of each consumer as a percentage of the audio rate, the 99th percentile of its
+* inter-arrival times, the process CPU time and the buffers dropped, as `scaling_session` and
+* `scaling` records. The first step where a consumer leaves 90 to 110 % of the rate, the p99
+* inter-arrival time doubles from the first step, or audio is dropped is the knee, written as a
+* `scaling_knee` record.
+*
+* Usage: bench_rmfAudioCapture [-w warmup] [-r repetitions] [-s seconds] [-n consumers] [-d directory] [-o metrics] [-c csv] [-b filter] [-l]
+*
+* When INPUT_PRIMARY is not set, a sine wave is written to the directory and INPUT_PRIMARY
+* names it, so the mock HAL has audio to deliver.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+
+#include "rmfAudioCapture.h"
+#include "capture_metrics.h"
+#include "capture_wav.h"
+#include "capture_meter.h"
+#include "capture_drift.h"
+#include "capture_flac.h"
+#include "capture_shm.h"
+#include "capture_pool.h"
+#include "capture_async.h"
+#include "capture_timeline.h"
+#include "rmfAudioCapture_timestamp.h"
+
+#define BENCH_BUFFER_BYTES      8192        // Callback buffer size of the mock HAL, its default threshold
+#define BENCH_SAMPLING_RATE     48000
+#define BENCH_SECONDS_DEFAULT   5           // Steady state capture measured for the delivery interval
+#define BENCH_WARMUP_DEFAULT    3
+#define BENCH_REPS_DEFAULT      20
+#define BENCH_DISPATCH_CALLS    200000      // Calls timed per callback_dispatch repetition
+#define BENCH_KERNEL_BUFFERS    256         // Callback buffers timed per kernel repetition
+#define BENCH_WAV_SECONDS       10
+#define BENCH_CALLBACK_TIMEOUT_MS 2000      // Wait for the first callback after start
+#define BENCH_STOP_SETTLE_MS    150         // Lets the HAL delivery thread finish after stop
+#define BENCH_MAX_ARRIVALS      65536
+#define BENCH_SHM_SLOTS         CAPTURE_SHM_SLOTS_DEFAULT
+#define BENCH_SHM_BUFFERS       4096        // Buffers published per shared memory repetition
+#define BENCH_SHM_PACE_NS       50000       // Publish period of the latency benchmark
+#define BENCH_SHM_MAX_READERS   4
+#define BENCH_FANOUT_CONSUMERS  2
+#define BENCH_POOL_BUFFERS      16
+#define BENCH_SWEEP_POLL_MS     47          // FIFO depth sampling period, prime so it does not beat with the callbacks
+#define BENCH_SWEEP_STALL_MS    100         // Consumer stall the FIFO must absorb, about 19 KB of 16 bit stereo 48 kHz
+#define BENCH_TIMELINE_EVENTS   4096        // Events timed per timeline repetition, as begin and end pairs
+#define BENCH_SCALING_DEFAULT   8           // Consumers the session_scaling ramp ends at
+#define BENCH_SCALING_MAX       64
+#define BENCH_SCALING_SLOTS     4           // Buffers queued to a consumer before the HAL callback drops one
+#define BENCH_SCALING_TOLERANCE_LOW  90.0   // Percent of the audio rate a consumer must receive, as the L2 byte checks
+#define BENCH_SCALING_TOLERANCE_HIGH 110.0
+#define BENCH_SCALING_P99_FACTOR 2.0        // Degraded when the worst p99 inter-arrival time exceeds the single consumer's by this factor
+
+typedef struct
+{
+    uint32_t warmup;
+    uint32_t repetitions;
+    uint32_t seconds;
+    uint32_t consumers;
+    const char *directory;
+    const char *filter;
+    const char *csv;
+    bool list;
+} bench_options_t;
+
+typedef struct
+{
+    double min;
+    double max;
+    double mean;
+    double median;
+    double p90;
+    double p99;
+    double stddev;
+} bench_stats_t;
+
+typedef struct
+{
+    _Atomic uint64_t bytes_received;
+    _Atomic uint32_t callbacks;
+    _Atomic uint64_t first_ns;      // Arrival of the first callback, 0 until it arrives
+    bool record_arrivals;
+    _Atomic uint32_t arrivals_count;
+    uint64_t *arrivals;
+    capture_meter_t meter;
+    capture_drift_t drift;
+    uint8_t copy[BENCH_FANOUT_CONSUMERS][BENCH_BUFFER_BYTES];
+    capture_pool_t *pool;
+    capture_pool_buffer_t *held[BENCH_FANOUT_CONSUMERS];   // References the consumers hold until the next buffer
+    _Atomic uint32_t stall_ms;      // One consumer stall of this long on the next callback
+} bench_session_t;
+
+/* Measures one repetition and returns nanoseconds per operation */
+typedef double (*bench_run_t)(void *ctx);
+
+static bench_options_t gOptions;
+static int gFailures;
+static volatile float gSink;        // Keeps the optimiser from discarding kernel results
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleepMs(uint32_t ms)
+{
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+static bool selected(const char *name)
+{
+    if (gOptions.list)
+    {
+        printf("%s\n", name);
+        return false;
+    }
+    return (gOptions.filter == NULL) || (strstr(name, gOptions.filter) != NULL);
+}
+
+static int compareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest rank percentile of sorted samples */
+static double percentile(const double *sorted, size_t count, double p)
+{
+    size_t rank = (size_t)ceil(p / 100.0 * (double)count);
+    return sorted[(rank > 0) ? rank - 1 : 0];
+}
+
+static void computeStats(double *samples, size_t count, bench_stats_t *stats)
+{
+    double sum = 0.0;
+    double squares = 0.0;
+
+    qsort(samples, count, sizeof(double), compareDouble);
+    for (size_t i = 0; i < count; i++)
+    {
+        sum += samples[i];
+    }
+    stats->mean = sum / (double)count;
+    for (size_t i = 0; i < count; i++)
+    {
+        squares += (samples[i] - stats->mean) * (samples[i] - stats->mean);
+    }
+    stats->stddev = (count > 1) ? sqrt(squares / (double)(count - 1)) : 0.0;
+    stats->min = samples[0];
+    stats->max = samples[count - 1];
+    stats->median = (count % 2) ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2.0;
+    stats->p90 = percentile(samples, count, 90.0);
+    stats->p99 = percentile(samples, count, 99.0);
+}
+
+/* Formats nanoseconds with a readable unit for the table */
+static const char *formatNs(char *text, size_t size, double ns)
+{
+    if (ns >= 1e6)
+    {
+        snprintf(text, size, "%.3f ms", ns / 1e6);
+    }
+    else if (ns >= 1e3)
+    {
+        snprintf(text, size, "%.3f us", ns / 1e3);
+    }
+    else
+    {
+        snprintf(text, size, "%.1f ns", ns);
+    }
+    return text;
+}
+
+/**
+ * @brief Reports the samples of a benchmark, bytes is the data processed per operation or 0
+ *
+ * extra names one more field of the record, with its value, or is NULL.
+ */
+static void report(const char *name, double *samples, size_t count, uint32_t warmup, uint64_t bytes, const char *extra, double value)
+{
+    bench_stats_t stats;
+    capture_metrics_record_t record;
+    double throughput = 0.0;
+    char median[24], p99[24], min[24], max[24];
+
+    if (count == 0)
+    {
+        fprintf(stderr, "%-24s no samples\n", name);
+        gFailures++;
+        return;
+    }
+    computeStats(samples, count, &stats);
+    if ((bytes > 0) && (stats.median > 0.0))
+    {
+        throughput = (double)bytes / stats.median * 1e3;   // MB/s
+    }
+
+    fprintf(stderr, "%-24s median %12s  p99 %12s  min %12s  max %12s  sd %5.1f%%",
+            name, formatNs(median, sizeof(median), stats.median), formatNs(p99, sizeof(p99), stats.p99),
+            formatNs(min, sizeof(min), stats.min), formatNs(max, sizeof(max), stats.max),
+            (stats.mean > 0.0) ? stats.stddev / stats.mean * 100.0 : 0.0);
+    if (throughput > 0.0)
+    {
+        fprintf(stderr, "  %9.1f MB/s", throughput);
+    }
+    fprintf(stderr, "\n");
+
+    capture_metrics_begin(&record, "benchmark", "bench_rmfAudioCapture", NULL);
+    capture_json_add_string(&record.writer, "name", name);
+    capture_json_add_string(&record.writer, "unit", "ns");
+    capture_json_add_uint(&record.writer, "warmup", warmup);
+    capture_json_add_uint(&record.writer, "repetitions", count);
+    capture_json_add_double(&record.writer, "min", stats.min);
+    capture_json_add_double(&record.writer, "median", stats.median);
+    capture_json_add_double(&record.writer, "mean", stats.mean);
+    capture_json_add_double(&record.writer, "p90", stats.p90);
+    capture_json_add_double(&record.writer, "p99", stats.p99);
+    capture_json_add_double(&record.writer, "max", stats.max);
+    capture_json_add_double(&record.writer, "stddev", stats.stddev);
+    if (bytes > 0)
+    {
+        capture_json_add_uint(&record.writer, "bytes", bytes);
+        capture_json_add_double(&record.writer, "mb_per_s", throughput);
+    }
+    if (extra != NULL)
+    {
+        capture_json_add_double(&record.writer, extra, value);
+    }
+    capture_metrics_emit(&record);
+}
+
+/**
+ * @brief Runs the warmup and measured repetitions of a benchmark and reports them
+ */
+static void run(const char *name, bench_run_t fn, void *ctx, uint64_t bytes)
+{
+    double *samples;
+
+    if (!selected(name))
+    {
+        return;
+    }
+    samples = calloc(gOptions.repetitions, sizeof(double));
+    if (samples == NULL)
+    {
+        gFailures++;
+        return;
+    }
+    for (uint32_t i = 0; i < gOptions.warmup; i++)
+    {
+        fn(ctx);
+    }
+    for (uint32_t i = 0; i < gOptions.repetitions; i++)
+    {
+        samples[i] = fn(ctx);
+    }
+    report(name, samples, gOptions.repetitions, gOptions.warmup, bytes, NULL, 0.0);
+    free(samples);
+}
+
+/* Fills a buffer with a 1 kHz tone in the given layout */
+static void fillTone(uint8_t *pcm, size_t frames, uint16_t channels, uint16_t bits_per_sample)
+{
+    size_t bytesPerSample = bits_per_sample / 8;
+
+    for (size_t f = 0; f < frames; f++)
+    {
+        int32_t value = (int32_t)(sin(2.0 * M_PI * 1000.0 * (double)f / BENCH_SAMPLING_RATE) * 0.5 * 2147483647.0);
+
+        for (uint16_t c = 0; c < channels; c++)
+        {
+            uint32_t u = (uint32_t)value >> (32 - bits_per_sample);
+            for (size_t b = 0; b < bytesPerSample; b++)
+            {
+                *pcm++ = (uint8_t)(u >> (8 * b));
+            }
+        }
+    }
+}
+
+/*
+ * Callback benchmarks
+ */
+
+static rmf_Error countingCallback(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    bench_session_t *session = (bench_session_t *)context_blob;
+    uint64_t now = nowNs();
+    uint64_t unset = 0;
+
+    (void)AudioCaptureBuffer;
+    atomic_compare_exchange_strong(&session->first_ns, &unset, now);
+    if (session->record_arrivals)
+    {
+        uint32_t index = atomic_fetch_add(&session->arrivals_count, 1);
+        if (index < BENCH_MAX_ARRIVALS)
+        {
+            session->arrivals[index] = now;
+        }
+    }
+    atomic_fetch_add_explicit(&session->bytes_received, AudioCaptureBufferSize, memory_order_relaxed);
+    atomic_fetch_add_explicit(&session->callbacks, 1, memory_order_relaxed);
+    return RMF_SUCCESS;
+}
+
+static rmf_Error meteredCallback(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    bench_session_t *session = (bench_session_t *)context_blob;
+
+    capture_meter_process(&session->meter, AudioCaptureBuffer, AudioCaptureBufferSize);
+    capture_drift_process(&session->drift, AudioCaptureBufferSize);
+    atomic_fetch_add_explicit(&session->bytes_received, AudioCaptureBufferSize, memory_order_relaxed);
+    return RMF_SUCCESS;
+}
+
+static rmf_Error copyingCallback(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    bench_session_t *session = (bench_session_t *)context_blob;
+
+    memcpy(session->copy[0], AudioCaptureBuffer, (AudioCaptureBufferSize < sizeof(session->copy[0])) ? AudioCaptureBufferSize : sizeof(session->copy[0]));
+    atomic_fetch_add_explicit(&session->bytes_received, AudioCaptureBufferSize, memory_order_relaxed);
+    return RMF_SUCCESS;
+}
+
+static rmf_Error copyingFanoutCallback(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    bench_session_t *session = (bench_session_t *)context_blob;
+    size_t bytes = (AudioCaptureBufferSize < sizeof(session->copy[0])) ? AudioCaptureBufferSize : sizeof(session->copy[0]);
+
+    for (int c = 0; c < BENCH_FANOUT_CONSUMERS; c++)
+    {
+        memcpy(session->copy[c], AudioCaptureBuffer, bytes);
+    }
+    atomic_fetch_add_explicit(&session->bytes_received, AudioCaptureBufferSize, memory_order_relaxed);
+    return RMF_SUCCESS;
+}
+
+/* Copies once into a pool buffer; each consumer keeps a reference until the next buffer, as an asynchronous consumer would */
+static rmf_Error poolFanoutCallback(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    bench_session_t *session = (bench_session_t *)context_blob;
+    capture_pool_buffer_t *buffer = capture_pool_acquire(session->pool);
+
+    if (buffer == NULL)
+    {
+        return RMF_ERROR;
+    }
+    buffer->bytes = (AudioCaptureBufferSize < buffer->capacity) ? AudioCaptureBufferSize : buffer->capacity;
+    memcpy(buffer->data, AudioCaptureBuffer, buffer->bytes);
+    for (int c = 0; c < BENCH_FANOUT_CONSUMERS; c++)
+    {
+        capture_pool_release(session->held[c]);
+        capture_pool_retain(buffer);
+        session->held[c] = buffer;
+    }
+    capture_pool_release(buffer);
+    atomic_fetch_add_explicit(&session->bytes_received, AudioCaptureBufferSize, memory_order_relaxed);
+    return RMF_SUCCESS;
+}
+
+typedef struct
+{
+    RMF_AudioCapture_Settings settings;
+    bench_session_t session;
+    uint8_t buffer[BENCH_BUFFER_BYTES];
+    uint32_t calls;
+} bench_dispatch_t;
+
+static double runDispatch(void *ctx)
+{
+    bench_dispatch_t *dispatch = (bench_dispatch_t *)ctx;
+    /* Read the callback through a volatile pointer, as the HAL does from its settings */
+    RMF_AudioCaptureBufferReadyCb volatile *callback = &dispatch->settings.cbBufferReady;
+    uint64_t start = nowNs();
+
+    for (uint32_t i = 0; i < dispatch->calls; i++)
+    {
+        (*callback)(dispatch->settings.cbBufferReadyParm, dispatch->buffer, sizeof(dispatch->buffer));
+    }
+    return (double)(nowNs() - start) / dispatch->calls;
+}
+
+static void benchCallbacks(void)
+{
+    bench_dispatch_t *dispatch = calloc(1, sizeof(*dispatch));
+
+    if (dispatch == NULL)
+    {
+        gFailures++;
+        return;
+    }
+    fillTone(dispatch->buffer, sizeof(dispatch->buffer) / 4, 2, 16);
+    dispatch->settings.cbBufferReadyParm = &dispatch->session;
+
+    dispatch->settings.cbBufferReady = countingCallback;
+    dispatch->calls = BENCH_DISPATCH_CALLS;
+    run("callback_dispatch", runDispatch, dispatch, 0);
+
+    capture_meter_init(&dispatch->session.meter, 2, BENCH_SAMPLING_RATE, 16, CAPTURE_METER_WINDOW_MS);
+    capture_drift_init(&dispatch->session.drift, 2, BENCH_SAMPLING_RATE, 16);
+    dispatch->settings.cbBufferReady = meteredCallback;
+    dispatch->calls = BENCH_KERNEL_BUFFERS;
+    run("callback_metered", runDispatch, dispatch, BENCH_BUFFER_BYTES);
+
+    dispatch->settings.cbBufferReady = copyingCallback;
+    dispatch->calls = BENCH_DISPATCH_CALLS / 10;
+    run("callback_copy", runDispatch, dispatch, BENCH_BUFFER_BYTES);
+
+    dispatch->settings.cbBufferReady = copyingFanoutCallback;
+    run("callback_copy_fanout", runDispatch, dispatch, BENCH_BUFFER_BYTES);
+
+    if (RMF_SUCCESS == capture_pool_create(&dispatch->session.pool, BENCH_BUFFER_BYTES, BENCH_POOL_BUFFERS, 0))
+    {
+        capture_pool_stats_t stats;
+
+        dispatch->settings.cbBufferReady = poolFanoutCallback;
+        run("callback_pool_fanout", runDispatch, dispatch, BENCH_BUFFER_BYTES);
+        for (int c = 0; c < BENCH_FANOUT_CONSUMERS; c++)
+        {
+            capture_pool_release(dispatch->session.held[c]);
+            dispatch->session.held[c] = NULL;
+        }
+        capture_pool_stats(dispatch->session.pool, &stats);
+        if (stats.exhausted > 0)
+        {
+            fprintf(stderr, "callback_pool_fanout     pool exhausted %llu times\n", (unsigned long long)stats.exhausted);
+            gFailures++;
+        }
+        capture_pool_destroy(dispatch->session.pool);
+    }
+    else
+    {
+        gFailures++;
+    }
+    free(dispatch);
+}
+
+static double runPool(void *ctx)
+{
+    capture_pool_t *pool = (capture_pool_t *)ctx;
+    uint64_t start = nowNs();
+
+    for (uint32_t i = 0; i < BENCH_DISPATCH_CALLS; i++)
+    {
+        capture_pool_release(capture_pool_acquire(pool));
+    }
+    return (double)(nowNs() - start) / BENCH_DISPATCH_CALLS;
+}
+
+static void benchPool(void)
+{
+    capture_pool_t *pool = NULL;
+
+    if (RMF_SUCCESS != capture_pool_create(&pool, BENCH_BUFFER_BYTES, BENCH_POOL_BUFFERS, 0))
+    {
+        gFailures++;
+        return;
+    }
+    run("pool_acquire_release", runPool, pool, 0);
+    capture_pool_destroy(pool);
+}
+
+/*
+ * Shared memory export benchmarks
+ */
+
+typedef struct
+{
+    capture_shm_t *shm;
+    uint8_t buffer[BENCH_BUFFER_BYTES];
+    uint32_t readers;
+    uint32_t processes;         // Readers run as forked processes rather than threads, up to readers
+    uint32_t buffers;
+    uint64_t pace_ns;           // Publish period, 0 to publish as fast as possible
+    _Atomic uint32_t attached;
+    uint64_t dropped;           // Buffers the readers missed, over all repetitions
+    pthread_mutex_t lock;
+    double *latencies;          // Publish to read latency of every buffer read, when pacing
+    size_t latency_count;
+    size_t latency_size;
+} bench_shm_t;
+
+/* Reader thread, attaches to the memfd as another process would and reads until the ring closes */
+static void *shmReader(void *arg)
+{
+    bench_shm_t *bench = (bench_shm_t *)arg;
+    capture_shm_reader_t reader;
+    uint8_t data[BENCH_BUFFER_BYTES];
+    uint32_t bytes;
+    uint64_t stamp;
+
+    if (RMF_SUCCESS != capture_shm_attach(&reader, capture_shm_fd(bench->shm)))
+    {
+        atomic_fetch_add(&bench->attached, 1);
+        return NULL;
+    }
+    atomic_fetch_add(&bench->attached, 1);
+    while (RMF_SUCCESS == capture_shm_read(&reader, data, sizeof(data), &bytes, &stamp, -1))
+    {
+        if (bench->pace_ns > 0)
+        {
+            double latency = (double)(nowNs() - stamp);
+
+            pthread_mutex_lock(&bench->lock);
+            if (bench->latency_count < bench->latency_size)
+            {
+                bench->latencies[bench->latency_count++] = latency;
+            }
+            pthread_mutex_unlock(&bench->lock);
+        }
+        gSink = data[0];
+    }
+    pthread_mutex_lock(&bench->lock);
+    bench->dropped += reader.dropped;
+    pthread_mutex_unlock(&bench->lock);
+    capture_shm_detach(&reader);
+    return NULL;
+}
+
+/* Publish to read latencies of a forked reader, kept in the child until the ring closes */
+static double gProcessLatencies[BENCH_SHM_BUFFERS];
+
+/*
+ * Forked reader, attaches through /proc/<pid>/fd of the writer as an unrelated process would.
+ * Reports on fd whether it attached, then once the ring closes its dropped count, the number
+ * of latencies and the latencies, and exits.
+ */
+static void shmProcessReader(bench_shm_t *bench, pid_t writer, int fd)
+{
+    capture_shm_reader_t reader;
+    uint8_t data[BENCH_BUFFER_BYTES];
+    char path[64];
+    uint32_t bytes;
+    uint64_t stamp;
+    uint64_t count = 0;
+    uint8_t attached = 0;
+    int memfd;
+
+    snprintf(path, sizeof(path), "/proc/%d/fd/%d", (int)writer, capture_shm_fd(bench->shm));
+    memfd = open(path, O_RDWR | O_CLOEXEC);
+    if ((memfd >= 0) && (RMF_SUCCESS == capture_shm_attach(&reader, memfd)))
+    {
+        attached = 1;
+    }
+    if (memfd >= 0)
+    {
+        close(memfd);
+    }
+    if ((write(fd, &attached, sizeof(attached)) != sizeof(attached)) || !attached)
+    {
+        _exit(1);
+    }
+    while (RMF_SUCCESS == capture_shm_read(&reader, data, sizeof(data), &bytes, &stamp, -1))
+    {
+        if ((bench->pace_ns > 0) && (count < BENCH_SHM_BUFFERS))
+        {
+            gProcessLatencies[count++] = (double)(nowNs() - stamp);
+        }
+        gSink = data[0];
+    }
+    if ((write(fd, &reader.dropped, sizeof(reader.dropped)) != sizeof(reader.dropped)) ||
+        (write(fd, &count, sizeof(count)) != sizeof(count)) ||
+        (write(fd, gProcessLatencies, count * sizeof(double)) != (ssize_t)(count * sizeof(double))))
+    {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+/* Reads exactly size bytes from fd, false on end of file or error */
+static bool readAll(int fd, void *data, size_t size)
+{
+    size_t done = 0;
+
+    while (done < size)
+    {
+        ssize_t got = read(fd, (uint8_t *)data + done, size - done);
+
+        if (got <= 0)
+        {
+            return false;
+        }
+        done += (size_t)got;
+    }
+    return true;
+}
+
+/* Collects the results of a forked reader and waits for it, false if it did not report them */
+static bool shmProcessFinish(bench_shm_t *bench, pid_t child, int fd)
+{
+    uint64_t dropped = 0;
+    uint64_t count = 0;
+    bool ok = readAll(fd, &dropped, sizeof(dropped)) && readAll(fd, &count, sizeof(count)) && (count <= BENCH_SHM_BUFFERS);
+
+    if (ok && (count > 0))
+    {
+        double latency;
+
+        for (uint64_t i = 0; ok && (i < count); i++)
+        {
+            ok = readAll(fd, &latency, sizeof(latency));
+            if (ok && (bench->latency_count < bench->latency_size))
+            {
+                bench->latencies[bench->latency_count++] = latency;
+            }
+        }
+    }
+    bench->dropped += dropped;
+    close(fd);
+    waitpid(child, NULL, 0);
+    return ok;
+}
+
+/* Publishes the buffers to the attached readers, timing until every reader has finished, per buffer read */
+static double runShm(void *ctx)
+{
+    bench_shm_t *bench = (bench_shm_t *)ctx;
+    pthread_t threads[BENCH_SHM_MAX_READERS];
+    pid_t children[BENCH_SHM_MAX_READERS];
+    int pipes[BENCH_SHM_MAX_READERS];
+    uint32_t started = 0;
+    uint32_t forked = 0;
+    uint64_t start, next;
+    uint64_t dropped = bench->dropped;
+    uint64_t read;
+    bool reported = true;
+
+    if (RMF_SUCCESS != capture_shm_create(&bench->shm, BENCH_BUFFER_BYTES, BENCH_SHM_SLOTS))
+    {
+        return NAN;
+    }
+    // Forked before any reader thread exists, so the children start from a single threaded copy
+    for (uint32_t i = 0; (i < bench->processes) && (i < bench->readers); i++)
+    {
+        int fds[2];
+        uint8_t attached = 0;
+
+        if (pipe(fds) != 0)
+        {
+            break;
+        }
+        children[forked] = fork();
+        if (children[forked] == 0)
+        {
+            close(fds[0]);
+            shmProcessReader(bench, getppid(), fds[1]);
+        }
+        close(fds[1]);
+        if ((children[forked] < 0) || !readAll(fds[0], &attached, sizeof(attached)) || !attached)
+        {
+            if (children[forked] > 0)
+            {
+                waitpid(children[forked], NULL, 0);
+            }
+            close(fds[0]);
+            break;
+        }
+        pipes[forked++] = fds[0];
+    }
+    atomic_store(&bench->attached, 0);
+    for (uint32_t i = forked; i < bench->readers; i++)
+    {
+        if (pthread_create(&threads[started], NULL, shmReader, bench) == 0)
+        {
+            started++;
+        }
+    }
+    while (atomic_load(&bench->attached) < started)
+    {
+        sched_yield();
+    }
+
+    start = nowNs();
+    next = start;
+    for (uint32_t i = 0; i < bench->buffers; i++)
+    {
+        if (bench->pace_ns > 0)
+        {
+            next += bench->pace_ns;
+            while (nowNs() < next)
+            {
+                // Spin, a sleep would add the scheduler wake up to the period
+            }
+        }
+        capture_shm_publish(bench->shm, bench->buffer, sizeof(bench->buffer), nowNs());
+    }
+    capture_shm_destroy(bench->shm);
+    for (uint32_t i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    for (uint32_t i = 0; i < forked; i++)
+    {
+        pthread_mutex_lock(&bench->lock);
+        reported = shmProcessFinish(bench, children[i], pipes[i]) && reported;
+        pthread_mutex_unlock(&bench->lock);
+    }
+    bench->shm = NULL;
+    if ((started + forked != bench->readers) || !reported)
+    {
+        return NAN;
+    }
+    read = (uint64_t)bench->buffers * bench->readers - (bench->dropped - dropped);
+    return (double)(nowNs() - start) / ((bench->readers > 0) ? read : bench->buffers);
+}
+
+static void benchShm(void)
+{
+    /* Readers of each configuration, and how many of them are forked processes */
+    static const struct { uint32_t readers; uint32_t processes; } configs[] = { { 1, 0 }, { 2, 0 }, { BENCH_SHM_MAX_READERS, 0 }, { 1, 1 } };
+    bench_shm_t *bench = calloc(1, sizeof(*bench));
+    char name[64];
+
+    if (bench == NULL)
+    {
+        gFailures++;
+        return;
+    }
+    pthread_mutex_init(&bench->lock, NULL);
+    fillTone(bench->buffer, sizeof(bench->buffer) / 4, 2, 16);
+    bench->buffers = BENCH_SHM_BUFFERS;
+
+    run("shm_publish", runShm, bench, BENCH_BUFFER_BYTES);
+
+    for (size_t r = 0; r < sizeof(configs) / sizeof(configs[0]); r++)
+    {
+        const char *kind = (configs[r].processes > 0) ? "process_" : "";
+
+        bench->readers = configs[r].readers;
+        bench->processes = configs[r].processes;
+        bench->pace_ns = 0;
+        bench->dropped = 0;
+        snprintf(name, sizeof(name), "shm_%sreaders_%u", kind, configs[r].readers);
+        run(name, runShm, bench, BENCH_BUFFER_BYTES);
+        if (bench->dropped > 0)
+        {
+            fprintf(stderr, "%-24s %llu buffers overwritten before they were read, the writer outpaced the readers\n", name, (unsigned long long)bench->dropped);
+        }
+
+        snprintf(name, sizeof(name), "shm_latency_%sreaders_%u", kind, configs[r].readers);
+        if (!selected(name))
+        {
+            continue;
+        }
+        bench->pace_ns = BENCH_SHM_PACE_NS;
+        bench->dropped = 0;
+        bench->latency_count = 0;
+        bench->latency_size = (size_t)bench->buffers * configs[r].readers;
+        bench->latencies = calloc(bench->latency_size, sizeof(double));
+        if (bench->latencies == NULL)
+        {
+            gFailures++;
+            continue;
+        }
+        runShm(bench);      // Warmup, faults in the ring and starts the reader threads once
+        bench->latency_count = 0;
+        bench->dropped = 0;
+        runShm(bench);
+        report(name, bench->latencies, bench->latency_count, 1, 0, "dropped", (double)bench->dropped);
+        free(bench->latencies);
+        bench->latencies = NULL;
+    }
+    pthread_mutex_destroy(&bench->lock);
+    free(bench);
+}
+
+/*
+ * Kernel benchmarks
+ */
+
+typedef struct
+{
+    uint8_t *pcm;
+    size_t frames;
+    uint16_t channels;
+    uint16_t bits_per_sample;
+    float *mono;
+    capture_meter_t meter;
+    const char *path;
+} bench_kernel_t;
+
+static double runConvert(void *ctx)
+{
+    bench_kernel_t *kernel = (bench_kernel_t *)ctx;
+    uint64_t start = nowNs();
+
+    capture_wav_pcm_to_mono(kernel->pcm, kernel->frames, kernel->channels, kernel->bits_per_sample, kernel->mono);
+    gSink = kernel->mono[kernel->frames / 2];
+    return (double)(nowNs() - start) / kernel->frames;
+}
+
+static double runMeter(void *ctx)
+{
+    bench_kernel_t *kernel = (bench_kernel_t *)ctx;
+    size_t frameBytes = kernel->channels * kernel->bits_per_sample / 8;
+    size_t buffers = kernel->frames * frameBytes / BENCH_BUFFER_BYTES;
+    uint64_t start = nowNs();
+
+    for (size_t i = 0; i < buffers; i++)
+    {
+        capture_meter_process(&kernel->meter, kernel->pcm + i * BENCH_BUFFER_BYTES, BENCH_BUFFER_BYTES);
+    }
+    return (double)(nowNs() - start) / buffers;
+}
+
+static double runFlac(void *ctx)
+{
+    bench_kernel_t *kernel = (bench_kernel_t *)ctx;
+    size_t frameBytes = kernel->channels * kernel->bits_per_sample / 8;
+    size_t buffers = kernel->frames * frameBytes / BENCH_BUFFER_BYTES;
+    capture_flac_encoder_t *encoder = NULL;
+    uint64_t elapsed;
+    uint64_t start;
+
+    if (RMF_SUCCESS != capture_flac_encoder_open(&encoder, kernel->channels, BENCH_SAMPLING_RATE, kernel->bits_per_sample))
+    {
+        return NAN;
+    }
+    start = nowNs();
+    for (size_t i = 0; i < buffers; i++)
+    {
+        capture_flac_encoder_write(encoder, kernel->pcm + i * BENCH_BUFFER_BYTES, BENCH_BUFFER_BYTES);
+    }
+    elapsed = nowNs() - start;
+    capture_flac_encoder_close(encoder);
+    return (double)elapsed / buffers;
+}
+
+static double runWavWrite(void *ctx)
+{
+    bench_kernel_t *kernel = (bench_kernel_t *)ctx;
+    size_t bytes = kernel->frames * kernel->channels * kernel->bits_per_sample / 8;
+    uint64_t start = nowNs();
+    rmf_Error result;
+
+    result = capture_wav_write(kernel->path, kernel->channels, BENCH_SAMPLING_RATE, kernel->bits_per_sample, kernel->pcm, (uint32_t)bytes);
+    start = nowNs() - start;
+    unlink(kernel->path);
+    return (result == RMF_SUCCESS) ? (double)start : NAN;
+}
+
+static bool kernelInit(bench_kernel_t *kernel, uint16_t channels, uint16_t bits_per_sample, size_t frames)
+{
+    memset(kernel, 0, sizeof(*kernel));
+    kernel->channels = channels;
+    kernel->bits_per_sample = bits_per_sample;
+    kernel->frames = frames;
+    kernel->pcm = malloc(frames * channels * bits_per_sample / 8);
+    kernel->mono = malloc(frames * sizeof(float));
+    if ((kernel->pcm == NULL) || (kernel->mono == NULL))
+    {
+        free(kernel->pcm);
+        free(kernel->mono);
+        gFailures++;
+        return false;
+    }
+    fillTone(kernel->pcm, frames, channels, bits_per_sample);
+    return true;
+}
+
+static void kernelRelease(bench_kernel_t *kernel)
+{
+    free(kernel->pcm);
+    free(kernel->mono);
+}
+
+static void benchKernels(void)
+{
+    static const struct
+    {
+        const char *name;
+        uint16_t channels;
+        uint16_t bits_per_sample;
+    } formats[] =
+    {
+        { "convert_s16_mono",   1, 16 },
+        { "convert_s16_stereo", 2, 16 },
+        { "convert_s24_stereo", 2, 24 },
+        { "convert_s24_5_1",    6, 24 },
+    };
+    size_t kernelFrames = BENCH_KERNEL_BUFFERS * BENCH_BUFFER_BYTES / 4;   // 16 bit stereo frames in the kernel buffers
+    bench_kernel_t kernel;
+    char path[512];
+
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+    {
+        if (kernelInit(&kernel, formats[i].channels, formats[i].bits_per_sample, kernelFrames))
+        {
+            run(formats[i].name, runConvert, &kernel, formats[i].channels * formats[i].bits_per_sample / 8);
+            kernelRelease(&kernel);
+        }
+    }
+
+    if (kernelInit(&kernel, 2, 16, kernelFrames))
+    {
+        capture_meter_init(&kernel.meter, 2, BENCH_SAMPLING_RATE, 16, CAPTURE_METER_WINDOW_MS);
+        run("meter_s16_stereo", runMeter, &kernel, BENCH_BUFFER_BYTES);
+        run("flac_s16_stereo", runFlac, &kernel, BENCH_BUFFER_BYTES);
+        kernelRelease(&kernel);
+    }
+
+    if (kernelInit(&kernel, 2, 16, BENCH_WAV_SECONDS * BENCH_SAMPLING_RATE))
+    {
+        snprintf(path, sizeof(path), "%s/bench_rmfAudioCapture_%d.wav", gOptions.directory, (int)getpid());
+        kernel.path = path;
+        run("wav_write", runWavWrite, &kernel, (uint64_t)BENCH_WAV_SECONDS * BENCH_SAMPLING_RATE * 4);
+        kernelRelease(&kernel);
+    }
+}
+
+/*
+ * HAL benchmarks
+ */
+
+static bool waitForCallback(bench_session_t *session, uint32_t timeout_ms)
+{
+    uint64_t deadline = nowNs() + (uint64_t)timeout_ms * 1000000ull;
+
+    while (atomic_load(&session->first_ns) == 0)
+    {
+        if (nowNs() > deadline)
+        {
+            return false;
+        }
+        sleepMs(1);
+    }
+    return true;
+}
+
+static double runOpenClose(void *ctx)
+{
+    RMF_AudioCaptureHandle handle = NULL;
+    uint64_t start = nowNs();
+    rmf_Error result;
+
+    (void)ctx;
+    result = RMF_AudioCapture_Open(&handle);
+    if (result == RMF_SUCCESS)
+    {
+        result = RMF_AudioCapture_Close(handle);
+    }
+    return (result == RMF_SUCCESS) ? (double)(nowNs() - start) : NAN;
+}
+
+/* Runs open, start, first callback, stop and close cycles, timing the start, the first callback and the stop */
+static void benchStartStop(void)
+{
+    uint32_t total = gOptions.warmup + gOptions.repetitions;
+    double *start_ns = calloc(total, sizeof(double));
+    double *first_ns = calloc(total, sizeof(double));
+    double *stop_ns = calloc(total, sizeof(double));
+    size_t count = 0;
+    bool wantStart = selected("hal_start");
+    bool wantFirst = selected("hal_first_callback");
+    bool wantStop = selected("hal_stop");
+
+    if (!(wantStart || wantFirst || wantStop) || (start_ns == NULL) || (first_ns == NULL) || (stop_ns == NULL))
+    {
+        goto done;
+    }
+
+    for (uint32_t i = 0; i < total; i++)
+    {
+        RMF_AudioCaptureHandle handle = NULL;
+        RMF_AudioCapture_Settings settings;
+        bench_session_t session;
+        uint64_t before, after;
+        bool delivered;
+
+        memset(&session, 0, sizeof(session));
+        if ((RMF_SUCCESS != RMF_AudioCapture_Open(&handle)) || (RMF_SUCCESS != RMF_AudioCapture_GetDefaultSettings(&settings)))
+        {
+            fprintf(stderr, "Unable to open the primary capture\n");
+            gFailures++;
+            goto done;
+        }
+        settings.cbBufferReady = countingCallback;
+        settings.cbBufferReadyParm = &session;
+        settings.cbStatusChange = NULL;
+
+        before = nowNs();
+        if (RMF_SUCCESS != RMF_AudioCapture_Start(handle, &settings))
+        {
+            fprintf(stderr, "Unable to start the primary capture\n");
+            RMF_AudioCapture_Close(handle);
+            gFailures++;
+            goto done;
+        }
+        after = nowNs();
+        delivered = waitForCallback(&session, BENCH_CALLBACK_TIMEOUT_MS);
+
+        uint64_t stopBefore = nowNs();
+        RMF_AudioCapture_Stop(handle);
+        uint64_t stopAfter = nowNs();
+        sleepMs(BENCH_STOP_SETTLE_MS);
+        RMF_AudioCapture_Close(handle);
+
+        if (!delivered)
+        {
+            fprintf(stderr, "No buffer ready callback within %u ms of start\n", BENCH_CALLBACK_TIMEOUT_MS);
+            gFailures++;
+            goto done;
+        }
+        if (i >= gOptions.warmup)
+        {
+            start_ns[count] = (double)(after - before);
+            first_ns[count] = (double)(atomic_load(&session.first_ns) - before);
+            stop_ns[count] = (double)(stopAfter - stopBefore);
+            count++;
+        }
+    }
+
+    if (wantStart)
+    {
+        report("hal_start", start_ns, count, gOptions.warmup, 0, NULL, 0.0);
+    }
+    if (wantFirst)
+    {
+        report("hal_first_callback", first_ns, count, gOptions.warmup, 0, NULL, 0.0);
+    }
+    if (wantStop)
+    {
+        report("hal_stop", stop_ns, count, gOptions.warmup, 0, NULL, 0.0);
+    }
+
+done:
+    free(start_ns);
+    free(first_ns);
+    free(stop_ns);
+}
+
+/* Times the interval between callbacks over the steady state capture, after the first second */
+static void benchDelivery(void)
+{
+    RMF_AudioCaptureHandle handle = NULL;
+    RMF_AudioCapture_Settings settings;
+    bench_session_t session;
+    double *intervals = NULL;
+    uint32_t arrivals;
+    uint32_t skip;
+    size_t count = 0;
+    double nominal = 0.0;
+
+    if (!selected("hal_delivery_interval"))
+    {
+        return;
+    }
+    memset(&session, 0, sizeof(session));
+    session.arrivals = calloc(BENCH_MAX_ARRIVALS, sizeof(uint64_t));
+    intervals = calloc(BENCH_MAX_ARRIVALS, sizeof(double));
+    if ((session.arrivals == NULL) || (intervals == NULL) ||
+        (RMF_SUCCESS != RMF_AudioCapture_Open(&handle)) || (RMF_SUCCESS != RMF_AudioCapture_GetDefaultSettings(&settings)))
+    {
+        fprintf(stderr, "Unable to open the primary capture\n");
+        gFailures++;
+        goto done;
+    }
+    settings.cbBufferReady = countingCallback;
+    settings.cbBufferReadyParm = &session;
+    settings.cbStatusChange = NULL;
+
+    if (RMF_SUCCESS != RMF_AudioCapture_Start(handle, &settings))
+    {
+        fprintf(stderr, "Unable to start the primary capture\n");
+        RMF_AudioCapture_Close(handle);
+        gFailures++;
+        goto done;
+    }
+    sleepMs(1000);      // Warmup, the intervals of the first second are discarded
+    skip = atomic_load(&session.arrivals_count);
+    session.record_arrivals = true;
+    sleepMs(gOptions.seconds * 1000);
+    session.record_arrivals = false;
+    RMF_AudioCapture_Stop(handle);
+    sleepMs(BENCH_STOP_SETTLE_MS);
+    RMF_AudioCapture_Close(handle);
+
+    arrivals = atomic_load(&session.arrivals_count);
+    if (arrivals > BENCH_MAX_ARRIVALS)
+    {
+        arrivals = BENCH_MAX_ARRIVALS;
+    }
+    for (uint32_t i = skip + 1; i < arrivals; i++)
+    {
+        intervals[count++] = (double)(session.arrivals[i] - session.arrivals[i - 1]);
+    }
+    if ((count > 0) && (atomic_load(&session.callbacks) > 0))
+    {
+        /* Period of the data rate of the default settings, 16 bit stereo */
+        double bytesPerCallback = (double)atomic_load(&session.bytes_received) / atomic_load(&session.callbacks);
+        nominal = bytesPerCallback / ((double)BENCH_SAMPLING_RATE * 4) * 1e9;
+    }
+    report("hal_delivery_interval", intervals, count, 1, 0, (nominal > 0.0) ? "nominal" : NULL, nominal);
+
+done:
+    free(session.arrivals);
+    free(intervals);
+}
+
+static rmf_Error timestampedCallback(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize, const RMF_AudioCapture_BufferInfo *info)
+{
+    bench_session_t *session = (bench_session_t *)context_blob;
+    uint64_t now = nowNs();
+
+    (void)AudioCaptureBuffer;
+    if (session->record_arrivals && (now >= info->captureTimeNs))
+    {
+        uint32_t index = atomic_fetch_add(&session->arrivals_count, 1);
+        if (index < BENCH_MAX_ARRIVALS)
+        {
+            session->arrivals[index] = now - info->captureTimeNs;
+        }
+    }
+    atomic_fetch_add_explicit(&session->bytes_received, AudioCaptureBufferSize, memory_order_relaxed);
+    atomic_fetch_add_explicit(&session->callbacks, 1, memory_order_relaxed);
+    return RMF_SUCCESS;
+}
+
+/* Times the capture time to callback entry delay over the steady state capture, when the HAL timestamps its buffers */
+static void benchTimestampDelay(void)
+{
+    RMF_AudioCaptureHandle handle = NULL;
+    RMF_AudioCapture_Settings settings;
+    bench_session_t session;
+    double *delays = NULL;
+    uint32_t count;
+
+    if (!selected("hal_timestamp_delay"))
+    {
+        return;
+    }
+    memset(&session, 0, sizeof(session));
+    session.arrivals = calloc(BENCH_MAX_ARRIVALS, sizeof(uint64_t));
+    delays = calloc(BENCH_MAX_ARRIVALS, sizeof(double));
+    if ((session.arrivals == NULL) || (delays == NULL) ||
+        (RMF_SUCCESS != RMF_AudioCapture_Open(&handle)) || (RMF_SUCCESS != RMF_AudioCapture_GetDefaultSettings(&settings)))
+    {
+        fprintf(stderr, "Unable to open the primary capture\n");
+        gFailures++;
+        goto done;
+    }
+    if ((RMF_AudioCapture_SetTimestampedBufferReadyCb == NULL) ||
+        (RMF_SUCCESS != RMF_AudioCapture_SetTimestampedBufferReadyCb(handle, timestampedCallback)))
+    {
+        fprintf(stderr, "%-24s not supported by the HAL\n", "hal_timestamp_delay");
+        RMF_AudioCapture_Close(handle);
+        goto done;
+    }
+    settings.cbBufferReady = countingCallback;
+    settings.cbBufferReadyParm = &session;
+    settings.cbStatusChange = NULL;
+
+    if (RMF_SUCCESS != RMF_AudioCapture_Start(handle, &settings))
+    {
+        fprintf(stderr, "Unable to start the primary capture\n");
+        RMF_AudioCapture_Close(handle);
+        gFailures++;
+        goto done;
+    }
+    sleepMs(1000);      // Warmup, the delays of the first second are discarded
+    session.record_arrivals = true;
+    sleepMs(gOptions.seconds * 1000);
+    session.record_arrivals = false;
+    RMF_AudioCapture_Stop(handle);
+    sleepMs(BENCH_STOP_SETTLE_MS);
+    RMF_AudioCapture_Close(handle);
+
+    count = atomic_load(&session.arrivals_count);
+    if (count > BENCH_MAX_ARRIVALS)
+    {
+        count = BENCH_MAX_ARRIVALS;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        delays[i] = (double)session.arrivals[i];
+    }
+    report("hal_timestamp_delay", delays, count, 1, 0, NULL, 0.0);
+
+done:
+    free(session.arrivals);
+    free(delays);
+}
+
+static void benchHal(void)
+{
+    run("hal_open_close", runOpenClose, NULL, 0);
+    benchStartStop();
+    benchDelivery();
+    benchTimestampDelay();
+}
+
+/*
+ * Coalescing sweeps
+ */
+
+static const uint32_t gCoalesceBatches[] = { 1, 2, 4, 8, 16 };
+
+typedef struct
+{
+    uint64_t wall_ns;
+    uint64_t cpu_ns;            // Process CPU time, every thread of the capture path
+    uint64_t switches;          // Voluntary and involuntary context switches of the process
+    uint64_t callbacks;
+    uint64_t bytes;
+    uint64_t wakeups;           // Adapter worker wakeups, the HAL thread's are its callbacks
+} bench_usage_t;
+
+static rmf_Error monitorCallback(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    bench_session_t *session = (bench_session_t *)context_blob;
+
+    capture_meter_process(&session->meter, AudioCaptureBuffer, AudioCaptureBufferSize);
+    atomic_fetch_add_explicit(&session->bytes_received, AudioCaptureBufferSize, memory_order_relaxed);
+    atomic_fetch_add_explicit(&session->callbacks, 1, memory_order_relaxed);
+    return RMF_SUCCESS;
+}
+
+static void sampleUsage(bench_session_t *session, capture_async_t *async, bench_usage_t *usage)
+{
+    struct rusage rusage;
+    struct timespec cpu;
+    capture_async_stats_t stats;
+
+    usage->wall_ns = nowNs();
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu);
+    usage->cpu_ns = (uint64_t)cpu.tv_sec * 1000000000ull + (uint64_t)cpu.tv_nsec;
+    getrusage(RUSAGE_SELF, &rusage);
+    usage->switches = (uint64_t)rusage.ru_nvcsw + (uint64_t)rusage.ru_nivcsw;
+    usage->callbacks = atomic_load(&session->callbacks);
+    usage->bytes = atomic_load(&session->bytes_received);
+    capture_async_stats(async, &stats);
+    usage->wakeups = stats.wakeups;
+}
+
+/* Captures for the measurement period with one batch size and reports the cost, returns false on failure */
+static bool runCoalesce(const char *name, uint32_t batch, bool adapter)
+{
+    RMF_AudioCaptureHandle handle = NULL;
+    RMF_AudioCapture_Settings settings;
+    capture_async_t *async = NULL;
+    capture_async_coalesce_t budget = { .bytes = batch * BENCH_BUFFER_BYTES, .ms = 0 };
+    capture_metrics_record_t record;
+    bench_session_t *session = calloc(1, sizeof(*session));
+    bench_usage_t before, after;
+    double seconds, audioSeconds, cpuUs, callbacks, wakeups, switches;
+    char value[16];
+    rmf_Error result;
+
+    if ((session == NULL) || (RMF_SUCCESS != RMF_AudioCapture_Open(&handle)) || (RMF_SUCCESS != RMF_AudioCapture_GetDefaultSettings(&settings)))
+    {
+        fprintf(stderr, "Unable to open the primary capture\n");
+        free(session);
+        return false;
+    }
+    capture_meter_init(&session->meter, 2, BENCH_SAMPLING_RATE, 16, CAPTURE_METER_WINDOW_MS);
+    settings.cbBufferReady = monitorCallback;
+    settings.cbBufferReadyParm = session;
+    settings.cbStatusChange = NULL;
+
+    if (adapter)
+    {
+        result = capture_async_start_coalesced(&async, handle, &settings, 0, &budget);
+    }
+    else
+    {
+        snprintf(value, sizeof(value), "%u", batch);
+        setenv("INPUT_PRIMARY_COALESCE", value, 1);
+        result = RMF_AudioCapture_Start(handle, &settings);
+    }
+    if (result != RMF_SUCCESS)
+    {
+        fprintf(stderr, "Unable to start the primary capture\n");
+        unsetenv("INPUT_PRIMARY_COALESCE");
+        RMF_AudioCapture_Close(handle);
+        capture_async_destroy(async);
+        free(session);
+        return false;
+    }
+
+    sleepMs(1000);      // Warmup, excluded from the measurement
+    sampleUsage(session, async, &before);
+    sleepMs(gOptions.seconds * 1000);
+    sampleUsage(session, async, &after);
+
+    if (adapter)
+    {
+        capture_async_stop(async);
+    }
+    else
+    {
+        RMF_AudioCapture_Stop(handle);
+    }
+    sleepMs(BENCH_STOP_SETTLE_MS);
+    RMF_AudioCapture_Close(handle);
+    capture_async_destroy(async);
+    unsetenv("INPUT_PRIMARY_COALESCE");
+
+    seconds = (double)(after.wall_ns - before.wall_ns) / 1e9;
+    audioSeconds = (double)(after.bytes - before.bytes) / ((double)BENCH_SAMPLING_RATE * 4);
+    if ((seconds <= 0.0) || (audioSeconds <= 0.0) || (after.callbacks == before.callbacks))
+    {
+        fprintf(stderr, "%-24s no audio delivered\n", name);
+        free(session);
+        return false;
+    }
+    cpuUs = (double)(after.cpu_ns - before.cpu_ns) / 1e3 / audioSeconds;
+    callbacks = (double)(after.callbacks - before.callbacks) / seconds;
+    wakeups = adapter ? (double)(after.wakeups - before.wakeups) / seconds : callbacks;
+    switches = (double)(after.switches - before.switches) / seconds;
+
+    fprintf(stderr, "%-24s batch %3u  %8.0f bytes/call  %7.2f calls/s  %7.2f wakeups/s  %7.2f switches/s  %9.1f us CPU per audio s\n",
+            name, batch, (double)(after.bytes - before.bytes) / (double)(after.callbacks - before.callbacks),
+            callbacks, wakeups, switches, cpuUs);
+
+    capture_metrics_begin(&record, "coalesce", "bench_rmfAudioCapture", NULL);
+    capture_json_add_string(&record.writer, "name", name);
+    capture_json_add_uint(&record.writer, "batch", batch);
+    capture_json_add_double(&record.writer, "seconds", seconds);
+    capture_json_add_double(&record.writer, "bytes_per_call", (double)(after.bytes - before.bytes) / (double)(after.callbacks - before.callbacks));
+    capture_json_add_double(&record.writer, "calls_per_s", callbacks);
+    capture_json_add_double(&record.writer, "wakeups_per_s", wakeups);
+    capture_json_add_double(&record.writer, "context_switches_per_s", switches);
+    capture_json_add_double(&record.writer, "cpu_us_per_audio_s", cpuUs);
+    capture_metrics_emit(&record);
+
+    free(session);
+    return true;
+}
+
+static void benchCoalesce(void)
+{
+    const char *names[] = { "hal_coalesce", "async_coalesce" };
+
+    for (int adapter = 0; adapter < 2; adapter++)
+    {
+        if (!selected(names[adapter]))
+        {
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(gCoalesceBatches) / sizeof(gCoalesceBatches[0]); i++)
+        {
+            if (!runCoalesce(names[adapter], gCoalesceBatches[i], adapter != 0))
+            {
+                gFailures++;
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * Threshold and FIFO size sweep
+ */
+
+static const uint32_t gSweepThresholds[] = { 1024, 2048, 4096, 8192, 16384, 32768 };
+static const uint32_t gSweepFifoSizes[] = { 16384, 65536, 262144 };
+
+typedef struct
+{
+    uint32_t threshold;
+    uint32_t fifo_size;
+    double calls_per_s;
+    double cpu_us_per_audio_s;
+    double interval_us;         // Mean callback interval
+    double jitter_sd_us;        // Standard deviation of the callback intervals
+    double jitter_p99_us;       // 99th percentile of the distance of an interval from the mean
+    double latency_ms;          // Mean wait in the FIFO, or half a threshold when the HAL reports no depth
+    double latency_max_ms;      // Deepest FIFO seen, or a whole threshold
+    bool fifo_depth;            // The HAL reported a FIFO depth
+    uint32_t overflows;         // Caused by the consumer stall
+} bench_sweep_t;
+
+static rmf_Error sweepCallback(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    bench_session_t *session = (bench_session_t *)context_blob;
+    uint32_t stall = atomic_exchange(&session->stall_ms, 0);
+
+    if (session->record_arrivals)
+    {
+        uint32_t index = atomic_fetch_add(&session->arrivals_count, 1);
+        if (index < BENCH_MAX_ARRIVALS)
+        {
+            session->arrivals[index] = nowNs();
+        }
+    }
+    capture_meter_process(&session->meter, AudioCaptureBuffer, AudioCaptureBufferSize);
+    atomic_fetch_add_explicit(&session->bytes_received, AudioCaptureBufferSize, memory_order_relaxed);
+    atomic_fetch_add_explicit(&session->callbacks, 1, memory_order_relaxed);
+    if (stall > 0)
+    {
+        sleepMs(stall);
+    }
+    return RMF_SUCCESS;
+}
+
+/* Captures at one point of the grid, returns false on failure */
+static bool runSweepPoint(bench_sweep_t *point)
+{
+    RMF_AudioCaptureHandle handle = NULL;
+    RMF_AudioCapture_Settings settings;
+    RMF_AudioCapture_Status status;
+    bench_session_t *session = calloc(1, sizeof(*session));
+    double *intervals = calloc(BENCH_MAX_ARRIVALS, sizeof(double));
+    double byteRate = (double)BENCH_SAMPLING_RATE * 4;
+    bench_usage_t before, after;
+    uint64_t depthSum = 0;
+    size_t depthMax = 0;
+    uint32_t depthSamples = 0;
+    uint32_t overflows;
+    uint32_t arrivals;
+    size_t count = 0;
+    bench_stats_t stats;
+    bool ok = false;
+
+    if ((session == NULL) || (intervals == NULL) ||
+        ((session->arrivals = calloc(BENCH_MAX_ARRIVALS, sizeof(uint64_t))) == NULL) ||
+        (RMF_SUCCESS != RMF_AudioCapture_Open(&handle)) || (RMF_SUCCESS != RMF_AudioCapture_GetDefaultSettings(&settings)))
+    {
+        fprintf(stderr, "Unable to open the primary capture\n");
+        goto done;
+    }
+    capture_meter_init(&session->meter, 2, BENCH_SAMPLING_RATE, 16, CAPTURE_METER_WINDOW_MS);
+    settings.threshold = point->threshold;
+    settings.fifoSize = point->fifo_size;
+    settings.cbBufferReady = sweepCallback;
+    settings.cbBufferReadyParm = session;
+    settings.cbStatusChange = NULL;
+    if (RMF_SUCCESS != RMF_AudioCapture_Start(handle, &settings))
+    {
+        fprintf(stderr, "Unable to start the primary capture with threshold %u fifoSize %u\n", point->threshold, point->fifo_size);
+        RMF_AudioCapture_Close(handle);
+        goto done;
+    }
+
+    sleepMs(1000);      // Warmup, excluded from the measurement
+    session->record_arrivals = true;
+    sampleUsage(session, NULL, &before);
+    for (uint64_t end = nowNs() + (uint64_t)gOptions.seconds * 1000000000ull; nowNs() < end;)
+    {
+        if (RMF_SUCCESS == RMF_AudioCapture_GetStatus(handle, &status))
+        {
+            depthSum += status.fifoDepth;
+            depthMax = (status.fifoDepth > depthMax) ? status.fifoDepth : depthMax;
+            depthSamples++;
+        }
+        sleepMs(BENCH_SWEEP_POLL_MS);
+    }
+    sampleUsage(session, NULL, &after);
+    session->record_arrivals = false;
+
+    /* Then one stall, and the overflows it causes */
+    memset(&status, 0, sizeof(status));
+    RMF_AudioCapture_GetStatus(handle, &status);
+    overflows = status.overflows;
+    atomic_store(&session->stall_ms, BENCH_SWEEP_STALL_MS);
+    sleepMs(BENCH_SWEEP_STALL_MS + 1000);
+    memset(&status, 0, sizeof(status));
+    RMF_AudioCapture_GetStatus(handle, &status);
+    point->overflows = status.overflows - overflows;
+
+    RMF_AudioCapture_Stop(handle);
+    sleepMs(BENCH_STOP_SETTLE_MS);
+    RMF_AudioCapture_Close(handle);
+
+    arrivals = atomic_load(&session->arrivals_count);
+    if (arrivals > BENCH_MAX_ARRIVALS)
+    {
+        arrivals = BENCH_MAX_ARRIVALS;
+    }
+    for (uint32_t i = 1; i < arrivals; i++)
+    {
+        intervals[count++] = (double)(session->arrivals[i] - session->arrivals[i - 1]);
+    }
+    if ((count == 0) || (after.bytes == before.bytes))
+    {
+        fprintf(stderr, "No audio delivered with threshold %u fifoSize %u\n", point->threshold, point->fifo_size);
+        goto done;
+    }
+    computeStats(intervals, count, &stats);
+    point->interval_us = stats.mean / 1e3;
+    point->jitter_sd_us = stats.stddev / 1e3;
+    for (size_t i = 0; i < count; i++)
+    {
+        intervals[i] = fabs(intervals[i] - stats.mean);
+    }
+    computeStats(intervals, count, &stats);
+    point->jitter_p99_us = stats.p99 / 1e3;
+
+    point->calls_per_s = (double)(after.callbacks - before.callbacks) / ((double)(after.wall_ns - before.wall_ns) / 1e9);
+    point->cpu_us_per_audio_s = (double)(after.cpu_ns - before.cpu_ns) / 1e3 / ((double)(after.bytes - before.bytes) / byteRate);
+    point->fifo_depth = (depthMax > 0);
+    if (point->fifo_depth)
+    {
+        /* Little's law: the mean time a byte waits is the mean occupancy over the arrival rate */
+        point->latency_ms = (double)depthSum / depthSamples / byteRate * 1e3;
+        point->latency_max_ms = (double)depthMax / byteRate * 1e3;
+    }
+    else
+    {
+        point->latency_ms = (double)point->threshold / 2 / byteRate * 1e3;
+        point->latency_max_ms = (double)point->threshold / byteRate * 1e3;
+    }
+    ok = true;
+
+done:
+    if (session != NULL)
+    {
+        free(session->arrivals);
+    }
+    free(session);
+    free(intervals);
+    return ok;
+}
+
+static void reportSweepPoint(const bench_sweep_t *point, FILE *csv)
+{
+    capture_metrics_record_t record;
+
+    fprintf(stderr, "%9u %9u %9.2f %11.1f %11.3f %9.1f %9.1f %10.3f %10.3f %9u\n",
+            point->threshold, point->fifo_size, point->calls_per_s, point->cpu_us_per_audio_s, point->interval_us / 1e3,
+            point->jitter_sd_us, point->jitter_p99_us, point->latency_ms, point->latency_max_ms, point->overflows);
+    if (csv != NULL)
+    {
+        fprintf(csv, "%u,%u,%.3f,%.1f,%.1f,%.1f,%.1f,%.3f,%.3f,%s,%u\n",
+                point->threshold, point->fifo_size, point->calls_per_s, point->cpu_us_per_audio_s, point->interval_us,
+                point->jitter_sd_us, point->jitter_p99_us, point->latency_ms, point->latency_max_ms,
+                point->fifo_depth ? "fifo_depth" : "threshold", point->overflows);
+        fflush(csv);
+    }
+
+    capture_metrics_begin(&record, "sweep", "bench_rmfAudioCapture", NULL);
+    capture_json_add_uint(&record.writer, "threshold", point->threshold);
+    capture_json_add_uint(&record.writer, "fifo_size", point->fifo_size);
+    capture_json_add_double(&record.writer, "calls_per_s", point->calls_per_s);
+    capture_json_add_double(&record.writer, "cpu_us_per_audio_s", point->cpu_us_per_audio_s);
+    capture_json_add_double(&record.writer, "interval_us", point->interval_us);
+    capture_json_add_double(&record.writer, "jitter_sd_us", point->jitter_sd_us);
+    capture_json_add_double(&record.writer, "jitter_p99_us", point->jitter_p99_us);
+    capture_json_add_double(&record.writer, "latency_ms", point->latency_ms);
+    capture_json_add_double(&record.writer, "latency_max_ms", point->latency_max_ms);
+    capture_json_add_string(&record.writer, "latency_source", point->fifo_depth ? "fifo_depth" : "threshold");
+    capture_json_add_uint(&record.writer, "stall_ms", BENCH_SWEEP_STALL_MS);
+    capture_json_add_uint(&record.writer, "overflows", point->overflows);
+    capture_metrics_emit(&record);
+}
+
+static void benchSweep(void)
+{
+    FILE *csv = NULL;
+
+    if (!selected("settings_sweep"))
+    {
+        return;
+    }
+    if (gOptions.csv != NULL)
+    {
+        csv = fopen(gOptions.csv, "w");
+        if (csv == NULL)
+        {
+            fprintf(stderr, "Unable to write %s\n", gOptions.csv);
+            gFailures++;
+            return;
+        }
+        fprintf(csv, "threshold,fifo_size,calls_per_s,cpu_us_per_audio_s,interval_us,jitter_sd_us,jitter_p99_us,latency_ms,latency_max_ms,latency_source,overflows\n");
+    }
+    fprintf(stderr, "%9s %9s %9s %11s %11s %9s %9s %10s %10s %9s\n", "threshold", "fifoSize", "calls/s", "CPU us/s",
+            "interval ms", "jitter sd", "jit p99", "latency ms", "max ms", "overflows");
+    for (size_t f = 0; f < sizeof(gSweepFifoSizes) / sizeof(gSweepFifoSizes[0]); f++)
+    {
+        for (size_t t = 0; t < sizeof(gSweepThresholds) / sizeof(gSweepThresholds[0]); t++)
+        {
+            bench_sweep_t point = { .threshold = gSweepThresholds[t], .fifo_size = gSweepFifoSizes[f] };
+
+            if (point.threshold > point.fifo_size / 2)
+            {
+                continue;   // The FIFO must hold a buffer being delivered and the next one filling
+            }
+            if (!runSweepPoint(&point))
+            {
+                gFailures++;
+                continue;
+            }
+            reportSweepPoint(&point, csv);
+        }
+    }
+    if (csv != NULL)
+    {
+        fclose(csv);
+    }
+}
+
+/*
+ * Session scaling
+ */
+
+static const char *const gScalingTypes[] = { RMF_AC_TYPE_PRIMARY, RMF_AC_TYPE_AUXILIARY };
+
+/* A consumer thread fed by one HAL session, as a room or picture in picture consumer would be */
+typedef struct
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    uint8_t slots[BENCH_SCALING_SLOTS][BENCH_BUFFER_BYTES];
+    uint32_t sizes[BENCH_SCALING_SLOTS];
+    uint32_t head;              // Slots filled by the HAL callback
+    uint32_t tail;              // Slots taken by the consumer
+    bool stop;
+    _Atomic bool record;
+    _Atomic uint64_t bytes;     // Consumed while recording
+    _Atomic uint64_t dropped;   // Buffers the HAL callback found no free slot for
+    uint32_t arrivals_count;
+    uint64_t *arrivals;
+    capture_meter_t meter;
+} bench_consumer_t;
+
+/* One HAL session and the consumers it feeds */
+typedef struct
+{
+    RMF_AudioCaptureHandle handle;
+    const char *type;
+    bench_consumer_t *consumers[BENCH_SCALING_MAX];
+    uint32_t count;
+    uint32_t overflows;
+} bench_fanout_t;
+
+typedef struct
+{
+    uint32_t consumers;
+    uint32_t sessions;
+    double throughput_min;      // Percent of the audio rate, lowest consumer
+    double throughput_max;
+    double interval_p99_ms;     // 99th percentile of the inter-arrival times, worst consumer
+    double cpu_percent;         // Process CPU time over wall time
+    uint64_t dropped;
+    uint32_t overflows;
+    bool degraded;
+} bench_scaling_t;
+
+static rmf_Error fanoutCallback(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    bench_fanout_t *fanout = (bench_fanout_t *)context_blob;
+    uint32_t size = (AudioCaptureBufferSize < BENCH_BUFFER_BYTES) ? AudioCaptureBufferSize : BENCH_BUFFER_BYTES;
+
+    for (uint32_t i = 0; i < fanout->count; i++)
+    {
+        bench_consumer_t *consumer = fanout->consumers[i];
+
+        pthread_mutex_lock(&consumer->lock);
+        if (consumer->head - consumer->tail < BENCH_SCALING_SLOTS)
+        {
+            uint32_t slot = consumer->head % BENCH_SCALING_SLOTS;
+
+            memcpy(consumer->slots[slot], AudioCaptureBuffer, size);
+            consumer->sizes[slot] = AudioCaptureBufferSize;
+            consumer->head++;
+            pthread_cond_signal(&consumer->ready);
+        }
+        else if (atomic_load_explicit(&consumer->record, memory_order_relaxed))
+        {
+            atomic_fetch_add_explicit(&consumer->dropped, 1, memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&consumer->lock);
+    }
+    return RMF_SUCCESS;
+}
+
+static void *consumerThread(void *arg)
+{
+    bench_consumer_t *consumer = (bench_consumer_t *)arg;
+
+    for (;;)
+    {
+        uint32_t slot;
+        uint32_t size;
+
+        pthread_mutex_lock(&consumer->lock);
+        while ((consumer->head == consumer->tail) && !consumer->stop)
+        {
+            pthread_cond_wait(&consumer->ready, &consumer->lock);
+        }
+        if (consumer->head == consumer->tail)
+        {
+            pthread_mutex_unlock(&consumer->lock);
+            break;
+        }
+        slot = consumer->tail % BENCH_SCALING_SLOTS;
+        size = consumer->sizes[slot];
+        pthread_mutex_unlock(&consumer->lock);
+
+        if (atomic_load_explicit(&consumer->record, memory_order_relaxed))
+        {
+            if (consumer->arrivals_count < BENCH_MAX_ARRIVALS)
+            {
+                consumer->arrivals[consumer->arrivals_count++] = nowNs();
+            }
+            atomic_fetch_add_explicit(&consumer->bytes, size, memory_order_relaxed);
+        }
+        capture_meter_process(&consumer->meter, consumer->slots[slot], (size < BENCH_BUFFER_BYTES) ? size : BENCH_BUFFER_BYTES);
+
+        pthread_mutex_lock(&consumer->lock);
+        consumer->tail++;
+        pthread_mutex_unlock(&consumer->lock);
+    }
+    return NULL;
+}
+
+static bench_consumer_t *consumerStart(void)
+{
+    bench_consumer_t *consumer = calloc(1, sizeof(*consumer));
+
+    if ((consumer == NULL) || ((consumer->arrivals = calloc(BENCH_MAX_ARRIVALS, sizeof(uint64_t))) == NULL))
+    {
+        free(consumer);
+        return NULL;
+    }
+    pthread_mutex_init(&consumer->lock, NULL);
+    pthread_cond_init(&consumer->ready, NULL);
+    capture_meter_init(&consumer->meter, 2, BENCH_SAMPLING_RATE, 16, CAPTURE_METER_WINDOW_MS);
+    if (pthread_create(&consumer->thread, NULL, consumerThread, consumer) != 0)
+    {
+        pthread_cond_destroy(&consumer->ready);
+        pthread_mutex_destroy(&consumer->lock);
+        free(consumer->arrivals);
+        free(consumer);
+        return NULL;
+    }
+    return consumer;
+}
+
+/* Lets the consumer drain its slots and joins it, its counters may then be read */
+static void consumerJoin(bench_consumer_t *consumer)
+{
+    pthread_mutex_lock(&consumer->lock);
+    if (consumer->stop)
+    {
+        pthread_mutex_unlock(&consumer->lock);
+        return;
+    }
+    consumer->stop = true;
+    pthread_cond_signal(&consumer->ready);
+    pthread_mutex_unlock(&consumer->lock);
+    pthread_join(consumer->thread, NULL);
+}
+
+static void consumerRelease(bench_consumer_t *consumer)
+{
+    consumerJoin(consumer);
+    pthread_cond_destroy(&consumer->ready);
+    pthread_mutex_destroy(&consumer->lock);
+    free(consumer->arrivals);
+    free(consumer);
+}
+
+/* 99th percentile of the inter-arrival times of a consumer in ms, 0 with fewer than two arrivals */
+static double consumerIntervalP99(const bench_consumer_t *consumer, double *intervals)
+{
+    bench_stats_t stats;
+    size_t count = 0;
+
+    for (uint32_t i = 1; i < consumer->arrivals_count; i++)
+    {
+        intervals[count++] = (double)(consumer->arrivals[i] - consumer->arrivals[i - 1]);
+    }
+    if (count == 0)
+    {
+        return 0.0;
+    }
+    computeStats(intervals, count, &stats);
+    return stats.p99 / 1e6;
+}
+
+/* Opens the HAL sessions the step needs, up to the limit the HAL has shown, returns how many were opened */
+static uint32_t openFanouts(bench_fanout_t *fanouts, uint32_t wanted, uint32_t *limit)
+{
+    uint32_t opened = 0;
+
+    while ((opened < wanted) && (opened < *limit))
+    {
+        RMF_AudioCaptureHandle handle = NULL;
+        bool duplicate = false;
+
+        if ((opened >= sizeof(gScalingTypes) / sizeof(gScalingTypes[0])) ||
+            (RMF_SUCCESS != RMF_AudioCapture_Open_Type(&handle, (RMF_AudioCaptureType)gScalingTypes[opened])))
+        {
+            *limit = opened;
+            break;
+        }
+        for (uint32_t i = 0; i < opened; i++)
+        {
+            duplicate = duplicate || (fanouts[i].handle == handle);
+        }
+        if (duplicate)
+        {
+            // The HAL handed out a session already in use
+            *limit = opened;
+            break;
+        }
+        fanouts[opened].handle = handle;
+        fanouts[opened].type = gScalingTypes[opened];
+        opened++;
+    }
+    return opened;
+}
+
+/* Captures with the given number of consumers spread over as many HAL sessions as the HAL opens, returns false on failure */
+static bool runScalingStep(bench_scaling_t *step, uint32_t *limit)
+{
+    bench_fanout_t fanouts[sizeof(gScalingTypes) / sizeof(gScalingTypes[0])];
+    bench_consumer_t *consumers[BENCH_SCALING_MAX] = { NULL };
+    double *intervals = calloc(BENCH_MAX_ARRIVALS, sizeof(double));
+    double byteRate = (double)BENCH_SAMPLING_RATE * 4;
+    uint32_t sessions;
+    uint32_t started = 0;
+    bench_usage_t before, after;
+    bench_session_t idle = { 0 };
+    double seconds;
+    bool ok = false;
+
+    memset(fanouts, 0, sizeof(fanouts));
+    sessions = openFanouts(fanouts, step->consumers, limit);
+    if ((intervals == NULL) || (sessions == 0))
+    {
+        fprintf(stderr, "Unable to open a capture session\n");
+        goto done;
+    }
+    for (uint32_t i = 0; i < step->consumers; i++)
+    {
+        bench_fanout_t *fanout = &fanouts[i % sessions];
+
+        consumers[i] = consumerStart();
+        if (consumers[i] == NULL)
+        {
+            fprintf(stderr, "Unable to start consumer %u\n", i);
+            goto done;
+        }
+        fanout->consumers[fanout->count++] = consumers[i];
+    }
+    for (started = 0; started < sessions; started++)
+    {
+        RMF_AudioCapture_Settings settings;
+
+        RMF_AudioCapture_GetDefaultSettings(&settings);
+        settings.threshold = BENCH_BUFFER_BYTES;
+        settings.cbBufferReady = fanoutCallback;
+        settings.cbBufferReadyParm = &fanouts[started];
+        settings.cbStatusChange = NULL;
+        if (RMF_SUCCESS != RMF_AudioCapture_Start(fanouts[started].handle, &settings))
+        {
+            fprintf(stderr, "Unable to start the %s capture\n", fanouts[started].type);
+            goto done;
+        }
+    }
+
+    sleepMs(1000);      // Warmup, excluded from the measurement
+    for (uint32_t i = 0; i < step->consumers; i++)
+    {
+        atomic_store(&consumers[i]->record, true);
+    }
+    sampleUsage(&idle, NULL, &before);
+    sleepMs(gOptions.seconds * 1000);
+    sampleUsage(&idle, NULL, &after);
+    for (uint32_t i = 0; i < step->consumers; i++)
+    {
+        atomic_store(&consumers[i]->record, false);
+    }
+    for (uint32_t s = 0; s < sessions; s++)
+    {
+        RMF_AudioCapture_Status status;
+
+        memset(&status, 0, sizeof(status));
+        RMF_AudioCapture_GetStatus(fanouts[s].handle, &status);
+        fanouts[s].overflows = status.overflows;
+        RMF_AudioCapture_Stop(fanouts[s].handle);
+    }
+    started = 0;
+    sleepMs(BENCH_STOP_SETTLE_MS);
+    for (uint32_t i = 0; i < step->consumers; i++)
+    {
+        consumerJoin(consumers[i]);
+    }
+
+    seconds = (double)(after.wall_ns - before.wall_ns) / 1e9;
+    step->sessions = sessions;
+    step->cpu_percent = (double)(after.cpu_ns - before.cpu_ns) / (double)(after.wall_ns - before.wall_ns) * 100.0;
+    step->throughput_min = INFINITY;
+    for (uint32_t s = 0; s < sessions; s++)
+    {
+        step->overflows += fanouts[s].overflows;
+        for (uint32_t c = 0; c < fanouts[s].count; c++)
+        {
+            bench_consumer_t *consumer = fanouts[s].consumers[c];
+            double throughput = (double)atomic_load(&consumer->bytes) / (byteRate * seconds) * 100.0;
+            double p99 = consumerIntervalP99(consumer, intervals);
+            uint64_t dropped = atomic_load(&consumer->dropped);
+            capture_metrics_record_t record;
+
+            step->throughput_min = (throughput < step->throughput_min) ? throughput : step->throughput_min;
+            step->throughput_max = (throughput > step->throughput_max) ? throughput : step->throughput_max;
+            step->interval_p99_ms = (p99 > step->interval_p99_ms) ? p99 : step->interval_p99_ms;
+            step->dropped += dropped;
+
+            capture_metrics_begin(&record, "scaling_session", "bench_rmfAudioCapture", fanouts[s].type);
+            capture_json_add_uint(&record.writer, "consumers", step->consumers);
+            capture_json_add_uint(&record.writer, "consumer", c);
+            capture_json_add_double(&record.writer, "throughput_percent", throughput);
+            capture_json_add_double(&record.writer, "interval_p99_ms", p99);
+            capture_json_add_uint(&record.writer, "dropped", dropped);
+            capture_metrics_emit(&record);
+        }
+    }
+    ok = true;
+
+done:
+    for (uint32_t s = 0; s < started; s++)
+    {
+        RMF_AudioCapture_Stop(fanouts[s].handle);
+    }
+    if (started > 0)
+    {
+        sleepMs(BENCH_STOP_SETTLE_MS);
+    }
+    for (uint32_t s = 0; s < sessions; s++)
+    {
+        RMF_AudioCapture_Close(fanouts[s].handle);
+    }
+    for (uint32_t i = 0; i < step->consumers; i++)
+    {
+        if (consumers[i] != NULL)
+        {
+            consumerRelease(consumers[i]);
+        }
+    }
+    free(intervals);
+    return ok;
+}
+
+static void reportScalingStep(const bench_scaling_t *step)
+{
+    capture_metrics_record_t record;
+
+    fprintf(stderr, "%9u %8u %10.1f %10.1f %12.3f %8.1f %8llu %9u%s\n", step->consumers, step->sessions, step->throughput_min,
+            step->throughput_max, step->interval_p99_ms, step->cpu_percent, (unsigned long long)step->dropped, step->overflows,
+            step->degraded ? "  degraded" : "");
+
+    capture_metrics_begin(&record, "scaling", "bench_rmfAudioCapture", NULL);
+    capture_json_add_uint(&record.writer, "consumers", step->consumers);
+    capture_json_add_uint(&record.writer, "sessions", step->sessions);
+    capture_json_add_double(&record.writer, "throughput_min_percent", step->throughput_min);
+    capture_json_add_double(&record.writer, "throughput_max_percent", step->throughput_max);
+    capture_json_add_double(&record.writer, "interval_p99_ms", step->interval_p99_ms);
+    capture_json_add_double(&record.writer, "cpu_percent", step->cpu_percent);
+    capture_json_add_uint(&record.writer, "dropped", step->dropped);
+    capture_json_add_uint(&record.writer, "overflows", step->overflows);
+    capture_json_add_bool(&record.writer, "degraded", step->degraded);
+    capture_metrics_emit(&record);
+}
+
+static void benchScaling(void)
+{
+    uint32_t limit = BENCH_SCALING_MAX;
+    uint32_t sessions = 0;      // Most HAL sessions a step opened
+    uint32_t knee = 0;
+    double baselineP99 = 0.0;
+    capture_metrics_record_t record;
+
+    if (!selected("session_scaling"))
+    {
+        return;
+    }
+    fprintf(stderr, "%9s %8s %10s %10s %12s %8s %8s %9s\n", "consumers", "sessions", "min rate %", "max rate %",
+            "p99 gap ms", "CPU %", "dropped", "overflows");
+    for (uint32_t consumers = 1; consumers <= gOptions.consumers; consumers++)
+    {
+        bench_scaling_t step = { .consumers = consumers };
+
+        if (!runScalingStep(&step, &limit))
+        {
+            gFailures++;
+            break;
+        }
+        if (consumers == 1)
+        {
+            baselineP99 = step.interval_p99_ms;
+        }
+        sessions = (step.sessions > sessions) ? step.sessions : sessions;
+        step.degraded = (step.throughput_min < BENCH_SCALING_TOLERANCE_LOW) || (step.throughput_max > BENCH_SCALING_TOLERANCE_HIGH) ||
+                        (step.interval_p99_ms > baselineP99 * BENCH_SCALING_P99_FACTOR) || (step.dropped > 0) || (step.overflows > 0);
+        if (step.degraded && (knee == 0))
+        {
+            knee = consumers;
+        }
+        reportScalingStep(&step);
+    }
+
+    if (knee > 0)
+    {
+        fprintf(stderr, "Delivery degrades at %u consumers, on up to %u HAL sessions\n", knee, sessions);
+    }
+    else
+    {
+        fprintf(stderr, "No degradation up to %u consumers, on up to %u HAL sessions\n", gOptions.consumers, sessions);
+    }
+    capture_metrics_begin(&record, "scaling_knee", "bench_rmfAudioCapture", NULL);
+    capture_json_add_uint(&record.writer, "knee_consumers", knee);
+    capture_json_add_uint(&record.writer, "consumers_max", gOptions.consumers);
+    capture_json_add_uint(&record.writer, "sessions_max", sessions);
+    capture_metrics_emit(&record);
+}
+
+/* Gives the mock HAL a tone to deliver when no input has been configured, on both captures for session_scaling */
+static void prepareInput(void)
+{
+    static char path[512];
+    bench_kernel_t kernel;
+
+    if (gOptions.list)
+    {
+        return;
+    }
+    if (getenv("INPUT_PRIMARY") != NULL)
+    {
+        setenv("INPUT_AUXILIARY", getenv("INPUT_PRIMARY"), 0);
+        return;
+    }
+    if (kernelInit(&kernel, 2, 16, 2 * BENCH_SAMPLING_RATE))
+    {
+        snprintf(path, sizeof(path), "%s/bench_rmfAudioCapture_input.wav", gOptions.directory);
+        if (RMF_SUCCESS == capture_wav_write(path, 2, BENCH_SAMPLING_RATE, 16, kernel.pcm, (uint32_t)(kernel.frames * 4)))
+        {
+            setenv("INPUT_PRIMARY", path, 1);
+            setenv("INPUT_AUXILIARY", path, 0);
+        }
+        else
+        {
+            fprintf(stderr, "Unable to write %s, the HAL benchmarks need INPUT_PRIMARY with the mock\n", path);
+        }
+        kernelRelease(&kernel);
+    }
+}
+
+static double runTimeline(void *ctx)
+{
+    uint64_t start;
+
+    (void)ctx;
+    capture_timeline_discard();
+    start = nowNs();
+    for (uint32_t i = 0; i < BENCH_TIMELINE_EVENTS / 2; i++)
+    {
+        capture_timeline_begin("bench", "bytes", i);
+        capture_timeline_end("bench");
+    }
+    return (double)(nowNs() - start) / BENCH_TIMELINE_EVENTS;
+}
+
+/* Runs last, as it leaves the timeline recording */
+static void benchTimeline(void)
+{
+    if (!capture_timeline_enabled())
+    {
+        run("timeline_event_off", runTimeline, NULL, 0);
+    }
+    if (selected("timeline_event"))
+    {
+        capture_timeline_open(NULL);
+        run("timeline_event", runTimeline, NULL, 0);
+        capture_timeline_discard();
+    }
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [-w warmup] [-r repetitions] [-s seconds] [-n consumers] [-d directory] [-o metrics] [-c csv] [-b filter] [-l]\n", program);
+    fprintf(stderr, "  -w  Warmup repetitions discarded before measuring (default %d)\n", BENCH_WARMUP_DEFAULT);
+    fprintf(stderr, "  -r  Measured repetitions (default %d)\n", BENCH_REPS_DEFAULT);
+    fprintf(stderr, "  -s  Seconds of steady state capture for hal_delivery_interval, each coalescing batch, each settings_sweep point and each session_scaling step (default %d)\n", BENCH_SECONDS_DEFAULT);
+    fprintf(stderr, "  -n  Consumers the session_scaling ramp ends at, up to %d (default %d)\n", BENCH_SCALING_MAX, BENCH_SCALING_DEFAULT);
+    fprintf(stderr, "  -d  Directory for the files written (default /tmp)\n");
+    fprintf(stderr, "  -o  Metrics stream for the results, fd:<n> or file:<path> (default fd:1)\n");
+    fprintf(stderr, "  -c  Also writes the settings_sweep points to a CSV file\n");
+    fprintf(stderr, "  -b  Runs only the benchmarks whose name contains filter\n");
+    fprintf(stderr, "  -l  Lists the benchmarks\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *metrics = "fd:1";
+    int option;
+
+    gOptions.warmup = BENCH_WARMUP_DEFAULT;
+    gOptions.repetitions = BENCH_REPS_DEFAULT;
+    gOptions.seconds = BENCH_SECONDS_DEFAULT;
+    gOptions.consumers = BENCH_SCALING_DEFAULT;
+    gOptions.directory = "/tmp";
+
+    while ((option = getopt(argc, argv, "w:r:s:n:d:o:c:b:lh")) != -1)
+    {
+        switch (option)
+        {
+        case 'w':
+            gOptions.warmup = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            gOptions.repetitions = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            gOptions.seconds = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            gOptions.consumers = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            gOptions.directory = optarg;
+            break;
+        case 'o':
+            metrics = optarg;
+            break;
+        case 'c':
+            gOptions.csv = optarg;
+            break;
+        case 'b':
+            gOptions.filter = optarg;
+            break;
+        case 'l':
+            gOptions.list = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if ((gOptions.repetitions == 0) || (gOptions.seconds == 0) || (gOptions.consumers == 0) || (gOptions.consumers > BENCH_SCALING_MAX))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!gOptions.list && (RMF_SUCCESS != capture_metrics_open(metrics)))
+    {
+        fprintf(stderr, "Unable to open the metrics stream %s\n", metrics);
+        return 2;
+    }
+
+    prepareInput();
+    benchCallbacks();
+    benchPool();
+    benchKernels();
+    benchShm();
+    benchHal();
+    benchCoalesce();
+    benchSweep();
+    benchScaling();
+    benchTimeline();
+
+    capture_metrics_close();
+    return (gFailures > 0) ? 1 : 0;
+}
@@ -57,6 +57,8 @@ class rmfAudio_L1_L2_tests(utHelperClass):
 
         # Get path to device profile file
         self.moduleConfigProfileFile = os.path.join(dir_path, deviceTestSetup.get("profile"))
+        # Host file collecting the metrics records of every run, for comparing HAL releases
+        self.metricsFile = deviceTestSetup.get("metrics_file") or None
         # Get the target workspace
         self.targetWorkspace = os.path.join(targetWorkspace, moduleName)
 
@@ -80,7 +82,7 @@ class rmfAudio_L1_L2_tests(utHelperClass):
             testsuite_name = testsuite.get("name")
 
             # Create the dsVideoDevice class
-            testrmfaudio = rmfAudioClass(self.moduleConfigProfileFile, self.hal_session, testsuite_name, self.targetWorkspace, copyArtifacts)
+            testrmfaudio = rmfAudioClass(self.moduleConfigProfileFile, self.hal_session, testsuite_name, self.targetWorkspace, copyArtifacts, self.metricsFile)
             copyArtifacts = False
             test_cases = testsuite.get("test_cases")
 
@@ -35,6 +35,7 @@ from raft.framework.plugins.ut_raft.configRead import ConfigRead
 from raft.framework.plugins.ut_raft.utSuiteNavigator import UTSuiteNavigatorClass
 from raft.framework.plugins.ut_raft.interactiveShell import InteractiveShell
 from raft.framework.plugins.ut_raft.utBaseUtils import utBaseUtils
+from rmfAudioClasses.rmfAudioMetrics import rmfAudioMetricsClass
 
 class rmfAudioClass():
     """
@@ -43,13 +44,15 @@ class rmfAudioClass():
     This module provides common functionalities and extensions for RMF Audio Capture Module.
     """
 
-    def __init__(self, moduleConfigProfileFile:str, session=None, testSuite:str="L3 rmfAudioCapture", targetWorkspace="/tmp", copyArtifacts:bool=True ):
+    def __init__(self, moduleConfigProfileFile:str, session=None, testSuite:str="L3 rmfAudioCapture", targetWorkspace="/tmp", copyArtifacts:bool=True, metricsFile:str=None, telemetry=None ):
         """
         Initializes the rmfAudioClass instance with configuration settings.
 
         Args:
             moduleConfigProfileFile (str): Path to the device profile configuration file.
             session: Optional; session object for the user interface.
+            metricsFile (str, optional): Host file the metrics records of the test binary are appended to.
+            telemetry (rmfAudioTelemetryClass, optional): Reader of the live counters, served by the binary when given.
 
         Returns:
             None
@@ -63,6 +66,14 @@ class rmfAudioClass():
         self.testConfig    = ConfigRead(self.testConfigFile, self.moduleName)
         self.testConfig.test.execute = os.path.join(targetWorkspace, self.testConfig.test.execute)
         self.testConfig.test.execute = self.testConfig.test.execute + f" -p {os.path.basename(moduleConfigProfileFile)}"
+        # The binary writes its metrics records on the console next to the log, see rmfAudioMetricsClass
+        self.metrics       = rmfAudioMetricsClass(metricsFile)
+        self.lastMetrics   = []
+        self.jitterStart   = {}
+        self.testConfig.test.execute = f"{self.metrics.environment()} {self.testConfig.test.execute}"
+        self.telemetry     = telemetry
+        if telemetry is not None:
+            self.testConfig.test.execute = f"{telemetry.environment()} {self.testConfig.test.execute}"
         self.utMenu        = UTSuiteNavigatorClass(self.testConfig, None, session)
         self.testSession   = session
         self.utils         = utBaseUtils()
@@ -97,6 +108,20 @@ class rmfAudioClass():
             return match.group()
         return None
 
+    def selectMenu(self, *args):
+        """
+        Selects a menu entry and collects the metrics records from its output.
+
+        Args:
+            args: Arguments of UTSuiteNavigatorClass.select().
+
+        Returns:
+            str: Output of the menu entry.
+        """
+        output = self.utMenu.select(*args)
+        self.lastMetrics = self.metrics.ingest(output)
+        return output
+
     def checkAuxiliarySupport(self):
         """
         Check auxiliary interface support based on profile file
@@ -117,7 +142,7 @@ class rmfAudioClass():
         Returns:
             bool: True - test pass, False - test fails
         """
-        output = self.utMenu.select( self.testSuite, test_case, None, 25)
+        output = self.selectMenu( self.testSuite, test_case, None, 25)
         results = self.utMenu.collect_results(output)
         if results == None:
             results = False
@@ -142,7 +167,7 @@ class rmfAudioClass():
                     "input": str(capture_type)
                 }
         ]
-        result = self.utMenu.select( self.testSuite, "Open RMF Audio Capture Handle", promptWithAnswers)
+        result = self.selectMenu( self.testSuite, "Open RMF Audio Capture Handle", promptWithAnswers)
 
     def closeHandle(self, capture_type:int=1):
         """
@@ -163,7 +188,7 @@ class rmfAudioClass():
                     "input": str(capture_type)
                 }
         ]
-        result = self.utMenu.select(self.testSuite, "Close RMF Audio Capture Handle", promptWithAnswers)
+        result = self.selectMenu(self.testSuite, "Close RMF Audio Capture Handle", promptWithAnswers)
 
     def updateSettings(self, capture_type:int=1, settings_update:int=0, capture_format:int=1, sampling_rate:int=5, fifo_size:int=65536, threshold:int=8192):
         """
@@ -220,7 +245,7 @@ class rmfAudioClass():
                     "input": str(threshold)
                 })
 
-        result = self.utMenu.select(self.testSuite, "Get and update default settings", promptWithAnswers)
+        result = self.selectMenu(self.testSuite, "Get and update default settings", promptWithAnswers)
 
     def selectTestType(self, capture_type:int=1, test_type:int=1, datacapture_duration:int=10):
         """
@@ -228,7 +253,7 @@ class rmfAudioClass():
 
         Args:
             capture_type (int, optional): 1 for primary data capture (default), 2 for auxiliary data capture.
-            test_type (int, optional): Type of test about to be run : 1 for byte counting tests (default), 2 for data tracking tests where audio data is captured.
+            test_type (int, optional): Type of test about to be run : 1 for byte counting tests (default), 2 for data tracking tests where audio data is captured, 3 for data tracking tests that also compress the audio for a .flac output file.
             datacapture_duration (int, optional) : Test duration in seconds to capture audio data (default is 10 seconds)
 
         Returns:
@@ -247,7 +272,7 @@ class rmfAudioClass():
                 },
         ]
 
-        if test_type == 2:
+        if test_type in (2, 3):
             promptWithAnswers.append(
                 {
                     "query_type": "direct",
@@ -255,7 +280,7 @@ class rmfAudioClass():
                     "input": str(datacapture_duration)
                 })
 
-        result = self.utMenu.select(self.testSuite, "Select the type of test", promptWithAnswers)
+        result = self.selectMenu(self.testSuite, "Select the type of test", promptWithAnswers)
 
     def startCapture(self, capture_type:int=1):
         """
@@ -275,7 +300,7 @@ class rmfAudioClass():
                 }
         ]
 
-        result = self.utMenu.select(self.testSuite, "Start RMF Audio Capture", promptWithAnswers)
+        result = self.selectMenu(self.testSuite, "Start RMF Audio Capture", promptWithAnswers)
 
     def checkBytesReceived(self):
         """
@@ -287,7 +312,11 @@ class rmfAudioClass():
         Returns:
             int, int(optional) : Bytes received from primary data capture. Included auxiliary data capture if it is supported.
         """
-        result = self.utMenu.select(self.testSuite, "Check Bytes Received")
+        result = self.selectMenu(self.testSuite, "Check Bytes Received")
+        received = {record.get("capture"): str(record.get("bytes_received")) for record in self.metrics.get("received", records=self.lastMetrics)}
+        if received:
+            return received.get("primary"), received.get("auxiliary")
+
         bytes_received_string = r"Bytes Received for \w+ capture (\d+)(?:[^0-9]*Bytes Received for \w+ capture (\d+))?"
 
         matches = re.findall(bytes_received_string, result)
@@ -298,11 +327,11 @@ class rmfAudioClass():
 
     def writeWavFile(self, capture_type:int=1, file_path:str="/tmp/output.wav"):
         """ 
-        Writes captured audio data to a wav file
+        Writes captured audio data to a wav file, or a lossless flac file when file_path ends with ".flac" and test type 3 was selected
 
         Args:
             capture_type (int, optional): 1 for primary data capture (default), 2 for auxiliary data capture.
-            file_path (string, optional): File name and path of the output wav file to create (default is "/tmp/output.wav").
+            file_path (string, optional): File name and path of the output .wav or .flac file to create (default is "/tmp/output.wav").
 
         Returns:
             None
@@ -320,7 +349,7 @@ class rmfAudioClass():
                 }
         ]
 
-        result = self.utMenu.select(self.testSuite, "Write output wav file", promptWithAnswers)
+        result = self.selectMenu(self.testSuite, "Write output wav file", promptWithAnswers)
 
     def startJitterTest(self, capture_type:int=1, threshold:int=16384, jitter_interval:int=100000, jitter_test_duration:int=120):
         """
@@ -358,7 +387,8 @@ class rmfAudioClass():
                 }
         ]
 
-        result = self.utMenu.select(self.testSuite, "Start Jitter test", promptWithAnswers)
+        self.jitterStart[capture_type] = len(self.metrics.records)
+        result = self.selectMenu(self.testSuite, "Start Jitter test", promptWithAnswers)
 
     def checkJitterTestResult(self, capture_type:int=1):
         """
@@ -378,7 +408,13 @@ class rmfAudioClass():
                 }
         ]
 
-        result = self.utMenu.select(self.testSuite, "Check jitter test result", promptWithAnswers)
+        result = self.selectMenu(self.testSuite, "Check jitter test result", promptWithAnswers)
+        # The monitor reports its verdict in a record once it finishes, before the step returns
+        jitter = self.metrics.get("jitter", "primary" if capture_type == 1 else "auxiliary",
+                                  records=self.metrics.records[self.jitterStart.get(capture_type, 0):])
+        if jitter:
+            return jitter[-1].get("jitter") is False
+
         jitter_pattern = "Jitter Detected !"
 
         jitter_result = self.searchPattern(result, jitter_pattern)
@@ -405,7 +441,7 @@ class rmfAudioClass():
                 }
         ]
 
-        result = self.utMenu.select(self.testSuite, "Get current settings", promptWithAnswers)
+        result = self.selectMenu(self.testSuite, "Get current settings", promptWithAnswers)
         curr_settings_string = r'settings\.\w+:\[([^\]]+)\]'
 
         current_settings = re.findall(curr_settings_string, result)
@@ -430,7 +466,7 @@ class rmfAudioClass():
                 }
         ]
 
-        result = self.utMenu.select(self.testSuite, "Get RMF Audio Capture status", promptWithAnswers)
+        result = self.selectMenu(self.testSuite, "Get RMF Audio Capture status", promptWithAnswers)
         curr_status_string = r'status\.\w+:\[([^\]]+)\]'
 
         current_status = re.findall(curr_status_string, result)
@@ -455,7 +491,42 @@ class rmfAudioClass():
                 }
         ]
 
-        result = self.utMenu.select(self.testSuite, "Stop RMF Audio Capture", promptWithAnswers)
+        result = self.selectMenu(self.testSuite, "Stop RMF Audio Capture", promptWithAnswers)
+
+    def compareWavFiles(self, reference_path:str, file_path:str="/tmp/output.wav"):
+        """
+        Compares a captured wav file with its reference on the device
+
+        Args:
+            reference_path (str): Path of the reference wav file on the device.
+            file_path (str, optional): Path of the captured wav file on the device (default is "/tmp/output.wav").
+
+        Returns:
+            dict : analysis values reported by the device (match, frames, delay_samples, xcorr_peak, pitch_agreement,
+                   pitch_correlation, spectral_similarity, reference_hz, capture_hz, reference_cached, elapsed_ms),
+                   empty if the analysis failed
+        """
+        promptWithAnswers = [
+                {
+                    "query_type": "direct",
+                    "query": "Enter reference wav file name and location :",
+                    "input": str(reference_path)
+                },
+                {
+                    "query_type": "direct",
+                    "query": "Enter captured wav file name and location (example - /tmp/output.wav) :",
+                    "input": str(file_path)
+                }
+        ]
+
+        result = self.selectMenu(self.testSuite, "Compare output wav with reference", promptWithAnswers)
+        analysis_string = r'analysis\.(\w+):\[([^\]]+)\]'
+
+        analysis = dict(re.findall(analysis_string, result))
+        for flag in ("match", "reference_cached"):
+            if flag in analysis:
+                analysis[flag] = analysis[flag] == "true"
+        return analysis
 
     def __del__(self):
         """
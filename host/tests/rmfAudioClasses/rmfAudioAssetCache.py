@@ -0,0 +1,293 @@
+#!/usr/bin/env python3
+#** *****************************************************************************
+# *
+# * If not stated otherwise in this file or this component's LICENSE file the
+# * following copyright and licenses apply:
+# *
+# * Copyright 2024 RDK Management
+# *
+# * Licensed under the Apache License, Version 2.0 (the "License");
+# * you may not use this file except in compliance with the License.
+# * You may obtain a copy of the License at
+# *
+# *
+# http://www.apache.org/licenses/LICENSE-2.0
+# *
+# * Unless required by applicable law or agreed to in writing, software
+# * distributed under the License is distributed on an "AS IS" BASIS,
+# * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# * See the License for the specific language governing permissions and
+# * limitations under the License.
+# *
+#* ******************************************************************************
+
+import hashlib
+import json
+import os
+import shutil
+import sys
+import urllib.parse
+import urllib.request
+import urllib.error
+
+# Add parent directory to the system path for module imports
+dir_path = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(dir_path, "../"))
+
+from raft.framework.plugins.ut_raft.utBaseUtils import utBaseUtils
+
+class rmfAudioAssetCacheClass():
+    """
+    Content addressed cache of the L3 test streams.
+
+    Streams are fetched once into a host cache, stored as <cache>/<sha256>/<name>, and copied to
+    the device workspace only when the device copy is missing or its content differs. The source
+    is either a URL prefix or a local directory. The SHA-256 of every file is recorded in a host
+    manifest together with its size and modification time, so a file is only hashed again, on the
+    host or on the device, when one of those has changed.
+    """
+
+    MANIFEST = "manifest.json"
+    HASH_BLOCK = 1024 * 1024
+    DONE_MARKER = "__RMF_AUDIO_ASSETS_DONE__"
+
+    def __init__(self, session, targetWorkspace:str, source:str, cacheDirectory:str=None, deviceName:str="dut", timeout:int=120):
+        """
+        Initializes the cache.
+
+        Args:
+            session: Console session on the device, used for the shell commands and copies.
+            targetWorkspace (str): Directory on the device receiving the streams.
+            source (str): URL prefix or local directory the streams are taken from.
+            cacheDirectory (str, optional): Host cache directory, defaults to ~/.cache/rmfAudioCapture/streams.
+            deviceName (str, optional): Identifies the device in the manifest when several share a host cache.
+            timeout (int, optional): Seconds to wait for a device command.
+        """
+        self.session = session
+        self.targetWorkspace = targetWorkspace
+        self.source = source
+        self.deviceName = deviceName
+        self.timeout = timeout
+        self.utils = utBaseUtils()
+        if cacheDirectory is None:
+            cacheDirectory = os.path.join(os.path.expanduser("~"), ".cache", "rmfAudioCapture", "streams")
+        self.cacheDirectory = cacheDirectory
+        os.makedirs(self.cacheDirectory, exist_ok=True)
+        self.manifestPath = os.path.join(self.cacheDirectory, self.MANIFEST)
+        self.manifest = self._loadManifest()
+
+    def _loadManifest(self):
+        manifest = {"host": {}, "urls": {}, "device": {}}
+        try:
+            with open(self.manifestPath, "r") as file:
+                manifest.update(json.load(file))
+        except (OSError, ValueError):
+            pass
+        return manifest
+
+    def _saveManifest(self):
+        temporary = self.manifestPath + f".{os.getpid()}.tmp"
+        with open(temporary, "w") as file:
+            json.dump(self.manifest, file, indent=1, sort_keys=True)
+        os.replace(temporary, self.manifestPath)
+
+    def _localSource(self):
+        """
+        Returns the source directory when the source is local, otherwise None.
+        """
+        if self.source.startswith("file://"):
+            return urllib.parse.urlparse(self.source).path
+        if os.path.isdir(self.source):
+            return self.source
+        return None
+
+    def hostDigest(self, path:str):
+        """
+        Returns the SHA-256 of a host file, hashing it only when its size or modification time changed.
+
+        Args:
+            path (str): Host file.
+
+        Returns:
+            str: Hex digest.
+        """
+        info = os.stat(path)
+        key = os.path.realpath(path)
+        record = self.manifest["host"].get(key)
+        if record and record["size"] == info.st_size and record["mtime_ns"] == info.st_mtime_ns:
+            return record["sha256"]
+
+        digest = hashlib.sha256()
+        with open(path, "rb") as file:
+            for block in iter(lambda: file.read(self.HASH_BLOCK), b""):
+                digest.update(block)
+        self.manifest["host"][key] = {"size": info.st_size, "mtime_ns": info.st_mtime_ns, "sha256": digest.hexdigest()}
+        return digest.hexdigest()
+
+    def _fetch(self, stream:str):
+        """
+        Fetches a stream from a URL source into the host cache, revalidating with the server
+        through ETag and Last-Modified so an unchanged stream is not downloaded again.
+        """
+        url = self.source.rstrip("/") + "/" + stream
+        name = os.path.basename(stream)
+        record = self.manifest["urls"].get(url)
+        cached = os.path.join(self.cacheDirectory, record["sha256"], name) if record else None
+
+        request = urllib.request.Request(url)
+        if cached and os.path.exists(cached):
+            if record.get("etag"):
+                request.add_header("If-None-Match", record["etag"])
+            if record.get("last_modified"):
+                request.add_header("If-Modified-Since", record["last_modified"])
+        try:
+            response = urllib.request.urlopen(request, timeout=self.timeout)
+        except urllib.error.HTTPError as error:
+            if error.code == 304:
+                return cached
+            raise
+
+        partial = os.path.join(self.cacheDirectory, f".{name}.{os.getpid()}.part")
+        digest = hashlib.sha256()
+        with response, open(partial, "wb") as file:
+            for block in iter(lambda: response.read(self.HASH_BLOCK), b""):
+                digest.update(block)
+                file.write(block)
+            etag = response.headers.get("ETag")
+            lastModified = response.headers.get("Last-Modified")
+
+        objectDirectory = os.path.join(self.cacheDirectory, digest.hexdigest())
+        os.makedirs(objectDirectory, exist_ok=True)
+        cached = os.path.join(objectDirectory, name)
+        os.replace(partial, cached)
+        info = os.stat(cached)
+        self.manifest["host"][os.path.realpath(cached)] = {"size": info.st_size, "mtime_ns": info.st_mtime_ns, "sha256": digest.hexdigest()}
+        self.manifest["urls"][url] = {"sha256": digest.hexdigest(), "etag": etag, "last_modified": lastModified}
+        return cached
+
+    def hostPath(self, stream:str):
+        """
+        Returns a host file holding the stream, from the local source or the host cache.
+
+        Args:
+            stream (str): Stream path relative to the source.
+
+        Returns:
+            str: Host file path.
+        """
+        localSource = self._localSource()
+        if localSource is not None:
+            return os.path.join(localSource, stream)
+        return self._fetch(stream)
+
+    def _deviceCommand(self, command:str):
+        """
+        Runs a shell command on the device and returns its output. The quotes split the
+        marker in the echoed command line, so only the command output contains it whole.
+        """
+        marker = self.DONE_MARKER
+        self.session.write(f"{command}; echo {marker[:8]}\"\"{marker[8:]}")
+        output = self.session.read_until(marker, self.timeout)
+        # The echoed command line is returned too, callers only accept lines in their command's output format
+        return [line.strip() for line in output.splitlines() if marker not in line]
+
+    def _deviceStat(self, paths:list):
+        """
+        Returns the device time in seconds and {path: (size, mtime)} for the device files that exist.
+        """
+        quoted = " ".join(f"'{path}'" for path in paths)
+        now = 0
+        result = {}
+        for line in self._deviceCommand(f"date +%s; stat -c '%s %Y %n' {quoted} 2>/dev/null"):
+            fields = line.split(" ", 2)
+            if len(fields) == 1 and fields[0].isdigit():
+                now = int(fields[0])
+            elif len(fields) == 3 and fields[0].isdigit() and fields[1].isdigit():
+                result[fields[2]] = (int(fields[0]), int(fields[1]))
+        return now, result
+
+    def _deviceDigests(self, paths:list):
+        """
+        Returns {path: sha256} computed on the device.
+        """
+        if not paths:
+            return {}
+        quoted = " ".join(f"'{path}'" for path in paths)
+        result = {}
+        for line in self._deviceCommand(f"sha256sum {quoted} 2>/dev/null"):
+            fields = line.split(None, 1)
+            if len(fields) == 2 and len(fields[0]) == 64:
+                result[fields[1].lstrip("*")] = fields[0]
+        return result
+
+    def _deviceKey(self, path:str):
+        return f"{self.deviceName}:{path}"
+
+    def sync(self, streams:list):
+        """
+        Makes the device workspace hold the given streams, copying only missing or changed ones.
+
+        Args:
+            streams (list): Stream paths relative to the source.
+
+        Returns:
+            list: Device paths of the streams, in the same order.
+        """
+        wanted = {}
+        for stream in streams:
+            hostFile = self.hostPath(stream)
+            devicePath = os.path.join(self.targetWorkspace, os.path.basename(stream))
+            wanted[devicePath] = (hostFile, self.hostDigest(hostFile))
+
+        # Device files whose size and time match the last verified copy are trusted, the others are hashed
+        now, stats = self._deviceStat(list(wanted))
+        unverified = []
+        current = set()
+        for devicePath, (hostFile, digest) in wanted.items():
+            record = self.manifest["device"].get(self._deviceKey(devicePath))
+            if devicePath not in stats:
+                continue
+            size, mtime = stats[devicePath]
+            if record and record["sha256"] == digest and record["size"] == size and record["mtime"] == mtime and not record.get("racy", True):
+                current.add(devicePath)
+            else:
+                unverified.append(devicePath)
+        for devicePath, deviceDigest in self._deviceDigests(unverified).items():
+            if devicePath in wanted and deviceDigest == wanted[devicePath][1]:
+                current.add(devicePath)
+
+        copied = []
+        for devicePath, (hostFile, digest) in wanted.items():
+            if devicePath in current:
+                continue
+            # The copy keeps the host file name, which the cache layout preserves
+            self.utils.scpCopy(self.session, hostFile, self.targetWorkspace)
+            copied.append(devicePath)
+        verified = self._deviceDigests(copied)
+        for devicePath in copied:
+            if verified.get(devicePath) != wanted[devicePath][1]:
+                raise RuntimeError(f"Stream {devicePath} does not match its source after the copy")
+
+        # Record the size and time of every verified device copy for the next run. The time only has a
+        # resolution of a second, so a copy modified in the second it was verified is hashed again next time
+        now, stats = self._deviceStat(list(wanted))
+        for devicePath in current.union(copied):
+            if devicePath in stats:
+                size, mtime = stats[devicePath]
+                self.manifest["device"][self._deviceKey(devicePath)] = {"sha256": wanted[devicePath][1], "size": size, "mtime": mtime,
+                                                                        "racy": mtime >= now}
+        self._saveManifest()
+        return list(wanted)
+
+    def prune(self):
+        """
+        Removes host cache objects that are no longer referenced by a URL entry.
+        """
+        referenced = {record["sha256"] for record in self.manifest["urls"].values()}
+        for entry in os.listdir(self.cacheDirectory):
+            path = os.path.join(self.cacheDirectory, entry)
+            if os.path.isdir(path) and len(entry) == 64 and entry not in referenced:
+                for name in os.listdir(path):
+                    self.manifest["host"].pop(os.path.realpath(os.path.join(path, name)), None)
+                shutil.rmtree(path, ignore_errors=True)
+        self._saveManifest()
@@ -0,0 +1,277 @@
+#!/usr/bin/env python3
+#** *****************************************************************************
+# *
+# * If not stated otherwise in this file or this component's LICENSE file the
+# * following copyright and licenses apply:
+# *
+# * Copyright 2024 RDK Management
+# *
+# * Licensed under the Apache License, Version 2.0 (the "License");
+# * you may not use this file except in compliance with the License.
+# * You may obtain a copy of the License at
+# *
+# *
+# http://www.apache.org/licenses/LICENSE-2.0
+# *
+# * Unless required by applicable law or agreed to in writing, software
+# * distributed under the License is distributed on an "AS IS" BASIS,
+# * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# * See the License for the specific language governing permissions and
+# * limitations under the License.
+# *
+#* ******************************************************************************
+
+import json
+import os
+import sys
+
+# Add parent directory to the system path for module imports
+dir_path = os.path.dirname(os.path.realpath(__file__))
+sys.path.append(os.path.join(dir_path, "../"))
+
+from raft.framework.plugins.ut_raft.configRead import ConfigRead
+from raft.framework.plugins.ut_raft.interactiveShell import InteractiveShell
+from raft.framework.plugins.ut_raft.utBaseUtils import utBaseUtils
+from rmfAudioClasses.rmfAudioMetrics import rmfAudioMetricsClass
+
+class rmfAudioControlClass():
+    """
+    RMF Audio Capture control channel class.
+
+    Drives the L3 steps of the test binary through its line-delimited JSON control
+    channel (RMF_AUDIOCAPTURE_CONTROL=stdio) instead of navigating the interactive menu.
+    The public methods mirror rmfAudioClass so test cases can use either class.
+    """
+
+    ANALYSE_TIMEOUT = 300  # Seconds an uncached reference may take to analyse on a slow device
+
+    def __init__(self, moduleConfigProfileFile:str, session=None, testSuite:str="L3 rmfAudioCapture", targetWorkspace="/tmp", copyArtifacts:bool=True, timeout:int=30, metricsFile:str=None, telemetry=None ):
+        """
+        Initializes the rmfAudioControlClass instance and starts the test binary in control mode.
+
+        Args:
+            moduleConfigProfileFile (str): Path to the device profile configuration file.
+            session: Optional; session object for the user interface.
+            testSuite (str, optional): Unused, kept for compatibility with rmfAudioClass.
+            targetWorkspace (str, optional): Workspace on the device holding the test binary.
+            copyArtifacts (bool, optional): Copy the binaries and profile to the device.
+            timeout (int, optional): Seconds to wait for a response to a command, blocking commands add their own duration to it.
+            metricsFile (str, optional): Host file the metrics records of the test binary are appended to.
+            telemetry (rmfAudioTelemetryClass, optional): Reader of the live counters, served by the binary when given.
+
+        Returns:
+            None
+        """
+        self.moduleName = "rmfaudiocapture"
+        self.testConfigFile = os.path.join(dir_path, "rmfAudio_testConfig.yml")
+        self.testSuite = testSuite
+        self.timeout = timeout
+        self.jitterDuration = {}
+
+        # Load configurations for device profile and menu
+        self.moduleConfigProfile = ConfigRead( moduleConfigProfileFile , self.moduleName)
+        self.testConfig    = ConfigRead(self.testConfigFile, self.moduleName)
+        self.testSession   = session
+        self.utils         = utBaseUtils()
+        self.responses     = []
+        self.metrics       = rmfAudioMetricsClass(metricsFile)
+        self.telemetry     = telemetry
+
+        if copyArtifacts:
+            for artifact in self.testConfig.test.artifacts:
+                filesPath = os.path.join(dir_path, artifact)
+                self.utils.rsync(self.testSession, filesPath, targetWorkspace)
+
+            # Copy the profile file to the target
+            self.utils.scpCopy(self.testSession, moduleConfigProfileFile, targetWorkspace)
+
+        execute = os.path.join(targetWorkspace, self.testConfig.test.execute)
+        execute = execute + f" -p {os.path.basename(moduleConfigProfileFile)}"
+        if telemetry is not None:
+            execute = f"{telemetry.environment()} {execute}"
+        self.testSession.write(f"RMF_AUDIOCAPTURE_CONTROL=stdio {self.metrics.environment()} {execute}")
+
+    def sendCommand(self, cmd:str, capture_type:int=1, timeout:int=None, **kwargs):
+        """
+        Sends one command over the control channel and waits for its response.
+
+        Args:
+            cmd (str): Command name, e.g. "open", "start", "jitter_result".
+            capture_type (int, optional): 1 for primary data capture (default), 2 for auxiliary data capture.
+            timeout (int, optional): Seconds to wait for the response, the class timeout when None.
+            kwargs: Additional command parameters.
+
+        Returns:
+            dict: Parsed response, an empty dict if no response was received.
+        """
+        request = {"cmd": cmd, "type": capture_type}
+        request.update(kwargs)
+        self.testSession.write(json.dumps(request, separators=(',', ':')))
+
+        # Responses echo the command name first, which lets us skip log output and echoed input
+        marker = '{"cmd":' + json.dumps(cmd)
+        if timeout is None:
+            timeout = self.timeout
+        output = self.testSession.read_until('"result":', timeout)
+        output += self.testSession.read_until('}', self.timeout)
+        self.metrics.ingest(output)
+        for line in reversed(output.splitlines()):
+            start = line.find(marker)
+            if start < 0:
+                continue
+            try:
+                response = json.loads(line[start:])
+            except ValueError:
+                continue
+            self.responses.append(response)
+            return response
+        return {}
+
+    def commandSucceeded(self, response:dict):
+        """
+        Checks whether a control channel response reports success.
+
+        Args:
+            response (dict): Response returned by sendCommand().
+
+        Returns:
+            bool: True if the step returned RMF_SUCCESS.
+        """
+        return response.get("result") == "RMF_SUCCESS"
+
+    def checkAuxiliarySupport(self):
+        """
+        Check auxiliary interface support based on profile file
+
+        Returns:
+            bool : true/false based on auxsupport value in profile file yaml
+        """
+        return self.moduleConfigProfile.get("features").get("auxsupport")
+
+    def openHandle(self, capture_type:int=1):
+        """
+        Opens the RMF audio capture interface and gets a handle.
+        """
+        return self.commandSucceeded(self.sendCommand("open", capture_type))
+
+    def closeHandle(self, capture_type:int=1):
+        """
+        Closes RMF Audio Capture interface.
+        """
+        return self.commandSucceeded(self.sendCommand("close", capture_type))
+
+    def updateSettings(self, capture_type:int=1, settings_update:int=0, capture_format:int=1, sampling_rate:int=5, fifo_size:int=65536, threshold:int=8192):
+        """
+        Loads default RMF_AudioCapture_Settings and updates them if required.
+
+        Args are the same as rmfAudioClass.updateSettings(), -1 retains the default value.
+        """
+        if settings_update == 1:
+            response = self.sendCommand("settings", capture_type, format=capture_format, samplingFreq=sampling_rate, fifoSize=fifo_size, threshold=threshold)
+        else:
+            response = self.sendCommand("settings", capture_type)
+        return self.commandSucceeded(response)
+
+    def selectTestType(self, capture_type:int=1, test_type:int=1, datacapture_duration:int=10):
+        """
+        Selects the type of test, to set up data callbacks for counting, capture tests
+        """
+        return self.commandSucceeded(self.sendCommand("setup", capture_type, test=test_type, duration=datacapture_duration))
+
+    def startCapture(self, capture_type:int=1):
+        """
+        Starts RMF Audio Capture
+        """
+        return self.commandSucceeded(self.sendCommand("start", capture_type))
+
+    def checkBytesReceived(self):
+        """
+        Checks bytes received for both primary and auxiliary data captures
+
+        Returns:
+            str, str : Bytes received from primary and auxiliary data capture.
+        """
+        response = self.sendCommand("bytes")
+        return str(response.get("primary")), str(response.get("auxiliary"))
+
+    def writeWavFile(self, capture_type:int=1, file_path:str="/tmp/output.wav"):
+        """
+        Writes captured audio data to a wav file
+        """
+        return self.commandSucceeded(self.sendCommand("write", capture_type, path=file_path))
+
+    def startJitterTest(self, capture_type:int=1, threshold:int=16384, jitter_interval:int=100000, jitter_test_duration:int=120):
+        """
+        Starts jitter test with required parameters for test
+        """
+        self.jitterDuration[capture_type] = jitter_test_duration
+        return self.commandSucceeded(self.sendCommand("jitter_start", capture_type, threshold=threshold, interval=jitter_interval, duration=jitter_test_duration))
+
+    def checkJitterTestResult(self, capture_type:int=1):
+        """
+        Gets the result of jitter test
+
+        Returns:
+            bool : True if no jitter was detected
+        """
+        # The step blocks until the monitor thread finishes, allow for the full test duration
+        response = self.sendCommand("jitter_result", capture_type, timeout=self.jitterDuration.get(capture_type, 0) + self.timeout)
+        return self.commandSucceeded(response) and response.get("jitter") is False
+
+    def getCurrentSettings(self, capture_type:int=1):
+        """
+        Gets current RMF audio capture settings
+
+        Returns:
+            dict : fifoSize, threshold, format, samplingFreq and delayCompensation_ms
+        """
+        return self.sendCommand("current_settings", capture_type)
+
+    def getStatus(self, capture_type:int=1):
+        """
+        Gets RMF audio capture status
+
+        Returns:
+            dict : started, format, samplingFreq, fifoDepth, overflows and underflows
+        """
+        return self.sendCommand("status", capture_type)
+
+    def stopCapture(self, capture_type:int=1):
+        """
+        Stops audio capture
+        """
+        return self.commandSucceeded(self.sendCommand("stop", capture_type))
+
+    def compareWavFiles(self, reference_path:str, file_path:str="/tmp/output.wav"):
+        """
+        Compares a captured wav file with its reference on the device
+
+        Returns:
+            dict : analysis values reported by the device, see rmfAudioClass.compareWavFiles()
+        """
+        # Extracting the reference features is slow until they are cached on the device
+        response = self.sendCommand("analyse", reference=reference_path, path=file_path, timeout=self.ANALYSE_TIMEOUT)
+        if not self.commandSucceeded(response):
+            return {}
+        return response
+
+    def __del__(self):
+        """
+        Stops the control channel.
+        """
+        self.sendCommand("quit")
+
+# Test and example usage code
+if __name__ == '__main__':
+
+    shell = InteractiveShell()
+    shell.open()
+
+    platformProfile = dir_path + "/../../../profiles/rmfAudioCaptureAuxSupported.yaml"
+    test = rmfAudioControlClass(platformProfile, shell)
+
+    test.openHandle(1)
+
+    test.closeHandle(1)
+
+    shell.close()
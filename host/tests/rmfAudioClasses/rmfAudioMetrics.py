@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+#** *****************************************************************************
+# *
+# * If not stated otherwise in this file or this component's LICENSE file the
+# * following copyright and licenses apply:
+# *
+# * Copyright 2024 RDK Management
+# *
+# * Licensed under the Apache License, Version 2.0 (the "License");
+# * you may not use this file except in compliance with the License.
+# * You may obtain a copy of the License at
+# *
+# *
+# http://www.apache.org/licenses/LICENSE-2.0
+# *
+# * Unless required by applicable law or agreed to in writing, software
+# * distributed under the License is distributed on an "AS IS" BASIS,
+# * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# * See the License for the specific language governing permissions and
+# * limitations under the License.
+# *
+#* ******************************************************************************
+
+import json
+
+class rmfAudioMetricsClass():
+    """
+    Collects the metrics records of the test binary.
+
+    With RMF_AUDIOCAPTURE_METRICS=fd:1 the binary writes one JSON object per line on its
+    console output next to the log, each starting with its "metric" kind. The records are
+    picked out of every output read from the device, kept in order and, when a file is
+    given, appended to it so results can be compared across HAL releases.
+    """
+
+    ENV = "RMF_AUDIOCAPTURE_METRICS"
+    MARKER = '{"metric":'
+
+    def __init__(self, metricsFile:str=None):
+        """
+        Initializes the collector.
+
+        Args:
+            metricsFile (str, optional): Host file the records are appended to as JSON lines.
+        """
+        self.records = []
+        self.metricsFile = metricsFile
+
+    def environment(self):
+        """
+        Returns the environment assignment to prefix the test binary command with.
+        """
+        return f"{self.ENV}=fd:1"
+
+    def ingest(self, output:str):
+        """
+        Collects the records found in console output.
+
+        Args:
+            output (str): Output read from the device.
+
+        Returns:
+            list: Records found in the output, in order.
+        """
+        found = []
+        if not output:
+            return found
+        for line in output.splitlines():
+            start = line.find(self.MARKER)
+            if start < 0:
+                continue
+            try:
+                record = json.loads(line[start:].strip())
+            except ValueError:
+                # A record split across two reads is skipped, the log still holds its values
+                continue
+            found.append(record)
+
+        self.records.extend(found)
+        if found and self.metricsFile:
+            with open(self.metricsFile, "a") as file:
+                for record in found:
+                    file.write(json.dumps(record, separators=(',', ':')) + "\n")
+        return found
+
+    def get(self, metric:str=None, capture:str=None, test:str=None, records:list=None):
+        """
+        Returns the collected records matching the given fields.
+
+        Args:
+            metric (str, optional): Record kind, e.g. "bytes", "window" or "jitter".
+            capture (str, optional): "primary" or "auxiliary".
+            test (str, optional): Test that produced the records.
+            records (list, optional): Records to filter, defaults to all collected records.
+
+        Returns:
+            list: Matching records, oldest first.
+        """
+        if records is None:
+            records = self.records
+        return [record for record in records
+                if (metric is None or record.get("metric") == metric)
+                and (capture is None or record.get("capture") == capture)
+                and (test is None or record.get("test") == test)]
+
+    def last(self, metric:str, capture:str=None, test:str=None):
+        """
+        Returns the most recent matching record, or None.
+        """
+        matching = self.get(metric, capture, test)
+        return matching[-1] if matching else None
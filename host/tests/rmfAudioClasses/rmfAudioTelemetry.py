@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+#** *****************************************************************************
+# *
+# * If not stated otherwise in this file or this component's LICENSE file the
+# * following copyright and licenses apply:
+# *
+# * Copyright 2024 RDK Management
+# *
+# * Licensed under the Apache License, Version 2.0 (the "License");
+# * you may not use this file except in compliance with the License.
+# * You may obtain a copy of the License at
+# *
+# *
+# http://www.apache.org/licenses/LICENSE-2.0
+# *
+# * Unless required by applicable law or agreed to in writing, software
+# * distributed under the License is distributed on an "AS IS" BASIS,
+# * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# * See the License for the specific language governing permissions and
+# * limitations under the License.
+# *
+#* ******************************************************************************
+
+import time
+
+from rmfAudioClasses.rmfAudioMetrics import rmfAudioMetricsClass
+
+class rmfAudioTelemetryClass():
+    """
+    Reads the live counters of the test binary while a capture runs.
+
+    With RMF_AUDIOCAPTURE_TELEMETRY=unix:<path> the binary sends a snapshot of its captures to
+    every client connecting to path, one "telemetry" record per capture in the format of the
+    metrics records. The console running the binary is busy, so the snapshots are read over a
+    second console session on the device, with a client command, socat by default.
+    """
+
+    ENV = "RMF_AUDIOCAPTURE_TELEMETRY"
+    END = "TELEMETRY_END"
+
+    def __init__(self, session, socketPath:str="/tmp/rmfAudioCapture.telemetry", client:str="socat -u UNIX-CONNECT:{path} -", timeout:int=5, metricsFile:str=None):
+        """
+        Initializes the reader.
+
+        Args:
+            session: Console session on the device, other than the one running the test binary.
+            socketPath (str, optional): Socket the binary serves the counters on.
+            client (str, optional): Device command printing what the socket sends, {path} is replaced by socketPath.
+            timeout (int, optional): Seconds to wait for a snapshot.
+            metricsFile (str, optional): Host file the snapshots are appended to, with the metrics records.
+        """
+        self.session = session
+        self.socketPath = socketPath
+        self.client = client
+        self.timeout = timeout
+        self.metrics = rmfAudioMetricsClass(metricsFile)
+
+    def environment(self):
+        """
+        Returns the environment assignment to prefix the test binary command with.
+        """
+        return f"{self.ENV}=unix:{self.socketPath}"
+
+    def snapshot(self):
+        """
+        Reads the counters of every capture.
+
+        Returns:
+            dict: "telemetry" record of each capture by capture name, empty if none could be read.
+        """
+        # The quotes keep the echoed command from matching the end marker
+        self.session.write(self.client.format(path=self.socketPath) + f'; echo {self.END[:-3]}""{self.END[-3:]}')
+        output = self.session.read_until(self.END, self.timeout)
+        records = self.metrics.ingest(output)
+        return {record.get("capture"): record for record in self.metrics.get("telemetry", records=records)}
+
+    def watch(self, duration:float, captures:list, interval:float=5, maxGapMs:float=1000):
+        """
+        Watches captures for up to duration seconds, ending as soon as one of them fails.
+
+        A capture fails when it is no longer started, when no callback has arrived for
+        maxGapMs, or when its FIFO has overflowed. A capture missing from a snapshot, for
+        example with a binary that does not serve telemetry, is not checked.
+
+        Args:
+            duration (float): Seconds to watch for.
+            captures (list): Capture names, "primary" and or "auxiliary".
+            interval (float, optional): Seconds between snapshots.
+            maxGapMs (float, optional): Longest time without a callback.
+
+        Returns:
+            str: Why a capture failed, None if they ran for the whole duration.
+        """
+        end = time.time() + duration
+        while True:
+            remaining = end - time.time()
+            if remaining <= 0:
+                return None
+            time.sleep(min(interval, remaining))
+            snapshot = self.snapshot()
+            for capture in captures:
+                record = snapshot.get(capture)
+                if record is None:
+                    continue
+                if not record.get("started"):
+                    return f"{capture} capture is not started"
+                sinceLastMs = record.get("since_last_ns", 0) / 1e6
+                if sinceLastMs > maxGapMs:
+                    return f"no {capture} callback for {sinceLastMs:.0f} ms"
+                if record.get("overflows", 0) > 0:
+                    return f"{capture} FIFO overflowed {record.get('overflows')} times"
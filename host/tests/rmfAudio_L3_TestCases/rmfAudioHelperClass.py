@@ -24,10 +24,6 @@
 import os
 import sys
 import time
-import librosa
-import numpy as np
-import paramiko
-import io
 
 dir_path = os.path.dirname(os.path.realpath(__file__))
 sys.path.append(os.path.join(dir_path, "../"))
@@ -38,6 +34,9 @@ from raft.framework.plugins.ut_raft.configRead import ConfigRead
 from raft.framework.plugins.ut_raft.utUserResponse import utUserResponse
 from raft.framework.core.logModule import logModule
 from rmfAudioClasses.rmfAudio import rmfAudioClass
+from rmfAudioClasses.rmfAudioControl import rmfAudioControlClass
+from rmfAudioClasses.rmfAudioAssetCache import rmfAudioAssetCacheClass
+from rmfAudioClasses.rmfAudioTelemetry import rmfAudioTelemetryClass
 
 class rmfAudioHelperClass(utHelperClass):
     """
@@ -96,13 +95,31 @@ class rmfAudioHelperClass(utHelperClass):
         self.targetWorkspace = self.cpe.get("target_directory")
         self.targetWorkspace = os.path.join(self.targetWorkspace, self.moduleName)
         self.streamDownloadURL = deviceTestSetup.get("streams_download_url")
+        # Drive the L3 steps over the JSON control channel instead of the interactive menu
+        self.useControlChannel = bool(deviceTestSetup.get("control_channel"))
+        # Host file collecting the metrics records of every run, for comparing HAL releases
+        self.metricsFile = deviceTestSetup.get("metrics_file") or None
+        # Watch the live counters of the binary over a second console while captures run
+        self.telemetry = None
+        if deviceTestSetup.get("telemetry"):
+            self.telemetry = rmfAudioTelemetryClass(self.dut.getConsoleSession("ssh_telemetry"), metricsFile=self.metricsFile)
+
+        # Keep the streams on the device between tests and copy only missing or changed ones.
+        # A local source directory is always served through the cache, it cannot be downloaded by URL
+        self.assetCache = None
+        if self.streamDownloadURL and (deviceTestSetup.get("streams_cache") or os.path.isdir(self.streamDownloadURL)
+                                       or self.streamDownloadURL.startswith("file://")):
+            self.assetCache = rmfAudioAssetCacheClass(self.hal_session, self.targetWorkspace, self.streamDownloadURL,
+                                                      deviceTestSetup.get("streams_cache_directory") or None, self.rackDevice)
+        self.keepAssets = bool(deviceTestSetup.get("streams_cache"))
 
     def testDownloadAssets(self):
         """
         Downloads the test artifacts and streams listed in the test setup configuration.
 
         This function retrieves audio streams and other necessary files and
-        saves them on the DUT (Device Under Test).
+        saves them on the DUT (Device Under Test). With the stream cache, streams
+        already on the DUT with the same content are not transferred again.
 
         Args:
             None
@@ -114,6 +131,10 @@ class rmfAudioHelperClass(utHelperClass):
 
         streamPaths = self.testSetup.get("assets").get("device").get(self.testName).get("streams")
 
+        if streamPaths and self.assetCache:
+            self.testStreams = self.assetCache.sync(streamPaths)
+            return
+
         # Download test streams to device
         if streamPaths and self.streamDownloadURL:
             for streamPath in streamPaths:
@@ -124,10 +145,13 @@ class rmfAudioHelperClass(utHelperClass):
     def testCleanAssets(self):
         """
         Removes the downloaded assets and test streams from the DUT after test execution.
+        Cached streams are kept for the next test.
 
         Args:
             None
         """
+        if self.keepAssets:
+            return
         self.deleteFromDevice(self.testStreams)
 
     def testRunPrerequisites(self):
@@ -164,114 +188,86 @@ class rmfAudioHelperClass(utHelperClass):
         self.testRunPrerequisites()
 
         # Create the rmfaudiocapture class
-        self.testrmfAudio = rmfAudioClass(self.moduleConfigProfileFile, self.hal_session, self.testsuite, self.targetWorkspace)
+        if self.useControlChannel:
+            self.testrmfAudio = rmfAudioControlClass(self.moduleConfigProfileFile, self.hal_session, self.testsuite, self.targetWorkspace,
+                                                     metricsFile=self.metricsFile, telemetry=self.telemetry)
+        else:
+            self.testrmfAudio = rmfAudioClass(self.moduleConfigProfileFile, self.hal_session, self.testsuite, self.targetWorkspace,
+                                              metricsFile=self.metricsFile, telemetry=self.telemetry)
 
         return True
 
-    def extract_pitch(self, y):
+    def waitForCapture(self, duration:float, captures:list):
         """
-        Extracts the pitch from an audio signal using the YIN algorithm.
-    
-        This function applies the YIN algorithm to estimate the pitch 
-        of the given audio signal over time. The pitch values are returned 
-        as a NumPy array.
+        Lets the captures run for duration seconds.
+
+        With telemetry, the captures are watched while they run and the wait ends as soon
+        as one of them stalls, stops or overflows, instead of at the end of the duration.
 
         Args:
-            y (NumPy array) : The audio time series (waveform) as a 1D NumPy array.
+            duration (float): Seconds to wait for.
+            captures (list): Capture names, "primary" and or "auxiliary".
 
         Returns:
-            A NumPy array containing the estimated pitch values 
-                (in Hz) for each frame. Frames with no detected pitch 
-                will be represented as NaN.
+            str: Why the wait ended early, None if it lasted the duration.
         """
-        # Apply the YIN algorithm to estimate the pitch
-        pitches = librosa.yin(y, fmin=librosa.note_to_hz('C2'), fmax=librosa.note_to_hz('C7'))
-        
-        # Use NaN for frames with no detected pitch
-        return np.array(pitches)
+        if self.telemetry is None:
+            time.sleep(duration)
+            return None
+        return self.telemetry.watch(duration, captures)
 
-    def compare_pitches(self, pitch1, pitch2):
+    def finishJitterTest(self, capture_type:int, failure:str):
         """
-        Compares two pitch arrays and calculates the correlation.
-    
-        This function aligns two pitch arrays to the same length and 
-        computes the Pearson correlation coefficient between them.
+        Stops a capture whose jitter monitor was started and collects the monitor.
+
+        When the wait ended early, stopping the capture ends the monitor thread early too.
+        It is still collected so it is not left running, but its verdict does not count.
 
         Args:
-            pitch1, pitch2 (NumPy array) : contains the pitch values from two audio files
+            capture_type (int): Capture type, 1 for primary and 2 for auxiliary.
+            failure (str): Why waitForCapture() ended early, None if it lasted the duration.
 
         Returns:
-            correlation: The Pearson correlation coefficient between the two pitch 
-                arrays, ranging from -1 to 1, where 1 indicates a perfect 
-                positive correlation, -1 indicates a perfect negative 
-                correlation, and 0 indicates no correlation.
+            bool: The jitter verdict, False when the wait ended early.
         """
-        # Align lengths
-        min_length = min(len(pitch1), len(pitch2))
-        pitch1 = pitch1[:min_length]
-        pitch2 = pitch2[:min_length]
-
-        # Calculate correlation or mean squared error
-        correlation = np.corrcoef(pitch1, pitch2)[0, 1]
-        return correlation
+        result = False
+        if failure is None:
+            result = self.testrmfAudio.checkJitterTestResult(capture_type)
+        self.testrmfAudio.stopCapture(capture_type)
+        if failure is not None:
+            self.testrmfAudio.checkJitterTestResult(capture_type)
+        return result
 
     def compareWavFiles(self, url, file_path):
         """
-        Compares the pitch of two audio files and determines if they match.
+        Compares a captured audio file against its reference and determines if they match.
 
-        This function loads two audio files from remote location, extracts their pitch using the YIN algorithm,
-        and calculates the correlation between the extracted pitches. If the correlation 
-        exceeds a specified threshold, it concludes that the audio files match.
+        The comparison runs in the test binary on the device: both files are reduced to
+        dominant-frequency tracks and spectral fingerprints, aligned by cross-correlation
+        and compared, so only the analysis result is returned to the host. The reference
+        features are cached on the device after the first test that uses the stream.
 
         Args:
-            file1, file2: The paths to audio files for comparison.
+            url (str): Path of the reference audio file on the device.
+            file_path (str): Path of the captured audio file on the device.
 
         Returns:
-            None
+            bool: True if the captured audio matches the reference
         """
-        threshold=0.95 # Set threshold for comparison
-
-        host = self.hal_session.address
-        port = self.hal_session.port
-        username = self.hal_session.username
-        password = self.hal_session.password
-
-        ssh = paramiko.SSHClient()
-        ssh.set_missing_host_key_policy(paramiko.AutoAddPolicy())
-        ssh.connect(hostname=host, port=port, username=username, password=password)
-
-        sftp = ssh.open_sftp()
-
-        with sftp.open(url, 'r') as remote_file:
-            ref_content = remote_file.read()
-
-        with sftp.open(file_path, 'r') as remote_file:
-            wav_content = remote_file.read()
-
-        sftp.close()
-        ssh.close()
-
-        # Create a BytesIO object from the bytes
-        wav_file_content = io.BytesIO(wav_content)
-        ref_file_content = io.BytesIO(ref_content)
-
-        # Load the audio files
-        y1, sr1 = librosa.load(ref_file_content)
-        y2, sr2 = librosa.load(wav_file_content)
+        analysis = self.testrmfAudio.compareWavFiles(url, file_path)
+        if not analysis:
+            print("Unable to analyse the audio files")
+            return False
 
-        # Extract pitch from both audio files
-        pitch1 = self.extract_pitch(y1)
-        pitch2 = self.extract_pitch(y2)
+        print(f"Analysis: pitch agreement {analysis.get('pitch_agreement')}, spectral similarity {analysis.get('spectral_similarity')}, "
+              f"delay {analysis.get('delay_samples')} samples, reference {analysis.get('reference_hz')} Hz, capture {analysis.get('capture_hz')} Hz, "
+              f"reference features cached {analysis.get('reference_cached')}")
 
-        # Compare pitches
-        correlation = self.compare_pitches(pitch1, pitch2)
-        
-        # Determine if they match based on the threshold
-        if correlation >= threshold:
-            print(f"The audio files match with a correlation of {correlation:.2f}")
+        if analysis.get("match") is True:
+            print("The audio files match")
             return True
         else:
-            print(f"The audio files do not match (correlation: {correlation:.2f})")
+            print("The audio files do not match")
             return False
 
     def testEndFunction(self, powerOff=True):
@@ -84,13 +84,12 @@ class rmfAudio_test02_primaryJitterTest(rmfAudioHelperClass):
         self.testrmfAudio.startCapture(capture_type)
         self.testrmfAudio.startJitterTest(capture_type, threshold, jitter_interval, jitter_test_duration)
         
-        time.sleep(jitter_test_duration)
+        failure = self.waitForCapture(jitter_test_duration, ["primary"])
 
-        result = self.testrmfAudio.checkJitterTestResult(capture_type)
-        self.testrmfAudio.stopCapture(capture_type)
+        result = self.finishJitterTest(capture_type, failure)
         self.testPlayer.stop()
         self.testrmfAudio.closeHandle(capture_type)
-        self.log.stepResult(result, 'Primary jitter test')
+        self.log.stepResult(result, 'Primary jitter test' if failure is None else f'Primary jitter test ended early: {failure}')
 
         return result
 
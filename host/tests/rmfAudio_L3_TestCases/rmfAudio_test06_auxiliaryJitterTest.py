@@ -90,13 +90,12 @@ class rmfAudio_test06_auxiliaryJitterTest(rmfAudioHelperClass):
             time.sleep(0.1)
             self.testrmfAudio.startJitterTest(capture_type, threshold, jitter_interval, jitter_test_duration)
             
-            time.sleep(jitter_test_duration)
-            result = self.testrmfAudio.checkJitterTestResult(capture_type)
-            self.testrmfAudio.stopCapture(capture_type)
+            failure = self.waitForCapture(jitter_test_duration, ["auxiliary"])
+            result = self.finishJitterTest(capture_type, failure)
             ## TODO : Aux feature supported only in mock implementation now, enable below only for aux supported devices.
             ##self.testPlayer.stop()
             self.testrmfAudio.closeHandle(capture_type)
-            self.log.stepResult(result, 'Auxiliary jitter test')
+            self.log.stepResult(result, 'Auxiliary jitter test' if failure is None else f'Auxiliary jitter test ended early: {failure}')
         else:
             self.log.stepResult(result, 'Auxiliary support in configuration file is False. Auxiliary jitter test test not run')
 
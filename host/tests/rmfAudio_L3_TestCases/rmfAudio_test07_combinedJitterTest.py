@@ -93,17 +93,16 @@ class rmfAudio_test07_combinedJitterTest(rmfAudioHelperClass):
             for capture_type in (1, 2):
                 self.testrmfAudio.startJitterTest(capture_type, threshold, jitter_interval, jitter_test_duration)
         
-            time.sleep(jitter_test_duration)
+            failure = self.waitForCapture(jitter_test_duration, ["primary", "auxiliary"])
 
             for capture_type in (1, 2):
-                result.append(self.testrmfAudio.checkJitterTestResult(capture_type))
-                self.testrmfAudio.stopCapture(capture_type)
+                result.append(self.finishJitterTest(capture_type, failure))
                 self.testrmfAudio.closeHandle(capture_type)
 
             ## TODO : Aux feature supported only in mock implementation now, enable below only for aux supported devices.
             ##self.testPlayer.stop()
 
-            self.log.stepResult(all(result), 'Combined jitter test')
+            self.log.stepResult(all(result), 'Combined jitter test' if failure is None else f'Combined jitter test ended early: {failure}')
         else:
             self.log.stepResult(result, 'Auxiliary support in configuration file is False. Combined jitter test test not run')
 
@@ -0,0 +1,85 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file rmfAudioCapture_timestamp.h
+*
+* Optional extension of the RMF Audio Capture HAL: per buffer capture timestamps.
+*
+* cbBufferReady carries no timing, so a consumer aligning the captured audio with other
+* streams, for lip sync or echo cancellation, cannot tell when its samples were captured.
+* A HAL implementing this extension calls a timestamped variant of the data callback
+* instead, with the CLOCK_MONOTONIC time the first sample of the buffer was captured and
+* the number of frames captured before it since RMF_AudioCapture_Start().
+*
+* The extension is negotiated per session before start: the client registers the
+* timestamped callback and uses it only if the HAL accepts it. The function is declared
+* weak, so a client links against a HAL without it and finds it NULL; the client then
+* keeps cbBufferReady.
+*/
+
+#ifndef RMF_AUDIO_CAPTURE_TIMESTAMP_H
+#define RMF_AUDIO_CAPTURE_TIMESTAMP_H
+
+#include <stdint.h>
+
+#include "rmfAudioCapture.h"
+
+/**
+ * @brief Timing of one captured buffer
+ */
+typedef struct
+{
+    uint64_t captureTimeNs;     //!< CLOCK_MONOTONIC time the first sample of the buffer was captured
+    uint64_t samplePosition;    //!< Frames captured since start before the first one of the buffer, including any the HAL dropped
+} RMF_AudioCapture_BufferInfo;
+
+/**
+ * @brief Timestamped variant of RMF_AudioCaptureBufferReadyCb
+ *
+ * @param[in] cbBufferReadyParm - cbBufferReadyParm of the settings passed to RMF_AudioCapture_Start()
+ * @param[in] AudioCaptureBuffer - captured audio, valid until the callback returns
+ * @param[in] AudioCaptureBufferSize - bytes in AudioCaptureBuffer
+ * @param[in] info - timing of the buffer, valid until the callback returns
+ *
+ * @return rmf_Error - RMF_SUCCESS if the buffer was consumed
+ */
+typedef rmf_Error (*RMF_AudioCaptureTimestampedBufferReadyCb)(void *cbBufferReadyParm, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize,
+                                                              const RMF_AudioCapture_BufferInfo *info);
+
+/**
+ * @brief Asks the HAL to deliver the next session's buffers through the timestamped callback
+ *
+ * When accepted, RMF_AudioCapture_Start() calls cbTimestampedBufferReady for every buffer in
+ * place of settings->cbBufferReady, which must still be set. NULL returns to cbBufferReady.
+ * The registration lasts until RMF_AudioCapture_Close().
+ *
+ * @param[in] handle - handle from RMF_AudioCapture_Open() or RMF_AudioCapture_Open_Type()
+ * @param[in] cbTimestampedBufferReady - timestamped callback, or NULL
+ *
+ * @return rmf_Error
+ * @retval RMF_SUCCESS - The HAL will call the timestamped callback
+ * @retval RMF_INVALID_HANDLE - handle is not open
+ * @retval RMF_INVALID_STATE - capture is started, register before RMF_AudioCapture_Start()
+ * @retval RMF_ERROR - The HAL cannot timestamp the buffers of this capture, keep cbBufferReady
+ *
+ * @pre RMF_AudioCapture_Open() or RMF_AudioCapture_Open_Type() must be called before calling this API
+ */
+rmf_Error RMF_AudioCapture_SetTimestampedBufferReadyCb(RMF_AudioCaptureHandle handle, RMF_AudioCaptureTimestampedBufferReadyCb cbTimestampedBufferReady) __attribute__((weak));
+
+#endif // RMF_AUDIO_CAPTURE_TIMESTAMP_H
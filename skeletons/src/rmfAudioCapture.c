@@ -23,8 +23,20 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 #include "rmfAudioCapture.h"
+#include "rmfAudioCapture_timestamp.h"
+#include "capture_clock.h"
+#include "capture_trace.h"
+#include "capture_timeline.h"
 
 RMF_AudioCapture_Settings primary;
 RMF_AudioCapture_Settings auxiliary;
@@ -32,11 +44,83 @@ RMF_AudioCapture_Settings auxiliary;
 static const size_t DEFAULT_FIFO_SIZE = 64 * 1024;
 static const size_t DEFAULT_THRESHOLD = 8 * 1024;
 #define DATA_RATE 192000    // Bytes per second = sampling rate x num channels x bytes per second = 48000 * 2 * 2
+#define FRAME_BYTES 4       // 16 bit stereo
+#define LIVE_JITTER_MS_DEFAULT 100  // Audio buffered from a live source before delivery starts
+#define LIVE_STAMP_BYTES 256        // Granularity of the arrival times kept for the latency
+#define LIVE_POLL_MS 20             // Reader wakes up at least this often to notice a stop
+#define COALESCE_PERIODS_MAX 64     // Most threshold periods INPUT_*_COALESCE may batch into one callback
+#define STOP_POLL_MS 20             // Delivery on the virtual clock wakes up at least this often to notice a stop
 int exitFlag_primary = 0;
 int exitFlag_auxiliary = 0;
 
+/*
+ * Simulated HAL FIFO: audio fills it on the session clock and each callback takes threshold bytes
+ * from it. While a callback runs long the FIFO keeps filling; audio that no longer fits in
+ * fifoSize is dropped and counted as an overflow, and the delivery skips ahead past it.
+ */
+typedef struct
+{
+    int started;
+    uint64_t startNs;           // Session clock origin, the first buffer is due then
+    uint64_t periodNs;          // Time to fill one threshold
+    size_t threshold;
+    size_t fifoSize;
+    uint64_t consumedBytes;     // Delivered or dropped
+    unsigned int overflows;
+    pthread_t thread;           // Delivery thread of the session, joined when the session stops
+    bool delivering;            // thread has been created and not joined yet
+    pthread_mutex_t stopLock;   // With stopWake, wakes the delivery thread from its sleep on a stop
+    pthread_cond_t stopWake;
+} fifoStatus_t;
+
+static fifoStatus_t status_primary;
+static fifoStatus_t status_auxiliary;
+static pthread_once_t stopOnce = PTHREAD_ONCE_INIT;
+
+/* Timestamped data callbacks registered for the next session, see rmfAudioCapture_timestamp.h */
+static RMF_AudioCaptureTimestampedBufferReadyCb timestamped_primary;
+static RMF_AudioCaptureTimestampedBufferReadyCb timestamped_auxiliary;
+
+/*
+ * Live source: INPUT_PRIMARY / INPUT_AUXILIARY set to fifo:<path> or unix:<path> reads raw PCM
+ * in the default format (16 bit stereo 48 kHz) from a named pipe, created if needed, or from
+ * clients connecting one at a time to a UNIX stream socket. A reader thread fills a jitter buffer
+ * which the delivery thread drains on the session clock, so the feeder may write in bursts.
+ * Delivery starts once INPUT_*_JITTER_MS of audio is buffered; when the buffer runs dry silence
+ * is delivered until it is full again. The reader stops reading while the buffer is full, which
+ * paces a feeder writing faster than real time. The latency from the mock reading the audio to
+ * the buffer ready callback delivering it is reported when the capture stops. The feeder runs in
+ * real time, so a live source is refused on the virtual clock.
+ */
+typedef struct
+{
+    const char *name;
+    const char *path;
+    bool socket;
+    int listenFd;               // Listening UNIX socket, -1 for a FIFO
+    int fd;                     // FIFO or connected feeder, -1 when none
+    int fifoWriteFd;            // Keeps the FIFO open so it does not report end of file between feeders
+    char *ring;
+    uint64_t *stamps;           // Arrival time of each LIVE_STAMP_BYTES block of the ring
+    size_t size;
+    size_t target;              // Buffered bytes needed to start or resume delivery
+    uint64_t written;           // Total bytes read from the feeder
+    uint64_t delivered;         // Total bytes delivered
+    bool buffering;
+    volatile int stop;
+    pthread_mutex_t lock;
+    pthread_t reader;
+    uint64_t underruns;
+    uint64_t silentBytes;
+    uint64_t latencyCount;
+    uint64_t latencySumNs;
+    uint64_t latencyMinNs;
+    uint64_t latencyMaxNs;
+} liveSource_t;
+
 rmf_Error RMF_AudioCapture_Open_Type(RMF_AudioCaptureHandle* handle, RMF_AudioCaptureType rmfAcType)
 {
+  CAPTURE_TIMELINE_SCOPE("RMF_AudioCapture_Open_Type", NULL, 0);
   rmf_Error result = RMF_SUCCESS;
   if(NULL != handle)
   {
@@ -58,6 +142,7 @@ rmf_Error RMF_AudioCapture_Open_Type(RMF_AudioCaptureHandle* handle, RMF_AudioCa
 
 rmf_Error RMF_AudioCapture_Open(RMF_AudioCaptureHandle* handle)
 {
+  CAPTURE_TIMELINE_SCOPE("RMF_AudioCapture_Open", NULL, 0);
   rmf_Error result = RMF_SUCCESS;
   if(NULL != handle)
   {
@@ -68,16 +153,79 @@ rmf_Error RMF_AudioCapture_Open(RMF_AudioCaptureHandle* handle)
   return result;
 }
 
+/* Bytes the simulated clock has put in the FIFO and no callback has taken yet */
+static size_t fifoDepth(fifoStatus_t *fifo)
+{
+    uint64_t start = __atomic_load_n(&fifo->startNs, __ATOMIC_ACQUIRE);
+    uint64_t period = __atomic_load_n(&fifo->periodNs, __ATOMIC_RELAXED);
+    uint64_t now = capture_clock_now_ns();
+    double produced;
+    double depth;
+
+    if ((start == 0) || (period == 0) || (now < start))
+    {
+        return 0;
+    }
+    produced = (double)(now - start) * (double)fifo->threshold / (double)period + (double)fifo->threshold;
+    depth = produced - (double)__atomic_load_n(&fifo->consumedBytes, __ATOMIC_RELAXED);
+    return (depth > 0.0) ? (size_t)depth : 0;
+}
+
 rmf_Error RMF_AudioCapture_GetStatus(RMF_AudioCaptureHandle handle, RMF_AudioCapture_Status* status)
 {
-  /*TODO: Implement Me!*/
-  (void)handle;
-  (void)status;
-  return (rmf_Error)0;
+  CAPTURE_TIMELINE_SCOPE("RMF_AudioCapture_GetStatus", NULL, 0);
+  RMF_AudioCapture_Settings *settings = (RMF_AudioCapture_Settings *)handle;
+  fifoStatus_t *fifo = NULL;
+
+  if(&primary == settings)
+  {
+    fifo = &status_primary;
+  }
+  else if(&auxiliary == settings)
+  {
+    fifo = &status_auxiliary;
+  }
+  else
+    return RMF_INVALID_HANDLE;
+  if(NULL == status)
+    return RMF_INVALID_PARM;
+
+  memset(status, 0, sizeof(*status));
+  status->started = __atomic_load_n(&fifo->started, __ATOMIC_RELAXED);
+  status->format = settings->format;
+  status->samplingFreq = settings->samplingFreq;
+  status->overflows = __atomic_load_n(&fifo->overflows, __ATOMIC_RELAXED);
+  if(status->started)
+  {
+    size_t depth = fifoDepth(fifo);
+    status->fifoDepth = (depth < fifo->fifoSize) ? depth : fifo->fifoSize;
+  }
+  return RMF_SUCCESS;
+}
+
+rmf_Error RMF_AudioCapture_SetTimestampedBufferReadyCb(RMF_AudioCaptureHandle handle, RMF_AudioCaptureTimestampedBufferReadyCb cbTimestampedBufferReady)
+{
+  CAPTURE_TIMELINE_SCOPE("RMF_AudioCapture_SetTimestampedBufferReadyCb", NULL, 0);
+  if(&primary == (RMF_AudioCapture_Settings *)handle)
+  {
+    if(status_primary.started)
+      return RMF_INVALID_STATE;
+    timestamped_primary = cbTimestampedBufferReady;
+  }
+  else if(&auxiliary == (RMF_AudioCapture_Settings *)handle)
+  {
+    if(status_auxiliary.started)
+      return RMF_INVALID_STATE;
+    timestamped_auxiliary = cbTimestampedBufferReady;
+  }
+  else
+    return RMF_INVALID_HANDLE;
+  return RMF_SUCCESS;
 }
 
 rmf_Error RMF_AudioCapture_GetDefaultSettings(RMF_AudioCapture_Settings* settings)
 {
+  CAPTURE_TIMELINE_SCOPE("RMF_AudioCapture_GetDefaultSettings", NULL, 0);
   settings->format = racFormat_e16BitStereo;
   settings->samplingFreq = racFreq_e48000;
   settings->fifoSize = DEFAULT_FIFO_SIZE;
@@ -87,6 +235,7 @@ rmf_Error RMF_AudioCapture_GetDefaultSettings(RMF_AudioCapture_Settings* setting
 
 rmf_Error RMF_AudioCapture_GetCurrentSettings(RMF_AudioCaptureHandle handle, RMF_AudioCapture_Settings* settings)
 {
+  CAPTURE_TIMELINE_SCOPE("RMF_AudioCapture_GetCurrentSettings", NULL, 0);
   /*TODO: Implement Me!*/
   (void)handle;
   (void)settings;
@@ -141,25 +290,406 @@ size_t readRawAudio(const char *filename, char **buffer) {
     return bytesRead;
 }
 
+/* Live sources are fed in real time and never run on the virtual clock, see RMF_AudioCapture_Start() */
+static bool isLiveSource(const char *filePath)
+{
+    return (filePath != NULL) && ((0 == strncmp(filePath, "fifo:", 5)) || (0 == strncmp(filePath, "unix:", 5)));
+}
+
+static uint64_t liveNowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Copies what the feeder wrote into the jitter buffer, stamping the blocks that start in it */
+static void liveSourceStore(liveSource_t *live, const char *data, size_t bytes)
+{
+    uint64_t now = liveNowNs();
+
+    pthread_mutex_lock(&live->lock);
+    for (size_t i = 0; i < bytes; i++)
+    {
+        uint64_t position = live->written + i;
+        size_t index = (size_t)(position % live->size);
+
+        live->ring[index] = data[i];
+        if ((index % LIVE_STAMP_BYTES) == 0)
+        {
+            live->stamps[index / LIVE_STAMP_BYTES] = now;
+        }
+    }
+    live->written += bytes;
+    pthread_mutex_unlock(&live->lock);
+}
+
+/* Reader thread: accepts feeders and moves their audio into the jitter buffer */
+static void* liveSourceReader(void *arg)
+{
+    liveSource_t *live = (liveSource_t *)arg;
+    char data[DEFAULT_THRESHOLD];
+
+    while (!live->stop)
+    {
+        struct pollfd pfd;
+        size_t space;
+        ssize_t bytes;
+
+        if (live->fd < 0)
+        {
+            pfd.fd = live->listenFd;
+            pfd.events = POLLIN;
+            if ((poll(&pfd, 1, LIVE_POLL_MS) > 0) && (pfd.revents & POLLIN))
+            {
+                live->fd = accept(live->listenFd, NULL, NULL);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&live->lock);
+        space = live->size - (size_t)(live->written - live->delivered);
+        pthread_mutex_unlock(&live->lock);
+        if (space == 0)
+        {
+            // Full, leave the data with the feeder until the delivery thread makes room
+            usleep(1000);
+            continue;
+        }
+
+        pfd.fd = live->fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, LIVE_POLL_MS) <= 0)
+        {
+            continue;
+        }
+        bytes = read(live->fd, data, (space < sizeof(data)) ? space : sizeof(data));
+        if (bytes > 0)
+        {
+            liveSourceStore(live, data, (size_t)bytes);
+        }
+        else if ((bytes == 0) || ((errno != EINTR) && (errno != EAGAIN)))
+        {
+            if (live->socket)
+            {
+                // Feeder went away, wait for the next one
+                close(live->fd);
+                live->fd = -1;
+            }
+            else
+            {
+                usleep(LIVE_POLL_MS * 1000);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void liveSourceClose(liveSource_t *live)
+{
+    live->stop = 1;
+    pthread_join(live->reader, NULL);
+    if (live->fd >= 0)
+    {
+        close(live->fd);
+    }
+    if (live->fifoWriteFd >= 0)
+    {
+        close(live->fifoWriteFd);
+    }
+    if (live->listenFd >= 0)
+    {
+        close(live->listenFd);
+        unlink(live->path);
+    }
+    pthread_mutex_destroy(&live->lock);
+    free(live->ring);
+    free(live->stamps);
+}
+
+/* Opens the FIFO or socket named by spec and starts reading it, returns -1 on failure */
+static int liveSourceOpen(liveSource_t *live, const char *name, const char *spec, const char *jitterMs, size_t chunkBytes)
+{
+    double milliseconds = (jitterMs != NULL) ? atof(jitterMs) : LIVE_JITTER_MS_DEFAULT;
+
+    memset(live, 0, sizeof(*live));
+    live->name = name;
+    live->socket = (0 == strncmp(spec, "unix:", 5));
+    live->path = spec + 5;
+    live->listenFd = -1;
+    live->fd = -1;
+    live->fifoWriteFd = -1;
+    live->buffering = true;
+    live->latencyMinNs = UINT64_MAX;
+
+    // Jitter buffer depth in whole callback buffers, the ring holds twice that
+    live->target = (size_t)(milliseconds > 0 ? milliseconds : 0) * DATA_RATE / 1000;
+    live->target = ((live->target + DEFAULT_THRESHOLD - 1) / DEFAULT_THRESHOLD) * DEFAULT_THRESHOLD;
+    if (live->target < chunkBytes)
+    {
+        // A coalesced callback must fit in the jitter buffer
+        live->target = chunkBytes;
+    }
+    live->size = live->target * 2;
+    live->ring = (char *)malloc(live->size);
+    live->stamps = (uint64_t *)calloc(live->size / LIVE_STAMP_BYTES, sizeof(uint64_t));
+    if ((live->ring == NULL) || (live->stamps == NULL))
+    {
+        free(live->ring);
+        free(live->stamps);
+        return -1;
+    }
+
+    if (live->socket)
+    {
+        struct sockaddr_un address;
+
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, live->path, sizeof(address.sun_path) - 1);
+        live->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(live->path);
+        if ((live->listenFd < 0) || (bind(live->listenFd, (struct sockaddr *)&address, sizeof(address)) != 0) ||
+            (listen(live->listenFd, 1) != 0))
+        {
+            printf("%s,  %d : Unable to listen on live source socket %s", __FILE__, __LINE__, live->path);
+            if (live->listenFd >= 0)
+            {
+                close(live->listenFd);
+            }
+            free(live->ring);
+            free(live->stamps);
+            return -1;
+        }
+    }
+    else
+    {
+        if ((mkfifo(live->path, 0666) != 0) && (errno != EEXIST))
+        {
+            printf("%s,  %d : Unable to create live source FIFO %s", __FILE__, __LINE__, live->path);
+            free(live->ring);
+            free(live->stamps);
+            return -1;
+        }
+        live->fd = open(live->path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        live->fifoWriteFd = open(live->path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (live->fd < 0)
+        {
+            printf("%s,  %d : Unable to open live source FIFO %s", __FILE__, __LINE__, live->path);
+            if (live->fifoWriteFd >= 0)
+            {
+                close(live->fifoWriteFd);
+            }
+            free(live->ring);
+            free(live->stamps);
+            return -1;
+        }
+    }
+
+    pthread_mutex_init(&live->lock, NULL);
+    if (pthread_create(&live->reader, NULL, liveSourceReader, live) != 0)
+    {
+        printf("%s,  %d : Failed to create live source reader thread", __FILE__, __LINE__);
+        if (live->fd >= 0)
+        {
+            close(live->fd);
+        }
+        if (live->fifoWriteFd >= 0)
+        {
+            close(live->fifoWriteFd);
+        }
+        if (live->listenFd >= 0)
+        {
+            close(live->listenFd);
+        }
+        pthread_mutex_destroy(&live->lock);
+        free(live->ring);
+        free(live->stamps);
+        return -1;
+    }
+    return 0;
+}
+
+/* Takes one callback buffer from the jitter buffer, filling with silence while it refills */
+static void liveSourceTake(liveSource_t *live, char *buffer, size_t bytes)
+{
+    size_t available;
+    size_t taken = 0;
+    uint64_t now = liveNowNs();
+
+    pthread_mutex_lock(&live->lock);
+    available = (size_t)(live->written - live->delivered);
+    if (live->buffering && (available >= live->target))
+    {
+        live->buffering = false;
+    }
+    if (!live->buffering)
+    {
+        size_t index = (size_t)(live->delivered % live->size);
+        uint64_t stamp = live->stamps[index / LIVE_STAMP_BYTES];
+
+        taken = (available < bytes) ? available : bytes;
+        for (size_t i = 0; i < taken; i++)
+        {
+            buffer[i] = live->ring[(index + i) % live->size];
+        }
+        live->delivered += taken;
+        if (taken > 0)
+        {
+            uint64_t latency = (now > stamp) ? now - stamp : 0;
+
+            live->latencyCount++;
+            live->latencySumNs += latency;
+            live->latencyMinNs = (latency < live->latencyMinNs) ? latency : live->latencyMinNs;
+            live->latencyMaxNs = (latency > live->latencyMaxNs) ? latency : live->latencyMaxNs;
+        }
+        if (taken < bytes)
+        {
+            // Ran dry, deliver silence until the jitter buffer is full again
+            live->underruns++;
+            live->buffering = true;
+        }
+    }
+    live->silentBytes += bytes - taken;
+    pthread_mutex_unlock(&live->lock);
+
+    memset(buffer + taken, 0, bytes - taken);
+}
+
+static void liveSourceReport(liveSource_t *live)
+{
+    printf("%s,  %d : Live source %s %s: delivered %llu bytes, silence %llu bytes, underruns %llu, jitter buffer %zu bytes\n",
+           __FILE__, __LINE__, live->name, live->path, (unsigned long long)live->delivered,
+           (unsigned long long)live->silentBytes, (unsigned long long)live->underruns, live->target);
+    if (live->latencyCount > 0)
+    {
+        printf("%s,  %d : Live source %s latency from read to callback: min %.3f ms, mean %.3f ms, max %.3f ms over %llu callbacks\n",
+               __FILE__, __LINE__, live->name, live->latencyMinNs / 1e6,
+               (double)live->latencySumNs / live->latencyCount / 1e6, live->latencyMaxNs / 1e6,
+               (unsigned long long)live->latencyCount);
+    }
+}
+
+/*
+ * Trace replay: INPUT_PRIMARY_TRACE / INPUT_AUXILIARY_TRACE name a callback timing trace recorded
+ * from a real HAL (see capture_trace.h). Each callback then delivers the bytes of the next traced
+ * callback, rounded to whole frames, at its traced time from the start of the session multiplied
+ * by INPUT_*_TRACE_SCALE (default 1). The audio still comes from the file or live source. The
+ * trace repeats, each lap starting one buffer after the last callback of the previous one. The
+ * traced HAL already dropped or delayed audio as its own FIFO did, so the simulated FIFO does not
+ * overflow while replaying.
+ */
+static size_t traceBytes(const capture_trace_t *trace, uint32_t index)
+{
+    size_t bytes = trace->events[index].bytes & ~(size_t)(FRAME_BYTES - 1);
+
+    return (bytes > 0) ? bytes : FRAME_BYTES;
+}
+
+static void stopInit(void)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&status_primary.stopLock, NULL);
+    pthread_cond_init(&status_primary.stopWake, &attr);
+    pthread_mutex_init(&status_auxiliary.stopLock, NULL);
+    pthread_cond_init(&status_auxiliary.stopWake, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/*
+ * Sleeps until deadline_ns on the session clock or until the session stops, so a stop is noticed
+ * at once even while waiting out a long coalesced period or a gap in a replayed trace. The virtual
+ * clock has no wakeup to wait on, it is slept on in slices of STOP_POLL_MS instead.
+ */
+static void sleepUntilStopped(uint64_t deadline_ns, fifoStatus_t *fifo, const int *exitFlag)
+{
+    // The real session clock is CLOCK_MONOTONIC, the clock of stopWake
+    struct timespec deadline = { .tv_sec = (time_t)(deadline_ns / 1000000000ull), .tv_nsec = (long)(deadline_ns % 1000000000ull) };
+
+    if (capture_clock_virtual())
+    {
+        uint64_t now = capture_clock_now_ns();
+
+        while ((__atomic_load_n(exitFlag, __ATOMIC_ACQUIRE) == 0) && (now < deadline_ns))
+        {
+            uint64_t slice = now + (uint64_t)STOP_POLL_MS * 1000000ull;
+
+            capture_clock_sleep_until_ns((slice < deadline_ns) ? slice : deadline_ns);
+            now = capture_clock_now_ns();
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&fifo->stopLock);
+    while ((*exitFlag == 0) && (pthread_cond_timedwait(&fifo->stopWake, &fifo->stopLock, &deadline) != ETIMEDOUT))
+    {
+    }
+    pthread_mutex_unlock(&fifo->stopLock);
+}
+
 /* Function that will run in thread and send raw audio data in required datarate  */
 void* sendAudioData(void* handle) 
 {
-    char *rawDataBuffer;
-    size_t dataSize;
+    char *rawDataBuffer = NULL;
+    size_t dataSize = 0;
     size_t offset = 0;
     int *exitFlag = NULL;
     char *filePath = NULL;
-    unsigned int sleepTimeMicroseconds = 0;
+    char *skewPpm = NULL;
+    char *jitterMs = NULL;
+    char *coalesce = NULL;
+    char *coalesceMs = NULL;
+    char *tracePath = NULL;
+    char *traceScale = NULL;
+    const char *name = NULL;
+    liveSource_t live;
+    bool isLive = false;
+    uint64_t periodNanoseconds = 0;
+    uint64_t nextDelivery = 0;
     size_t chunkSize = 0;
+    size_t periods = 1;
+    size_t callbackSize = 0;
+    size_t bufferSize = 0;
+    capture_trace_t trace = {0};
+    uint32_t traceIndex = 0;
+    uint64_t traceLapNs = 0;
+    double scale = 1.0;
+    uint64_t sessionStart = 0;
+    size_t threshold = 0;
+    fifoStatus_t *fifo = NULL;
+    RMF_AudioCaptureTimestampedBufferReadyCb timestamped = NULL;
+    RMF_AudioCapture_BufferInfo info;
+    char *buffer = NULL;
 
     if(&primary == (RMF_AudioCapture_Settings *)handle) 
     {
         filePath = getenv("INPUT_PRIMARY");
+        skewPpm = getenv("INPUT_PRIMARY_SKEW_PPM");
+        jitterMs = getenv("INPUT_PRIMARY_JITTER_MS");
+        coalesce = getenv("INPUT_PRIMARY_COALESCE");
+        coalesceMs = getenv("INPUT_PRIMARY_COALESCE_MS");
+        tracePath = getenv("INPUT_PRIMARY_TRACE");
+        traceScale = getenv("INPUT_PRIMARY_TRACE_SCALE");
+        name = "primary";
         exitFlag = &exitFlag_primary;
+        fifo = &status_primary;
+        timestamped = timestamped_primary;
     } else 
     {
         filePath = getenv("INPUT_AUXILIARY");
+        skewPpm = getenv("INPUT_AUXILIARY_SKEW_PPM");
+        jitterMs = getenv("INPUT_AUXILIARY_JITTER_MS");
+        coalesce = getenv("INPUT_AUXILIARY_COALESCE");
+        coalesceMs = getenv("INPUT_AUXILIARY_COALESCE_MS");
+        tracePath = getenv("INPUT_AUXILIARY_TRACE");
+        traceScale = getenv("INPUT_AUXILIARY_TRACE_SCALE");
+        name = "auxiliary";
         exitFlag = &exitFlag_auxiliary;
+        fifo = &status_auxiliary;
+        timestamped = timestamped_auxiliary;
     }
 
     if (filePath == NULL) 
@@ -168,82 +698,264 @@ void* sendAudioData(void* handle)
         printf("%s,  %d : Not setting environment variable for input files when running with mock might result in incorrect test results !", __FILE__, __LINE__);
         return NULL;
     }
-    
-    if (access(filePath, F_OK) != 0 ) 
+
+    isLive = isLiveSource(filePath);
+    if (!isLive && (access(filePath, F_OK) != 0))
     {
         printf("%s,  %d : File does not exist", __FILE__, __LINE__);
         return NULL;
     }
     
-    char buffer[DEFAULT_THRESHOLD];
-    memset(buffer, 0, DEFAULT_THRESHOLD);
+    // Each callback delivers the threshold of the settings, a whole number of frames
+    threshold = ((RMF_AudioCapture_Settings *)handle)->threshold & ~(size_t)3;
+    if (threshold == 0)
+    {
+        threshold = DEFAULT_THRESHOLD;
+    }
 
-    // Calculate the sleep time to achieve the desired data rate
-    sleepTimeMicroseconds = (DEFAULT_THRESHOLD * 1000000) / DATA_RATE;
+    // Calculate the delivery period to achieve the desired data rate, a positive skew makes the simulated audio clock run fast
+    periodNanoseconds = (uint64_t)((double)threshold * 1e9 / DATA_RATE / (1.0 + ((skewPpm != NULL) ? atof(skewPpm) : 0.0) / 1e6));
 
-    // Read raw audio data from wav file into a buffer
-    dataSize = readRawAudio(filePath, &rawDataBuffer);
-    if (dataSize == 0) 
+    // Coalesce several periods into one callback, by count or by the longest time the audio may wait
+    if ((coalesce != NULL) && (atoi(coalesce) > 1))
+    {
+        periods = (size_t)atoi(coalesce);
+    }
+    else if ((coalesceMs != NULL) && (atof(coalesceMs) * 1e6 >= (double)periodNanoseconds))
     {
-        printf("%s,  %d : Failed to read audio data or file is empty", __FILE__, __LINE__);
-        free(rawDataBuffer);
+        periods = (size_t)(atof(coalesceMs) * 1e6 / (double)periodNanoseconds);
+    }
+    if (periods > COALESCE_PERIODS_MAX)
+    {
+        periods = COALESCE_PERIODS_MAX;
+    }
+    callbackSize = periods * threshold;
+    if (periods > 1)
+    {
+        printf("%s,  %d : Coalescing %zu periods, %zu bytes per %s callback\n", __FILE__, __LINE__, periods, callbackSize, name);
+    }
+
+    bufferSize = callbackSize;
+
+    if (tracePath != NULL)
+    {
+        if (capture_trace_load(&trace, tracePath) != RMF_SUCCESS)
+        {
+            printf("%s,  %d : Unable to load callback timing trace %s", __FILE__, __LINE__, tracePath);
+            return NULL;
+        }
+        if ((traceScale != NULL) && (atof(traceScale) > 0.0))
+        {
+            scale = atof(traceScale);
+        }
+        callbackSize = traceBytes(&trace, 0);
+        bufferSize = (trace.max_bytes > FRAME_BYTES) ? trace.max_bytes : FRAME_BYTES;
+        printf("%s,  %d : Replaying trace %s on %s: %u callbacks over %.3f s, time scale %.3f\n", __FILE__, __LINE__, tracePath, name,
+               trace.count, capture_trace_duration_ns(&trace) / 1e9, scale);
+    }
+
+    buffer = (char *)calloc(1, bufferSize);
+    if (buffer == NULL)
+    {
+        printf("%s,  %d : Failed to allocate the callback buffer", __FILE__, __LINE__);
+        capture_trace_release(&trace);
         return NULL;
     }
 
-    while (*exitFlag == 0) 
+    if (isLive)
+    {
+        if (liveSourceOpen(&live, name, filePath, jitterMs, bufferSize) != 0)
+        {
+            free(buffer);
+            capture_trace_release(&trace);
+            return NULL;
+        }
+    }
+    else
     {
-        if (offset >= dataSize) 
+        // Read raw audio data from wav file into a buffer
+        dataSize = readRawAudio(filePath, &rawDataBuffer);
+        if (dataSize == 0)
         {
-            // Restart from the beginning of the data if we have reached the end
-            offset = 0;
+            printf("%s,  %d : Failed to read audio data or file is empty", __FILE__, __LINE__);
+            free(rawDataBuffer);
+            free(buffer);
+            capture_trace_release(&trace);
+            return NULL;
         }
+    }
 
-        // Calculate the size of the chunk to send
-        chunkSize = (dataSize - offset >= DEFAULT_THRESHOLD) ? DEFAULT_THRESHOLD : (dataSize - offset);
+    nextDelivery = capture_clock_now_ns();
+    sessionStart = nextDelivery;
+    fifo->threshold = threshold;
+    fifo->fifoSize = (((RMF_AudioCapture_Settings *)handle)->fifoSize > bufferSize) ? ((RMF_AudioCapture_Settings *)handle)->fifoSize : bufferSize;
+    fifo->consumedBytes = 0;
+    __atomic_store_n(&fifo->periodNs, periodNanoseconds, __ATOMIC_RELAXED);
+    __atomic_store_n(&fifo->startNs, nextDelivery, __ATOMIC_RELEASE);
+    while (__atomic_load_n(exitFlag, __ATOMIC_ACQUIRE) == 0)
+    {
+        if (trace.count > 0)
+        {
+            callbackSize = traceBytes(&trace, traceIndex);
+        }
+        if (isLive)
+        {
+            // Re-time the live audio to the session clock
+            liveSourceTake(&live, buffer, callbackSize);
+        }
+        else
+        {
+            for (size_t filled = 0; filled < callbackSize; filled += chunkSize)
+            {
+                if (offset >= dataSize)
+                {
+                    // Restart from the beginning of the data if we have reached the end
+                    offset = 0;
+                }
 
-        // Copy data into buffer
-        memcpy(buffer, rawDataBuffer + offset, chunkSize);
+                // Calculate the size of the chunk to send
+                chunkSize = (dataSize - offset >= callbackSize - filled) ? callbackSize - filled : (dataSize - offset);
+
+                // Copy data into buffer
+                memcpy(buffer + filled, rawDataBuffer + offset, chunkSize);
+
+                // Move to the next chunk
+                offset += chunkSize;
+            }
+        }
 
         // Call buffer ready on right handle
-        if(&primary == (RMF_AudioCapture_Settings *)handle) 
+        if (timestamped != NULL)
         {
-            primary.cbBufferReady(primary.cbBufferReadyParm, (void *)buffer, sizeof(buffer));
+            // On the pacing clock the buffer filled during the period before its delivery time
+            info.captureTimeNs = nextDelivery - ((trace.count > 0) ? (uint64_t)callbackSize * 1000000000ull / DATA_RATE : periodNanoseconds * periods);
+            info.samplePosition = fifo->consumedBytes / FRAME_BYTES;
+            timestamped(((RMF_AudioCapture_Settings *)handle)->cbBufferReadyParm, (void *)buffer, callbackSize, &info);
+        }
+        else if(&primary == (RMF_AudioCapture_Settings *)handle) 
+        {
+            primary.cbBufferReady(primary.cbBufferReadyParm, (void *)buffer, callbackSize);
         } else 
         {
-    	    auxiliary.cbBufferReady(auxiliary.cbBufferReadyParm, (void *)buffer, sizeof(buffer));
+    	    auxiliary.cbBufferReady(auxiliary.cbBufferReadyParm, (void *)buffer, callbackSize);
+        }
+        __atomic_store_n(&fifo->consumedBytes, fifo->consumedBytes + callbackSize, __ATOMIC_RELAXED);
+
+        // A callback that ran long lets the FIFO fill, drop what no longer fits and skip the deliveries it would have made
+        if ((trace.count == 0) && (fifoDepth(fifo) > fifo->fifoSize))
+        {
+            size_t dropped = (fifoDepth(fifo) - fifo->fifoSize + callbackSize - 1) / callbackSize;
+
+            printf("%s,  %d : FIFO overflow on %s, %zu bytes dropped\n", __FILE__, __LINE__, name, dropped * callbackSize);
+            __atomic_store_n(&fifo->overflows, fifo->overflows + 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&fifo->consumedBytes, fifo->consumedBytes + dropped * callbackSize, __ATOMIC_RELAXED);
+            for (size_t i = 0; i < dropped; i++)
+            {
+                if (isLive)
+                {
+                    liveSourceTake(&live, buffer, callbackSize);
+                }
+                else if (dataSize > 0)
+                {
+                    offset = (offset + callbackSize) % dataSize;
+                }
+                nextDelivery += periodNanoseconds * periods;
+            }
         }
 
-        // Simulate sending data in required data rate by sleeping
-        usleep(sleepTimeMicroseconds);
+        // Simulate sending data in required data rate by sleeping until the next delivery time, so time spent in the callback does not add up
+        if (trace.count > 0)
+        {
+            if (++traceIndex == trace.count)
+            {
+                traceLapNs += capture_trace_duration_ns(&trace) + (uint64_t)callbackSize * 1000000000ull / DATA_RATE;
+                traceIndex = 0;
+            }
+            nextDelivery = sessionStart + (uint64_t)((double)(traceLapNs + trace.events[traceIndex].time_ns) * scale);
+        }
+        else
+        {
+            nextDelivery += periodNanoseconds * periods;
+        }
+        sleepUntilStopped(nextDelivery, fifo, exitFlag);
+        if (capture_timeline_enabled())
+        {
+            uint64_t now = capture_clock_now_ns();
 
-        // Move to the next chunk
-        offset += chunkSize;
+            capture_timeline_instant("wakeup", "late_ns", (now > nextDelivery) ? now - nextDelivery : 0);
+        }
+    }
+    __atomic_store_n(&fifo->startNs, 0, __ATOMIC_RELEASE);
+    if (isLive)
+    {
+        liveSourceClose(&live);
+        liveSourceReport(&live);
     }
     free(rawDataBuffer);
-    pthread_exit(NULL);
+    free(buffer);
+    capture_trace_release(&trace);
+    return NULL;
+}
+
+/* Delivery thread, runs the session on the clock shared with the tests, which may be virtual (see capture_clock.h) */
+static void* deliveryThread(void* handle)
+{
+    capture_clock_attach();
+    capture_timeline_thread_name((&primary == (RMF_AudioCapture_Settings *)handle) ? "primary delivery" : "auxiliary delivery");
+    sendAudioData(handle);
+    capture_clock_detach();
+    return NULL;
+}
+
+/*
+ * Ends the delivery thread of a session and waits for it, so no callback runs once this returns
+ * and a following start cannot overlap the previous session. A stop from inside the callback
+ * cannot wait for its own thread, the next start or close joins it instead.
+ */
+static void stopDelivery(fifoStatus_t *fifo, int *exitFlag)
+{
+    pthread_once(&stopOnce, stopInit);
+    pthread_mutex_lock(&fifo->stopLock);
+    __atomic_store_n(exitFlag, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&fifo->stopWake);
+    pthread_mutex_unlock(&fifo->stopLock);
+    if (fifo->delivering && !pthread_equal(fifo->thread, pthread_self()))
+    {
+        pthread_join(fifo->thread, NULL);
+        fifo->delivering = false;
+    }
 }
 
 rmf_Error RMF_AudioCapture_Start(RMF_AudioCaptureHandle handle, RMF_AudioCapture_Settings* settings)
 {
-  pthread_t thread;
+  CAPTURE_TIMELINE_SCOPE("RMF_AudioCapture_Start", NULL, 0);
   rmf_Error result = RMF_SUCCESS;
+  fifoStatus_t *fifo = NULL;
 
   if(&primary == (RMF_AudioCapture_Settings *)handle)
   {
+    stopDelivery(&status_primary, &exitFlag_primary);
     primary = *settings;
     if(primary.cbBufferReady)
     {
+        fifo = &status_primary;
         exitFlag_primary = 0;
+        status_primary.overflows = 0;
+        status_primary.started = 1;
     }
     else
       result = RMF_INVALID_PARM;
   }
   else if(&auxiliary == (RMF_AudioCapture_Settings *)handle)
   {
+    stopDelivery(&status_auxiliary, &exitFlag_auxiliary);
     auxiliary = *settings;
     if(auxiliary.cbBufferReady)
     {
+        fifo = &status_auxiliary;
         exitFlag_auxiliary = 0;
+        status_auxiliary.overflows = 0;
+        status_auxiliary.started = 1;
     }
     else
       result = RMF_INVALID_PARM;
@@ -251,16 +963,28 @@ rmf_Error RMF_AudioCapture_Start(RMF_AudioCaptureHandle handle, RMF_AudioCapture
   else
     result = RMF_INVALID_HANDLE;
 
+  if((RMF_SUCCESS == result) && capture_clock_virtual() &&
+     isLiveSource(getenv((fifo == &status_primary) ? "INPUT_PRIMARY" : "INPUT_AUXILIARY")))
+  {
+      printf("%s,  %d : A live source is fed in real time and cannot be captured on the virtual clock, unset %s\n", __FILE__, __LINE__, CAPTURE_CLOCK_ENV);
+      fifo->started = 0;
+      result = RMF_ERROR;
+  }
+
   if(RMF_SUCCESS == result)
   {
-      // Create the thread to simulate sending audio data
-      if (pthread_create(&thread, NULL, sendAudioData, (void *)handle) != 0) 
+      // Create the thread to simulate sending audio data, the clock waits for it from now
+      capture_clock_reserve();
+      capture_timeline_instant("thread_create", NULL, 0);
+      if (pthread_create(&fifo->thread, NULL, deliveryThread, (void *)handle) != 0) 
       {
           printf("%s,  %d : Failed to create thread to send audio data", __FILE__, __LINE__);
+          capture_clock_detach();
+          fifo->started = 0;
           result = RMF_INVALID_PARM;
       } else 
       {
-          pthread_detach(thread);
+          fifo->delivering = true;
       }
   }
   return result;
@@ -268,24 +992,40 @@ rmf_Error RMF_AudioCapture_Start(RMF_AudioCaptureHandle handle, RMF_AudioCapture
 
 rmf_Error RMF_AudioCapture_Stop(RMF_AudioCaptureHandle handle)
 {
+  CAPTURE_TIMELINE_SCOPE("RMF_AudioCapture_Stop", NULL, 0);
   /*TODO: Implement Me!*/
   (void)handle;
   if(&primary == (RMF_AudioCapture_Settings *)handle) 
   {
-      exitFlag_primary = 1;
+      status_primary.started = 0;
+      stopDelivery(&status_primary, &exitFlag_primary);
   } else 
   {
-      exitFlag_auxiliary = 1;
+      status_auxiliary.started = 0;
+      stopDelivery(&status_auxiliary, &exitFlag_auxiliary);
   }
   return (rmf_Error)0;
 }
 
 rmf_Error RMF_AudioCapture_Close(RMF_AudioCaptureHandle handle)
 {
+  CAPTURE_TIMELINE_SCOPE("RMF_AudioCapture_Close", NULL, 0);
   rmf_Error result = RMF_SUCCESS;
   if((&primary == (RMF_AudioCapture_Settings *)handle) || (&auxiliary == (RMF_AudioCapture_Settings *)handle))
   {
     RMF_AudioCapture_Settings * ctx = (RMF_AudioCapture_Settings *)handle;
+    if(&primary == ctx)
+    {
+      status_primary.started = 0;
+      stopDelivery(&status_primary, &exitFlag_primary);
+      timestamped_primary = NULL;
+    }
+    else
+    {
+      status_auxiliary.started = 0;
+      stopDelivery(&status_auxiliary, &exitFlag_auxiliary);
+      timestamped_auxiliary = NULL;
+    }
     ctx->cbBufferReady = NULL;
     ctx->cbBufferReadyParm = NULL;
     ctx->cbStatusChange = NULL;
@@ -0,0 +1,287 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_alloc.c
+*
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capture_alloc.h"
+
+#if defined(__GLIBC__) && !defined(CAPTURE_ALLOC_NO_INTERPOSE)
+#define CAPTURE_ALLOC_INTERPOSE 1
+#include <malloc.h>
+#endif
+
+#define ALLOC_STATUS_MAX 4096
+
+static capture_alloc_counts_t gCounts;
+static uint32_t gPeakGeneration;  // Bumped whenever a phase resets the high water mark
+static __thread int gCallbackDepth;
+static __thread bool gDeliveryThread;
+
+#ifdef CAPTURE_ALLOC_INTERPOSE
+
+/* The glibc implementations, exported for exactly this purpose */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static void countAllocation(void *ptr)
+{
+    uint64_t bytes;
+
+    if (ptr == NULL)
+    {
+        return;
+    }
+    bytes = malloc_usable_size(ptr);
+    __atomic_fetch_add(&gCounts.allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&gCounts.bytes_allocated, bytes, __ATOMIC_RELAXED);
+    if (gCallbackDepth > 0)
+    {
+        __atomic_fetch_add(&gCounts.callback_allocations, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&gCounts.callback_bytes, bytes, __ATOMIC_RELAXED);
+    }
+    else if (gDeliveryThread)
+    {
+        __atomic_fetch_add(&gCounts.delivery_allocations, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&gCounts.delivery_bytes, bytes, __ATOMIC_RELAXED);
+    }
+}
+
+static void countFree(void *ptr)
+{
+    if (ptr != NULL)
+    {
+        __atomic_fetch_add(&gCounts.frees, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&gCounts.bytes_freed, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    }
+}
+
+void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+
+    countAllocation(ptr);
+    return ptr;
+}
+
+void *calloc(size_t count, size_t size)
+{
+    void *ptr = __libc_calloc(count, size);
+
+    countAllocation(ptr);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    uint64_t oldBytes = (ptr != NULL) ? malloc_usable_size(ptr) : 0;
+    void *moved = __libc_realloc(ptr, size);
+
+    if ((ptr != NULL) && ((moved != NULL) || (size == 0)))
+    {
+        __atomic_fetch_add(&gCounts.frees, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&gCounts.bytes_freed, oldBytes, __ATOMIC_RELAXED);
+    }
+    countAllocation(moved);
+    return moved;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *ptr = __libc_memalign(alignment, size);
+
+    countAllocation(ptr);
+    return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+/* Page aligned, so a block from them freed through free() is counted as it was allocated */
+void *valloc(size_t size)
+{
+    return memalign((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+void *pvalloc(size_t size)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (size > SIZE_MAX - page)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return memalign(page, (size == 0) ? page : (size + page - 1) & ~(page - 1));
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    void *ptr;
+
+    if ((alignment < sizeof(void *)) || ((alignment & (alignment - 1)) != 0))
+    {
+        return EINVAL;
+    }
+    ptr = memalign(alignment, size);
+    if (ptr == NULL)
+    {
+        return ENOMEM;
+    }
+    *out = ptr;
+    return 0;
+}
+
+void free(void *ptr)
+{
+    countFree(ptr);
+    __libc_free(ptr);
+}
+
+#endif // CAPTURE_ALLOC_INTERPOSE
+
+/* Reads a kB field of /proc/self/status without allocating, so the read is not counted */
+static uint64_t readStatusKb(const char *field)
+{
+    char status[ALLOC_STATUS_MAX];
+    const char *line;
+    ssize_t length;
+    int fd;
+
+    fd = open("/proc/self/status", O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return 0;
+    }
+    length = read(fd, status, sizeof(status) - 1);
+    close(fd);
+    if (length <= 0)
+    {
+        return 0;
+    }
+    status[length] = '\0';
+    line = strstr(status, field);
+    return (line != NULL) ? strtoull(line + strlen(field), NULL, 10) : 0;
+}
+
+/* Writing 5 to clear_refs resets VmHWM to the current VmRSS, since Linux 4.0 */
+static bool resetPeakRss(void)
+{
+    bool reset;
+    int fd;
+
+    fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    reset = (write(fd, "5", 1) == 1);
+    close(fd);
+    return reset;
+}
+
+bool capture_alloc_available(void)
+{
+#ifdef CAPTURE_ALLOC_INTERPOSE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void capture_alloc_counts(capture_alloc_counts_t *counts)
+{
+    if (counts == NULL)
+    {
+        return;
+    }
+    counts->allocations = __atomic_load_n(&gCounts.allocations, __ATOMIC_RELAXED);
+    counts->frees = __atomic_load_n(&gCounts.frees, __ATOMIC_RELAXED);
+    counts->bytes_allocated = __atomic_load_n(&gCounts.bytes_allocated, __ATOMIC_RELAXED);
+    counts->bytes_freed = __atomic_load_n(&gCounts.bytes_freed, __ATOMIC_RELAXED);
+    counts->callback_allocations = __atomic_load_n(&gCounts.callback_allocations, __ATOMIC_RELAXED);
+    counts->callback_bytes = __atomic_load_n(&gCounts.callback_bytes, __ATOMIC_RELAXED);
+    counts->delivery_allocations = __atomic_load_n(&gCounts.delivery_allocations, __ATOMIC_RELAXED);
+    counts->delivery_bytes = __atomic_load_n(&gCounts.delivery_bytes, __ATOMIC_RELAXED);
+}
+
+void capture_alloc_callback_enter(void)
+{
+    gDeliveryThread = true;
+    gCallbackDepth++;
+}
+
+void capture_alloc_callback_leave(void)
+{
+    if (gCallbackDepth > 0)
+    {
+        gCallbackDepth--;
+    }
+}
+
+void capture_alloc_begin(capture_alloc_phase_t *phase)
+{
+    if (phase == NULL)
+    {
+        return;
+    }
+    phase->peak_rss_reset = resetPeakRss();
+    phase->peak_generation = __atomic_add_fetch(&gPeakGeneration, 1, __ATOMIC_RELAXED);
+    phase->start_rss_kb = readStatusKb("VmRSS:");
+    capture_alloc_counts(&phase->start);
+}
+
+rmf_Error capture_alloc_end(const capture_alloc_phase_t *phase, capture_alloc_stats_t *stats)
+{
+    capture_alloc_counts_t now;
+
+    if ((phase == NULL) || (stats == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    capture_alloc_counts(&now);
+    memset(stats, 0, sizeof(*stats));
+    stats->counts.allocations = now.allocations - phase->start.allocations;
+    stats->counts.frees = now.frees - phase->start.frees;
+    stats->counts.bytes_allocated = now.bytes_allocated - phase->start.bytes_allocated;
+    stats->counts.bytes_freed = now.bytes_freed - phase->start.bytes_freed;
+    stats->counts.callback_allocations = now.callback_allocations - phase->start.callback_allocations;
+    stats->counts.callback_bytes = now.callback_bytes - phase->start.callback_bytes;
+    stats->counts.delivery_allocations = now.delivery_allocations - phase->start.delivery_allocations;
+    stats->counts.delivery_bytes = now.delivery_bytes - phase->start.delivery_bytes;
+    stats->live_bytes = (int64_t)stats->counts.bytes_allocated - (int64_t)stats->counts.bytes_freed;
+    stats->rss_kb = readStatusKb("VmRSS:");
+    stats->rss_change_kb = (int64_t)stats->rss_kb - (int64_t)phase->start_rss_kb;
+    stats->peak_rss_kb = readStatusKb("VmHWM:");
+    stats->peak_rss_reset = phase->peak_rss_reset && (phase->peak_generation == __atomic_load_n(&gPeakGeneration, __ATOMIC_RELAXED));
+    return capture_alloc_available() ? RMF_SUCCESS : RMF_ERROR;
+}
@@ -0,0 +1,106 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_alloc.h
+*
+* Allocation and memory footprint tracking for the test binary.
+*
+* capture_alloc.c defines malloc, calloc, realloc, free, valloc, pvalloc and the aligned
+* allocators, which take precedence over the C library for the test binary and every library it
+* loads, including the HAL. They count calls and bytes before forwarding to the glibc
+* implementation. Allocations made inside the buffer ready callback, and on a thread
+* that has invoked it outside the callback, are counted separately so a phase of steady
+* state capture can be checked for allocation free delivery.
+*
+* Interposition needs glibc. Build with -DCAPTURE_ALLOC_NO_INTERPOSE to leave the
+* allocator alone, for example with sanitizers, and capture_alloc_available() then
+* returns false.
+*/
+
+#ifndef CAPTURE_ALLOC_H
+#define CAPTURE_ALLOC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rmfAudioCapture.h"
+
+typedef struct
+{
+    uint64_t allocations;           // Calls that returned memory, a realloc counts as one allocation and one free
+    uint64_t frees;
+    uint64_t bytes_allocated;       // Usable bytes of those allocations
+    uint64_t bytes_freed;
+    uint64_t callback_allocations;  // Made while inside the buffer ready callback
+    uint64_t callback_bytes;
+    uint64_t delivery_allocations;  // Made on a callback thread outside the callback, by the HAL
+    uint64_t delivery_bytes;
+} capture_alloc_counts_t;
+
+typedef struct
+{
+    capture_alloc_counts_t counts;  // Counted during the phase
+    int64_t live_bytes;             // Change of allocated and not yet freed bytes over the phase
+    uint64_t rss_kb;                // Resident set size at the end of the phase
+    int64_t rss_change_kb;
+    uint64_t peak_rss_kb;           // High water mark of the resident set size during the phase
+    bool peak_rss_reset;            // The high water mark covers only this phase, it does not when the kernel refused the reset or a nested phase began
+} capture_alloc_stats_t;
+
+typedef struct
+{
+    capture_alloc_counts_t start;
+    uint64_t start_rss_kb;
+    bool peak_rss_reset;
+    uint32_t peak_generation;
+} capture_alloc_phase_t;
+
+/**
+ * @brief Whether the allocator is interposed and counts are collected
+ */
+bool capture_alloc_available(void);
+
+/**
+ * @brief Gets the counts since the process started
+ */
+void capture_alloc_counts(capture_alloc_counts_t *counts);
+
+/**
+ * @brief Marks the calling thread as inside the buffer ready callback, call first thing in the callback
+ */
+void capture_alloc_callback_enter(void);
+
+/**
+ * @brief Marks the calling thread as back in the HAL, call before the callback returns
+ */
+void capture_alloc_callback_leave(void);
+
+/**
+ * @brief Starts a phase, resetting the resident set high water mark when the kernel allows it
+ */
+void capture_alloc_begin(capture_alloc_phase_t *phase);
+
+/**
+ * @brief Ends a phase and reports the allocations and footprint since capture_alloc_begin()
+ *
+ * @return RMF_SUCCESS, RMF_ERROR when the allocator is not interposed and only the footprint is reported
+ */
+rmf_Error capture_alloc_end(const capture_alloc_phase_t *phase, capture_alloc_stats_t *stats);
+
+#endif // CAPTURE_ALLOC_H
@@ -0,0 +1,841 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_analysis.c
+*
+*/
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "capture_analysis.h"
+#include "capture_wav.h"
+
+#define ANALYSIS_SILENCE_LEVEL      1.0e-3f     // -60 dBFS, frames and samples below this are treated as silent
+#define ANALYSIS_MIN_FREQUENCY      40.0        // Lowest dominant frequency searched for
+#define ANALYSIS_BAND_LOW           50.0        // Lower edge of the first fingerprint band
+#define ANALYSIS_BAND_HIGH          16000.0     // Upper edge of the last fingerprint band
+#define ANALYSIS_MIN_XCORR_SAMPLES  1024        // Shorter excerpts are not cross-correlated
+#define ANALYSIS_CONSTANT_TONE_HZ   0.5         // Tracks with less deviation than this have no meaningful correlation
+#define ANALYSIS_CACHE_MAGIC        "RMFACF01"  // Cached features file, bump the version when the features change
+#define ANALYSIS_HASH_BLOCK         65536
+#define ANALYSIS_HASH_MULTIPLIER    0x100000001B3ull        // 64 bit FNV prime
+#define ANALYSIS_HASH_SEED          0xCBF29CE484222325ull
+
+typedef struct
+{
+    char magic[8];
+    uint64_t hash;
+    uint32_t frame_size;
+    uint32_t hop_size;
+    uint32_t bands;
+    uint32_t xcorr_size;
+    uint32_t sampling_rate;
+    uint32_t reserved;
+    uint64_t frames;
+    uint64_t onset;
+    uint64_t excerpt_len;
+} analysis_cache_header_t;
+
+rmf_Error capture_analysis_fft_init(capture_analysis_fft_t *fft, size_t n)
+{
+    if ((fft == NULL) || (n < 2) || ((n & (n - 1)) != 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    fft->n = n;
+    fft->cos_table = malloc(n * sizeof(float));
+    fft->sin_table = malloc(n * sizeof(float));
+    if ((fft->cos_table == NULL) || (fft->sin_table == NULL))
+    {
+        capture_analysis_fft_deinit(fft);
+        return RMF_ERROR;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        double angle = 2.0 * M_PI * (double)i / (double)n;
+        fft->cos_table[i] = (float)cos(angle);
+        fft->sin_table[i] = (float)sin(angle);
+    }
+    return RMF_SUCCESS;
+}
+
+void capture_analysis_fft_run(const capture_analysis_fft_t *fft, float *re, float *im)
+{
+    size_t n = fft->n;
+    size_t len = 1;
+    size_t log2n = 0;
+
+    /* Bit reversed ordering lets every stage work in place */
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    while (((size_t)1 << log2n) < n)
+    {
+        log2n++;
+    }
+
+    /* Odd powers of two need one radix-2 stage before the radix-4 stages */
+    if (log2n & 1)
+    {
+        for (size_t i = 0; i < n; i += 2)
+        {
+            float tr = re[i + 1];
+            float ti = im[i + 1];
+            re[i + 1] = re[i] - tr;
+            im[i + 1] = im[i] - ti;
+            re[i] += tr;
+            im[i] += ti;
+        }
+        len = 2;
+    }
+
+    /*
+     * Each radix-4 stage combines four sub-transforms of length len/4. In bit reversed
+     * order the quarters hold the transforms of x[4k], x[4k+2], x[4k+1] and x[4k+3],
+     * which take twiddles W^0, W^2k, W^k and W^3k respectively.
+     */
+    for (len *= 4; len <= n; len *= 4)
+    {
+        size_t quarter = len / 4;
+        size_t stride = n / len;
+
+        for (size_t base = 0; base < n; base += len)
+        {
+            for (size_t k = 0; k < quarter; k++)
+            {
+                size_t i0 = base + k;
+                size_t i1 = i0 + quarter;
+                size_t i2 = i1 + quarter;
+                size_t i3 = i2 + quarter;
+                float c1 = fft->cos_table[k * stride],     s1 = fft->sin_table[k * stride];
+                float c2 = fft->cos_table[2 * k * stride], s2 = fft->sin_table[2 * k * stride];
+                float c3 = fft->cos_table[3 * k * stride], s3 = fft->sin_table[3 * k * stride];
+
+                float ar = re[i0], ai = im[i0];
+                float br = re[i1] * c2 + im[i1] * s2, bi = im[i1] * c2 - re[i1] * s2;
+                float cr = re[i2] * c1 + im[i2] * s1, ci = im[i2] * c1 - re[i2] * s1;
+                float dr = re[i3] * c3 + im[i3] * s3, di = im[i3] * c3 - re[i3] * s3;
+
+                float t0r = ar + br, t0i = ai + bi;
+                float t1r = ar - br, t1i = ai - bi;
+                float t2r = cr + dr, t2i = ci + di;
+                float t3r = cr - dr, t3i = ci - di;
+
+                re[i0] = t0r + t2r; im[i0] = t0i + t2i;
+                re[i2] = t0r - t2r; im[i2] = t0i - t2i;
+                re[i1] = t1r + t3i; im[i1] = t1i - t3r;
+                re[i3] = t1r - t3i; im[i3] = t1i + t3r;
+            }
+        }
+    }
+}
+
+void capture_analysis_fft_deinit(capture_analysis_fft_t *fft)
+{
+    if (fft == NULL)
+    {
+        return;
+    }
+    free(fft->cos_table);
+    free(fft->sin_table);
+    fft->cos_table = NULL;
+    fft->sin_table = NULL;
+    fft->n = 0;
+}
+
+typedef struct
+{
+    capture_analysis_fft_t fft;
+    float window[CAPTURE_ANALYSIS_FRAME_SIZE];
+    float re[CAPTURE_ANALYSIS_FRAME_SIZE];
+    float im[CAPTURE_ANALYSIS_FRAME_SIZE];
+    size_t band_start[CAPTURE_ANALYSIS_BANDS + 1];
+    size_t min_bin;
+} analysis_state_t;
+
+static void setupBands(analysis_state_t *state, uint32_t sampling_rate)
+{
+    double binHz = (double)sampling_rate / CAPTURE_ANALYSIS_FRAME_SIZE;
+    double high = fmin(ANALYSIS_BAND_HIGH, sampling_rate / 2.0);
+
+    for (int b = 0; b <= CAPTURE_ANALYSIS_BANDS; b++)
+    {
+        double edge = ANALYSIS_BAND_LOW * pow(high / ANALYSIS_BAND_LOW, (double)b / CAPTURE_ANALYSIS_BANDS);
+        size_t bin = (size_t)(edge / binHz + 0.5);
+
+        if (bin >= CAPTURE_ANALYSIS_FRAME_SIZE / 2)
+        {
+            bin = CAPTURE_ANALYSIS_FRAME_SIZE / 2;
+        }
+        /* Keep every band at least one bin wide so low bands are not empty */
+        if ((b > 0) && (bin <= state->band_start[b - 1]))
+        {
+            bin = state->band_start[b - 1] + 1;
+        }
+        state->band_start[b] = bin;
+    }
+    state->min_bin = (size_t)ceil(ANALYSIS_MIN_FREQUENCY / binHz);
+    if (state->min_bin < 1)
+    {
+        state->min_bin = 1;
+    }
+}
+
+/* Extracts the dominant frequency and fingerprint of one frame of mono samples */
+static void analyseFrame(analysis_state_t *state, const float *samples, uint32_t sampling_rate, float *frequency, float *bands)
+{
+    double energy = 0.0;
+    double total = 0.0;
+    size_t half = CAPTURE_ANALYSIS_FRAME_SIZE / 2;
+    size_t peak = state->min_bin;
+
+    for (size_t i = 0; i < CAPTURE_ANALYSIS_FRAME_SIZE; i++)
+    {
+        energy += (double)samples[i] * samples[i];
+        state->re[i] = samples[i] * state->window[i];
+        state->im[i] = 0.0f;
+    }
+
+    if (sqrt(energy / CAPTURE_ANALYSIS_FRAME_SIZE) < ANALYSIS_SILENCE_LEVEL)
+    {
+        *frequency = NAN;
+        memset(bands, 0, CAPTURE_ANALYSIS_BANDS * sizeof(float));
+        return;
+    }
+
+    capture_analysis_fft_run(&state->fft, state->re, state->im);
+
+    /* Power spectrum is kept in re[] for the lower half */
+    for (size_t k = 0; k < half; k++)
+    {
+        state->re[k] = state->re[k] * state->re[k] + state->im[k] * state->im[k];
+    }
+
+    for (size_t k = state->min_bin; k < half - 1; k++)
+    {
+        if (state->re[k] > state->re[peak])
+        {
+            peak = k;
+        }
+    }
+
+    /* Parabolic interpolation of the log power gives sub-bin accuracy */
+    {
+        double l = log(state->re[peak - 1] + 1e-20);
+        double c = log(state->re[peak] + 1e-20);
+        double r = log(state->re[peak + 1] + 1e-20);
+        double denominator = l - 2.0 * c + r;
+        double delta = (denominator != 0.0) ? 0.5 * (l - r) / denominator : 0.0;
+
+        if (fabs(delta) > 0.5)
+        {
+            delta = 0.0;
+        }
+        *frequency = (float)(((double)peak + delta) * sampling_rate / CAPTURE_ANALYSIS_FRAME_SIZE);
+    }
+
+    for (int b = 0; b < CAPTURE_ANALYSIS_BANDS; b++)
+    {
+        double sum = 0.0;
+        for (size_t k = state->band_start[b]; (k < state->band_start[b + 1]) && (k < half); k++)
+        {
+            sum += state->re[k];
+        }
+        bands[b] = (float)sum;
+        total += sum;
+    }
+    for (int b = 0; b < CAPTURE_ANALYSIS_BANDS; b++)
+    {
+        bands[b] = (total > 0.0) ? (float)(bands[b] / total) : 0.0f;
+    }
+}
+
+/* Tracks the first non-silent sample and copies the excerpt used for delay estimation */
+static void captureExcerpt(capture_analysis_features_t *features, const float *samples, size_t count, size_t position, bool *started)
+{
+    for (size_t i = 0; (i < count) && (features->excerpt_len < CAPTURE_ANALYSIS_XCORR_SIZE); i++)
+    {
+        if (!*started)
+        {
+            if (fabsf(samples[i]) < ANALYSIS_SILENCE_LEVEL)
+            {
+                continue;
+            }
+            *started = true;
+            features->onset = position + i;
+        }
+        features->excerpt[features->excerpt_len++] = samples[i];
+    }
+}
+
+rmf_Error capture_analysis_extract(const char *path, capture_analysis_features_t *features)
+{
+    capture_wav_reader_t reader;
+    analysis_state_t *state;
+    float frame[CAPTURE_ANALYSIS_FRAME_SIZE];
+    size_t capacity;
+    size_t position = 0;
+    size_t got;
+    bool started = false;
+    bool full;
+    rmf_Error result;
+
+    if ((path == NULL) || (features == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(features, 0, sizeof(*features));
+
+    result = capture_wav_open(&reader, path);
+    if (result != RMF_SUCCESS)
+    {
+        return result;
+    }
+    features->sampling_rate = reader.sampling_rate;
+
+    capacity = (reader.data_bytes / ((reader.bits_per_sample / 8) * reader.channels)) / CAPTURE_ANALYSIS_HOP_SIZE + 1;
+    state = malloc(sizeof(*state));
+    features->frequency = malloc(capacity * sizeof(float));
+    features->bands = malloc(capacity * CAPTURE_ANALYSIS_BANDS * sizeof(float));
+    if ((state == NULL) || (features->frequency == NULL) || (features->bands == NULL) ||
+        (capture_analysis_fft_init(&state->fft, CAPTURE_ANALYSIS_FRAME_SIZE) != RMF_SUCCESS))
+    {
+        free(state);
+        capture_wav_close(&reader);
+        capture_analysis_release(features);
+        return RMF_ERROR;
+    }
+
+    for (size_t i = 0; i < CAPTURE_ANALYSIS_FRAME_SIZE; i++)
+    {
+        state->window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * (double)i / CAPTURE_ANALYSIS_FRAME_SIZE));
+    }
+    setupBands(state, reader.sampling_rate);
+
+    /* Frames overlap by FRAME_SIZE - HOP_SIZE, only the new hop is read each time */
+    got = capture_wav_read_mono(&reader, frame, CAPTURE_ANALYSIS_FRAME_SIZE);
+    captureExcerpt(features, frame, got, position, &started);
+    position += got;
+
+    full = (got == CAPTURE_ANALYSIS_FRAME_SIZE);
+    while (full)
+    {
+        float *tail = frame + CAPTURE_ANALYSIS_FRAME_SIZE - CAPTURE_ANALYSIS_HOP_SIZE;
+
+        if (features->frames < capacity)
+        {
+            analyseFrame(state, frame, reader.sampling_rate,
+                         &features->frequency[features->frames],
+                         &features->bands[features->frames * CAPTURE_ANALYSIS_BANDS]);
+            features->frames++;
+        }
+
+        memmove(frame, frame + CAPTURE_ANALYSIS_HOP_SIZE, (CAPTURE_ANALYSIS_FRAME_SIZE - CAPTURE_ANALYSIS_HOP_SIZE) * sizeof(float));
+        got = capture_wav_read_mono(&reader, tail, CAPTURE_ANALYSIS_HOP_SIZE);
+        captureExcerpt(features, tail, got, position, &started);
+        position += got;
+        full = (got == CAPTURE_ANALYSIS_HOP_SIZE);
+    }
+
+    capture_analysis_fft_deinit(&state->fft);
+    free(state);
+    capture_wav_close(&reader);
+    return RMF_SUCCESS;
+}
+
+void capture_analysis_release(capture_analysis_features_t *features)
+{
+    if (features == NULL)
+    {
+        return;
+    }
+    free(features->frequency);
+    free(features->bands);
+    features->frequency = NULL;
+    features->bands = NULL;
+    features->frames = 0;
+}
+
+/*
+ * Finds the lag maximising sum(capture[t + lag] * reference[t]) over the excerpts using
+ * an FFT of twice the excerpt length, then returns the exact normalised correlation of
+ * the overlapping samples at that lag.
+ */
+static rmf_Error crossCorrelate(const capture_analysis_features_t *reference, const capture_analysis_features_t *capture,
+                                int64_t *lag, double *peak)
+{
+    const size_t n = 2 * CAPTURE_ANALYSIS_XCORR_SIZE;
+    capture_analysis_fft_t fft;
+    float *refRe, *refIm, *capRe, *capIm;
+    size_t best = 0;
+    double dot = 0.0, refEnergy = 0.0, capEnergy = 0.0;
+    rmf_Error result;
+
+    result = capture_analysis_fft_init(&fft, n);
+    if (result != RMF_SUCCESS)
+    {
+        return result;
+    }
+    refRe = calloc(4 * n, sizeof(float));
+    if (refRe == NULL)
+    {
+        capture_analysis_fft_deinit(&fft);
+        return RMF_ERROR;
+    }
+    refIm = refRe + n;
+    capRe = refIm + n;
+    capIm = capRe + n;
+
+    memcpy(refRe, reference->excerpt, reference->excerpt_len * sizeof(float));
+    memcpy(capRe, capture->excerpt, capture->excerpt_len * sizeof(float));
+    capture_analysis_fft_run(&fft, refRe, refIm);
+    capture_analysis_fft_run(&fft, capRe, capIm);
+
+    /* conj(conj(REF) * CAP) is transformed forward again, which yields the inverse up to scale */
+    for (size_t k = 0; k < n; k++)
+    {
+        float pr = refRe[k] * capRe[k] + refIm[k] * capIm[k];
+        float pi = refRe[k] * capIm[k] - refIm[k] * capRe[k];
+        capRe[k] = pr;
+        capIm[k] = -pi;
+    }
+    capture_analysis_fft_run(&fft, capRe, capIm);
+
+    for (size_t k = 1; k < n; k++)
+    {
+        if (capRe[k] > capRe[best])
+        {
+            best = k;
+        }
+    }
+    *lag = (best < n / 2) ? (int64_t)best : (int64_t)best - (int64_t)n;
+
+    for (size_t t = 0; t < reference->excerpt_len; t++)
+    {
+        int64_t c = (int64_t)t + *lag;
+        if ((c < 0) || (c >= (int64_t)capture->excerpt_len))
+        {
+            continue;
+        }
+        dot += (double)reference->excerpt[t] * capture->excerpt[c];
+        refEnergy += (double)reference->excerpt[t] * reference->excerpt[t];
+        capEnergy += (double)capture->excerpt[c] * capture->excerpt[c];
+    }
+    *peak = ((refEnergy > 0.0) && (capEnergy > 0.0)) ? dot / sqrt(refEnergy * capEnergy) : NAN;
+
+    free(refRe);
+    capture_analysis_fft_deinit(&fft);
+    return RMF_SUCCESS;
+}
+
+static int compareFloat(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static double medianFrequency(const capture_analysis_features_t *features)
+{
+    float *voiced = malloc((features->frames + 1) * sizeof(float));
+    size_t count = 0;
+    double median = NAN;
+
+    if (voiced == NULL)
+    {
+        return NAN;
+    }
+    for (size_t i = 0; i < features->frames; i++)
+    {
+        if (!isnan(features->frequency[i]))
+        {
+            voiced[count++] = features->frequency[i];
+        }
+    }
+    if (count > 0)
+    {
+        qsort(voiced, count, sizeof(float), compareFloat);
+        median = (count & 1) ? voiced[count / 2] : 0.5 * (voiced[count / 2 - 1] + voiced[count / 2]);
+    }
+    free(voiced);
+    return median;
+}
+
+rmf_Error capture_analysis_compare(const capture_analysis_features_t *reference, const capture_analysis_features_t *capture,
+                                   double min_pitch_agreement, double min_spectral_similarity, capture_analysis_result_t *result)
+{
+    double delaySeconds;
+    size_t voiced = 0, agreed = 0, bothVoiced = 0;
+    double similarity = 0.0;
+    double sx = 0.0, sy = 0.0, sxx = 0.0, syy = 0.0, sxy = 0.0;
+
+    if ((reference == NULL) || (capture == NULL) || (result == NULL) ||
+        (reference->sampling_rate == 0) || (capture->sampling_rate == 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(result, 0, sizeof(*result));
+    result->xcorr_peak = NAN;
+    result->pitch_correlation = NAN;
+
+    /* Without a common rate the onsets alone give the delay */
+    result->delay_samples = (int64_t)capture->onset -
+                            (int64_t)((double)reference->onset * capture->sampling_rate / reference->sampling_rate);
+    if ((reference->sampling_rate == capture->sampling_rate) &&
+        (reference->excerpt_len >= ANALYSIS_MIN_XCORR_SAMPLES) && (capture->excerpt_len >= ANALYSIS_MIN_XCORR_SAMPLES))
+    {
+        int64_t lag = 0;
+        rmf_Error status = crossCorrelate(reference, capture, &lag, &result->xcorr_peak);
+        if (status != RMF_SUCCESS)
+        {
+            return status;
+        }
+        result->delay_samples = (int64_t)capture->onset + lag - (int64_t)reference->onset;
+    }
+    delaySeconds = (double)result->delay_samples / capture->sampling_rate;
+
+    for (size_t i = 0; i < reference->frames; i++)
+    {
+        double seconds = (double)i * CAPTURE_ANALYSIS_HOP_SIZE / reference->sampling_rate + delaySeconds;
+        int64_t j = (int64_t)floor(seconds * capture->sampling_rate / CAPTURE_ANALYSIS_HOP_SIZE + 0.5);
+        const float *refBands = &reference->bands[i * CAPTURE_ANALYSIS_BANDS];
+        const float *capBands;
+        float fr = reference->frequency[i];
+        float fc;
+
+        if ((j < 0) || (j >= (int64_t)capture->frames))
+        {
+            continue;
+        }
+        fc = capture->frequency[j];
+        capBands = &capture->bands[(size_t)j * CAPTURE_ANALYSIS_BANDS];
+        result->frames++;
+
+        if (isnan(fr) && isnan(fc))
+        {
+            continue; // Both silent, nothing to compare
+        }
+        voiced++;
+        if (isnan(fr) || isnan(fc))
+        {
+            continue; // Counted as disagreement, similarity contribution is zero
+        }
+
+        bothVoiced++;
+        if (fabs((double)fc - fr) <= CAPTURE_ANALYSIS_PITCH_TOLERANCE * fr)
+        {
+            agreed++;
+        }
+        sx += fr; sy += fc;
+        sxx += (double)fr * fr; syy += (double)fc * fc; sxy += (double)fr * fc;
+
+        {
+            double dot = 0.0, nr = 0.0, nc = 0.0;
+            for (int b = 0; b < CAPTURE_ANALYSIS_BANDS; b++)
+            {
+                dot += (double)refBands[b] * capBands[b];
+                nr += (double)refBands[b] * refBands[b];
+                nc += (double)capBands[b] * capBands[b];
+            }
+            if ((nr > 0.0) && (nc > 0.0))
+            {
+                similarity += dot / sqrt(nr * nc);
+            }
+        }
+    }
+
+    if (voiced > 0)
+    {
+        result->pitch_agreement = (double)agreed / voiced;
+        result->spectral_similarity = similarity / voiced;
+    }
+    if (bothVoiced > 1)
+    {
+        double n = (double)bothVoiced;
+        double varX = sxx / n - (sx / n) * (sx / n);
+        double varY = syy / n - (sy / n) * (sy / n);
+
+        if ((sqrt(fmax(varX, 0.0)) >= ANALYSIS_CONSTANT_TONE_HZ) && (sqrt(fmax(varY, 0.0)) >= ANALYSIS_CONSTANT_TONE_HZ))
+        {
+            result->pitch_correlation = (sxy / n - (sx / n) * (sy / n)) / sqrt(varX * varY);
+        }
+    }
+
+    result->reference_hz = medianFrequency(reference);
+    result->capture_hz = medianFrequency(capture);
+    result->match = (voiced > 0) &&
+                    (result->pitch_agreement >= min_pitch_agreement) &&
+                    (result->spectral_similarity >= min_spectral_similarity);
+    return RMF_SUCCESS;
+}
+
+rmf_Error capture_analysis_hash_file(const char *path, uint64_t *hash)
+{
+    uint8_t *block;
+    size_t got;
+    FILE *file;
+    uint64_t h = ANALYSIS_HASH_SEED;
+
+    if ((path == NULL) || (hash == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return RMF_INVALID_PARM;
+    }
+    block = malloc(ANALYSIS_HASH_BLOCK);
+    if (block == NULL)
+    {
+        fclose(file);
+        return RMF_ERROR;
+    }
+    while ((got = fread(block, 1, ANALYSIS_HASH_BLOCK, file)) > 0)
+    {
+        for (size_t i = 0; i < got; i++)
+        {
+            h = (h ^ block[i]) * ANALYSIS_HASH_MULTIPLIER;
+        }
+    }
+    free(block);
+    if (ferror(file))
+    {
+        fclose(file);
+        return RMF_ERROR;
+    }
+    fclose(file);
+    *hash = h;
+    return RMF_SUCCESS;
+}
+
+static void cachePath(char *path, size_t size, const char *cache_dir, uint64_t hash)
+{
+    snprintf(path, size, "%s/%016llx.features", cache_dir, (unsigned long long)hash);
+}
+
+/* The entry must be exactly as long as its header says, so a corrupt header never sizes an allocation */
+static bool cacheSizeMatches(FILE *file, const analysis_cache_header_t *header)
+{
+    const uint64_t frame_bytes = sizeof(float) * (1 + CAPTURE_ANALYSIS_BANDS);
+    uint64_t payload;
+    long size;
+
+    if ((fseek(file, 0, SEEK_END) != 0) || ((size = ftell(file)) < 0) ||
+        (fseek(file, (long)sizeof(*header), SEEK_SET) != 0) || ((uint64_t)size < sizeof(*header)))
+    {
+        return false;
+    }
+    payload = (uint64_t)size - sizeof(*header);
+    return (header->frames <= payload / frame_bytes) &&
+           (payload == header->frames * frame_bytes + header->excerpt_len * sizeof(float));
+}
+
+static bool loadCachedFeatures(const char *path, uint64_t hash, capture_analysis_features_t *features)
+{
+    analysis_cache_header_t header;
+    FILE *file;
+    bool ok;
+
+    file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    ok = (fread(&header, sizeof(header), 1, file) == 1) &&
+         (memcmp(header.magic, ANALYSIS_CACHE_MAGIC, sizeof(header.magic)) == 0) && (header.hash == hash) &&
+         (header.frame_size == CAPTURE_ANALYSIS_FRAME_SIZE) && (header.hop_size == CAPTURE_ANALYSIS_HOP_SIZE) &&
+         (header.bands == CAPTURE_ANALYSIS_BANDS) && (header.xcorr_size == CAPTURE_ANALYSIS_XCORR_SIZE) &&
+         (header.excerpt_len <= CAPTURE_ANALYSIS_XCORR_SIZE) && cacheSizeMatches(file, &header);
+    if (ok)
+    {
+        memset(features, 0, sizeof(*features));
+        features->sampling_rate = header.sampling_rate;
+        features->frames = (size_t)header.frames;
+        features->onset = (size_t)header.onset;
+        features->excerpt_len = (size_t)header.excerpt_len;
+        features->frequency = malloc((features->frames + 1) * sizeof(float));
+        features->bands = malloc((features->frames + 1) * CAPTURE_ANALYSIS_BANDS * sizeof(float));
+        ok = (features->frequency != NULL) && (features->bands != NULL) &&
+             (fread(features->frequency, sizeof(float), features->frames, file) == features->frames) &&
+             (fread(features->bands, sizeof(float) * CAPTURE_ANALYSIS_BANDS, features->frames, file) == features->frames) &&
+             (fread(features->excerpt, sizeof(float), features->excerpt_len, file) == features->excerpt_len);
+        if (!ok)
+        {
+            capture_analysis_release(features);
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+/* Written to a temporary file and renamed, so a concurrent reader never sees a partial cache entry */
+static void saveCachedFeatures(const char *path, uint64_t hash, const capture_analysis_features_t *features)
+{
+    analysis_cache_header_t header;
+    char temporary[PATH_MAX + 32];
+    FILE *file;
+    bool ok;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ANALYSIS_CACHE_MAGIC, sizeof(header.magic));
+    header.hash = hash;
+    header.frame_size = CAPTURE_ANALYSIS_FRAME_SIZE;
+    header.hop_size = CAPTURE_ANALYSIS_HOP_SIZE;
+    header.bands = CAPTURE_ANALYSIS_BANDS;
+    header.xcorr_size = CAPTURE_ANALYSIS_XCORR_SIZE;
+    header.sampling_rate = features->sampling_rate;
+    header.frames = features->frames;
+    header.onset = features->onset;
+    header.excerpt_len = features->excerpt_len;
+
+    if ((size_t)snprintf(temporary, sizeof(temporary), "%s.%ld.tmp", path, (long)getpid()) >= sizeof(temporary))
+    {
+        return;
+    }
+    file = fopen(temporary, "wb");
+    if (file == NULL)
+    {
+        return; // The cache is best effort, a read-only directory just means no caching
+    }
+    ok = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+         (fwrite(features->frequency, sizeof(float), features->frames, file) == features->frames) &&
+         (fwrite(features->bands, sizeof(float) * CAPTURE_ANALYSIS_BANDS, features->frames, file) == features->frames) &&
+         (fwrite(features->excerpt, sizeof(float), features->excerpt_len, file) == features->excerpt_len);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || (rename(temporary, path) != 0))
+    {
+        remove(temporary);
+    }
+}
+
+rmf_Error capture_analysis_extract_cached(const char *path, const char *cache_dir, capture_analysis_features_t *features, bool *cache_hit)
+{
+    char cached[PATH_MAX];
+    uint64_t hash;
+    rmf_Error result;
+
+    if (cache_hit != NULL)
+    {
+        *cache_hit = false;
+    }
+    if ((cache_dir == NULL) || (cache_dir[0] == '\0'))
+    {
+        return capture_analysis_extract(path, features);
+    }
+    if ((features == NULL) || (capture_analysis_hash_file(path, &hash) != RMF_SUCCESS))
+    {
+        return capture_analysis_extract(path, features);
+    }
+    cachePath(cached, sizeof(cached), cache_dir, hash);
+    if (loadCachedFeatures(cached, hash, features))
+    {
+        if (cache_hit != NULL)
+        {
+            *cache_hit = true;
+        }
+        return RMF_SUCCESS;
+    }
+    result = capture_analysis_extract(path, features);
+    if (result == RMF_SUCCESS)
+    {
+        saveCachedFeatures(cached, hash, features);
+    }
+    return result;
+}
+
+typedef struct
+{
+    const char *path;
+    const char *cache_dir;
+    capture_analysis_features_t *features;
+    bool cache_hit;
+    rmf_Error result;
+} analysis_job_t;
+
+static void *extractJob(void *arg)
+{
+    analysis_job_t *job = (analysis_job_t *)arg;
+
+    job->result = capture_analysis_extract_cached(job->path, job->cache_dir, job->features, &job->cache_hit);
+    return NULL;
+}
+
+rmf_Error capture_analysis_compare_files(const char *reference_path, const char *capture_path, const char *cache_dir,
+                                         double min_pitch_agreement, double min_spectral_similarity, capture_analysis_result_t *result)
+{
+    capture_analysis_features_t *reference = malloc(sizeof(*reference));
+    capture_analysis_features_t *capture = malloc(sizeof(*capture));
+    analysis_job_t job = { reference_path, cache_dir, reference, false, RMF_ERROR };
+    pthread_t thread;
+    rmf_Error captureResult;
+    rmf_Error status = RMF_ERROR;
+
+    if ((reference != NULL) && (capture != NULL) && (result != NULL))
+    {
+        /* The reference is extracted, or loaded from the cache, while this thread extracts the capture */
+        if (pthread_create(&thread, NULL, extractJob, &job) == 0)
+        {
+            captureResult = capture_analysis_extract(capture_path, capture);
+            pthread_join(thread, NULL);
+        }
+        else
+        {
+            extractJob(&job);
+            captureResult = capture_analysis_extract(capture_path, capture);
+        }
+
+        status = (job.result != RMF_SUCCESS) ? job.result : captureResult;
+        if (status == RMF_SUCCESS)
+        {
+            status = capture_analysis_compare(reference, capture, min_pitch_agreement, min_spectral_similarity, result);
+            result->reference_cached = job.cache_hit;
+        }
+        if (job.result == RMF_SUCCESS)
+        {
+            capture_analysis_release(reference);
+        }
+        if (captureResult == RMF_SUCCESS)
+        {
+            capture_analysis_release(capture);
+        }
+    }
+    free(reference);
+    free(capture);
+    return status;
+}
@@ -0,0 +1,148 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_analysis.h
+*
+* On-device comparison of a captured WAV file against its reference stream.
+*
+* Both files are reduced, frame by frame, to a dominant-frequency track and a
+* spectral fingerprint (normalised energy in log spaced bands). The start of each
+* file is cross-correlated to find the capture delay, the tracks are aligned by that
+* delay and compared. Only the small capture_analysis_result_t needs to leave the device.
+*
+* The features of a reference stream do not change between tests, so they can be cached
+* in a directory, keyed by a hash of the file contents. A cached reference is loaded
+* instead of being analysed again, and the reference and the capture are analysed on
+* separate threads.
+*/
+
+#ifndef CAPTURE_ANALYSIS_H
+#define CAPTURE_ANALYSIS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_ANALYSIS_FRAME_SIZE                 4096    // FFT length per analysis frame
+#define CAPTURE_ANALYSIS_HOP_SIZE                   2048    // Frame advance in samples
+#define CAPTURE_ANALYSIS_BANDS                      24      // Fingerprint bands per frame
+#define CAPTURE_ANALYSIS_XCORR_SIZE                 16384   // Samples from each file used for delay estimation
+#define CAPTURE_ANALYSIS_PITCH_TOLERANCE            0.03    // Relative tolerance for matching dominant frequencies
+#define CAPTURE_ANALYSIS_MIN_PITCH_AGREEMENT        0.95    // Default fraction of frames whose dominant frequency must match
+#define CAPTURE_ANALYSIS_MIN_SPECTRAL_SIMILARITY    0.90    // Default mean cosine similarity of the fingerprints
+#define CAPTURE_ANALYSIS_CACHE_ENV "RMF_AUDIOCAPTURE_ANALYSIS_CACHE" // Reference features cache directory, empty to disable
+
+/**
+ * @brief Precomputed twiddle factors for a power of two length FFT
+ */
+typedef struct
+{
+    size_t n;
+    float *cos_table;
+    float *sin_table;
+} capture_analysis_fft_t;
+
+/**
+ * @brief Per-file features extracted by capture_analysis_extract()
+ */
+typedef struct
+{
+    uint32_t sampling_rate;
+    size_t frames;              // Number of analysis frames
+    float *frequency;           // Dominant frequency per frame in Hz, NaN for silent frames
+    float *bands;               // frames * CAPTURE_ANALYSIS_BANDS fingerprint values, each frame sums to 1
+    size_t onset;               // Index of the first non-silent sample
+    size_t excerpt_len;         // Valid samples in excerpt
+    float excerpt[CAPTURE_ANALYSIS_XCORR_SIZE]; // Mono samples starting at onset, used for delay estimation
+} capture_analysis_features_t;
+
+/**
+ * @brief Result of comparing a capture with its reference
+ */
+typedef struct
+{
+    bool match;                 // pitch_agreement and spectral_similarity both met their thresholds
+    size_t frames;              // Aligned frames compared
+    int64_t delay_samples;      // Capture delay relative to the reference, positive when the capture is late
+    double xcorr_peak;          // Normalised cross-correlation peak of the aligned excerpts, NaN if not computed
+    double pitch_agreement;     // Fraction of voiced frames whose dominant frequencies agree
+    double pitch_correlation;   // Pearson correlation of the dominant-frequency tracks, NaN for constant tones
+    double spectral_similarity; // Mean cosine similarity of the fingerprints
+    double reference_hz;        // Median dominant frequency of the reference
+    double capture_hz;          // Median dominant frequency of the capture
+    bool reference_cached;      // The reference features were loaded from the cache
+} capture_analysis_result_t;
+
+/**
+ * @brief Prepares an FFT of length n, which must be a power of two
+ */
+rmf_Error capture_analysis_fft_init(capture_analysis_fft_t *fft, size_t n);
+
+/**
+ * @brief In-place forward complex FFT using radix-4 stages and a final radix-2 stage for odd powers
+ */
+void capture_analysis_fft_run(const capture_analysis_fft_t *fft, float *re, float *im);
+
+void capture_analysis_fft_deinit(capture_analysis_fft_t *fft);
+
+/**
+ * @brief Streams a WAV file and extracts its dominant-frequency track and spectral fingerprint
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for an unsupported file, RMF_ERROR on I/O or allocation failure
+ */
+rmf_Error capture_analysis_extract(const char *path, capture_analysis_features_t *features);
+
+void capture_analysis_release(capture_analysis_features_t *features);
+
+/**
+ * @brief 64 bit FNV-1a hash of a file's contents
+ */
+rmf_Error capture_analysis_hash_file(const char *path, uint64_t *hash);
+
+/**
+ * @brief Extracts features like capture_analysis_extract(), through a cache of features keyed by content hash
+ *
+ * Entries are stored as <cache_dir>/<hash>.features. A missing, stale or unreadable entry is
+ * replaced by extracting the file; failing to write the entry is not an error.
+ *
+ * @param cache_dir - cache directory, NULL or empty to extract without caching
+ * @param cache_hit - optional, set when the features came from the cache
+ */
+rmf_Error capture_analysis_extract_cached(const char *path, const char *cache_dir, capture_analysis_features_t *features, bool *cache_hit);
+
+/**
+ * @brief Compares capture features against reference features
+ *
+ * @param min_pitch_agreement - fraction of voiced frames that must agree, e.g. CAPTURE_ANALYSIS_MIN_PITCH_AGREEMENT
+ * @param min_spectral_similarity - required mean fingerprint similarity, e.g. CAPTURE_ANALYSIS_MIN_SPECTRAL_SIMILARITY
+ */
+rmf_Error capture_analysis_compare(const capture_analysis_features_t *reference, const capture_analysis_features_t *capture,
+                                   double min_pitch_agreement, double min_spectral_similarity, capture_analysis_result_t *result);
+
+/**
+ * @brief Convenience wrapper extracting both files in parallel and comparing them
+ *
+ * @param cache_dir - cache directory for the reference features, NULL to always extract them
+ */
+rmf_Error capture_analysis_compare_files(const char *reference_path, const char *capture_path, const char *cache_dir,
+                                         double min_pitch_agreement, double min_spectral_similarity, capture_analysis_result_t *result);
+
+#endif // CAPTURE_ANALYSIS_H
@@ -0,0 +1,479 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_async.c
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture_async.h"
+#include "capture_pool.h"
+
+#define ASYNC_CACHE_LINE 64
+#define ASYNC_BUFFER_BYTES_DEFAULT (64 * 1024)
+
+/* Producer and consumer indexes on separate cache lines, each written by one thread only */
+struct capture_async
+{
+    uint32_t head;              // Next slot the HAL thread fills
+    uint8_t pad0[ASYNC_CACHE_LINE - sizeof(uint32_t)];
+    uint32_t tail;              // Next slot the worker takes
+    uint8_t pad1[ASYNC_CACHE_LINE - sizeof(uint32_t)];
+
+    RMF_AudioCaptureHandle handle;
+    RMF_AudioCaptureBufferReadyCb callback;
+    void *parm;
+    uint32_t depth;
+    uint32_t mask;
+    capture_pool_buffer_t **queue;
+    capture_pool_t *pool;
+    sem_t ready;
+    pthread_t worker;
+    int worker_started;
+    int stopping;
+    int flush;                  // Set on stop, a partial batch is passed on without waiting for its budget
+    capture_async_coalesce_t coalesce;
+    int coalescing;
+    uint8_t *batch;             // Where the worker joins the buffers of a batch
+    uint32_t batch_capacity;
+    uint32_t batch_limit;       // Bytes passed in one call, except for a single larger buffer
+
+    /* Written by the HAL thread */
+    uint64_t buffers;
+    uint64_t queue_full;
+    uint64_t truncated;
+    uint32_t queue_high_water;
+    uint64_t hold_total_ns;
+    uint64_t hold_max_ns;
+    uint64_t pushed_bytes;
+    uint64_t wakeups;
+
+    /* Written by the thread calling the consumer */
+    uint64_t dispatched;
+    uint64_t calls;
+    uint64_t consumer_total_ns;
+    uint64_t consumer_max_ns;
+    uint64_t popped_bytes;
+    uint64_t delivered_bytes;
+};
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void recordMax(uint64_t *max, uint64_t value)
+{
+    if (value > __atomic_load_n(max, __ATOMIC_RELAXED))
+    {
+        __atomic_store_n(max, value, __ATOMIC_RELAXED);
+    }
+}
+
+static void dispatch(capture_async_t *async, void *data, unsigned int bytes, uint32_t buffers)
+{
+    uint64_t start = nowNs();
+    uint64_t elapsed;
+
+    async->callback(async->parm, data, bytes);
+    elapsed = nowNs() - start;
+    __atomic_store_n(&async->dispatched, async->dispatched + buffers, __ATOMIC_RELAXED);
+    __atomic_store_n(&async->calls, async->calls + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&async->consumer_total_ns, async->consumer_total_ns + elapsed, __ATOMIC_RELAXED);
+    recordMax(&async->consumer_max_ns, elapsed);
+    __atomic_store_n(&async->delivered_bytes, async->delivered_bytes + bytes, __ATOMIC_RELEASE);
+}
+
+static void wake(capture_async_t *async)
+{
+    __atomic_store_n(&async->wakeups, async->wakeups + 1, __ATOMIC_RELAXED);
+    sem_post(&async->ready);
+}
+
+static rmf_Error asyncBufferReady(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    capture_async_t *async = (capture_async_t *)context_blob;
+    uint64_t start = nowNs();
+    uint64_t elapsed;
+
+    __atomic_store_n(&async->buffers, async->buffers + 1, __ATOMIC_RELAXED);
+    if (async->depth == 0)
+    {
+        __atomic_store_n(&async->pushed_bytes, async->pushed_bytes + AudioCaptureBufferSize, __ATOMIC_RELAXED);
+        dispatch(async, AudioCaptureBuffer, AudioCaptureBufferSize, 1);
+    }
+    else
+    {
+        capture_pool_buffer_t *buffer = capture_pool_acquire(async->pool);
+
+        if (buffer != NULL)
+        {
+            uint32_t head = async->head;
+            uint32_t queued = head - __atomic_load_n(&async->tail, __ATOMIC_ACQUIRE);
+            uint64_t queued_bytes = async->pushed_bytes - __atomic_load_n(&async->popped_bytes, __ATOMIC_ACQUIRE);
+
+            if (queued >= async->depth)
+            {
+                __atomic_store_n(&async->queue_full, async->queue_full + 1, __ATOMIC_RELAXED);
+                capture_pool_release(buffer);
+            }
+            else
+            {
+                buffer->bytes = AudioCaptureBufferSize;
+                if (AudioCaptureBufferSize > buffer->capacity)
+                {
+                    __atomic_store_n(&async->truncated, async->truncated + 1, __ATOMIC_RELAXED);
+                    buffer->bytes = buffer->capacity;
+                }
+                memcpy(buffer->data, AudioCaptureBuffer, buffer->bytes);
+                buffer->timestamp_ns = start;
+                async->queue[head & async->mask] = buffer;
+                __atomic_store_n(&async->pushed_bytes, async->pushed_bytes + buffer->bytes, __ATOMIC_RELAXED);
+                __atomic_store_n(&async->head, head + 1, __ATOMIC_RELEASE);
+                if (queued + 1 > async->queue_high_water)
+                {
+                    __atomic_store_n(&async->queue_high_water, queued + 1, __ATOMIC_RELAXED);
+                }
+                /* When coalescing wake the worker to start the time budget, or when the byte budget is reached */
+                if (!async->coalescing ||
+                    ((async->coalesce.ms > 0) && (queued == 0)) ||
+                    ((async->coalesce.bytes > 0) && (queued_bytes < async->coalesce.bytes) &&
+                     (queued_bytes + buffer->bytes >= async->coalesce.bytes)) ||
+                    (2 * (queued + 1) >= async->depth))
+                {
+                    wake(async);
+                }
+            }
+        }
+    }
+
+    elapsed = nowNs() - start;
+    __atomic_store_n(&async->hold_total_ns, async->hold_total_ns + elapsed, __ATOMIC_RELAXED);
+    recordMax(&async->hold_max_ns, elapsed);
+    return RMF_SUCCESS;
+}
+
+static void waitReady(capture_async_t *async, uint64_t deadline_ns)
+{
+    struct timespec deadline;
+    uint64_t now;
+
+    if (deadline_ns == 0)
+    {
+        while ((sem_wait(&async->ready) != 0) && (errno == EINTR))
+        {
+        }
+        return;
+    }
+    /* sem_timedwait() takes CLOCK_REALTIME, move the CLOCK_MONOTONIC deadline across */
+    now = nowNs();
+    if (deadline_ns <= now)
+    {
+        return;
+    }
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline_ns = (uint64_t)deadline.tv_sec * 1000000000ull + (uint64_t)deadline.tv_nsec + (deadline_ns - now);
+    deadline.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    deadline.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    while ((sem_timedwait(&async->ready, &deadline) != 0) && (errno == EINTR))
+    {
+    }
+}
+
+/* Takes the oldest buffer off the queue */
+static capture_pool_buffer_t *take(capture_async_t *async, uint32_t tail)
+{
+    capture_pool_buffer_t *buffer = async->queue[tail & async->mask];
+
+    __atomic_store_n(&async->popped_bytes, async->popped_bytes + buffer->bytes, __ATOMIC_RELEASE);
+    __atomic_store_n(&async->tail, tail + 1, __ATOMIC_RELEASE);
+    return buffer;
+}
+
+/* Passes the queued buffers to the consumer in one call once a budget is reached, returns 0 if none is */
+static int coalesce(capture_async_t *async, uint32_t tail, uint32_t head)
+{
+    uint64_t queued_bytes = 0;
+    uint64_t oldest_ns = async->queue[tail & async->mask]->timestamp_ns;
+    uint64_t deadline_ns = (async->coalesce.ms > 0) ? oldest_ns + (uint64_t)async->coalesce.ms * 1000000ull : 0;
+    uint32_t length = 0;
+    uint32_t buffers = 0;
+
+    for (uint32_t i = tail; i != head; i++)
+    {
+        queued_bytes += async->queue[i & async->mask]->bytes;
+    }
+    if (!__atomic_load_n(&async->flush, __ATOMIC_ACQUIRE) &&
+        !__atomic_load_n(&async->stopping, __ATOMIC_ACQUIRE) &&
+        ((async->coalesce.bytes == 0) || (queued_bytes < async->coalesce.bytes)) &&
+        ((deadline_ns == 0) || (nowNs() < deadline_ns)) &&
+        (queued_bytes < async->batch_limit) &&
+        (2 * (head - tail) < async->depth))
+    {
+        waitReady(async, deadline_ns);
+        return 0;
+    }
+
+    while ((tail != head) && ((length == 0) || (length + async->queue[tail & async->mask]->bytes <= async->batch_limit)))
+    {
+        capture_pool_buffer_t *buffer = take(async, tail++);
+
+        memcpy(async->batch + length, buffer->data, buffer->bytes);
+        length += buffer->bytes;
+        buffers++;
+        capture_pool_release(buffer);
+    }
+    dispatch(async, async->batch, length, buffers);
+    return 1;
+}
+
+static void *asyncWorker(void *arg)
+{
+    capture_async_t *async = (capture_async_t *)arg;
+
+    for (;;)
+    {
+        uint32_t tail = async->tail;
+        uint32_t head = __atomic_load_n(&async->head, __ATOMIC_ACQUIRE);
+        capture_pool_buffer_t *buffer;
+
+        if (tail == head)
+        {
+            if (__atomic_load_n(&async->stopping, __ATOMIC_ACQUIRE))
+            {
+                break;
+            }
+            waitReady(async, 0);
+            continue;
+        }
+        if (async->coalescing)
+        {
+            coalesce(async, tail, head);
+            continue;
+        }
+        buffer = take(async, tail);
+        dispatch(async, buffer->data, buffer->bytes, 1);
+        capture_pool_release(buffer);
+    }
+    return NULL;
+}
+
+static void release(capture_async_t *async)
+{
+    if (async->worker_started)
+    {
+        __atomic_store_n(&async->stopping, 1, __ATOMIC_RELEASE);
+        sem_post(&async->ready);
+        pthread_join(async->worker, NULL);
+    }
+    if (async->queue != NULL)
+    {
+        sem_destroy(&async->ready);
+    }
+    capture_pool_destroy(async->pool);
+    free(async->batch);
+    free(async->queue);
+    free(async);
+}
+
+rmf_Error capture_async_start(capture_async_t **async, RMF_AudioCaptureHandle handle, const RMF_AudioCapture_Settings *settings, uint32_t depth)
+{
+    return capture_async_start_coalesced(async, handle, settings, depth, NULL);
+}
+
+rmf_Error capture_async_start_coalesced(capture_async_t **async, RMF_AudioCaptureHandle handle, const RMF_AudioCapture_Settings *settings,
+                                        uint32_t depth, const capture_async_coalesce_t *coalesce)
+{
+    RMF_AudioCapture_Settings internal;
+    capture_async_t *created;
+    uint32_t size = 1;
+    uint32_t bytes;
+    rmf_Error result;
+
+    if ((async == NULL) || (settings == NULL) || (settings->cbBufferReady == NULL) || (depth > (1u << 16)) ||
+        ((coalesce != NULL) && (coalesce->bytes > CAPTURE_ASYNC_BATCH_MAX)))
+    {
+        return RMF_INVALID_PARM;
+    }
+    bytes = (settings->fifoSize > 0) ? (uint32_t)settings->fifoSize : (uint32_t)settings->threshold;
+    if (bytes == 0)
+    {
+        bytes = ASYNC_BUFFER_BYTES_DEFAULT;
+    }
+    if ((coalesce != NULL) && ((coalesce->bytes > 0) || (coalesce->ms > 0)))
+    {
+        /* Twice the buffers of a batch, so the HAL can fill one while the worker passes on the other */
+        uint32_t per_buffer = (settings->threshold > 0) ? (uint32_t)settings->threshold : bytes;
+        uint32_t batch_buffers = (coalesce->bytes + per_buffer - 1) / per_buffer;
+
+        if (depth < 2 * batch_buffers)
+        {
+            depth = (batch_buffers < (1u << 15)) ? 2 * batch_buffers : (1u << 16);
+        }
+        if (depth == 0)
+        {
+            depth = CAPTURE_ASYNC_DEPTH_DEFAULT;
+        }
+    }
+    if (posix_memalign((void **)&created, ASYNC_CACHE_LINE, sizeof(*created)) != 0)
+    {
+        return RMF_ERROR;
+    }
+    memset(created, 0, sizeof(*created));
+    created->handle = handle;
+    created->callback = settings->cbBufferReady;
+    created->parm = settings->cbBufferReadyParm;
+    created->depth = depth;
+
+    if ((coalesce != NULL) && ((coalesce->bytes > 0) || (coalesce->ms > 0)))
+    {
+        created->coalesce = *coalesce;
+        created->coalescing = 1;
+        /* Without a byte budget a batch is at most half the queue, which is when it is passed on anyway */
+        created->batch_limit = (coalesce->bytes > 0) ? coalesce->bytes : bytes * ((depth + 1) / 2);
+        created->batch_capacity = created->batch_limit;
+        if (created->batch_capacity < bytes)
+        {
+            created->batch_capacity = bytes;
+        }
+        created->batch = (uint8_t *)malloc(created->batch_capacity);
+        if (created->batch == NULL)
+        {
+            release(created);
+            return RMF_ERROR;
+        }
+    }
+
+    if (depth > 0)
+    {
+        while (size < depth)
+        {
+            size <<= 1;
+        }
+        created->mask = size - 1;
+        created->queue = (capture_pool_buffer_t **)calloc(size, sizeof(capture_pool_buffer_t *));
+        if ((created->queue == NULL) || (sem_init(&created->ready, 0, 0) != 0))
+        {
+            free(created->queue);
+            created->queue = NULL;
+            release(created);
+            return RMF_ERROR;
+        }
+        /* The queued buffers, one with the consumer and one being filled */
+        if (RMF_SUCCESS != capture_pool_create(&created->pool, bytes, depth + 2, 0))
+        {
+            release(created);
+            return RMF_ERROR;
+        }
+        if (pthread_create(&created->worker, NULL, asyncWorker, created) != 0)
+        {
+            release(created);
+            return RMF_ERROR;
+        }
+        created->worker_started = 1;
+    }
+
+    internal = *settings;
+    internal.cbBufferReady = asyncBufferReady;
+    internal.cbBufferReadyParm = created;
+    result = RMF_AudioCapture_Start(handle, &internal);
+    if (result != RMF_SUCCESS)
+    {
+        release(created);
+        return result;
+    }
+    *async = created;
+    return RMF_SUCCESS;
+}
+
+rmf_Error capture_async_stop(capture_async_t *async)
+{
+    rmf_Error result;
+    uint64_t deadline;
+
+    if (async == NULL)
+    {
+        return RMF_INVALID_PARM;
+    }
+    result = RMF_AudioCapture_Stop(async->handle);
+    if (async->depth == 0)
+    {
+        return result;
+    }
+    __atomic_store_n(&async->flush, 1, __ATOMIC_RELEASE);
+    sem_post(&async->ready);
+    deadline = nowNs() + (uint64_t)CAPTURE_ASYNC_DRAIN_MS * 1000000ull;
+    while ((__atomic_load_n(&async->delivered_bytes, __ATOMIC_ACQUIRE) != __atomic_load_n(&async->pushed_bytes, __ATOMIC_ACQUIRE)) &&
+           (nowNs() < deadline))
+    {
+        usleep(1000);
+    }
+    return result;
+}
+
+void capture_async_stats(const capture_async_t *async, capture_async_stats_t *stats)
+{
+    capture_pool_stats_t pool;
+    uint64_t buffers, dispatched;
+
+    if (stats == NULL)
+    {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (async == NULL)
+    {
+        return;
+    }
+    buffers = __atomic_load_n(&async->buffers, __ATOMIC_RELAXED);
+    dispatched = __atomic_load_n(&async->dispatched, __ATOMIC_RELAXED);
+    capture_pool_stats(async->pool, &pool);
+
+    stats->depth = async->depth;
+    stats->buffers = buffers;
+    stats->dispatched = dispatched;
+    stats->calls = __atomic_load_n(&async->calls, __ATOMIC_RELAXED);
+    stats->wakeups = __atomic_load_n(&async->wakeups, __ATOMIC_RELAXED);
+    stats->queue_full = __atomic_load_n(&async->queue_full, __ATOMIC_RELAXED);
+    stats->pool_exhausted = pool.exhausted;
+    stats->truncated = __atomic_load_n(&async->truncated, __ATOMIC_RELAXED);
+    stats->queue_high_water = __atomic_load_n(&async->queue_high_water, __ATOMIC_RELAXED);
+    stats->pool_high_water = pool.high_water;
+    stats->hold_mean_ns = (buffers > 0) ? (double)__atomic_load_n(&async->hold_total_ns, __ATOMIC_RELAXED) / buffers : 0.0;
+    stats->hold_max_ns = __atomic_load_n(&async->hold_max_ns, __ATOMIC_RELAXED);
+    stats->consumer_mean_ns = (stats->calls > 0) ? (double)__atomic_load_n(&async->consumer_total_ns, __ATOMIC_RELAXED) / stats->calls : 0.0;
+    stats->consumer_max_ns = __atomic_load_n(&async->consumer_max_ns, __ATOMIC_RELAXED);
+}
+
+void capture_async_destroy(capture_async_t *async)
+{
+    if (async != NULL)
+    {
+        release(async);
+    }
+}
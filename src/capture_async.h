@@ -0,0 +1,127 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_async.h
+*
+* Asynchronous dispatch of the data callback, so a slow consumer does not hold the HAL thread.
+*
+* capture_async_start() starts the capture with an internal cbBufferReady. It copies each
+* buffer into a reference counted pool buffer (see capture_pool.h) and pushes it onto a
+* wait free single producer, single consumer queue. A worker thread pops the buffers and
+* calls the consumer's cbBufferReady with the consumer's cbBufferReadyParm, exactly as
+* the HAL would have. cbStatusChange is passed to the HAL unchanged.
+*
+* The HAL thread therefore holds the callback only for the copy. When the queue or the
+* pool is full the buffer is dropped and counted, the HAL thread never waits. The time
+* the HAL thread spends in the callback and the time the consumer takes are both
+* measured. A queue depth of 0 calls the consumer directly on the HAL thread with the
+* same measurements, to compare the two.
+*
+* capture_async_start_coalesced() also batches the buffers: the worker leaves them queued
+* until a byte budget is reached, or the oldest has waited a time budget, and then passes
+* them to the consumer in one call. The HAL thread wakes the worker only when the budget
+* is reached, or when the first buffer of a batch starts the time budget, so a background
+* consumer such as a loudness meter wakes a few times a second rather than once per buffer.
+*/
+
+#ifndef CAPTURE_ASYNC_H
+#define CAPTURE_ASYNC_H
+
+#include <stdint.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_ASYNC_DEPTH_DEFAULT 16          // Buffers queued, about 0.7 s of 8 KB buffers at 48 kHz 16 bit stereo
+#define CAPTURE_ASYNC_DRAIN_MS      2000        // Longest wait for the consumer to catch up on stop
+#define CAPTURE_ASYNC_BATCH_MAX     (1024 * 1024) // Largest byte budget of a coalesced call
+
+typedef struct capture_async capture_async_t;
+
+typedef struct
+{
+    uint32_t bytes;             // Call the consumer once this many bytes are queued, 0 for no byte budget
+    uint32_t ms;                // Call the consumer once the oldest queued buffer is this old, 0 for no time budget
+} capture_async_coalesce_t;
+
+typedef struct
+{
+    uint32_t depth;             // Queue depth, 0 when the consumer is called directly
+    uint64_t buffers;           // Buffers delivered by the HAL
+    uint64_t dispatched;        // Buffers passed to the consumer
+    uint64_t calls;             // Consumer calls, fewer than dispatched when coalescing
+    uint64_t wakeups;           // Times the HAL thread woke the worker
+    uint64_t queue_full;        // Buffers dropped because the queue was full
+    uint64_t pool_exhausted;    // Buffers dropped because every pool buffer was referenced
+    uint64_t truncated;         // Buffers larger than a pool buffer, cut to fit
+    uint32_t queue_high_water;  // Most buffers queued at once
+    uint32_t pool_high_water;   // Most pool buffers referenced at once
+    double hold_mean_ns;        // HAL thread time in the callback
+    uint64_t hold_max_ns;
+    double consumer_mean_ns;    // Time in the consumer's callback, per call
+    uint64_t consumer_max_ns;
+} capture_async_stats_t;
+
+/**
+ * @brief Starts capture on handle, dispatching settings->cbBufferReady on a worker thread
+ *
+ * The pool buffers hold settings->fifoSize bytes, or settings->threshold when no FIFO size is set.
+ *
+ * @param[in] depth - Queue depth, 0 to call the consumer on the HAL thread
+ *
+ * @return The result of RMF_AudioCapture_Start(), or RMF_INVALID_PARM / RMF_ERROR if the adapter could not be set up
+ */
+rmf_Error capture_async_start(capture_async_t **async, RMF_AudioCaptureHandle handle, const RMF_AudioCapture_Settings *settings, uint32_t depth);
+
+/**
+ * @brief As capture_async_start(), passing the queued buffers to the consumer in batches
+ *
+ * The consumer receives the audio of consecutive buffers, in order, in one call of at most
+ * coalesce->bytes bytes, or of one buffer if a buffer is larger. A budget of 8 KB periods is
+ * therefore coalesce->bytes = periods * settings->threshold. The queue must hold a whole
+ * batch, so depth is raised to twice the settings->threshold buffers in one when it is
+ * smaller, including 0.
+ * A NULL coalesce, or one with both budgets 0, is the same as capture_async_start().
+ *
+ * @return As capture_async_start(), RMF_INVALID_PARM for a byte budget over CAPTURE_ASYNC_BATCH_MAX
+ */
+rmf_Error capture_async_start_coalesced(capture_async_t **async, RMF_AudioCaptureHandle handle, const RMF_AudioCapture_Settings *settings,
+                                        uint32_t depth, const capture_async_coalesce_t *coalesce);
+
+/**
+ * @brief Stops capture and waits up to CAPTURE_ASYNC_DRAIN_MS for the consumer to take the queued buffers
+ *
+ * A partial batch is passed to the consumer without waiting for its budget.
+ *
+ * @return The result of RMF_AudioCapture_Stop()
+ */
+rmf_Error capture_async_stop(capture_async_t *async);
+
+/**
+ * @brief Copies the counters and timings
+ */
+void capture_async_stats(const capture_async_t *async, capture_async_stats_t *stats);
+
+/**
+ * @brief Stops the worker and frees the adapter, after RMF_AudioCapture_Close()
+ *
+ * The HAL may call the callback until the handle is closed, so the adapter must outlive it.
+ */
+void capture_async_destroy(capture_async_t *async);
+
+#endif // CAPTURE_ASYNC_H
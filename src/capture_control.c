@@ -0,0 +1,199 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_control.c
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "capture_control.h"
+
+/* Handles one request line, returns false when the channel should stop */
+static bool handleLine(char *line, FILE *out, capture_control_handler_t handler, void *ctx)
+{
+    capture_json_object_t request;
+    capture_json_writer_t response;
+    char text[CAPTURE_CONTROL_LINE_MAX * 4];
+    bool keepRunning = true;
+    size_t len = strlen(line);
+
+    while ((len > 0) && ((line[len - 1] == '\n') || (line[len - 1] == '\r')))
+    {
+        line[--len] = '\0';
+    }
+    if ((len == 0) || (line[0] == '#'))
+    {
+        return true; // Blank lines and comments are allowed in command files
+    }
+
+    capture_json_begin(&response, text, sizeof(text));
+    if (capture_json_parse(line, &request) != RMF_SUCCESS)
+    {
+        capture_json_add_string(&response, "cmd", NULL);
+        capture_json_add_string(&response, "result", "RMF_INVALID_PARM");
+        capture_json_add_string(&response, "error", "malformed request");
+    }
+    else
+    {
+        if (capture_json_has(&request, "id"))
+        {
+            capture_json_add_string(&response, "id", capture_json_get_string(&request, "id", ""));
+        }
+        keepRunning = handler(ctx, &request, &response);
+    }
+
+    if (capture_json_end(&response) == NULL)
+    {
+        capture_json_begin(&response, text, sizeof(text));
+        capture_json_add_string(&response, "result", "RMF_ERROR");
+        capture_json_add_string(&response, "error", "response too large");
+        capture_json_end(&response);
+    }
+    fprintf(out, "%s\n", text);
+    fflush(out);
+    return keepRunning;
+}
+
+static rmf_Error serveStream(FILE *in, FILE *out, capture_control_handler_t handler, void *ctx, bool *stopped)
+{
+    char line[CAPTURE_CONTROL_LINE_MAX];
+
+    *stopped = false;
+    while (fgets(line, sizeof(line), in) != NULL)
+    {
+        if (!handleLine(line, out, handler, ctx))
+        {
+            *stopped = true;
+            break;
+        }
+    }
+    return RMF_SUCCESS;
+}
+
+static rmf_Error serveUnixSocket(const char *path, capture_control_handler_t handler, void *ctx)
+{
+    struct sockaddr_un addr;
+    bool stopped = false;
+    int listenFd;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+    {
+        return RMF_ERROR;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+
+    if ((bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (listen(listenFd, 1) != 0))
+    {
+        close(listenFd);
+        return RMF_ERROR;
+    }
+
+    while (!stopped)
+    {
+        int clientFd = accept(listenFd, NULL, NULL);
+        FILE *in;
+        FILE *out;
+
+        if (clientFd < 0)
+        {
+            break;
+        }
+        in = fdopen(clientFd, "r");
+        out = fdopen(dup(clientFd), "w");
+        if ((in == NULL) || (out == NULL))
+        {
+            if (in) fclose(in); else close(clientFd);
+            if (out) fclose(out);
+            continue;
+        }
+        serveStream(in, out, handler, ctx, &stopped);
+        fclose(out);
+        fclose(in);
+    }
+
+    close(listenFd);
+    unlink(path);
+    return RMF_SUCCESS;
+}
+
+rmf_Error capture_control_serve(const char *spec, capture_control_handler_t handler, void *ctx)
+{
+    bool stopped = false;
+    rmf_Error result;
+
+    if ((spec == NULL) || (handler == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    if (strcmp(spec, "stdio") == 0)
+    {
+        return serveStream(stdin, stdout, handler, ctx, &stopped);
+    }
+
+    if (strncmp(spec, "file:", 5) == 0)
+    {
+        const char *resultsPath = getenv(CAPTURE_CONTROL_RESULTS_ENV);
+        FILE *in = fopen(spec + 5, "r");
+        FILE *out = stdout;
+
+        if (in == NULL)
+        {
+            return RMF_ERROR;
+        }
+        if ((resultsPath != NULL) && (*resultsPath != '\0'))
+        {
+            out = fopen(resultsPath, "w");
+            if (out == NULL)
+            {
+                fclose(in);
+                return RMF_ERROR;
+            }
+        }
+        result = serveStream(in, out, handler, ctx, &stopped);
+        fclose(in);
+        if (out != stdout)
+        {
+            fclose(out);
+        }
+        return result;
+    }
+
+    if (strncmp(spec, "unix:", 5) == 0)
+    {
+        return serveUnixSocket(spec + 5, handler, ctx);
+    }
+
+    return RMF_INVALID_PARM;
+}
@@ -0,0 +1,62 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_control.h
+*
+* Non-interactive control channel for the L3 test steps.
+*
+* Commands and responses are line-delimited JSON objects (see capture_json.h).
+* The channel is selected with the RMF_AUDIOCAPTURE_CONTROL environment variable:
+*
+* | Value | Description |
+* | ----- | ----------- |
+* | `stdio` | Commands are read from stdin, responses written to stdout |
+* | `file:<path>` | Commands are read from the file, responses written to stdout or to the file named by RMF_AUDIOCAPTURE_CONTROL_RESULTS |
+* | `unix:<path>` | Listens on a UNIX stream socket, one client at a time; responses are written back on the socket |
+*/
+
+#ifndef CAPTURE_CONTROL_H
+#define CAPTURE_CONTROL_H
+
+#include <stdbool.h>
+
+#include "rmfAudioCapture.h"
+#include "capture_json.h"
+
+#define CAPTURE_CONTROL_ENV "RMF_AUDIOCAPTURE_CONTROL"
+#define CAPTURE_CONTROL_RESULTS_ENV "RMF_AUDIOCAPTURE_CONTROL_RESULTS"
+#define CAPTURE_CONTROL_LINE_MAX 1024
+
+/**
+ * @brief Command handler invoked for every request line
+ *
+ * The handler fills in the response writer, which has already been started by the
+ * caller. Returning false stops the channel after the response has been sent.
+ */
+typedef bool (*capture_control_handler_t)(void *ctx, const capture_json_object_t *request, capture_json_writer_t *response);
+
+/**
+ * @brief Serves the control channel described by spec until the handler asks to stop
+ *
+ * @return RMF_SUCCESS when the channel closed normally, RMF_INVALID_PARM for a bad spec,
+ *         RMF_ERROR if the transport could not be opened
+ */
+rmf_Error capture_control_serve(const char *spec, capture_control_handler_t handler, void *ctx);
+
+#endif // CAPTURE_CONTROL_H
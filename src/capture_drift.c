@@ -0,0 +1,147 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_drift.c
+*
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "capture_drift.h"
+#include "capture_clock.h"
+
+#define DRIFT_Z_95  1.959963984540054   // Two sided 95% quantile of the normal distribution
+
+/* Two sided 95% quantile of Student's t distribution, Cornish-Fisher expansion around the normal quantile */
+static double studentT95(double df)
+{
+    const double z = DRIFT_Z_95;
+    const double z3 = z * z * z;
+    const double z5 = z3 * z * z;
+
+    return z + (z3 + z) / (4.0 * df) + (5.0 * z5 + 16.0 * z3 + 3.0 * z) / (96.0 * df * df);
+}
+
+rmf_Error capture_drift_init(capture_drift_t *drift, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample)
+{
+    if ((drift == NULL) || (channels == 0) || (sampling_rate == 0) || ((bits_per_sample != 16) && (bits_per_sample != 24)))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(drift, 0, sizeof(*drift));
+    drift->nominal_rate = sampling_rate;
+    drift->frame_bytes = (size_t)channels * (bits_per_sample / 8);
+    drift->settle_ns = (uint64_t)CAPTURE_DRIFT_SETTLE_MS * 1000000ull;
+    return RMF_SUCCESS;
+}
+
+void capture_drift_process(capture_drift_t *drift, size_t bytes)
+{
+    capture_drift_process_at(drift, bytes, capture_clock_now_ns());
+}
+
+void capture_drift_process_at(capture_drift_t *drift, size_t bytes, uint64_t now_ns)
+{
+    uint32_t sequence;
+    double t;
+    double frames;
+    double dt;
+    double dy;
+
+    if ((drift == NULL) || (drift->frame_bytes == 0))
+    {
+        return;
+    }
+    if ((drift->bytes == 0) && (drift->first_ns == 0))
+    {
+        drift->first_ns = now_ns;
+    }
+    drift->bytes += bytes;
+    if (now_ns - drift->first_ns < drift->settle_ns)
+    {
+        return;
+    }
+
+    t = (double)(now_ns - drift->first_ns) / 1e9;
+    frames = (double)(drift->bytes / drift->frame_bytes);
+
+    sequence = drift->sequence;
+    __atomic_store_n(&drift->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (drift->n == 0)
+    {
+        drift->first_point_t = t;
+    }
+    drift->last_point_t = t;
+    drift->n++;
+    dt = t - drift->mean_t;
+    dy = frames - drift->mean_frames;
+    drift->mean_t += dt / (double)drift->n;
+    drift->mean_frames += dy / (double)drift->n;
+    drift->sxx += dt * (t - drift->mean_t);
+    drift->sxy += dt * (frames - drift->mean_frames);
+    drift->syy += dy * (frames - drift->mean_frames);
+
+    __atomic_store_n(&drift->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+rmf_Error capture_drift_estimate(const capture_drift_t *drift, capture_drift_estimate_t *estimate)
+{
+    capture_drift_t copy;
+    uint32_t before;
+    uint32_t after;
+    double slope;
+    double residual;
+    double slopeError;
+
+    if ((drift == NULL) || (estimate == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    do
+    {
+        before = __atomic_load_n(&drift->sequence, __ATOMIC_ACQUIRE);
+        memcpy(&copy, drift, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&drift->sequence, __ATOMIC_RELAXED);
+    } while ((before & 1) || (before != after));
+
+    memset(estimate, 0, sizeof(*estimate));
+    if ((copy.n < 3) || (copy.sxx <= 0.0) || (copy.nominal_rate == 0))
+    {
+        return RMF_INVALID_STATE;
+    }
+
+    slope = copy.sxy / copy.sxx;
+    residual = copy.syy - slope * copy.sxy;
+    if (residual < 0.0)
+    {
+        residual = 0.0;
+    }
+    slopeError = sqrt(residual / (double)(copy.n - 2) / copy.sxx);
+
+    estimate->points = copy.n;
+    estimate->seconds = copy.last_point_t - copy.first_point_t;
+    estimate->rate_hz = slope;
+    estimate->ppm = (slope / (double)copy.nominal_rate - 1.0) * 1e6;
+    estimate->ci_ppm = studentT95((double)(copy.n - 2)) * slopeError / (double)copy.nominal_rate * 1e6;
+    return RMF_SUCCESS;
+}
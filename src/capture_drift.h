@@ -0,0 +1,100 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_drift.h
+*
+* Estimates the drift of the capture clock against CLOCK_MONOTONIC, or against the virtual
+* clock when the tests run on it (see capture_clock.h).
+*
+* Every callback adds a point (arrival time, frames delivered so far). A straight line
+* is fitted through the points with an online least squares regression, its slope is
+* the delivered sampling rate. The drift is the relative difference from the nominal
+* rate in parts per million, with a 95% confidence interval taken from the standard
+* error of the slope.
+*
+* Points from the first CAPTURE_DRIFT_SETTLE_MS are skipped, while a HAL may still be
+* filling or draining its FIFO in bursts.
+*/
+
+#ifndef CAPTURE_DRIFT_H
+#define CAPTURE_DRIFT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_DRIFT_SETTLE_MS     500
+
+typedef struct
+{
+    uint64_t points;            // Callbacks used by the fit
+    double seconds;             // Time spanned by those callbacks
+    double rate_hz;             // Fitted sampling rate
+    double ppm;                 // Drift of rate_hz from the nominal rate, positive when the capture clock is fast
+    double ci_ppm;              // Half-width of the 95% confidence interval of ppm
+} capture_drift_estimate_t;
+
+typedef struct
+{
+    uint32_t nominal_rate;
+    size_t frame_bytes;
+    uint64_t bytes;             // Bytes delivered since the first callback
+    uint64_t first_ns;
+    uint64_t settle_ns;
+
+    /* Running means and centred sums of squares, times in seconds from first_ns */
+    uint64_t n;
+    double mean_t;
+    double mean_frames;
+    double sxx;
+    double sxy;
+    double syy;
+    double first_point_t;
+    double last_point_t;
+
+    uint32_t sequence;          // Odd while the sums are being updated
+} capture_drift_t;
+
+/**
+ * @brief Prepares an estimator for the given PCM format
+ *
+ * @param bits_per_sample - 16 or 24
+ */
+rmf_Error capture_drift_init(capture_drift_t *drift, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample);
+
+/**
+ * @brief Adds a callback that delivered bytes, timed with capture_clock_now_ns()
+ */
+void capture_drift_process(capture_drift_t *drift, size_t bytes);
+
+/**
+ * @brief Adds a callback that delivered bytes at a given CLOCK_MONOTONIC time in nanoseconds
+ */
+void capture_drift_process_at(capture_drift_t *drift, size_t bytes, uint64_t now_ns);
+
+/**
+ * @brief Gets the current estimate, safe to call from any thread
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_STATE until enough callbacks have been seen for a fit
+ */
+rmf_Error capture_drift_estimate(const capture_drift_t *drift, capture_drift_estimate_t *estimate);
+
+#endif // CAPTURE_DRIFT_H
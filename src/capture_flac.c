@@ -0,0 +1,1342 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_flac.c
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capture_flac.h"
+#include "capture_timeline.h"
+
+#define FLAC_MAX_FIXED_ORDER        4
+#define FLAC_MAX_PARTITION_ORDER    8
+#define FLAC_MAX_RICE_PARAM         14      // Largest parameter for the 4 bit coding method, 15 is the escape code
+#define FLAC_MAX_RICE2_PARAM        30      // Largest parameter for the 5 bit coding method, 31 is the escape code
+#define FLAC_STREAMINFO_LENGTH      34
+#define FLAC_STREAM_POLL_US         10000
+
+#define FLAC_SUBFRAME_CONSTANT      0
+#define FLAC_SUBFRAME_VERBATIM      1
+#define FLAC_SUBFRAME_FIXED         8
+
+#define FLAC_CHANNELS_LEFT_SIDE     8
+#define FLAC_CHANNELS_RIGHT_SIDE    9
+#define FLAC_CHANNELS_MID_SIDE      10
+
+/* CRC-8 (x^8 + x^2 + x + 1) for frame headers, CRC-16 (x^16 + x^15 + x^2 + 1) for whole frames */
+static uint8_t crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t len)
+{
+    static uint16_t table[256];
+    static int tableReady;
+    uint16_t crc = 0;
+
+    if (!__atomic_load_n(&tableReady, __ATOMIC_ACQUIRE))
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            uint16_t value = (uint16_t)(i << 8);
+            for (int b = 0; b < 8; b++)
+            {
+                value = (value & 0x8000) ? (uint16_t)((value << 1) ^ 0x8005) : (uint16_t)(value << 1);
+            }
+            table[i] = value;
+        }
+        __atomic_store_n(&tableReady, 1, __ATOMIC_RELEASE);
+    }
+    while (len--)
+    {
+        crc = (uint16_t)((crc << 8) ^ table[(crc >> 8) ^ *data++]);
+    }
+    return crc;
+}
+
+/* MSB first bit writer, the caller sizes the buffer for the worst case */
+typedef struct
+{
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    uint64_t acc;
+    int bits;
+    bool overflow;
+} bitWriter_t;
+
+static void putBits(bitWriter_t *w, uint32_t value, int count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    w->acc = (w->acc << count) | ((uint64_t)value & ((((uint64_t)1) << count) - 1));
+    w->bits += count;
+    while (w->bits >= 8)
+    {
+        w->bits -= 8;
+        if (w->len >= w->size)
+        {
+            w->overflow = true;
+            continue;
+        }
+        w->buf[w->len++] = (uint8_t)(w->acc >> w->bits);
+    }
+}
+
+static void putUnary(bitWriter_t *w, uint32_t zeros)
+{
+    while (zeros >= 32)
+    {
+        putBits(w, 0, 32);
+        zeros -= 32;
+    }
+    putBits(w, 1, (int)zeros + 1);
+}
+
+static void alignWriter(bitWriter_t *w)
+{
+    if (w->bits > 0)
+    {
+        putBits(w, 0, 8 - w->bits);
+    }
+}
+
+/* Frame numbers use the extended UTF-8 coding, up to 36 bits in 7 bytes */
+static void putUtf8(bitWriter_t *w, uint64_t value)
+{
+    int extra;
+
+    if (value < 0x80)
+    {
+        putBits(w, (uint32_t)value, 8);
+        return;
+    }
+    for (extra = 1; extra < 6; extra++)
+    {
+        if (value < ((uint64_t)1 << (5 * extra + 6)))
+        {
+            break;
+        }
+    }
+    /* Leading byte: extra + 1 ones, a zero, then the top bits of the value */
+    putBits(w, ((1u << (extra + 1)) - 1) << 1, extra + 2);
+    putBits(w, (uint32_t)(value >> (6 * extra)), 6 - extra);
+    for (int i = extra - 1; i >= 0; i--)
+    {
+        putBits(w, 0x80 | (uint32_t)((value >> (6 * i)) & 0x3F), 8);
+    }
+}
+
+static inline uint32_t zigzag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+typedef struct
+{
+    int type;
+    int order;
+    int bps;
+    int partition_order;
+    int method;                                     // 0 - 4 bit Rice parameters, 1 - 5 bit
+    uint8_t params[1 << FLAC_MAX_PARTITION_ORDER];
+    int32_t constant;
+    uint64_t bits;
+} subframePlan_t;
+
+struct capture_flac_encoder
+{
+    uint16_t channels;
+    uint16_t bits_per_sample;
+    uint32_t sampling_rate;
+    size_t frame_bytes;
+
+    int32_t *samples[CAPTURE_FLAC_MAX_CHANNELS];    // Current block, one array per channel
+    int32_t *mid;
+    int32_t *side;
+    int32_t *residual;
+    uint32_t fill;
+
+    uint64_t frame_number;
+    uint64_t total_samples;
+    uint32_t min_frame_bytes;
+    uint32_t max_frame_bytes;
+
+    uint8_t *scratch;                               // One encoded frame
+    size_t scratch_size;
+    uint8_t *output;                                // All encoded frames
+    size_t output_len;
+    size_t output_size;
+};
+
+static void computeFixedResidual(const int32_t *x, uint32_t n, int order, int32_t *residual)
+{
+    for (uint32_t i = (uint32_t)order; i < n; i++)
+    {
+        int64_t prediction;
+        switch (order)
+        {
+        case 0:  prediction = 0; break;
+        case 1:  prediction = x[i - 1]; break;
+        case 2:  prediction = 2 * (int64_t)x[i - 1] - x[i - 2]; break;
+        case 3:  prediction = 3 * (int64_t)x[i - 1] - 3 * (int64_t)x[i - 2] + x[i - 3]; break;
+        default: prediction = 4 * (int64_t)x[i - 1] - 6 * (int64_t)x[i - 2] + 4 * (int64_t)x[i - 3] - x[i - 4]; break;
+        }
+        residual[i - order] = (int32_t)(x[i] - prediction);
+    }
+}
+
+/* Picks the fixed predictor order with the smallest absolute residual sum */
+static int chooseFixedOrder(const int32_t *x, uint32_t n)
+{
+    uint64_t sums[FLAC_MAX_FIXED_ORDER + 1] = { 0 };
+    int best = 0;
+
+    if (n <= FLAC_MAX_FIXED_ORDER)
+    {
+        return 0;
+    }
+    for (uint32_t i = FLAC_MAX_FIXED_ORDER; i < n; i++)
+    {
+        int64_t e0 = x[i];
+        int64_t e1 = e0 - x[i - 1];
+        int64_t e2 = e1 - ((int64_t)x[i - 1] - x[i - 2]);
+        int64_t e3 = e2 - (((int64_t)x[i - 1] - x[i - 2]) - ((int64_t)x[i - 2] - x[i - 3]));
+        int64_t e4 = e3 - ((((int64_t)x[i - 1] - x[i - 2]) - ((int64_t)x[i - 2] - x[i - 3])) -
+                           (((int64_t)x[i - 2] - x[i - 3]) - ((int64_t)x[i - 3] - x[i - 4])));
+        sums[0] += (uint64_t)(e0 < 0 ? -e0 : e0);
+        sums[1] += (uint64_t)(e1 < 0 ? -e1 : e1);
+        sums[2] += (uint64_t)(e2 < 0 ? -e2 : e2);
+        sums[3] += (uint64_t)(e3 < 0 ? -e3 : e3);
+        sums[4] += (uint64_t)(e4 < 0 ? -e4 : e4);
+    }
+    for (int order = 1; order <= FLAC_MAX_FIXED_ORDER; order++)
+    {
+        if (sums[order] < sums[best])
+        {
+            best = order;
+        }
+    }
+    return best;
+}
+
+/* Exact cost in bits of coding count values with Rice parameter k */
+static uint64_t riceBits(const int32_t *residual, uint32_t count, int k)
+{
+    uint64_t bits = (uint64_t)count * (uint64_t)(k + 1);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        bits += zigzag(residual[i]) >> k;
+    }
+    return bits;
+}
+
+static int estimateRiceParam(uint64_t sum, uint32_t count, int maxParam)
+{
+    int k = 0;
+    if (count == 0)
+    {
+        return 0;
+    }
+    while ((k < maxParam) && (((uint64_t)count << (k + 1)) < sum))
+    {
+        k++;
+    }
+    return k;
+}
+
+/*
+ * Chooses the partition order and per-partition Rice parameters. Partition sums are
+ * gathered once at the highest usable order and merged pairwise for lower orders.
+ */
+static void planResidual(const int32_t *residual, uint32_t n, int order, subframePlan_t *plan)
+{
+    uint64_t sums[1 << FLAC_MAX_PARTITION_ORDER];
+    uint64_t bestBits = UINT64_MAX;
+    int maxOrder = 0;
+
+    while ((maxOrder < FLAC_MAX_PARTITION_ORDER) && ((n % (1u << (maxOrder + 1))) == 0) &&
+           ((n >> (maxOrder + 1)) > (uint32_t)order))
+    {
+        maxOrder++;
+    }
+
+    {
+        uint32_t partitionSize = n >> maxOrder;
+        const int32_t *r = residual;
+        for (int p = 0; p < (1 << maxOrder); p++)
+        {
+            uint32_t count = (p == 0) ? partitionSize - (uint32_t)order : partitionSize;
+            sums[p] = 0;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                sums[p] += zigzag(r[i]);
+            }
+            r += count;
+        }
+    }
+
+    for (int po = maxOrder; po >= 0; po--)
+    {
+        uint32_t partitionSize = n >> po;
+        int partitions = 1 << po;
+        uint8_t params[1 << FLAC_MAX_PARTITION_ORDER];
+        uint64_t bits = 0;
+        int method = 0;
+
+        for (int p = 0; p < partitions; p++)
+        {
+            uint32_t count = (p == 0) ? partitionSize - (uint32_t)order : partitionSize;
+            int k = estimateRiceParam(sums[p], count, FLAC_MAX_RICE2_PARAM);
+            params[p] = (uint8_t)k;
+            if (k > FLAC_MAX_RICE_PARAM)
+            {
+                method = 1;
+            }
+            bits += (uint64_t)count * (uint64_t)(k + 1) + (sums[p] >> k);
+        }
+        bits += 2 + 4 + (uint64_t)partitions * (method ? 5 : 4);
+
+        if (bits < bestBits)
+        {
+            bestBits = bits;
+            plan->partition_order = po;
+            plan->method = method;
+            memcpy(plan->params, params, (size_t)partitions);
+        }
+
+        /* Merge neighbouring partitions for the next lower order */
+        for (int p = 0; p < partitions / 2; p++)
+        {
+            sums[p] = sums[2 * p] + sums[2 * p + 1];
+        }
+    }
+
+    /* Replace the estimate with the exact size of the chosen coding */
+    {
+        uint32_t partitionSize = n >> plan->partition_order;
+        const int32_t *r = residual;
+        uint64_t bits = 2 + 4 + (uint64_t)(1 << plan->partition_order) * (plan->method ? 5 : 4);
+        for (int p = 0; p < (1 << plan->partition_order); p++)
+        {
+            uint32_t count = (p == 0) ? partitionSize - (uint32_t)order : partitionSize;
+            bits += riceBits(r, count, plan->params[p]);
+            r += count;
+        }
+        plan->bits = bits;
+    }
+}
+
+static void planSubframe(capture_flac_encoder_t *enc, const int32_t *x, uint32_t n, int bps, subframePlan_t *plan)
+{
+    uint64_t verbatimBits = 8 + (uint64_t)n * (uint64_t)bps;
+    bool constant = true;
+
+    plan->bps = bps;
+    for (uint32_t i = 1; i < n; i++)
+    {
+        if (x[i] != x[0])
+        {
+            constant = false;
+            break;
+        }
+    }
+    if (constant)
+    {
+        plan->type = FLAC_SUBFRAME_CONSTANT;
+        plan->constant = x[0];
+        plan->bits = 8 + (uint64_t)bps;
+        return;
+    }
+
+    plan->order = chooseFixedOrder(x, n);
+    computeFixedResidual(x, n, plan->order, enc->residual);
+    planResidual(enc->residual, n, plan->order, plan);
+    plan->bits += 8 + (uint64_t)plan->order * (uint64_t)bps;
+    plan->type = FLAC_SUBFRAME_FIXED;
+
+    if (plan->bits >= verbatimBits)
+    {
+        plan->type = FLAC_SUBFRAME_VERBATIM;
+        plan->bits = verbatimBits;
+    }
+}
+
+static void writeSubframe(capture_flac_encoder_t *enc, bitWriter_t *w, const int32_t *x, uint32_t n, const subframePlan_t *plan)
+{
+    switch (plan->type)
+    {
+    case FLAC_SUBFRAME_CONSTANT:
+        putBits(w, 0x00, 8);
+        putBits(w, (uint32_t)plan->constant, plan->bps);
+        break;
+
+    case FLAC_SUBFRAME_VERBATIM:
+        putBits(w, 0x02, 8);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            putBits(w, (uint32_t)x[i], plan->bps);
+        }
+        break;
+
+    default:
+    {
+        uint32_t partitionSize = n >> plan->partition_order;
+        const int32_t *r = enc->residual;
+
+        putBits(w, (uint32_t)(FLAC_SUBFRAME_FIXED | plan->order) << 1, 8);
+        for (int i = 0; i < plan->order; i++)
+        {
+            putBits(w, (uint32_t)x[i], plan->bps);
+        }
+        computeFixedResidual(x, n, plan->order, enc->residual);
+        putBits(w, (uint32_t)plan->method, 2);
+        putBits(w, (uint32_t)plan->partition_order, 4);
+        for (int p = 0; p < (1 << plan->partition_order); p++)
+        {
+            uint32_t count = (p == 0) ? partitionSize - (uint32_t)plan->order : partitionSize;
+            int k = plan->params[p];
+
+            putBits(w, (uint32_t)k, plan->method ? 5 : 4);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t u = zigzag(r[i]);
+                putUnary(w, u >> k);
+                putBits(w, u, k);
+            }
+            r += count;
+        }
+        break;
+    }
+    }
+}
+
+static rmf_Error appendOutput(capture_flac_encoder_t *enc, const uint8_t *data, size_t len)
+{
+    if (enc->output_len + len > enc->output_size)
+    {
+        size_t size = enc->output_size ? enc->output_size : (1 << 20);
+        uint8_t *grown;
+
+        while (size < enc->output_len + len)
+        {
+            size *= 2;
+        }
+        grown = realloc(enc->output, size);
+        if (grown == NULL)
+        {
+            return RMF_ERROR;
+        }
+        enc->output = grown;
+        enc->output_size = size;
+    }
+    memcpy(enc->output + enc->output_len, data, len);
+    enc->output_len += len;
+    return RMF_SUCCESS;
+}
+
+static rmf_Error encodeFrame(capture_flac_encoder_t *enc)
+{
+    bitWriter_t w = { enc->scratch, enc->scratch_size, 0, 0, 0, false };
+    subframePlan_t plans[CAPTURE_FLAC_MAX_CHANNELS];
+    const int32_t *signals[CAPTURE_FLAC_MAX_CHANNELS];
+    uint32_t n = enc->fill;
+    int bps = enc->bits_per_sample;
+    int assignment = enc->channels - 1;
+    uint16_t crc;
+
+    if (n == 0)
+    {
+        return RMF_SUCCESS;
+    }
+
+    for (int c = 0; c < enc->channels; c++)
+    {
+        signals[c] = enc->samples[c];
+        planSubframe(enc, enc->samples[c], n, bps, &plans[c]);
+    }
+
+    /* For stereo also try the three side channel modes and keep the cheapest */
+    if (enc->channels == 2)
+    {
+        subframePlan_t midPlan;
+        subframePlan_t sidePlan;
+        uint64_t best = plans[0].bits + plans[1].bits;
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            enc->side[i] = enc->samples[0][i] - enc->samples[1][i];
+            enc->mid[i] = (enc->samples[0][i] + enc->samples[1][i]) >> 1;
+        }
+        planSubframe(enc, enc->side, n, bps + 1, &sidePlan);
+        planSubframe(enc, enc->mid, n, bps, &midPlan);
+
+        if (plans[0].bits + sidePlan.bits < best)
+        {
+            best = plans[0].bits + sidePlan.bits;
+            assignment = FLAC_CHANNELS_LEFT_SIDE;
+        }
+        if (plans[1].bits + sidePlan.bits < best)
+        {
+            best = plans[1].bits + sidePlan.bits;
+            assignment = FLAC_CHANNELS_RIGHT_SIDE;
+        }
+        if (midPlan.bits + sidePlan.bits < best)
+        {
+            assignment = FLAC_CHANNELS_MID_SIDE;
+        }
+
+        switch (assignment)
+        {
+        case FLAC_CHANNELS_LEFT_SIDE:
+            signals[1] = enc->side;
+            plans[1] = sidePlan;
+            break;
+        case FLAC_CHANNELS_RIGHT_SIDE:
+            signals[0] = enc->side;
+            plans[0] = sidePlan;
+            break;
+        case FLAC_CHANNELS_MID_SIDE:
+            signals[0] = enc->mid;
+            signals[1] = enc->side;
+            plans[0] = midPlan;
+            plans[1] = sidePlan;
+            break;
+        default:
+            break;
+        }
+    }
+
+    /* Frame header, sample rate and size come from STREAMINFO */
+    putBits(&w, 0xFFF8, 16);
+    putBits(&w, (n == CAPTURE_FLAC_BLOCK_SIZE) ? 12 : 7, 4);
+    putBits(&w, 0, 4);
+    putBits(&w, (uint32_t)assignment, 4);
+    putBits(&w, 0, 4);
+    putUtf8(&w, enc->frame_number);
+    if (n != CAPTURE_FLAC_BLOCK_SIZE)
+    {
+        putBits(&w, n - 1, 16);
+    }
+    putBits(&w, crc8(w.buf, w.len), 8);
+
+    for (int c = 0; c < enc->channels; c++)
+    {
+        writeSubframe(enc, &w, signals[c], n, &plans[c]);
+    }
+    alignWriter(&w);
+    crc = crc16(w.buf, w.len);
+    putBits(&w, crc, 16);
+
+    if (w.overflow)
+    {
+        return RMF_ERROR;
+    }
+    if ((enc->min_frame_bytes == 0) || (w.len < enc->min_frame_bytes))
+    {
+        enc->min_frame_bytes = (uint32_t)w.len;
+    }
+    if (w.len > enc->max_frame_bytes)
+    {
+        enc->max_frame_bytes = (uint32_t)w.len;
+    }
+
+    enc->frame_number++;
+    enc->total_samples += n;
+    enc->fill = 0;
+    return appendOutput(enc, w.buf, w.len);
+}
+
+rmf_Error capture_flac_encoder_open(capture_flac_encoder_t **encoder, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample)
+{
+    capture_flac_encoder_t *enc;
+
+    if ((encoder == NULL) || (channels == 0) || (channels > CAPTURE_FLAC_MAX_CHANNELS) ||
+        (sampling_rate == 0) || (sampling_rate >= (1u << 20)) ||
+        ((bits_per_sample != 16) && (bits_per_sample != 24)))
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    enc = calloc(1, sizeof(*enc));
+    if (enc == NULL)
+    {
+        return RMF_ERROR;
+    }
+    enc->channels = channels;
+    enc->sampling_rate = sampling_rate;
+    enc->bits_per_sample = bits_per_sample;
+    enc->frame_bytes = (size_t)channels * (bits_per_sample / 8);
+
+    /* Worst case is a verbatim subframe per channel, with one extra bit for a side channel */
+    enc->scratch_size = (size_t)channels * ((CAPTURE_FLAC_BLOCK_SIZE * (bits_per_sample + 1) + 7) / 8 + 1) + 32;
+    enc->scratch = malloc(enc->scratch_size);
+    enc->mid = malloc(CAPTURE_FLAC_BLOCK_SIZE * sizeof(int32_t));
+    enc->side = malloc(CAPTURE_FLAC_BLOCK_SIZE * sizeof(int32_t));
+    enc->residual = malloc(CAPTURE_FLAC_BLOCK_SIZE * sizeof(int32_t));
+    bool allocated = (enc->scratch != NULL) && (enc->mid != NULL) && (enc->side != NULL) && (enc->residual != NULL);
+    for (int c = 0; c < channels; c++)
+    {
+        enc->samples[c] = malloc(CAPTURE_FLAC_BLOCK_SIZE * sizeof(int32_t));
+        allocated = allocated && (enc->samples[c] != NULL);
+    }
+    if (!allocated)
+    {
+        capture_flac_encoder_close(enc);
+        return RMF_ERROR;
+    }
+
+    *encoder = enc;
+    return RMF_SUCCESS;
+}
+
+rmf_Error capture_flac_encoder_write(capture_flac_encoder_t *encoder, const uint8_t *pcm, size_t bytes)
+{
+    size_t frames;
+
+    if ((encoder == NULL) || ((pcm == NULL) && (bytes > 0)) || ((bytes % encoder->frame_bytes) != 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    frames = bytes / encoder->frame_bytes;
+    for (size_t f = 0; f < frames; f++)
+    {
+        for (int c = 0; c < encoder->channels; c++)
+        {
+            int32_t value;
+            if (encoder->bits_per_sample == 16)
+            {
+                value = (int16_t)(pcm[0] | (pcm[1] << 8));
+                pcm += 2;
+            }
+            else
+            {
+                value = (int32_t)(((uint32_t)pcm[0] << 8) | ((uint32_t)pcm[1] << 16) | ((uint32_t)pcm[2] << 24)) >> 8;
+                pcm += 3;
+            }
+            encoder->samples[c][encoder->fill] = value;
+        }
+        if (++encoder->fill == CAPTURE_FLAC_BLOCK_SIZE)
+        {
+            rmf_Error result = encodeFrame(encoder);
+            if (result != RMF_SUCCESS)
+            {
+                return result;
+            }
+        }
+    }
+    return RMF_SUCCESS;
+}
+
+rmf_Error capture_flac_encoder_finish(capture_flac_encoder_t *encoder)
+{
+    if (encoder == NULL)
+    {
+        return RMF_INVALID_PARM;
+    }
+    return encodeFrame(encoder);
+}
+
+rmf_Error capture_flac_encoder_save(capture_flac_encoder_t *encoder, const char *path)
+{
+    uint8_t header[8 + FLAC_STREAMINFO_LENGTH] = { 'f', 'L', 'a', 'C', 0x80, 0, 0, FLAC_STREAMINFO_LENGTH };
+    bitWriter_t w = { header + 8, FLAC_STREAMINFO_LENGTH, 0, 0, 0, false };
+    FILE *file;
+    bool written;
+
+    if ((encoder == NULL) || (path == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    putBits(&w, CAPTURE_FLAC_BLOCK_SIZE, 16);
+    putBits(&w, CAPTURE_FLAC_BLOCK_SIZE, 16);
+    putBits(&w, encoder->min_frame_bytes, 24);
+    putBits(&w, encoder->max_frame_bytes, 24);
+    putBits(&w, encoder->sampling_rate, 20);
+    putBits(&w, encoder->channels - 1u, 3);
+    putBits(&w, encoder->bits_per_sample - 1u, 5);
+    putBits(&w, (uint32_t)(encoder->total_samples >> 32), 4);
+    putBits(&w, (uint32_t)encoder->total_samples, 32);
+    /* The MD5 signature is left as zero, which marks it as not calculated */
+    for (int i = 0; i < 4; i++)
+    {
+        putBits(&w, 0, 32);
+    }
+
+    CAPTURE_TIMELINE_SCOPE("flac_write", "bytes", sizeof(header) + encoder->output_len);
+    file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return RMF_ERROR;
+    }
+    written = (fwrite(header, 1, sizeof(header), file) == sizeof(header)) &&
+              (fwrite(encoder->output, 1, encoder->output_len, file) == encoder->output_len);
+    written = (fclose(file) == 0) && written;
+    return written ? RMF_SUCCESS : RMF_ERROR;
+}
+
+void capture_flac_encoder_sizes(const capture_flac_encoder_t *encoder, uint64_t *pcm_bytes, uint64_t *flac_bytes)
+{
+    if (encoder == NULL)
+    {
+        return;
+    }
+    if (pcm_bytes != NULL)
+    {
+        *pcm_bytes = (encoder->total_samples + encoder->fill) * encoder->frame_bytes;
+    }
+    if (flac_bytes != NULL)
+    {
+        *flac_bytes = 8 + FLAC_STREAMINFO_LENGTH + encoder->output_len;
+    }
+}
+
+void capture_flac_encoder_close(capture_flac_encoder_t *encoder)
+{
+    if (encoder == NULL)
+    {
+        return;
+    }
+    for (int c = 0; c < CAPTURE_FLAC_MAX_CHANNELS; c++)
+    {
+        free(encoder->samples[c]);
+    }
+    free(encoder->mid);
+    free(encoder->side);
+    free(encoder->residual);
+    free(encoder->scratch);
+    free(encoder->output);
+    free(encoder);
+}
+
+static void *streamThread(void *arg)
+{
+    capture_flac_stream_t *stream = (capture_flac_stream_t *)arg;
+
+    for (;;)
+    {
+        /* Read the flag before the fill level so the last level seen after finishing is final */
+        int finishing = __atomic_load_n(&stream->finishing, __ATOMIC_ACQUIRE);
+        uint32_t available = __atomic_load_n(stream->available, __ATOMIC_ACQUIRE);
+        size_t whole = (available - stream->consumed) / stream->frame_bytes * stream->frame_bytes;
+
+        if (whole > 0)
+        {
+            stream->result = capture_flac_encoder_write(stream->encoder, stream->source + stream->consumed, whole);
+            if (stream->result != RMF_SUCCESS)
+            {
+                return NULL;
+            }
+            stream->consumed += (uint32_t)whole;
+            continue;
+        }
+        if (finishing)
+        {
+            break;
+        }
+        usleep(FLAC_STREAM_POLL_US);
+    }
+
+    stream->result = capture_flac_encoder_finish(stream->encoder);
+    return NULL;
+}
+
+rmf_Error capture_flac_stream_start(capture_flac_stream_t *stream, capture_flac_encoder_t *encoder, const uint8_t *source, const uint32_t *available)
+{
+    if ((stream == NULL) || (encoder == NULL) || (source == NULL) || (available == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(stream, 0, sizeof(*stream));
+    stream->encoder = encoder;
+    stream->source = source;
+    stream->available = available;
+    stream->frame_bytes = encoder->frame_bytes;
+    stream->result = RMF_SUCCESS;
+
+    if (pthread_create(&stream->thread, NULL, streamThread, stream) != 0)
+    {
+        return RMF_ERROR;
+    }
+    stream->running = true;
+    return RMF_SUCCESS;
+}
+
+rmf_Error capture_flac_stream_finish(capture_flac_stream_t *stream)
+{
+    if ((stream == NULL) || !stream->running)
+    {
+        return RMF_INVALID_PARM;
+    }
+    __atomic_store_n(&stream->finishing, 1, __ATOMIC_RELEASE);
+    pthread_join(stream->thread, NULL);
+    stream->running = false;
+    return stream->result;
+}
+
+/* MSB first bit reader over an in-memory stream */
+typedef struct
+{
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;         // Byte position of the next unread bit
+    int bit;            // Bits already consumed from buf[pos]
+    bool error;
+} bitReader_t;
+
+static uint32_t getBits(bitReader_t *r, int count)
+{
+    uint64_t value = 0;
+
+    while (count > 0)
+    {
+        int available = 8 - r->bit;
+        int take = (count < available) ? count : available;
+
+        if (r->pos >= r->len)
+        {
+            r->error = true;
+            return 0;
+        }
+        value = (value << take) | ((r->buf[r->pos] >> (available - take)) & ((1u << take) - 1));
+        count -= take;
+        r->bit += take;
+        if (r->bit == 8)
+        {
+            r->bit = 0;
+            r->pos++;
+        }
+    }
+    return (uint32_t)value;
+}
+
+static int32_t getSigned(bitReader_t *r, int count)
+{
+    uint32_t value = getBits(r, count);
+    if ((count > 0) && (count < 32) && (value & (1u << (count - 1))))
+    {
+        value |= ~((1u << count) - 1);
+    }
+    return (int32_t)value;
+}
+
+static uint32_t getUnary(bitReader_t *r)
+{
+    uint32_t zeros = 0;
+
+    /* Whole zero bytes are skipped at once, residuals with large quotients are common in noise */
+    while (!r->error)
+    {
+        if ((r->bit == 0) && (r->pos < r->len) && (r->buf[r->pos] == 0))
+        {
+            zeros += 8;
+            r->pos++;
+            continue;
+        }
+        if (getBits(r, 1))
+        {
+            break;
+        }
+        zeros++;
+    }
+    return zeros;
+}
+
+static bool getUtf8(bitReader_t *r, uint64_t *value)
+{
+    uint32_t first = getBits(r, 8);
+    int extra = 0;
+
+    while ((extra < 8) && (first & (0x80u >> extra)))
+    {
+        extra++;
+    }
+    if ((extra == 1) || (extra == 8))
+    {
+        return false;
+    }
+    if (extra == 0)
+    {
+        *value = first;
+        return true;
+    }
+    extra--; // Number of continuation bytes
+    *value = first & (0x3Fu >> extra);
+    for (int i = 0; i < extra; i++)
+    {
+        uint32_t next = getBits(r, 8);
+        if ((next & 0xC0) != 0x80)
+        {
+            return false;
+        }
+        *value = (*value << 6) | (next & 0x3F);
+    }
+    return !r->error;
+}
+
+static bool decodeResidual(bitReader_t *r, int32_t *residual, uint32_t n, int order)
+{
+    int method = (int)getBits(r, 2);
+    int partitionOrder = (int)getBits(r, 4);
+    uint32_t partitionSize = n >> partitionOrder;
+
+    if ((method > 1) || ((partitionSize << partitionOrder) != n) || (partitionSize < (uint32_t)order))
+    {
+        return false;
+    }
+    for (int p = 0; p < (1 << partitionOrder); p++)
+    {
+        uint32_t count = (p == 0) ? partitionSize - (uint32_t)order : partitionSize;
+        int k = (int)getBits(r, method ? 5 : 4);
+
+        if (k == (method ? 31 : 15))
+        {
+            int rawBits = (int)getBits(r, 5);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                *residual++ = getSigned(r, rawBits);
+            }
+            continue;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t u = (getUnary(r) << k) | getBits(r, k);
+            *residual++ = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+        }
+    }
+    return !r->error;
+}
+
+static bool decodeSubframe(bitReader_t *r, int32_t *x, uint32_t n, int bps)
+{
+    uint32_t type;
+    int wasted = 0;
+
+    if (getBits(r, 1) != 0)
+    {
+        return false;
+    }
+    type = getBits(r, 6);
+    if (getBits(r, 1))
+    {
+        wasted = (int)getUnary(r) + 1;
+        bps -= wasted;
+        if (bps <= 0)
+        {
+            return false;
+        }
+    }
+
+    if (type == FLAC_SUBFRAME_CONSTANT)
+    {
+        int32_t value = getSigned(r, bps);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            x[i] = value;
+        }
+    }
+    else if (type == FLAC_SUBFRAME_VERBATIM)
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            x[i] = getSigned(r, bps);
+        }
+    }
+    else if ((type >= 8) && (type <= 12))
+    {
+        int order = (int)type - 8;
+        if ((uint32_t)order > n)
+        {
+            return false;
+        }
+        for (int i = 0; i < order; i++)
+        {
+            x[i] = getSigned(r, bps);
+        }
+        if (!decodeResidual(r, x + order, n, order))
+        {
+            return false;
+        }
+        for (uint32_t i = (uint32_t)order; i < n; i++)
+        {
+            int64_t prediction;
+            switch (order)
+            {
+            case 0:  prediction = 0; break;
+            case 1:  prediction = x[i - 1]; break;
+            case 2:  prediction = 2 * (int64_t)x[i - 1] - x[i - 2]; break;
+            case 3:  prediction = 3 * (int64_t)x[i - 1] - 3 * (int64_t)x[i - 2] + x[i - 3]; break;
+            default: prediction = 4 * (int64_t)x[i - 1] - 6 * (int64_t)x[i - 2] + 4 * (int64_t)x[i - 3] - x[i - 4]; break;
+            }
+            x[i] = (int32_t)(x[i] + prediction);
+        }
+    }
+    else if (type >= 32)
+    {
+        int order = (int)type - 31;
+        int32_t coefs[32];
+        int precision;
+        int shift;
+
+        if ((uint32_t)order > n)
+        {
+            return false;
+        }
+        for (int i = 0; i < order; i++)
+        {
+            x[i] = getSigned(r, bps);
+        }
+        precision = (int)getBits(r, 4) + 1;
+        shift = getSigned(r, 5);
+        if ((precision == 16) || (shift < 0))
+        {
+            return false;
+        }
+        for (int i = 0; i < order; i++)
+        {
+            coefs[i] = getSigned(r, precision);
+        }
+        if (!decodeResidual(r, x + order, n, order))
+        {
+            return false;
+        }
+        for (uint32_t i = (uint32_t)order; i < n; i++)
+        {
+            int64_t sum = 0;
+            for (int j = 0; j < order; j++)
+            {
+                sum += (int64_t)coefs[j] * x[i - 1 - j];
+            }
+            x[i] = (int32_t)(x[i] + (sum >> shift));
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    if (wasted > 0)
+    {
+        for (uint32_t i = 0; i < n; i++)
+        {
+            x[i] = (int32_t)((uint32_t)x[i] << wasted);
+        }
+    }
+    return !r->error;
+}
+
+static rmf_Error readWholeFile(const char *path, uint8_t **data, size_t *len)
+{
+    FILE *file = fopen(path, "rb");
+    long size;
+
+    if (file == NULL)
+    {
+        return RMF_ERROR;
+    }
+    if ((fseek(file, 0, SEEK_END) != 0) || ((size = ftell(file)) < 0) || (fseek(file, 0, SEEK_SET) != 0))
+    {
+        fclose(file);
+        return RMF_ERROR;
+    }
+    *data = malloc((size_t)size + 1);
+    if (*data == NULL)
+    {
+        fclose(file);
+        return RMF_ERROR;
+    }
+    *len = fread(*data, 1, (size_t)size, file);
+    fclose(file);
+    if (*len != (size_t)size)
+    {
+        free(*data);
+        *data = NULL;
+        return RMF_ERROR;
+    }
+    return RMF_SUCCESS;
+}
+
+rmf_Error capture_flac_decode_file(const char *path, capture_flac_info_t *info, uint8_t **pcm, size_t *bytes)
+{
+    static const uint32_t fixedBlockSizes[16] = { 0, 192, 576, 1152, 2304, 4608, 0, 0, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768 };
+    static const int sampleSizes[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+    uint8_t *data = NULL;
+    size_t len = 0;
+    bitReader_t r;
+    bool last = false;
+    int32_t *channel[CAPTURE_FLAC_MAX_CHANNELS] = { NULL };
+    uint8_t *out = NULL;
+    size_t outLen = 0, outSize = 0;
+    size_t sampleBytes;
+    rmf_Error result;
+
+    if ((path == NULL) || (info == NULL) || (pcm == NULL) || (bytes == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(info, 0, sizeof(*info));
+    result = readWholeFile(path, &data, &len);
+    if (result != RMF_SUCCESS)
+    {
+        return result;
+    }
+    result = RMF_INVALID_PARM;
+    r = (bitReader_t){ data, len, 4, 0, false };
+
+    if ((len < 8 + FLAC_STREAMINFO_LENGTH) || (memcmp(data, "fLaC", 4) != 0))
+    {
+        goto done;
+    }
+
+    /* Metadata blocks, STREAMINFO comes first and the rest are skipped */
+    while (!last)
+    {
+        uint32_t type;
+        uint32_t length;
+
+        last = getBits(&r, 1) != 0;
+        type = getBits(&r, 7);
+        length = getBits(&r, 24);
+        if (r.error || (r.pos + length > len))
+        {
+            goto done;
+        }
+        if (type == 0)
+        {
+            size_t next = r.pos + length;
+            getBits(&r, 16 + 16 + 24 + 24);
+            info->sampling_rate = getBits(&r, 20);
+            info->channels = (uint16_t)(getBits(&r, 3) + 1);
+            info->bits_per_sample = (uint16_t)(getBits(&r, 5) + 1);
+            info->total_samples = ((uint64_t)getBits(&r, 4) << 32) | getBits(&r, 32);
+            r.pos = next;
+            r.bit = 0;
+        }
+        else
+        {
+            r.pos += length;
+        }
+    }
+    if ((info->channels == 0) || (info->channels > CAPTURE_FLAC_MAX_CHANNELS) ||
+        ((info->bits_per_sample != 16) && (info->bits_per_sample != 24) && (info->bits_per_sample != 32)))
+    {
+        goto done;
+    }
+    sampleBytes = info->bits_per_sample / 8;
+
+    for (int c = 0; c < info->channels; c++)
+    {
+        channel[c] = malloc(65536 * sizeof(int32_t));
+        if (channel[c] == NULL)
+        {
+            result = RMF_ERROR;
+            goto done;
+        }
+    }
+
+    while (r.pos + 2 <= len)
+    {
+        size_t frameStart = r.pos;
+        uint32_t blockCode, rateCode, assignment, sizeCode;
+        uint32_t n;
+        uint64_t number;
+        int bps = info->bits_per_sample;
+        int channels;
+
+        if ((getBits(&r, 15) != 0x7FFC))
+        {
+            goto done;
+        }
+        getBits(&r, 1); // Blocking strategy, the frame number coding is the same for both
+        blockCode = getBits(&r, 4);
+        rateCode = getBits(&r, 4);
+        assignment = getBits(&r, 4);
+        sizeCode = getBits(&r, 3);
+        if (getBits(&r, 1) || (blockCode == 0) || (rateCode == 15) || (sizeCode == 3) || !getUtf8(&r, &number))
+        {
+            goto done;
+        }
+        if (blockCode == 6)
+        {
+            n = getBits(&r, 8) + 1;
+        }
+        else if (blockCode == 7)
+        {
+            n = getBits(&r, 16) + 1;
+        }
+        else
+        {
+            n = fixedBlockSizes[blockCode];
+        }
+        if (rateCode == 12)
+        {
+            getBits(&r, 8);
+        }
+        else if ((rateCode == 13) || (rateCode == 14))
+        {
+            getBits(&r, 16);
+        }
+        if (sizeCode != 0)
+        {
+            bps = sampleSizes[sizeCode];
+        }
+        if (r.error || (crc8(data + frameStart, r.pos - frameStart) != getBits(&r, 8)))
+        {
+            goto done;
+        }
+
+        channels = (assignment < 8) ? (int)assignment + 1 : 2;
+        if ((assignment > FLAC_CHANNELS_MID_SIDE) || (channels != info->channels) || (bps != info->bits_per_sample))
+        {
+            goto done;
+        }
+
+        for (int c = 0; c < channels; c++)
+        {
+            bool side = ((assignment == FLAC_CHANNELS_LEFT_SIDE) && (c == 1)) ||
+                        ((assignment == FLAC_CHANNELS_RIGHT_SIDE) && (c == 0)) ||
+                        ((assignment == FLAC_CHANNELS_MID_SIDE) && (c == 1));
+            if (!decodeSubframe(&r, channel[c], n, side ? bps + 1 : bps))
+            {
+                goto done;
+            }
+        }
+        if (r.bit != 0)
+        {
+            getBits(&r, 8 - r.bit);
+        }
+        if (r.error || (crc16(data + frameStart, r.pos - frameStart) != getBits(&r, 16)))
+        {
+            goto done;
+        }
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            switch (assignment)
+            {
+            case FLAC_CHANNELS_LEFT_SIDE:
+                channel[1][i] = channel[0][i] - channel[1][i];
+                break;
+            case FLAC_CHANNELS_RIGHT_SIDE:
+                channel[0][i] += channel[1][i];
+                break;
+            case FLAC_CHANNELS_MID_SIDE:
+            {
+                int32_t side = channel[1][i];
+                int32_t mid = (int32_t)((uint32_t)channel[0][i] << 1) | (side & 1);
+                channel[0][i] = (mid + side) >> 1;
+                channel[1][i] = (mid - side) >> 1;
+                break;
+            }
+            default:
+                break;
+            }
+        }
+
+        if (outLen + (size_t)n * channels * sampleBytes > outSize)
+        {
+            size_t size = outSize ? outSize * 2 : (1 << 20);
+            uint8_t *grown;
+            while (size < outLen + (size_t)n * channels * sampleBytes)
+            {
+                size *= 2;
+            }
+            grown = realloc(out, size);
+            if (grown == NULL)
+            {
+                result = RMF_ERROR;
+                goto done;
+            }
+            out = grown;
+            outSize = size;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            for (int c = 0; c < channels; c++)
+            {
+                uint32_t value = (uint32_t)channel[c][i];
+                for (size_t b = 0; b < sampleBytes; b++)
+                {
+                    out[outLen++] = (uint8_t)(value >> (8 * b));
+                }
+            }
+        }
+    }
+
+    if (r.pos == len)
+    {
+        result = RMF_SUCCESS;
+    }
+
+done:
+    for (int c = 0; c < CAPTURE_FLAC_MAX_CHANNELS; c++)
+    {
+        free(channel[c]);
+    }
+    free(data);
+    if (result == RMF_SUCCESS)
+    {
+        *pcm = out;
+        *bytes = outLen;
+    }
+    else
+    {
+        free(out);
+    }
+    return result;
+}
+
+rmf_Error capture_flac_verify(const char *path, const uint8_t *pcm, size_t bytes)
+{
+    capture_flac_info_t info;
+    uint8_t *decoded = NULL;
+    size_t decodedBytes = 0;
+    rmf_Error result;
+
+    result = capture_flac_decode_file(path, &info, &decoded, &decodedBytes);
+    if (result != RMF_SUCCESS)
+    {
+        return result;
+    }
+    if ((decodedBytes != bytes) || (memcmp(decoded, pcm, bytes) != 0))
+    {
+        result = RMF_ERROR;
+    }
+    free(decoded);
+    return result;
+}
@@ -0,0 +1,133 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_flac.h
+*
+* Lossless compression of captured audio into FLAC streams.
+*
+* The encoder produces standard FLAC using the fixed polynomial predictors (orders 0-4),
+* Rice coded residuals with per-partition parameters and, for stereo, the best of the
+* four channel decorrelation modes per frame. Frames are kept in memory until
+* capture_flac_encoder_save() writes the stream, so the STREAMINFO block always carries
+* the final sample count.
+*
+* capture_flac_stream_start() runs the encoder on a background thread that follows a
+* linear PCM buffer while it is being filled by the capture callback.
+*
+* The decoder accepts FLAC streams with 16, 24 or 32 bits per sample, including LPC
+* subframes written by other encoders, and checks every frame CRC.
+*/
+
+#ifndef CAPTURE_FLAC_H
+#define CAPTURE_FLAC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_FLAC_BLOCK_SIZE 4096    // Samples per channel in every frame except the last
+#define CAPTURE_FLAC_MAX_CHANNELS 8
+
+typedef struct capture_flac_encoder capture_flac_encoder_t;
+
+/**
+ * @brief Creates an encoder for interleaved little-endian PCM
+ *
+ * @param bits_per_sample - 16 or 24, samples are packed in bits_per_sample / 8 bytes
+ */
+rmf_Error capture_flac_encoder_open(capture_flac_encoder_t **encoder, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample);
+
+/**
+ * @brief Encodes whole PCM frames, full blocks are compressed immediately
+ *
+ * @return RMF_INVALID_PARM if bytes is not a multiple of the PCM frame size
+ */
+rmf_Error capture_flac_encoder_write(capture_flac_encoder_t *encoder, const uint8_t *pcm, size_t bytes);
+
+/**
+ * @brief Compresses any buffered samples as the final, shorter frame
+ */
+rmf_Error capture_flac_encoder_finish(capture_flac_encoder_t *encoder);
+
+/**
+ * @brief Writes the STREAMINFO block and all encoded frames to path
+ */
+rmf_Error capture_flac_encoder_save(capture_flac_encoder_t *encoder, const char *path);
+
+/**
+ * @brief Gets the PCM bytes consumed and the compressed bytes produced so far
+ */
+void capture_flac_encoder_sizes(const capture_flac_encoder_t *encoder, uint64_t *pcm_bytes, uint64_t *flac_bytes);
+
+void capture_flac_encoder_close(capture_flac_encoder_t *encoder);
+
+/**
+ * @brief Background encoder following a PCM buffer that is filled by another thread
+ */
+typedef struct
+{
+    capture_flac_encoder_t *encoder;
+    const uint8_t *source;          // Start of the PCM buffer
+    const uint32_t *available;      // Bytes of source filled so far, updated with release semantics by the producer
+    uint32_t consumed;              // Bytes of source encoded so far
+    size_t frame_bytes;             // Bytes per PCM frame
+    int finishing;                  // Set by capture_flac_stream_finish(), accessed atomically
+    rmf_Error result;
+    pthread_t thread;
+    bool running;
+} capture_flac_stream_t;
+
+/**
+ * @brief Starts encoding source on a background thread as *available grows
+ */
+rmf_Error capture_flac_stream_start(capture_flac_stream_t *stream, capture_flac_encoder_t *encoder, const uint8_t *source, const uint32_t *available);
+
+/**
+ * @brief Encodes whatever remains up to *available, finishes the encoder and joins the thread
+ */
+rmf_Error capture_flac_stream_finish(capture_flac_stream_t *stream);
+
+typedef struct
+{
+    uint16_t channels;
+    uint16_t bits_per_sample;
+    uint32_t sampling_rate;
+    uint64_t total_samples;         // Samples per channel, 0 if the stream did not record it
+} capture_flac_info_t;
+
+/**
+ * @brief Decodes a FLAC file into interleaved little-endian PCM
+ *
+ * @param pcm - set to a malloc()ed buffer the caller frees
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for a corrupt or unsupported stream, RMF_ERROR on I/O or allocation failure
+ */
+rmf_Error capture_flac_decode_file(const char *path, capture_flac_info_t *info, uint8_t **pcm, size_t *bytes);
+
+/**
+ * @brief Decodes a FLAC file and checks it reproduces pcm exactly
+ *
+ * @return RMF_SUCCESS if the decoded stream matches, RMF_ERROR if it differs
+ */
+rmf_Error capture_flac_verify(const char *path, const uint8_t *pcm, size_t bytes);
+
+#endif // CAPTURE_FLAC_H
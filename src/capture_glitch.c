@@ -0,0 +1,333 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_glitch.c
+*
+*/
+
+#include <string.h>
+
+#include "capture_glitch.h"
+#include "capture_clock.h"
+
+#define GLITCH_AVERAGE_FRAMES   1024                    // Frames averaged by the running mean of the second difference
+#define GLITCH_HASH_MULTIPLIER  0x100000001B3ull        // 64 bit FNV prime
+#define GLITCH_HASH_SEED        0xCBF29CE484222325ull
+
+static void addEvent(capture_glitch_t *glitch, const capture_glitch_event_t *event)
+{
+    glitch->events[glitch->total % CAPTURE_GLITCH_MAX_EVENTS] = *event;
+    glitch->total++;
+    __atomic_store_n(&glitch->count[event->type], glitch->count[event->type] + 1, __ATOMIC_RELAXED);
+}
+
+static void closeSilence(capture_glitch_t *glitch)
+{
+    if (glitch->silence_frames >= glitch->min_silence_frames)
+    {
+        capture_glitch_event_t event = {
+            .type = CAPTURE_GLITCH_SILENCE,
+            .frame = glitch->silence_start,
+            .time_ns = glitch->silence_ns,
+            .buffer = glitch->silence_buffer,
+            .length = glitch->silence_frames,
+        };
+        addEvent(glitch, &event);
+    }
+    glitch->silence_frames = 0;
+}
+
+static void closeRepeatRun(capture_glitch_t *glitch)
+{
+    /* A replay is at most as long as its distance, a periodic signal repeats for longer */
+    if ((glitch->run_lag > 0) && !glitch->run_periodic && (glitch->run_length <= glitch->run_lag))
+    {
+        capture_glitch_event_t event = {
+            .type = CAPTURE_GLITCH_REPEAT,
+            .frame = glitch->run_frame,
+            .time_ns = glitch->run_ns,
+            .buffer = glitch->run_buffer,
+            .length = glitch->run_length,
+            .lag = glitch->run_lag,
+        };
+        addEvent(glitch, &event);
+    }
+    glitch->run_lag = 0;
+    glitch->run_length = 0;
+}
+
+static void checkFrame(capture_glitch_t *glitch, const uint8_t *p)
+{
+    const double fullScale = (glitch->bytes_per_sample == 2) ? 32768.0 : 8388608.0;
+    bool silent = true;
+
+    for (uint16_t c = 0; c < glitch->channels; c++, p += glitch->bytes_per_sample)
+    {
+        int32_t value;
+
+        if (glitch->bytes_per_sample == 2)
+        {
+            value = (int16_t)(p[0] | (p[1] << 8));
+        }
+        else
+        {
+            value = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) >> 8;
+        }
+        silent = silent && (value == 0);
+
+        if (glitch->frames >= 2)
+        {
+            /* Plain mean until enough frames have been seen for the running mean */
+            double weight = (glitch->frames < 2 + GLITCH_AVERAGE_FRAMES) ? 1.0 / (double)(glitch->frames - 1) : 1.0 / GLITCH_AVERAGE_FRAMES;
+            int64_t jump = (int64_t)value - 2 * (int64_t)glitch->previous[c][0] + glitch->previous[c][1];
+            double magnitude = (double)((jump < 0) ? -jump : jump) / fullScale;
+
+            if (glitch->refractory[c] > 0)
+            {
+                glitch->refractory[c]--;
+            }
+            else if ((glitch->frames >= 2 + CAPTURE_GLITCH_REFRACTORY_FRAMES) && (magnitude > CAPTURE_GLITCH_JUMP_FLOOR) &&
+                     (magnitude > CAPTURE_GLITCH_JUMP_RATIO * glitch->average_jump[c]))
+            {
+                capture_glitch_event_t event = {
+                    .type = CAPTURE_GLITCH_DISCONTINUITY,
+                    .frame = glitch->frames,
+                    .time_ns = glitch->buffer_ns,
+                    .buffer = glitch->buffers,
+                    .channel = c,
+                    .magnitude = magnitude,
+                };
+                addEvent(glitch, &event);
+                glitch->refractory[c] = CAPTURE_GLITCH_REFRACTORY_FRAMES;
+            }
+            glitch->average_jump[c] += (magnitude - glitch->average_jump[c]) * weight;
+        }
+        glitch->previous[c][1] = glitch->previous[c][0];
+        glitch->previous[c][0] = value;
+    }
+
+    if (silent)
+    {
+        if (glitch->silence_frames == 0)
+        {
+            glitch->silence_start = glitch->frames;
+            glitch->silence_ns = glitch->buffer_ns;
+            glitch->silence_buffer = glitch->buffers;
+        }
+        glitch->silence_frames++;
+    }
+    else if (glitch->silence_frames > 0)
+    {
+        closeSilence(glitch);
+    }
+    glitch->frames++;
+}
+
+static bool matchesAt(const capture_glitch_t *glitch, uint32_t lag, uint64_t hash, uint32_t size)
+{
+    uint32_t slot;
+
+    if ((lag == 0) || (lag >= CAPTURE_GLITCH_HISTORY) || (lag > glitch->buffers))
+    {
+        return false;
+    }
+    slot = (uint32_t)((glitch->buffers - lag) % CAPTURE_GLITCH_HISTORY);
+    return (glitch->sizes[slot] == size) && (glitch->hashes[slot] == hash) && !glitch->zero[slot];
+}
+
+/* Whether the previous buffer also matched the one lag buffers before it, both are still in the history */
+static bool previousMatchesAt(const capture_glitch_t *glitch, uint32_t lag)
+{
+    uint32_t previous;
+    uint32_t original;
+
+    if (glitch->buffers < (uint64_t)lag + 1)
+    {
+        return false;
+    }
+    previous = (uint32_t)((glitch->buffers - 1) % CAPTURE_GLITCH_HISTORY);
+    original = (uint32_t)((glitch->buffers - 1 - lag) % CAPTURE_GLITCH_HISTORY);
+    return (glitch->sizes[previous] == glitch->sizes[original]) && (glitch->hashes[previous] == glitch->hashes[original]) &&
+           !glitch->zero[previous];
+}
+
+static void checkRepeat(capture_glitch_t *glitch, const uint8_t *buffer, size_t bytes, uint64_t frame)
+{
+    uint64_t hash = GLITCH_HASH_SEED;
+    uint8_t any = 0;
+    uint32_t size = (uint32_t)bytes;
+    uint32_t slot = (uint32_t)(glitch->buffers % CAPTURE_GLITCH_HISTORY);
+
+    for (size_t i = 0; i < bytes; i++)
+    {
+        hash = (hash ^ buffer[i]) * GLITCH_HASH_MULTIPLIER;
+        any |= buffer[i];
+    }
+
+    if (glitch->run_lag > 0)
+    {
+        if ((any != 0) && matchesAt(glitch, glitch->run_lag, hash, size))
+        {
+            glitch->run_length++;
+        }
+        else
+        {
+            closeRepeatRun(glitch);
+        }
+    }
+    if ((glitch->run_lag == 0) && (any != 0))
+    {
+        for (uint32_t lag = 1; lag < CAPTURE_GLITCH_HISTORY; lag++)
+        {
+            if (matchesAt(glitch, lag, hash, size))
+            {
+                glitch->run_lag = lag;
+                glitch->run_length = 1;
+                glitch->run_periodic = previousMatchesAt(glitch, lag);
+                glitch->run_frame = frame;
+                glitch->run_ns = glitch->buffer_ns;
+                glitch->run_buffer = glitch->buffers;
+                break;
+            }
+        }
+    }
+
+    glitch->hashes[slot] = hash;
+    glitch->sizes[slot] = size;
+    glitch->zero[slot] = (any == 0);
+}
+
+rmf_Error capture_glitch_init(capture_glitch_t *glitch, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample)
+{
+    if ((glitch == NULL) || (channels == 0) || (channels > CAPTURE_GLITCH_MAX_CHANNELS) ||
+        (sampling_rate == 0) || ((bits_per_sample != 16) && (bits_per_sample != 24)))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(glitch, 0, sizeof(*glitch));
+    glitch->channels = channels;
+    glitch->bytes_per_sample = bits_per_sample / 8;
+    glitch->sampling_rate = sampling_rate;
+    glitch->min_silence_frames = (uint64_t)sampling_rate * CAPTURE_GLITCH_MIN_SILENCE_MS / 1000;
+    return RMF_SUCCESS;
+}
+
+void capture_glitch_process(capture_glitch_t *glitch, const void *buffer, size_t bytes)
+{
+    const uint8_t *p = (const uint8_t *)buffer;
+    size_t frameBytes;
+    uint64_t now;
+
+    if ((glitch == NULL) || (buffer == NULL) || (glitch->channels == 0) || (bytes == 0))
+    {
+        return;
+    }
+    now = capture_clock_now_ns();
+    if (glitch->buffers == 0)
+    {
+        glitch->start_ns = now;
+    }
+    glitch->buffer_ns = now - glitch->start_ns;
+    frameBytes = (size_t)glitch->channels * glitch->bytes_per_sample;
+
+    checkRepeat(glitch, p, bytes, glitch->frames);
+
+    /* Complete a frame split across the previous buffer */
+    if (glitch->carry_bytes > 0)
+    {
+        size_t need = frameBytes - glitch->carry_bytes;
+        size_t take = (bytes < need) ? bytes : need;
+
+        memcpy(glitch->carry + glitch->carry_bytes, p, take);
+        glitch->carry_bytes += take;
+        p += take;
+        bytes -= take;
+        if (glitch->carry_bytes == frameBytes)
+        {
+            checkFrame(glitch, glitch->carry);
+            glitch->carry_bytes = 0;
+        }
+    }
+    while (bytes >= frameBytes)
+    {
+        checkFrame(glitch, p);
+        p += frameBytes;
+        bytes -= frameBytes;
+    }
+    if (bytes > 0)
+    {
+        memcpy(glitch->carry + glitch->carry_bytes, p, bytes);
+        glitch->carry_bytes += bytes;
+    }
+    glitch->buffers++;
+}
+
+void capture_glitch_finish(capture_glitch_t *glitch)
+{
+    if (glitch == NULL)
+    {
+        return;
+    }
+    if (glitch->silence_frames > 0)
+    {
+        closeSilence(glitch);
+    }
+    closeRepeatRun(glitch);
+}
+
+uint64_t capture_glitch_count(const capture_glitch_t *glitch, capture_glitch_type_t type)
+{
+    if ((glitch == NULL) || (type >= CAPTURE_GLITCH_TYPES))
+    {
+        return 0;
+    }
+    return __atomic_load_n(&glitch->count[type], __ATOMIC_RELAXED);
+}
+
+size_t capture_glitch_events(const capture_glitch_t *glitch, capture_glitch_event_t *events, size_t max_events)
+{
+    uint64_t first;
+    size_t copied = 0;
+
+    if ((glitch == NULL) || (events == NULL))
+    {
+        return 0;
+    }
+    first = (glitch->total > CAPTURE_GLITCH_MAX_EVENTS) ? glitch->total - CAPTURE_GLITCH_MAX_EVENTS : 0;
+    for (uint64_t i = first; (i < glitch->total) && (copied < max_events); i++)
+    {
+        events[copied++] = glitch->events[i % CAPTURE_GLITCH_MAX_EVENTS];
+    }
+    return copied;
+}
+
+const char *capture_glitch_type_name(capture_glitch_type_t type)
+{
+    switch (type)
+    {
+    case CAPTURE_GLITCH_DISCONTINUITY:
+        return "discontinuity";
+    case CAPTURE_GLITCH_SILENCE:
+        return "silence";
+    case CAPTURE_GLITCH_REPEAT:
+        return "repeat";
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,151 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_glitch.h
+*
+* Online detection of glitches in captured audio, run on every callback buffer.
+*
+* Three kinds of glitch are detected:
+* - discontinuities, a second difference of the samples far above its recent average
+* - runs of digital silence, every channel exactly zero for at least CAPTURE_GLITCH_MIN_SILENCE_MS
+* - repeated buffers, buffers whose hashes equal those of buffers up to CAPTURE_GLITCH_HISTORY earlier
+*
+* A steady tone can produce identical buffers without any fault. Consecutive buffers
+* repeating at the same distance are therefore tracked as a run, and the run is only
+* reported as a glitch when the buffer before it did not repeat at that distance and
+* the run is no longer than the distance, as when a HAL replays buffers it already
+* delivered. A periodic signal keeps repeating for far longer.
+* All-zero buffers are left to the silence detection.
+*
+* Memory use is constant, the most recent CAPTURE_GLITCH_MAX_EVENTS events are kept
+* and older ones are only counted.
+*/
+
+#ifndef CAPTURE_GLITCH_H
+#define CAPTURE_GLITCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_GLITCH_MAX_CHANNELS         6
+#define CAPTURE_GLITCH_MAX_EVENTS           64
+#define CAPTURE_GLITCH_HISTORY              32      // Buffer hashes kept for repeat detection
+#define CAPTURE_GLITCH_MIN_SILENCE_MS       5       // Shortest run of digital silence reported
+#define CAPTURE_GLITCH_JUMP_RATIO           8.0     // Second difference over its running average flagged as a discontinuity
+#define CAPTURE_GLITCH_JUMP_FLOOR           0.0625  // Smallest second difference flagged, fraction of full scale
+#define CAPTURE_GLITCH_REFRACTORY_FRAMES    64      // Frames ignored on a channel after a discontinuity
+
+typedef enum
+{
+    CAPTURE_GLITCH_DISCONTINUITY = 0,
+    CAPTURE_GLITCH_SILENCE,
+    CAPTURE_GLITCH_REPEAT,
+    CAPTURE_GLITCH_TYPES
+} capture_glitch_type_t;
+
+typedef struct
+{
+    capture_glitch_type_t type;
+    uint64_t frame;             // Stream offset in frames where the glitch starts
+    uint64_t time_ns;           // Arrival of the buffer holding frame, relative to the first buffer
+    uint64_t buffer;            // Index of the buffer holding frame
+    uint16_t channel;           // Channel of a discontinuity, 0 otherwise
+    uint64_t length;            // Frames of silence, or number of repeated buffers
+    uint32_t lag;               // Buffers between a repeated buffer and its original
+    double magnitude;           // Second difference of a discontinuity as a fraction of full scale
+} capture_glitch_event_t;
+
+typedef struct
+{
+    uint16_t channels;
+    uint16_t bytes_per_sample;
+    uint32_t sampling_rate;
+    uint64_t min_silence_frames;
+
+    /* Stream position */
+    uint64_t frames;
+    uint64_t buffers;
+    uint64_t start_ns;
+    uint64_t buffer_ns;
+    uint8_t carry[CAPTURE_GLITCH_MAX_CHANNELS * 3];
+    size_t carry_bytes;
+
+    /* Discontinuities */
+    int32_t previous[CAPTURE_GLITCH_MAX_CHANNELS][2];   // Last two samples per channel
+    double average_jump[CAPTURE_GLITCH_MAX_CHANNELS];    // Running mean of |second difference|
+    uint32_t refractory[CAPTURE_GLITCH_MAX_CHANNELS];
+
+    /* Silence */
+    uint64_t silence_start;
+    uint64_t silence_frames;
+    uint64_t silence_ns;
+    uint64_t silence_buffer;
+
+    /* Repeats */
+    uint64_t hashes[CAPTURE_GLITCH_HISTORY];
+    uint32_t sizes[CAPTURE_GLITCH_HISTORY];
+    bool zero[CAPTURE_GLITCH_HISTORY];
+    uint32_t run_lag;           // Distance of the current run of repeats, 0 when there is none
+    uint64_t run_length;
+    uint64_t run_frame;
+    uint64_t run_ns;
+    uint64_t run_buffer;
+    bool run_periodic;          // The buffer before the run matched at the same distance
+
+    /* Results */
+    capture_glitch_event_t events[CAPTURE_GLITCH_MAX_EVENTS];
+    uint64_t total;             // Events recorded, the ring holds the latest CAPTURE_GLITCH_MAX_EVENTS
+    uint64_t count[CAPTURE_GLITCH_TYPES];
+} capture_glitch_t;
+
+/**
+ * @brief Prepares a detector for interleaved little-endian PCM
+ *
+ * @param bits_per_sample - 16 or 24, samples are packed in bits_per_sample / 8 bytes
+ */
+rmf_Error capture_glitch_init(capture_glitch_t *glitch, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample);
+
+/**
+ * @brief Checks one callback buffer, buffers need not hold whole frames
+ */
+void capture_glitch_process(capture_glitch_t *glitch, const void *buffer, size_t bytes);
+
+/**
+ * @brief Reports a run of silence or repeats still open at the end of the capture
+ */
+void capture_glitch_finish(capture_glitch_t *glitch);
+
+/**
+ * @brief Gets the number of events of a type detected so far, safe to call from any thread
+ */
+uint64_t capture_glitch_count(const capture_glitch_t *glitch, capture_glitch_type_t type);
+
+/**
+ * @brief Copies the retained events, oldest first
+ *
+ * @return number of events copied
+ */
+size_t capture_glitch_events(const capture_glitch_t *glitch, capture_glitch_event_t *events, size_t max_events);
+
+const char *capture_glitch_type_name(capture_glitch_type_t type);
+
+#endif // CAPTURE_GLITCH_H
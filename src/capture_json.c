@@ -0,0 +1,379 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_json.c
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include "capture_json.h"
+
+static const char *skipSpaces(const char *p)
+{
+    while (*p && isspace((unsigned char)*p))
+    {
+        p++;
+    }
+    return p;
+}
+
+/* Reads a quoted string starting at p (which must point at the opening quote) */
+static const char *readString(const char *p, char *out, size_t size)
+{
+    size_t len = 0;
+
+    if (*p != '"')
+    {
+        return NULL;
+    }
+    p++;
+    while (*p && *p != '"')
+    {
+        char c = *p++;
+        if (c == '\\')
+        {
+            switch (*p++)
+            {
+            case '"':  c = '"';  break;
+            case '\\': c = '\\'; break;
+            case '/':  c = '/';  break;
+            case 'n':  c = '\n'; break;
+            case 't':  c = '\t'; break;
+            case 'r':  c = '\r'; break;
+            case 'b':  c = '\b'; break;
+            case 'f':  c = '\f'; break;
+            case 'u':
+                /* Only the ASCII range is meaningful for commands */
+                if (!isxdigit((unsigned char)p[0]) || !isxdigit((unsigned char)p[1]) ||
+                    !isxdigit((unsigned char)p[2]) || !isxdigit((unsigned char)p[3]))
+                {
+                    return NULL;
+                }
+                {
+                    char hex[5] = { p[0], p[1], p[2], p[3], 0 };
+                    long code = strtol(hex, NULL, 16);
+                    c = (code < 0x80) ? (char)code : '?';
+                }
+                p += 4;
+                break;
+            default:
+                return NULL;
+            }
+        }
+        if (len + 1 >= size)
+        {
+            return NULL;
+        }
+        out[len++] = c;
+    }
+    if (*p != '"')
+    {
+        return NULL;
+    }
+    out[len] = '\0';
+    return p + 1;
+}
+
+rmf_Error capture_json_parse(const char *line, capture_json_object_t *obj)
+{
+    const char *p;
+
+    if ((line == NULL) || (obj == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(obj, 0, sizeof(*obj));
+
+    p = skipSpaces(line);
+    if (*p++ != '{')
+    {
+        return RMF_INVALID_PARM;
+    }
+    p = skipSpaces(p);
+    if (*p == '}')
+    {
+        return RMF_SUCCESS;
+    }
+
+    while (*p)
+    {
+        capture_json_field_t *field;
+
+        if (obj->count >= CAPTURE_JSON_MAX_FIELDS)
+        {
+            return RMF_INVALID_PARM;
+        }
+        field = &obj->fields[obj->count];
+
+        p = readString(skipSpaces(p), field->key, sizeof(field->key));
+        if (p == NULL)
+        {
+            return RMF_INVALID_PARM;
+        }
+        p = skipSpaces(p);
+        if (*p++ != ':')
+        {
+            return RMF_INVALID_PARM;
+        }
+        p = skipSpaces(p);
+
+        if (*p == '"')
+        {
+            p = readString(p, field->value, sizeof(field->value));
+            if (p == NULL)
+            {
+                return RMF_INVALID_PARM;
+            }
+            field->is_string = true;
+        }
+        else
+        {
+            size_t len = 0;
+            while (*p && *p != ',' && *p != '}' && !isspace((unsigned char)*p))
+            {
+                if ((*p == '{') || (*p == '[') || (len + 1 >= sizeof(field->value)))
+                {
+                    return RMF_INVALID_PARM;
+                }
+                field->value[len++] = *p++;
+            }
+            if (len == 0)
+            {
+                return RMF_INVALID_PARM;
+            }
+            field->value[len] = '\0';
+            field->is_string = false;
+        }
+        obj->count++;
+
+        p = skipSpaces(p);
+        if (*p == ',')
+        {
+            p++;
+            continue;
+        }
+        if (*p == '}')
+        {
+            return RMF_SUCCESS;
+        }
+        return RMF_INVALID_PARM;
+    }
+    return RMF_INVALID_PARM;
+}
+
+static const capture_json_field_t *findField(const capture_json_object_t *obj, const char *key)
+{
+    if ((obj == NULL) || (key == NULL))
+    {
+        return NULL;
+    }
+    for (int i = 0; i < obj->count; i++)
+    {
+        if (strcmp(obj->fields[i].key, key) == 0)
+        {
+            return &obj->fields[i];
+        }
+    }
+    return NULL;
+}
+
+bool capture_json_has(const capture_json_object_t *obj, const char *key)
+{
+    const capture_json_field_t *field = findField(obj, key);
+    return (field != NULL) && (field->is_string || strcmp(field->value, "null") != 0);
+}
+
+const char *capture_json_get_string(const capture_json_object_t *obj, const char *key, const char *def)
+{
+    const capture_json_field_t *field = findField(obj, key);
+    if ((field == NULL) || (!field->is_string && strcmp(field->value, "null") == 0))
+    {
+        return def;
+    }
+    return field->value;
+}
+
+int64_t capture_json_get_int(const capture_json_object_t *obj, const char *key, int64_t def)
+{
+    const char *value = capture_json_get_string(obj, key, NULL);
+    char *end = NULL;
+    int64_t result;
+
+    if (value == NULL)
+    {
+        return def;
+    }
+    if (strcmp(value, "true") == 0)
+    {
+        return 1;
+    }
+    if (strcmp(value, "false") == 0)
+    {
+        return 0;
+    }
+    result = strtoll(value, &end, 0);
+    if ((end == value) || (*end != '\0'))
+    {
+        return def;
+    }
+    return result;
+}
+
+double capture_json_get_double(const capture_json_object_t *obj, const char *key, double def)
+{
+    const char *value = capture_json_get_string(obj, key, NULL);
+    char *end = NULL;
+    double result;
+
+    if (value == NULL)
+    {
+        return def;
+    }
+    result = strtod(value, &end);
+    if ((end == value) || (*end != '\0'))
+    {
+        return def;
+    }
+    return result;
+}
+
+static void appendRaw(capture_json_writer_t *w, const char *text, size_t len)
+{
+    if (w->overflow || (w->len + len + 1 >= w->size))
+    {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, text, len);
+    w->len += len;
+    w->buf[w->len] = '\0';
+}
+
+static void appendQuoted(capture_json_writer_t *w, const char *text)
+{
+    appendRaw(w, "\"", 1);
+    for (const char *p = text; p && *p; p++)
+    {
+        char escaped[8];
+        unsigned char c = (unsigned char)*p;
+
+        if ((c == '"') || (c == '\\'))
+        {
+            escaped[0] = '\\';
+            escaped[1] = (char)c;
+            appendRaw(w, escaped, 2);
+        }
+        else if (c < 0x20)
+        {
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            appendRaw(w, escaped, 6);
+        }
+        else
+        {
+            appendRaw(w, (const char *)&c, 1);
+        }
+    }
+    appendRaw(w, "\"", 1);
+}
+
+static void appendKey(capture_json_writer_t *w, const char *key)
+{
+    if (!w->first)
+    {
+        appendRaw(w, ",", 1);
+    }
+    w->first = false;
+    appendQuoted(w, key);
+    appendRaw(w, ":", 1);
+}
+
+void capture_json_begin(capture_json_writer_t *w, char *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->first = true;
+    w->overflow = (buf == NULL) || (size < 3);
+    if (!w->overflow)
+    {
+        buf[0] = '\0';
+    }
+    appendRaw(w, "{", 1);
+}
+
+void capture_json_add_string(capture_json_writer_t *w, const char *key, const char *value)
+{
+    appendKey(w, key);
+    if (value == NULL)
+    {
+        appendRaw(w, "null", 4);
+        return;
+    }
+    appendQuoted(w, value);
+}
+
+void capture_json_add_int(capture_json_writer_t *w, const char *key, int64_t value)
+{
+    char text[32];
+    int len = snprintf(text, sizeof(text), "%" PRId64, value);
+    appendKey(w, key);
+    appendRaw(w, text, (size_t)len);
+}
+
+void capture_json_add_uint(capture_json_writer_t *w, const char *key, uint64_t value)
+{
+    char text[32];
+    int len = snprintf(text, sizeof(text), "%" PRIu64, value);
+    appendKey(w, key);
+    appendRaw(w, text, (size_t)len);
+}
+
+void capture_json_add_double(capture_json_writer_t *w, const char *key, double value)
+{
+    char text[48];
+    int len;
+
+    appendKey(w, key);
+    if (!isfinite(value))
+    {
+        /* JSON has no representation for NaN or infinity */
+        appendRaw(w, "null", 4);
+        return;
+    }
+    len = snprintf(text, sizeof(text), "%.6g", value);
+    appendRaw(w, text, (size_t)len);
+}
+
+void capture_json_add_bool(capture_json_writer_t *w, const char *key, bool value)
+{
+    appendKey(w, key);
+    appendRaw(w, value ? "true" : "false", value ? 4 : 5);
+}
+
+const char *capture_json_end(capture_json_writer_t *w)
+{
+    appendRaw(w, "}", 1);
+    return w->overflow ? NULL : w->buf;
+}
@@ -0,0 +1,90 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_json.h
+*
+* Minimal line-delimited JSON support used by the test binary to talk to the host.
+*
+* Only flat objects are supported: string, number, boolean and null values keyed
+* by string names. Nested objects and arrays are rejected by the parser and never
+* produced by the writer.
+*/
+
+#ifndef CAPTURE_JSON_H
+#define CAPTURE_JSON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_JSON_MAX_FIELDS 16
+#define CAPTURE_JSON_MAX_KEY 32
+#define CAPTURE_JSON_MAX_VALUE 256
+
+typedef struct
+{
+    char key[CAPTURE_JSON_MAX_KEY];
+    char value[CAPTURE_JSON_MAX_VALUE];
+    bool is_string;
+} capture_json_field_t;
+
+typedef struct
+{
+    int count;
+    capture_json_field_t fields[CAPTURE_JSON_MAX_FIELDS];
+} capture_json_object_t;
+
+typedef struct
+{
+    char *buf;
+    size_t size;
+    size_t len;
+    bool first;
+    bool overflow;
+} capture_json_writer_t;
+
+/**
+ * @brief Parses one line holding a flat JSON object
+ *
+ * @return RMF_SUCCESS on success, RMF_INVALID_PARM if the line is not a flat JSON object
+ */
+rmf_Error capture_json_parse(const char *line, capture_json_object_t *obj);
+
+bool capture_json_has(const capture_json_object_t *obj, const char *key);
+const char *capture_json_get_string(const capture_json_object_t *obj, const char *key, const char *def);
+int64_t capture_json_get_int(const capture_json_object_t *obj, const char *key, int64_t def);
+double capture_json_get_double(const capture_json_object_t *obj, const char *key, double def);
+
+/**
+ * @brief Starts a JSON object in the caller supplied buffer
+ *
+ * The writer never allocates; if the buffer is too small the overflow flag is set
+ * and capture_json_end() returns NULL.
+ */
+void capture_json_begin(capture_json_writer_t *w, char *buf, size_t size);
+void capture_json_add_string(capture_json_writer_t *w, const char *key, const char *value);
+void capture_json_add_int(capture_json_writer_t *w, const char *key, int64_t value);
+void capture_json_add_uint(capture_json_writer_t *w, const char *key, uint64_t value);
+void capture_json_add_double(capture_json_writer_t *w, const char *key, double value);
+void capture_json_add_bool(capture_json_writer_t *w, const char *key, bool value);
+const char *capture_json_end(capture_json_writer_t *w);
+
+#endif // CAPTURE_JSON_H
@@ -0,0 +1,289 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_meter.c
+*
+*/
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "capture_meter.h"
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Accumulates frames into part. Always inlined and called with constant channels and
+ * bytesPerSample, so each format gets a specialised loop with the channel loop unrolled
+ * and the per-channel sums kept in registers.
+ */
+static inline __attribute__((always_inline)) void meterFrames(capture_meter_part_t *part, const uint8_t *p, size_t frames,
+                                                              const uint16_t channels, const uint16_t bytesPerSample)
+{
+    const int32_t maxValue = (bytesPerSample == 2) ? INT16_MAX : 0x7FFFFF;
+    const int32_t minValue = -maxValue - 1;
+    int64_t sum[CAPTURE_METER_MAX_CHANNELS] = {0};
+    uint64_t sumSquares[CAPTURE_METER_MAX_CHANNELS] = {0};
+    uint32_t peak[CAPTURE_METER_MAX_CHANNELS] = {0};
+    uint32_t clipped[CAPTURE_METER_MAX_CHANNELS] = {0};
+
+    for (size_t f = 0; f < frames; f++)
+    {
+        for (uint16_t c = 0; c < channels; c++, p += bytesPerSample)
+        {
+            int32_t value;
+            uint32_t magnitude;
+
+            if (bytesPerSample == 2)
+            {
+                value = (int16_t)(p[0] | (p[1] << 8));
+            }
+            else
+            {
+                value = (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) >> 8;
+            }
+            magnitude = (uint32_t)((value < 0) ? -value : value);
+            sum[c] += value;
+            sumSquares[c] += (uint64_t)((int64_t)value * value);
+            peak[c] = (magnitude > peak[c]) ? magnitude : peak[c];
+            clipped[c] += (uint32_t)((value == maxValue) | (value == minValue));
+        }
+    }
+
+    for (uint16_t c = 0; c < channels; c++)
+    {
+        part->sum[c] += sum[c];
+        part->sum_squares[c] += sumSquares[c];
+        part->peak[c] = (peak[c] > part->peak[c]) ? peak[c] : part->peak[c];
+        part->clipped[c] += clipped[c];
+    }
+    part->frames += (uint32_t)frames;
+}
+
+static void meterSegment(capture_meter_t *meter, const uint8_t *p, size_t frames)
+{
+    capture_meter_part_t *part = &meter->parts[meter->current];
+
+    switch ((meter->channels << 2) | meter->bytes_per_sample)
+    {
+    case (1 << 2) | 2:
+        meterFrames(part, p, frames, 1, 2);
+        break;
+    case (2 << 2) | 2:
+        meterFrames(part, p, frames, 2, 2);
+        break;
+    case (2 << 2) | 3:
+        meterFrames(part, p, frames, 2, 3);
+        break;
+    case (6 << 2) | 3:
+        meterFrames(part, p, frames, 6, 3);
+        break;
+    default:
+        meterFrames(part, p, frames, meter->channels, meter->bytes_per_sample);
+        break;
+    }
+}
+
+/* Meters whole frames, moving the window on each time a part is completed */
+static void meterFramesWindowed(capture_meter_t *meter, const uint8_t *p, size_t frames)
+{
+    size_t frameBytes = (size_t)meter->channels * meter->bytes_per_sample;
+
+    while (frames > 0)
+    {
+        size_t room = meter->part_frames - meter->parts[meter->current].frames;
+        size_t count = (frames < room) ? frames : room;
+
+        meterSegment(meter, p, count);
+        p += count * frameBytes;
+        frames -= count;
+
+        if (meter->parts[meter->current].frames == meter->part_frames)
+        {
+            meter->current = (meter->current + 1) % CAPTURE_METER_SUBWINDOWS;
+            /* The part about to be reused leaves the window, keep its clips in the totals */
+            for (uint16_t c = 0; c < meter->channels; c++)
+            {
+                meter->clipped_total[c] += meter->parts[meter->current].clipped[c];
+            }
+            memset(&meter->parts[meter->current], 0, sizeof(meter->parts[meter->current]));
+        }
+    }
+}
+
+/* Writes the window levels into the published snapshot, the caller holds the sequence lock */
+static void publishLevels(capture_meter_t *meter, capture_meter_snapshot_t *out)
+{
+    const double fullScale = (meter->bytes_per_sample == 2) ? 32768.0 : 8388608.0;
+    uint64_t frames = 0;
+
+    for (uint32_t i = 0; i < CAPTURE_METER_SUBWINDOWS; i++)
+    {
+        frames += meter->parts[i].frames;
+    }
+    out->window_frames = frames;
+
+    for (uint16_t c = 0; c < meter->channels; c++)
+    {
+        int64_t sum = 0;
+        uint64_t sumSquares = 0;
+        uint32_t peak = 0;
+        uint64_t clipped = 0;
+
+        for (uint32_t i = 0; i < CAPTURE_METER_SUBWINDOWS; i++)
+        {
+            const capture_meter_part_t *part = &meter->parts[i];
+            sum += part->sum[c];
+            sumSquares += part->sum_squares[c];
+            peak = (part->peak[c] > peak) ? part->peak[c] : peak;
+            clipped += part->clipped[c];
+        }
+        out->channel[c].rms = (frames > 0) ? sqrt((double)sumSquares / (double)frames) / fullScale : 0.0;
+        out->channel[c].peak = (double)peak / fullScale;
+        out->channel[c].dc_offset = (frames > 0) ? ((double)sum / (double)frames) / fullScale : 0.0;
+        out->channel[c].clipped = clipped;
+        out->channel[c].clipped_total = meter->clipped_total[c] + clipped;
+    }
+}
+
+rmf_Error capture_meter_init(capture_meter_t *meter, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample, uint32_t window_ms)
+{
+    if ((meter == NULL) || (channels == 0) || (channels > CAPTURE_METER_MAX_CHANNELS) ||
+        (sampling_rate == 0) || ((bits_per_sample != 16) && (bits_per_sample != 24)) || (window_ms == 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(meter, 0, sizeof(*meter));
+    meter->channels = channels;
+    meter->bytes_per_sample = bits_per_sample / 8;
+    meter->sampling_rate = sampling_rate;
+    meter->part_frames = (uint32_t)((uint64_t)sampling_rate * window_ms / 1000 / CAPTURE_METER_SUBWINDOWS);
+    if (meter->part_frames == 0)
+    {
+        meter->part_frames = 1;
+    }
+    meter->published.channels = channels;
+    meter->published.sampling_rate = sampling_rate;
+    return RMF_SUCCESS;
+}
+
+void capture_meter_process(capture_meter_t *meter, const void *buffer, size_t bytes)
+{
+    const uint8_t *p = (const uint8_t *)buffer;
+    size_t frameBytes;
+    size_t frames = 0;
+    uint64_t start;
+    uint64_t cost;
+    uint32_t sequence;
+    capture_meter_snapshot_t *out;
+
+    if ((meter == NULL) || (buffer == NULL) || (meter->channels == 0))
+    {
+        return;
+    }
+    start = nowNs();
+    frameBytes = (size_t)meter->channels * meter->bytes_per_sample;
+
+    /* Complete a frame split across the previous buffer */
+    if (meter->carry_bytes > 0)
+    {
+        size_t need = frameBytes - meter->carry_bytes;
+        size_t take = (bytes < need) ? bytes : need;
+
+        memcpy(meter->carry + meter->carry_bytes, p, take);
+        meter->carry_bytes += take;
+        p += take;
+        bytes -= take;
+        if (meter->carry_bytes == frameBytes)
+        {
+            meterFramesWindowed(meter, meter->carry, 1);
+            meter->carry_bytes = 0;
+            frames++;
+        }
+    }
+
+    meterFramesWindowed(meter, p, bytes / frameBytes);
+    frames += bytes / frameBytes;
+    p += (bytes / frameBytes) * frameBytes;
+    bytes %= frameBytes;
+    if (bytes > 0)
+    {
+        memcpy(meter->carry + meter->carry_bytes, p, bytes);
+        meter->carry_bytes += bytes;
+    }
+
+    /* Publish, readers retry while the sequence is odd or has changed */
+    out = &meter->published;
+    sequence = meter->sequence;
+    __atomic_store_n(&meter->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    publishLevels(meter, out);
+    out->frames += frames;
+    out->buffers++;
+    cost = nowNs() - start;
+    out->cost_ns += cost;
+    if (cost > out->max_cost_ns)
+    {
+        out->max_cost_ns = cost;
+    }
+    if (out->frames > 0)
+    {
+        out->load = (double)out->cost_ns * meter->sampling_rate / ((double)out->frames * 1e9);
+    }
+    if (frames > 0)
+    {
+        double bufferLoad = (double)cost * meter->sampling_rate / ((double)frames * 1e9);
+        if (bufferLoad > out->max_load)
+        {
+            out->max_load = bufferLoad;
+        }
+    }
+
+    __atomic_store_n(&meter->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+void capture_meter_snapshot(const capture_meter_t *meter, capture_meter_snapshot_t *snapshot)
+{
+    uint32_t before;
+    uint32_t after;
+
+    if ((meter == NULL) || (snapshot == NULL))
+    {
+        return;
+    }
+    do
+    {
+        before = __atomic_load_n(&meter->sequence, __ATOMIC_ACQUIRE);
+        memcpy(snapshot, &meter->published, sizeof(*snapshot));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&meter->sequence, __ATOMIC_RELAXED);
+    } while ((before & 1) || (before != after));
+}
+
+double capture_meter_dbfs(double level)
+{
+    return (level > 0.0) ? 20.0 * log10(level) : -INFINITY;
+}
@@ -0,0 +1,129 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_meter.h
+*
+* Per-channel level metering of captured audio, run from the buffer ready callback.
+*
+* The window is split into CAPTURE_METER_SUBWINDOWS equal parts and the levels are
+* computed over the last full window, sliding forward one part at a time. Only
+* integer sums are kept per part, so each sample costs a few integer operations.
+*
+* The callback thread is the only writer. Other threads read a consistent copy of
+* the latest levels with capture_meter_snapshot() at any time, using a sequence lock
+* so the callback never waits for a reader.
+*/
+
+#ifndef CAPTURE_METER_H
+#define CAPTURE_METER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_METER_MAX_CHANNELS  6
+#define CAPTURE_METER_SUBWINDOWS    8       // Parts the sliding window advances by
+#define CAPTURE_METER_WINDOW_MS     400     // Default sliding window length
+#define CAPTURE_METER_MAX_LOAD      0.01    // Metering may use at most 1% of the callback period
+
+/**
+ * @brief Levels of one channel over the sliding window, normalised to full scale
+ */
+typedef struct
+{
+    double rms;                 // 0 to 1
+    double peak;                // Largest absolute sample, 0 to 1
+    double dc_offset;           // Mean sample value, -1 to 1
+    uint64_t clipped;           // Samples at either full scale value in the window
+    uint64_t clipped_total;     // Samples at either full scale value since capture_meter_init()
+} capture_meter_channel_t;
+
+/**
+ * @brief Consistent copy of the meter state returned by capture_meter_snapshot()
+ */
+typedef struct
+{
+    uint16_t channels;
+    uint32_t sampling_rate;
+    uint64_t window_frames;     // Frames covered by the levels, less than a full window just after start
+    uint64_t frames;            // Frames metered since capture_meter_init()
+    uint64_t buffers;           // Callback buffers metered
+    uint64_t cost_ns;           // Time spent metering
+    uint64_t max_cost_ns;       // Longest time spent on one buffer
+    double load;                // cost_ns as a fraction of the audio duration metered
+    double max_load;            // Largest fraction of one buffer's period spent metering it
+    capture_meter_channel_t channel[CAPTURE_METER_MAX_CHANNELS];
+} capture_meter_snapshot_t;
+
+/**
+ * @brief Integer sums for one part of the window
+ */
+typedef struct
+{
+    uint32_t frames;
+    int64_t sum[CAPTURE_METER_MAX_CHANNELS];
+    uint64_t sum_squares[CAPTURE_METER_MAX_CHANNELS];
+    uint32_t peak[CAPTURE_METER_MAX_CHANNELS];
+    uint32_t clipped[CAPTURE_METER_MAX_CHANNELS];
+} capture_meter_part_t;
+
+typedef struct
+{
+    uint16_t channels;
+    uint16_t bytes_per_sample;
+    uint32_t sampling_rate;
+    uint32_t part_frames;       // Frames per window part
+    uint8_t carry[CAPTURE_METER_MAX_CHANNELS * 3];  // Partial frame left over from the previous buffer
+    size_t carry_bytes;
+    capture_meter_part_t parts[CAPTURE_METER_SUBWINDOWS];
+    uint32_t current;           // Part being filled
+    uint32_t parts_filled;      // Completed parts, up to CAPTURE_METER_SUBWINDOWS
+    uint64_t clipped_total[CAPTURE_METER_MAX_CHANNELS];
+    uint32_t sequence;          // Odd while the snapshot is being written
+    capture_meter_snapshot_t published;
+} capture_meter_t;
+
+/**
+ * @brief Prepares a meter for interleaved little-endian PCM
+ *
+ * @param bits_per_sample - 16 or 24, samples are packed in bits_per_sample / 8 bytes
+ * @param window_ms - sliding window length, e.g. CAPTURE_METER_WINDOW_MS
+ */
+rmf_Error capture_meter_init(capture_meter_t *meter, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample, uint32_t window_ms);
+
+/**
+ * @brief Meters one callback buffer and publishes the updated levels
+ *
+ * Buffers need not hold whole frames, a partial frame is kept for the next call.
+ */
+void capture_meter_process(capture_meter_t *meter, const void *buffer, size_t bytes);
+
+/**
+ * @brief Copies the latest published levels, safe to call from any thread
+ */
+void capture_meter_snapshot(const capture_meter_t *meter, capture_meter_snapshot_t *snapshot);
+
+/**
+ * @brief Converts a normalised level to dBFS, -INFINITY for 0
+ */
+double capture_meter_dbfs(double level);
+
+#endif // CAPTURE_METER_H
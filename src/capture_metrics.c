@@ -0,0 +1,185 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_metrics.c
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "capture_metrics.h"
+#include "capture_timeline.h"
+
+static pthread_mutex_t gMetricsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t gMetricsOnce = PTHREAD_ONCE_INIT;
+static int gMetricsFd = -1;
+static bool gMetricsOwnFd = false;
+
+static uint64_t nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000ull + (uint64_t)ts.tv_nsec / 1000000ull;
+}
+
+static void openFromEnvironment(void)
+{
+    const char *spec = getenv(CAPTURE_METRICS_ENV);
+
+    if ((spec != NULL) && (*spec != '\0') && (RMF_SUCCESS != capture_metrics_open(spec)))
+    {
+        fprintf(stderr, "Unable to open the metrics stream %s=%s\n", CAPTURE_METRICS_ENV, spec);
+    }
+}
+
+/* Caller holds gMetricsLock */
+static void closeLocked(void)
+{
+    if (gMetricsOwnFd)
+    {
+        close(gMetricsFd);
+    }
+    gMetricsFd = -1;
+    gMetricsOwnFd = false;
+}
+
+bool capture_metrics_enabled(void)
+{
+    pthread_once(&gMetricsOnce, openFromEnvironment);
+    return __atomic_load_n(&gMetricsFd, __ATOMIC_ACQUIRE) >= 0;
+}
+
+rmf_Error capture_metrics_open(const char *spec)
+{
+    int fd;
+    bool own;
+
+    if (spec == NULL)
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    if (strncmp(spec, "fd:", 3) == 0)
+    {
+        char *end;
+        long value = strtol(spec + 3, &end, 10);
+
+        if ((end == spec + 3) || (*end != '\0') || (value < 0) || (fcntl((int)value, F_GETFD) < 0))
+        {
+            return RMF_INVALID_PARM;
+        }
+        fd = (int)value;
+        own = false;
+    }
+    else if (strncmp(spec, "file:", 5) == 0)
+    {
+        fd = open(spec + 5, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            return RMF_ERROR;
+        }
+        own = true;
+    }
+    else
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    pthread_mutex_lock(&gMetricsLock);
+    closeLocked();
+    gMetricsOwnFd = own;
+    __atomic_store_n(&gMetricsFd, fd, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&gMetricsLock);
+    return RMF_SUCCESS;
+}
+
+void capture_metrics_close(void)
+{
+    pthread_mutex_lock(&gMetricsLock);
+    closeLocked();
+    pthread_mutex_unlock(&gMetricsLock);
+}
+
+void capture_metrics_begin(capture_metrics_record_t *record, const char *metric, const char *test, const char *capture)
+{
+    capture_json_begin(&record->writer, record->line, sizeof(record->line) - 1); // Leaves room for the newline
+    capture_json_add_string(&record->writer, "metric", metric);
+    capture_json_add_string(&record->writer, "test", test);
+    if (capture != NULL)
+    {
+        capture_json_add_string(&record->writer, "capture", capture);
+    }
+    capture_json_add_uint(&record->writer, "time_ms", nowMs());
+}
+
+rmf_Error capture_metrics_emit(capture_metrics_record_t *record)
+{
+    const char *line = capture_json_end(&record->writer);
+    size_t len;
+    size_t done = 0;
+    rmf_Error result = RMF_SUCCESS;
+
+    if (!capture_metrics_enabled())
+    {
+        return RMF_INVALID_STATE;
+    }
+    if (line == NULL)
+    {
+        return RMF_ERROR;
+    }
+    len = strlen(line);
+    record->line[len++] = '\n';
+
+    CAPTURE_TIMELINE_SCOPE("metrics_emit", "bytes", len);
+    pthread_mutex_lock(&gMetricsLock);
+    if (gMetricsFd < 0)
+    {
+        pthread_mutex_unlock(&gMetricsLock);
+        return RMF_INVALID_STATE;
+    }
+    if (gMetricsFd == STDOUT_FILENO)
+    {
+        /* Keep the record on a line of its own between the buffered log lines */
+        fflush(stdout);
+    }
+    while (done < len)
+    {
+        ssize_t written = write(gMetricsFd, record->line + done, len - done);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            result = RMF_ERROR;
+            break;
+        }
+        done += (size_t)written;
+    }
+    pthread_mutex_unlock(&gMetricsLock);
+    return result;
+}
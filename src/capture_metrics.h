@@ -0,0 +1,91 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_metrics.h
+*
+* Machine readable metrics stream of the test binary.
+*
+* Every measurement the tests log is also emitted as one flat JSON object per line
+* (see capture_json.h) so the host can track it without parsing the log text. The
+* stream is selected with the RMF_AUDIOCAPTURE_METRICS environment variable and is
+* disabled when it is not set:
+*
+* | Value | Description |
+* | ----- | ----------- |
+* | `fd:<n>` | Records are written to an inherited file descriptor, `fd:1` interleaves them with the log on stdout |
+* | `file:<path>` | Records are appended to the file, which is created if needed |
+*
+* Each record starts with the fields `metric` (record kind), `test` (test that
+* produced it), `capture` (`primary` or `auxiliary`) and `time_ms` (wall clock
+* milliseconds since the epoch), followed by the fields of its kind. Records are
+* written whole under a lock, so records from several threads never interleave.
+*/
+
+#ifndef CAPTURE_METRICS_H
+#define CAPTURE_METRICS_H
+
+#include <stdbool.h>
+
+#include "rmfAudioCapture.h"
+#include "capture_json.h"
+
+#define CAPTURE_METRICS_ENV "RMF_AUDIOCAPTURE_METRICS"
+#define CAPTURE_METRICS_LINE_MAX 1024
+
+typedef struct
+{
+    capture_json_writer_t writer;   // Add the fields of the record kind to this writer
+    char line[CAPTURE_METRICS_LINE_MAX];
+} capture_metrics_record_t;
+
+/**
+ * @brief Whether a metrics stream is configured, opening it from the environment on first use
+ */
+bool capture_metrics_enabled(void);
+
+/**
+ * @brief Opens the metrics stream described by spec, replacing any open stream
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for a bad spec, RMF_ERROR if the file could not be opened
+ */
+rmf_Error capture_metrics_open(const char *spec);
+
+/**
+ * @brief Closes the metrics stream, records are dropped until it is opened again
+ */
+void capture_metrics_close(void);
+
+/**
+ * @brief Starts a record with the common fields
+ *
+ * @param[in] metric   - Record kind, for example "bytes" or "window"
+ * @param[in] test     - Test producing the record
+ * @param[in] capture  - "primary", "auxiliary", or NULL when the record is not about one capture
+ */
+void capture_metrics_begin(capture_metrics_record_t *record, const char *metric, const char *test, const char *capture);
+
+/**
+ * @brief Writes the record as one line
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_STATE when no stream is open, RMF_ERROR when the
+ *         record did not fit in CAPTURE_METRICS_LINE_MAX or could not be written
+ */
+rmf_Error capture_metrics_emit(capture_metrics_record_t *record);
+
+#endif // CAPTURE_METRICS_H
@@ -0,0 +1,234 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_pool.c
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "capture_pool.h"
+
+#define POOL_EMPTY UINT32_MAX
+
+/*
+ * The free list is a stack of buffer indexes. Its head packs the top index with a
+ * counter bumped on every change, so a compare and swap cannot succeed on a head that
+ * was popped and pushed back in between.
+ */
+struct capture_pool
+{
+    uint64_t head;
+    uint32_t *next;             // Index below each free buffer on the stack
+    capture_pool_buffer_t *buffers;
+    uint8_t *storage;
+    uint32_t count;
+    uint32_t in_use;
+    uint32_t high_water;
+    uint64_t acquired;
+    uint64_t exhausted;
+    uint64_t last_exhausted_ns;
+};
+
+static uint64_t packHead(uint32_t index, uint32_t tag)
+{
+    return ((uint64_t)tag << 32) | index;
+}
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void push(capture_pool_t *pool, uint32_t index)
+{
+    uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+    uint64_t replacement;
+
+    do
+    {
+        pool->next[index] = (uint32_t)head;
+        replacement = packHead(index, (uint32_t)(head >> 32) + 1);
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, replacement, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static uint32_t pop(capture_pool_t *pool)
+{
+    uint64_t head = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE);
+    uint64_t replacement;
+    uint32_t index;
+
+    do
+    {
+        index = (uint32_t)head;
+        if (index == POOL_EMPTY)
+        {
+            return POOL_EMPTY;
+        }
+        /* next[index] may be stale if another thread won, the tag then makes the exchange fail */
+        replacement = packHead(__atomic_load_n(&pool->next[index], __ATOMIC_RELAXED), (uint32_t)(head >> 32) + 1);
+    } while (!__atomic_compare_exchange_n(&pool->head, &head, replacement, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return index;
+}
+
+rmf_Error capture_pool_create(capture_pool_t **pool, uint32_t buffer_bytes, uint32_t count, size_t alignment)
+{
+    capture_pool_t *created;
+    size_t stride;
+
+    if (alignment == 0)
+    {
+        alignment = CAPTURE_POOL_ALIGNMENT_DEFAULT;
+    }
+    if ((pool == NULL) || (buffer_bytes == 0) || (count == 0) || (count == POOL_EMPTY) ||
+        ((alignment & (alignment - 1)) != 0) || (alignment < sizeof(void *)))
+    {
+        return RMF_INVALID_PARM;
+    }
+    stride = ((size_t)buffer_bytes + alignment - 1) & ~(alignment - 1);
+
+    created = (capture_pool_t *)calloc(1, sizeof(*created));
+    if (created == NULL)
+    {
+        return RMF_ERROR;
+    }
+    created->next = (uint32_t *)calloc(count, sizeof(uint32_t));
+    created->buffers = (capture_pool_buffer_t *)calloc(count, sizeof(capture_pool_buffer_t));
+    if ((created->next == NULL) || (created->buffers == NULL) ||
+        (posix_memalign((void **)&created->storage, alignment, stride * count) != 0))
+    {
+        free(created->next);
+        free(created->buffers);
+        free(created);
+        return RMF_ERROR;
+    }
+    created->count = count;
+
+    /* Stack the buffers so the first acquires return them in address order */
+    created->head = packHead(POOL_EMPTY, 0);
+    for (uint32_t i = count; i-- > 0;)
+    {
+        created->buffers[i].data = created->storage + stride * i;
+        created->buffers[i].capacity = buffer_bytes;
+        created->buffers[i].pool = created;
+        created->buffers[i].index = i;
+        push(created, i);
+    }
+    *pool = created;
+    return RMF_SUCCESS;
+}
+
+capture_pool_buffer_t *capture_pool_acquire(capture_pool_t *pool)
+{
+    capture_pool_buffer_t *buffer;
+    uint32_t in_use;
+    uint32_t high;
+    uint32_t index;
+
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+    index = pop(pool);
+    if (index == POOL_EMPTY)
+    {
+        __atomic_add_fetch(&pool->exhausted, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&pool->last_exhausted_ns, nowNs(), __ATOMIC_RELAXED);
+        return NULL;
+    }
+    __atomic_add_fetch(&pool->acquired, 1, __ATOMIC_RELAXED);
+    in_use = __atomic_add_fetch(&pool->in_use, 1, __ATOMIC_RELAXED);
+    high = __atomic_load_n(&pool->high_water, __ATOMIC_RELAXED);
+    while ((in_use > high) &&
+           !__atomic_compare_exchange_n(&pool->high_water, &high, in_use, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+
+    buffer = &pool->buffers[index];
+    buffer->bytes = 0;
+    buffer->timestamp_ns = 0;
+    __atomic_store_n(&buffer->refs, 1, __ATOMIC_RELAXED);
+    return buffer;
+}
+
+void capture_pool_retain(capture_pool_buffer_t *buffer)
+{
+    if (buffer != NULL)
+    {
+        __atomic_add_fetch(&buffer->refs, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void capture_pool_release(capture_pool_buffer_t *buffer)
+{
+    capture_pool_t *pool;
+
+    if (buffer == NULL)
+    {
+        return;
+    }
+    /* Release ordering so every use of the data happens before the buffer is reused */
+    if (__atomic_sub_fetch(&buffer->refs, 1, __ATOMIC_ACQ_REL) != 0)
+    {
+        return;
+    }
+    pool = buffer->pool;
+    __atomic_sub_fetch(&pool->in_use, 1, __ATOMIC_RELAXED);
+    push(pool, buffer->index);
+}
+
+void capture_pool_stats(const capture_pool_t *pool, capture_pool_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (pool == NULL)
+    {
+        return;
+    }
+    stats->buffers = pool->count;
+    stats->in_use = __atomic_load_n(&pool->in_use, __ATOMIC_RELAXED);
+    stats->high_water = __atomic_load_n(&pool->high_water, __ATOMIC_RELAXED);
+    stats->acquired = __atomic_load_n(&pool->acquired, __ATOMIC_RELAXED);
+    stats->exhausted = __atomic_load_n(&pool->exhausted, __ATOMIC_RELAXED);
+    stats->last_exhausted_ns = __atomic_load_n(&pool->last_exhausted_ns, __ATOMIC_RELAXED);
+}
+
+rmf_Error capture_pool_destroy(capture_pool_t *pool)
+{
+    if (pool == NULL)
+    {
+        return RMF_SUCCESS;
+    }
+    if (__atomic_load_n(&pool->in_use, __ATOMIC_ACQUIRE) != 0)
+    {
+        return RMF_INVALID_STATE;
+    }
+    free(pool->storage);
+    free(pool->buffers);
+    free(pool->next);
+    free(pool);
+    return RMF_SUCCESS;
+}
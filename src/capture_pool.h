@@ -0,0 +1,104 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_pool.h
+*
+* Pool of reference counted capture buffers.
+*
+* The HAL only lends AudioCaptureBuffer for the duration of the callback. The callback
+* copies it once into a buffer taken from the pool, and every consumer that needs the
+* audio after the callback returns takes a reference instead of another copy. The buffer
+* returns to the pool when the last reference is released, from any thread.
+*
+* Buffers are allocated once, in one block, at the requested alignment. Acquire and
+* release are lock free and never allocate, so they are safe in the callback. When
+* every buffer is in use acquire fails and the exhaustion is counted; the pool also
+* keeps the high water mark of buffers in use so it can be sized from a real run.
+*/
+
+#ifndef CAPTURE_POOL_H
+#define CAPTURE_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_POOL_ALIGNMENT_DEFAULT  64      // Cache line, also enough for any SIMD load
+
+typedef struct capture_pool capture_pool_t;
+
+typedef struct
+{
+    uint8_t *data;              // Aligned storage of capacity bytes
+    uint32_t capacity;
+    uint32_t bytes;             // Valid bytes, set by the owner that filled the buffer
+    uint64_t timestamp_ns;      // Free for the owner, e.g. the callback arrival time
+    capture_pool_t *pool;
+    uint32_t index;
+    uint32_t refs;
+} capture_pool_buffer_t;
+
+typedef struct
+{
+    uint32_t buffers;           // Buffers in the pool
+    uint32_t in_use;            // Buffers currently referenced
+    uint32_t high_water;        // Most buffers ever in use at once
+    uint64_t acquired;          // Successful acquires
+    uint64_t exhausted;         // Acquires that failed because every buffer was in use
+    uint64_t last_exhausted_ns; // CLOCK_MONOTONIC time of the last failed acquire, 0 if none
+} capture_pool_stats_t;
+
+/**
+ * @brief Creates a pool of count buffers of buffer_bytes each
+ *
+ * @param[in] alignment - Power of two alignment of every buffer, 0 selects CAPTURE_POOL_ALIGNMENT_DEFAULT
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for a zero size or bad alignment, RMF_ERROR if the memory could not be allocated
+ */
+rmf_Error capture_pool_create(capture_pool_t **pool, uint32_t buffer_bytes, uint32_t count, size_t alignment);
+
+/**
+ * @brief Takes a free buffer holding one reference, or NULL when the pool is exhausted
+ */
+capture_pool_buffer_t *capture_pool_acquire(capture_pool_t *pool);
+
+/**
+ * @brief Takes one more reference to a buffer the caller already holds
+ */
+void capture_pool_retain(capture_pool_buffer_t *buffer);
+
+/**
+ * @brief Drops one reference, the buffer returns to its pool with the last one
+ */
+void capture_pool_release(capture_pool_buffer_t *buffer);
+
+/**
+ * @brief Copies the pool counters
+ */
+void capture_pool_stats(const capture_pool_t *pool, capture_pool_stats_t *stats);
+
+/**
+ * @brief Frees the pool, every buffer must have been released
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_STATE if buffers are still referenced, the pool is then left allocated
+ */
+rmf_Error capture_pool_destroy(capture_pool_t *pool);
+
+#endif // CAPTURE_POOL_H
@@ -0,0 +1,356 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_shm.c
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "capture_shm.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define SHM_ALIGN(x) (((x) + CAPTURE_SHM_CACHE_LINE - 1) & ~(size_t)(CAPTURE_SHM_CACHE_LINE - 1))
+
+/* Shared with the readers, the counters the writer updates on every buffer have a cache line of their own */
+struct capture_shm_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_bytes;
+    uint32_t slots;
+    uint32_t slot_stride;       // Slot header and data, a multiple of the cache line
+    uint32_t closed;
+    uint8_t reserved[CAPTURE_SHM_CACHE_LINE - 6 * sizeof(uint32_t)];
+    uint64_t published;         // Buffers published, the next sequence number
+    uint32_t futex;             // Incremented on every publish and on close, readers wait on it
+    uint32_t waiters;           // Readers waiting on futex
+    uint8_t reserved2[CAPTURE_SHM_CACHE_LINE - sizeof(uint64_t) - 2 * sizeof(uint32_t)];
+} __attribute__((aligned(CAPTURE_SHM_CACHE_LINE)));
+
+typedef struct
+{
+    uint64_t seq;               // 2n+1 while buffer n is written, 2n+2 once it is complete
+    uint64_t timestamp_ns;
+    uint32_t bytes;
+} __attribute__((aligned(CAPTURE_SHM_CACHE_LINE))) shm_slot_t;
+
+struct capture_shm
+{
+    int fd;
+    capture_shm_header_t *header;
+    uint8_t *slots;
+    size_t mapped;
+};
+
+static long futexCall(uint32_t *word, int op, uint32_t value, const struct timespec *timeout)
+{
+    return syscall(SYS_futex, word, op, value, timeout, NULL, 0);
+}
+
+static shm_slot_t *slotAt(capture_shm_header_t *header, uint8_t *slots, uint64_t sequence)
+{
+    return (shm_slot_t *)(slots + (size_t)(sequence % header->slots) * header->slot_stride);
+}
+
+rmf_Error capture_shm_create(capture_shm_t **shm, uint32_t slot_bytes, uint32_t slots)
+{
+    capture_shm_t *ring;
+    size_t stride;
+
+    if ((shm == NULL) || (slot_bytes == 0) || (slots == 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+    stride = sizeof(shm_slot_t) + SHM_ALIGN((size_t)slot_bytes);
+    if (stride > UINT32_MAX)
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    ring = (capture_shm_t *)calloc(1, sizeof(*ring));
+    if (ring == NULL)
+    {
+        return RMF_ERROR;
+    }
+    ring->mapped = sizeof(capture_shm_header_t) + stride * slots;
+#ifdef SYS_memfd_create
+    ring->fd = (int)syscall(SYS_memfd_create, "rmfAudioCapture", MFD_CLOEXEC);
+#else
+    ring->fd = -1;
+#endif
+    if ((ring->fd < 0) || (ftruncate(ring->fd, (off_t)ring->mapped) != 0))
+    {
+        if (ring->fd >= 0)
+        {
+            close(ring->fd);
+        }
+        free(ring);
+        return RMF_ERROR;
+    }
+    ring->header = (capture_shm_header_t *)mmap(NULL, ring->mapped, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+    if (ring->header == MAP_FAILED)
+    {
+        close(ring->fd);
+        free(ring);
+        return RMF_ERROR;
+    }
+    ring->slots = (uint8_t *)ring->header + sizeof(capture_shm_header_t);
+
+    /* The memfd starts zeroed, the magic is stored last so a reader never sees a half initialised header */
+    ring->header->version = CAPTURE_SHM_VERSION;
+    ring->header->slot_bytes = slot_bytes;
+    ring->header->slots = slots;
+    ring->header->slot_stride = (uint32_t)stride;
+    __atomic_store_n(&ring->header->magic, CAPTURE_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    *shm = ring;
+    return RMF_SUCCESS;
+}
+
+int capture_shm_fd(const capture_shm_t *shm)
+{
+    return (shm != NULL) ? shm->fd : -1;
+}
+
+rmf_Error capture_shm_publish(capture_shm_t *shm, const void *data, uint32_t bytes, uint64_t timestamp_ns)
+{
+    capture_shm_header_t *header;
+    shm_slot_t *slot;
+    uint64_t sequence;
+
+    if ((shm == NULL) || (data == NULL) || (bytes > shm->header->slot_bytes))
+    {
+        return RMF_INVALID_PARM;
+    }
+    header = shm->header;
+    sequence = header->published;     // Only the writer stores it
+    slot = slotAt(header, shm->slots, sequence);
+
+    __atomic_store_n(&slot->seq, 2 * sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((uint8_t *)(slot + 1), data, bytes);
+    slot->bytes = bytes;
+    slot->timestamp_ns = timestamp_ns;
+    __atomic_store_n(&slot->seq, 2 * sequence + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->published, sequence + 1, __ATOMIC_RELEASE);
+
+    __atomic_add_fetch(&header->futex, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&header->waiters, __ATOMIC_SEQ_CST) != 0)
+    {
+        futexCall(&header->futex, FUTEX_WAKE, INT_MAX, NULL);
+    }
+    return RMF_SUCCESS;
+}
+
+uint64_t capture_shm_published(const capture_shm_t *shm)
+{
+    return (shm != NULL) ? __atomic_load_n(&shm->header->published, __ATOMIC_ACQUIRE) : 0;
+}
+
+void capture_shm_destroy(capture_shm_t *shm)
+{
+    if (shm == NULL)
+    {
+        return;
+    }
+    __atomic_store_n(&shm->header->closed, 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&shm->header->futex, 1, __ATOMIC_SEQ_CST);
+    futexCall(&shm->header->futex, FUTEX_WAKE, INT_MAX, NULL);
+    munmap(shm->header, shm->mapped);
+    close(shm->fd);
+    free(shm);
+}
+
+rmf_Error capture_shm_attach(capture_shm_reader_t *reader, int fd)
+{
+    capture_shm_header_t header;
+    struct stat st;
+    void *mapped;
+
+    if ((reader == NULL) || (fd < 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(reader, 0, sizeof(*reader));
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(header)))
+    {
+        return RMF_INVALID_PARM;
+    }
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+    {
+        return RMF_ERROR;
+    }
+    if ((header.magic != CAPTURE_SHM_MAGIC) || (header.version != CAPTURE_SHM_VERSION) || (header.slots == 0) ||
+        ((size_t)st.st_size != sizeof(header) + (size_t)header.slot_stride * header.slots))
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    /* Writable, a waiting reader registers itself in the header */
+    mapped = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED)
+    {
+        return RMF_ERROR;
+    }
+    reader->header = (capture_shm_header_t *)mapped;
+    reader->slots = (uint8_t *)mapped + sizeof(capture_shm_header_t);
+    reader->mapped = (size_t)st.st_size;
+    reader->next = __atomic_load_n(&reader->header->published, __ATOMIC_ACQUIRE);
+    return RMF_SUCCESS;
+}
+
+static uint64_t monotonicNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+rmf_Error capture_shm_read(capture_shm_reader_t *reader, void *data, uint32_t size, uint32_t *bytes, uint64_t *timestamp_ns, int32_t timeout_ms)
+{
+    capture_shm_header_t *header;
+    uint64_t deadline = 0;
+
+    if ((reader == NULL) || (reader->header == NULL) || (data == NULL) || (bytes == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    header = reader->header;
+    if (size < header->slot_bytes)
+    {
+        return RMF_INVALID_PARM;
+    }
+    if (timeout_ms > 0)
+    {
+        deadline = monotonicNs() + (uint64_t)timeout_ms * 1000000ull;
+    }
+
+    for (;;)
+    {
+        uint64_t published = __atomic_load_n(&header->published, __ATOMIC_ACQUIRE);
+        uint32_t value;
+
+        if (reader->next < published)
+        {
+            uint64_t expected;
+            shm_slot_t *slot;
+            uint64_t before, after;
+            uint32_t length;
+            uint64_t stamp;
+
+            if (published - reader->next > header->slots)
+            {
+                // Lapped by the writer, resume with the oldest buffer still in the ring
+                reader->dropped += published - header->slots - reader->next;
+                reader->next = published - header->slots;
+            }
+            expected = 2 * reader->next + 2;
+            slot = slotAt(header, reader->slots, reader->next);
+
+            before = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+            length = slot->bytes;
+            stamp = slot->timestamp_ns;
+            if ((before == expected) && (length <= header->slot_bytes))
+            {
+                memcpy(data, (uint8_t *)(slot + 1), length);
+            }
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+
+            if ((before != expected) || (after != expected) || (length > header->slot_bytes))
+            {
+                // Overwritten while it was copied
+                reader->dropped++;
+                reader->next++;
+                continue;
+            }
+            reader->next++;
+            *bytes = length;
+            if (timestamp_ns != NULL)
+            {
+                *timestamp_ns = stamp;
+            }
+            return RMF_SUCCESS;
+        }
+
+        if (__atomic_load_n(&header->closed, __ATOMIC_ACQUIRE))
+        {
+            return RMF_INVALID_STATE;
+        }
+        if (timeout_ms == 0)
+        {
+            return RMF_ERROR;
+        }
+
+        value = __atomic_load_n(&header->futex, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&header->waiters, 1, __ATOMIC_SEQ_CST);
+        if ((__atomic_load_n(&header->published, __ATOMIC_SEQ_CST) == published) &&
+            !__atomic_load_n(&header->closed, __ATOMIC_SEQ_CST))
+        {
+            if (timeout_ms > 0)
+            {
+                uint64_t now = monotonicNs();
+                struct timespec remaining;
+
+                if (now >= deadline)
+                {
+                    __atomic_sub_fetch(&header->waiters, 1, __ATOMIC_SEQ_CST);
+                    return RMF_ERROR;
+                }
+                remaining.tv_sec = (time_t)((deadline - now) / 1000000000ull);
+                remaining.tv_nsec = (long)((deadline - now) % 1000000000ull);
+                futexCall(&header->futex, FUTEX_WAIT, value, &remaining);
+            }
+            else
+            {
+                futexCall(&header->futex, FUTEX_WAIT, value, NULL);
+            }
+        }
+        __atomic_sub_fetch(&header->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+uint32_t capture_shm_slot_bytes(const capture_shm_reader_t *reader)
+{
+    return ((reader != NULL) && (reader->header != NULL)) ? reader->header->slot_bytes : 0;
+}
+
+void capture_shm_detach(capture_shm_reader_t *reader)
+{
+    if ((reader == NULL) || (reader->header == NULL))
+    {
+        return;
+    }
+    munmap(reader->header, reader->mapped);
+    reader->header = NULL;
+    reader->slots = NULL;
+}
@@ -0,0 +1,128 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_shm.h
+*
+* Export of captured audio to other processes through a shared memory ring.
+*
+* The writer side publishes every callback buffer into a ring of fixed size slots held
+* in a memfd. Any number of readers, in this or other processes, map the same memory
+* and follow the ring without copying through sockets. Readers get the memfd by opening
+* /proc/<pid>/fd/<fd> of the writer, or by having it passed over a UNIX socket.
+*
+* The writer never waits for readers. A reader that falls more than a ring behind skips
+* to the oldest buffer still held and counts the buffers it missed. Each slot carries a
+* sequence number written before and after its data, so a reader detects a slot being
+* overwritten while it copies it. Readers sleep on a futex in the shared header and the
+* writer only makes the wake up system call when a reader is waiting.
+*
+* Header, slot headers and slot data are aligned to CAPTURE_SHM_CACHE_LINE so the
+* writer's stores to one slot never share a cache line with a reader of another.
+*/
+
+#ifndef CAPTURE_SHM_H
+#define CAPTURE_SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_SHM_MAGIC       0x53434152u     // "RACS"
+#define CAPTURE_SHM_VERSION     1
+#define CAPTURE_SHM_CACHE_LINE  64
+#define CAPTURE_SHM_SLOTS_DEFAULT 64            // About 2.7 s of 8 KB buffers at 48 kHz 16 bit stereo
+
+typedef struct capture_shm capture_shm_t;
+typedef struct capture_shm_header capture_shm_header_t;
+
+typedef struct
+{
+    capture_shm_header_t *header;
+    uint8_t *slots;
+    size_t mapped;
+    uint64_t next;              // Sequence number of the next buffer to read
+    uint64_t dropped;           // Buffers overwritten before they were read
+} capture_shm_reader_t;
+
+/**
+ * @brief Creates a ring of slots buffers of up to slot_bytes each in a new memfd
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for a zero size, RMF_ERROR if the memfd could not be created or mapped
+ */
+rmf_Error capture_shm_create(capture_shm_t **shm, uint32_t slot_bytes, uint32_t slots);
+
+/**
+ * @brief File descriptor of the memfd, for readers to attach to
+ */
+int capture_shm_fd(const capture_shm_t *shm);
+
+/**
+ * @brief Publishes one buffer with its capture time, without ever blocking
+ *
+ * Must only be called from one thread at a time.
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM if bytes exceeds the slot size
+ */
+rmf_Error capture_shm_publish(capture_shm_t *shm, const void *data, uint32_t bytes, uint64_t timestamp_ns);
+
+/**
+ * @brief Number of buffers published so far
+ */
+uint64_t capture_shm_published(const capture_shm_t *shm);
+
+/**
+ * @brief Marks the ring closed, waking the readers, and releases the writer side
+ *
+ * Readers keep their mapping until they detach.
+ */
+void capture_shm_destroy(capture_shm_t *shm);
+
+/**
+ * @brief Maps the ring behind fd for reading, starting with the next buffer published
+ *
+ * fd may be closed once attached.
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM if fd does not hold a ring, RMF_ERROR if it could not be mapped
+ */
+rmf_Error capture_shm_attach(capture_shm_reader_t *reader, int fd);
+
+/**
+ * @brief Copies the next buffer, waiting up to timeout_ms for it to be published
+ *
+ * @param[out] bytes         - Size of the buffer copied
+ * @param[out] timestamp_ns  - CLOCK_MONOTONIC time it was published, may be NULL
+ * @param[in]  timeout_ms    - Maximum wait, 0 to poll, negative to wait until a buffer or the close
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM if size is smaller than the slot size,
+ *         RMF_INVALID_STATE when the ring is closed and read to the end, RMF_ERROR on timeout
+ */
+rmf_Error capture_shm_read(capture_shm_reader_t *reader, void *data, uint32_t size, uint32_t *bytes, uint64_t *timestamp_ns, int32_t timeout_ms);
+
+/**
+ * @brief Size of the largest buffer the ring holds
+ */
+uint32_t capture_shm_slot_bytes(const capture_shm_reader_t *reader);
+
+/**
+ * @brief Unmaps the ring
+ */
+void capture_shm_detach(capture_shm_reader_t *reader);
+
+#endif // CAPTURE_SHM_H
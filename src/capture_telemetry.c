@@ -0,0 +1,340 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_telemetry.c
+*
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "capture_telemetry.h"
+#include "capture_clock.h"
+#include "capture_metrics.h"
+#include "capture_threads.h"
+
+#define TELEMETRY_SEND_TIMEOUT_SECONDS 2
+
+/* What the previous snapshot saw of a session, to report rates over the time between snapshots */
+typedef struct
+{
+    uint64_t time_ns;
+    uint64_t bytes;
+    pid_t tid;
+    uint64_t cpu_ticks;
+    uint64_t overflows;
+} telemetry_previous_t;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;  // Guards the handles of the sessions and the server state
+static capture_telemetry_session_t *gSessions[CAPTURE_TELEMETRY_SESSIONS_MAX];
+static telemetry_previous_t gPrevious[CAPTURE_TELEMETRY_SESSIONS_MAX];
+static uint32_t gCount;
+static const char *gTest;
+static int gListenFd = -1;
+static char gPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static pthread_t gThread;
+
+static __thread pid_t gCallerTid;
+
+static uint64_t load(const uint64_t *counter)
+{
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static pid_t callerTid(void)
+{
+    if (gCallerTid == 0)
+    {
+        gCallerTid = (pid_t)syscall(SYS_gettid);
+    }
+    return gCallerTid;
+}
+
+/* Resident set size in KB, from the second field of /proc/self/statm */
+static uint64_t rssKb(void)
+{
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    FILE *file = fopen("/proc/self/statm", "r");
+
+    if (file == NULL)
+    {
+        return 0;
+    }
+    if (fscanf(file, "%llu %llu", &size, &resident) != 2)
+    {
+        resident = 0;
+    }
+    fclose(file);
+    return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE) / 1024;
+}
+
+/* The caller holds gLock */
+static void addSession(capture_metrics_record_t *record, uint32_t index, uint64_t now, uint64_t rss)
+{
+    capture_telemetry_session_t *session = gSessions[index];
+    telemetry_previous_t *previous = &gPrevious[index];
+    RMF_AudioCaptureHandle handle = session->handle;
+    RMF_AudioCapture_Status status;
+    capture_threads_sample_t sample;
+    uint64_t bytes = load(&session->bytes);
+    uint64_t first = load(&session->first_ns);
+    uint64_t last = load(&session->last_ns);
+    pid_t tid = __atomic_load_n(&session->tid, __ATOMIC_RELAXED);
+    uint64_t cpuTicks = 0;
+    double tickMs = 1000.0 / (double)sysconf(_SC_CLK_TCK);
+    double elapsedS = (double)(now - previous->time_ns) / 1e9;
+    double rate = 0.0;
+    double cpuPercent = 0.0;
+
+    if ((tid != 0) && (capture_threads_sample(tid, &sample) == RMF_SUCCESS))
+    {
+        cpuTicks = sample.user_ticks + sample.system_ticks;
+    }
+    if ((previous->time_ns != 0) && (elapsedS > 0.0) && (bytes >= previous->bytes))
+    {
+        rate = (double)(bytes - previous->bytes) / elapsedS;
+        if ((tid == previous->tid) && (cpuTicks >= previous->cpu_ticks))
+        {
+            cpuPercent = (double)(cpuTicks - previous->cpu_ticks) * tickMs / 10.0 / elapsedS;
+        }
+    }
+    else if ((last > first) && (bytes > 0))
+    {
+        // First snapshot of the session, its mean rate so far
+        rate = (double)bytes / ((double)(now - first) / 1e9);
+    }
+    if ((handle != NULL) && (RMF_AudioCapture_GetStatus(handle, &status) == RMF_SUCCESS))
+    {
+        previous->overflows = status.overflows;
+    }
+
+    capture_metrics_begin(record, "telemetry", gTest, session->capture);
+    capture_json_add_bool(&record->writer, "started", handle != NULL);
+    capture_json_add_uint(&record->writer, "bytes", bytes);
+    capture_json_add_uint(&record->writer, "callbacks", load(&session->callbacks));
+    capture_json_add_double(&record->writer, "rate_bps", rate);
+    capture_json_add_uint(&record->writer, "last_gap_ns", load(&session->last_gap_ns));
+    capture_json_add_uint(&record->writer, "max_gap_ns", load(&session->max_gap_ns));
+    capture_json_add_uint(&record->writer, "since_last_ns", ((last != 0) && (now > last)) ? now - last : 0);
+    capture_json_add_uint(&record->writer, "overflows", previous->overflows);
+    capture_json_add_double(&record->writer, "callback_cpu_ms", (double)cpuTicks * tickMs);
+    capture_json_add_double(&record->writer, "callback_cpu_percent", cpuPercent);
+    capture_json_add_uint(&record->writer, "rss_kb", rss);
+
+    previous->time_ns = now;
+    previous->bytes = bytes;
+    previous->tid = tid;
+    previous->cpu_ticks = cpuTicks;
+}
+
+/* The lines are built under gLock and sent after it is released, so a slow client never holds up attach or detach */
+static void sendSnapshot(int fd)
+{
+    char buffer[CAPTURE_TELEMETRY_SESSIONS_MAX * CAPTURE_METRICS_LINE_MAX];
+    capture_metrics_record_t record;
+    uint64_t rss = rssKb();
+    size_t len = 0;
+    size_t done = 0;
+
+    pthread_mutex_lock(&gLock);
+    for (uint32_t i = 0; i < gCount; i++)
+    {
+        const char *line;
+        size_t lineLen;
+
+        addSession(&record, i, capture_clock_now_ns(), rss);
+        line = capture_json_end(&record.writer);
+        if (line == NULL)
+        {
+            continue;
+        }
+        lineLen = strlen(line);
+        memcpy(buffer + len, line, lineLen);
+        len += lineLen;
+        buffer[len++] = '\n';
+    }
+    pthread_mutex_unlock(&gLock);
+
+    while (done < len)
+    {
+        ssize_t written = send(fd, buffer + done, len - done, MSG_NOSIGNAL);
+
+        if ((written < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            return;
+        }
+        done += (size_t)written;
+    }
+}
+
+static void *serve(void *arg)
+{
+    int listenFd = (int)(intptr_t)arg;
+    struct timeval sendTimeout = {.tv_sec = TELEMETRY_SEND_TIMEOUT_SECONDS};
+
+    for (;;)
+    {
+        int clientFd = accept(listenFd, NULL, NULL);
+
+        if (clientFd < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            break;  // Shut down by capture_telemetry_stop()
+        }
+        // A client that stops reading holds up the server, and capture_telemetry_stop(), for at most this long
+        setsockopt(clientFd, SOL_SOCKET, SO_SNDTIMEO, &sendTimeout, sizeof(sendTimeout));
+        sendSnapshot(clientFd);
+        close(clientFd);
+    }
+    return NULL;
+}
+
+void capture_telemetry_reset(capture_telemetry_session_t *session)
+{
+    __atomic_store_n(&session->bytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&session->callbacks, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&session->first_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&session->last_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&session->last_gap_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&session->max_gap_ns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&session->tid, 0, __ATOMIC_RELAXED);
+}
+
+void capture_telemetry_callback(capture_telemetry_session_t *session, size_t bytes)
+{
+    uint64_t now = capture_clock_now_ns();
+    uint64_t last = session->last_ns;
+
+    if (last == 0)
+    {
+        __atomic_store_n(&session->first_ns, now, __ATOMIC_RELAXED);
+        __atomic_store_n(&session->tid, callerTid(), __ATOMIC_RELAXED);
+    }
+    else
+    {
+        uint64_t gap = (now > last) ? now - last : 0;
+
+        __atomic_store_n(&session->last_gap_ns, gap, __ATOMIC_RELAXED);
+        if (gap > session->max_gap_ns)
+        {
+            __atomic_store_n(&session->max_gap_ns, gap, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&session->last_ns, now, __ATOMIC_RELAXED);
+    __atomic_store_n(&session->bytes, session->bytes + bytes, __ATOMIC_RELAXED);
+    __atomic_store_n(&session->callbacks, session->callbacks + 1, __ATOMIC_RELAXED);
+}
+
+void capture_telemetry_attach(capture_telemetry_session_t *session, RMF_AudioCaptureHandle handle)
+{
+    pthread_mutex_lock(&gLock);
+    session->handle = handle;
+    pthread_mutex_unlock(&gLock);
+}
+
+void capture_telemetry_detach(capture_telemetry_session_t *session)
+{
+    pthread_mutex_lock(&gLock);
+    session->handle = NULL;
+    pthread_mutex_unlock(&gLock);
+}
+
+rmf_Error capture_telemetry_start(const char *spec, const char *test, capture_telemetry_session_t *const *sessions, uint32_t count)
+{
+    struct sockaddr_un addr;
+    int listenFd;
+
+    if ((spec == NULL) || (strncmp(spec, "unix:", 5) != 0) || (strlen(spec + 5) >= sizeof(addr.sun_path)) ||
+        (sessions == NULL) || (count > CAPTURE_TELEMETRY_SESSIONS_MAX))
+    {
+        return RMF_INVALID_PARM;
+    }
+    pthread_mutex_lock(&gLock);
+    if (gListenFd >= 0)
+    {
+        pthread_mutex_unlock(&gLock);
+        return RMF_INVALID_STATE;
+    }
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+    {
+        pthread_mutex_unlock(&gLock);
+        return RMF_ERROR;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, spec + 5);
+    unlink(addr.sun_path);
+    if ((bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (listen(listenFd, 4) != 0))
+    {
+        close(listenFd);
+        pthread_mutex_unlock(&gLock);
+        return RMF_ERROR;
+    }
+    memcpy(gSessions, sessions, count * sizeof(sessions[0]));
+    memset(gPrevious, 0, sizeof(gPrevious));
+    gCount = count;
+    gTest = test;
+    strcpy(gPath, addr.sun_path);
+    if (pthread_create(&gThread, NULL, serve, (void *)(intptr_t)listenFd) != 0)
+    {
+        close(listenFd);
+        unlink(gPath);
+        pthread_mutex_unlock(&gLock);
+        return RMF_ERROR;
+    }
+    gListenFd = listenFd;
+    pthread_mutex_unlock(&gLock);
+    return RMF_SUCCESS;
+}
+
+void capture_telemetry_stop(void)
+{
+    int listenFd;
+
+    pthread_mutex_lock(&gLock);
+    listenFd = gListenFd;
+    gListenFd = -1;
+    pthread_mutex_unlock(&gLock);
+    if (listenFd < 0)
+    {
+        return;
+    }
+    // Wakes the server from accept()
+    shutdown(listenFd, SHUT_RDWR);
+    pthread_join(gThread, NULL);
+    close(listenFd);
+    unlink(gPath);
+}
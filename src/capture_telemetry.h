@@ -0,0 +1,102 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_telemetry.h
+*
+* Live counters of the capture sessions, served on a local UNIX socket while the tests run.
+*
+* With RMF_AUDIOCAPTURE_TELEMETRY=unix:<path> in the environment, a thread listens on path.
+* Every client that connects is sent a snapshot, one `telemetry` record per session in the
+* format of the metrics stream (see capture_metrics.h), and the connection is closed:
+*
+* ```bash
+* socat -u UNIX-CONNECT:/tmp/rmfAudioCapture.telemetry -
+* ```
+*
+* The buffer ready callback only updates counters of its own session with relaxed atomic
+* stores, it takes no lock and makes no system call. The snapshot derives the rate and the
+* CPU share of the callback thread over the time since the previous snapshot, asks the HAL
+* for the overflow count and reads the RSS of the process.
+*/
+
+#ifndef CAPTURE_TELEMETRY_H
+#define CAPTURE_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_TELEMETRY_ENV           "RMF_AUDIOCAPTURE_TELEMETRY"
+#define CAPTURE_TELEMETRY_SESSIONS_MAX  4
+
+typedef struct
+{
+    const char *capture;        // "primary" or "auxiliary", names the session in its records
+    uint64_t bytes;             // Written by the buffer ready callback only, from here
+    uint64_t callbacks;
+    uint64_t first_ns;          // Clock time of the first callback, 0 before it
+    uint64_t last_ns;
+    uint64_t last_gap_ns;       // Between the latest two callbacks
+    uint64_t max_gap_ns;
+    pid_t tid;                  // Thread of the latest callback
+    RMF_AudioCaptureHandle handle; // Set while started, for the overflow count (see capture_telemetry_attach())
+} capture_telemetry_session_t;
+
+/**
+ * @brief Clears the counters of a session, before its capture is started
+ */
+void capture_telemetry_reset(capture_telemetry_session_t *session);
+
+/**
+ * @brief Counts a buffer of bytes, call from the buffer ready callback
+ */
+void capture_telemetry_callback(capture_telemetry_session_t *session, size_t bytes);
+
+/**
+ * @brief Marks the session started on handle, which the snapshots may then query
+ */
+void capture_telemetry_attach(capture_telemetry_session_t *session, RMF_AudioCaptureHandle handle);
+
+/**
+ * @brief Marks the session stopped, before RMF_AudioCapture_Stop() is called on its handle
+ *
+ * Waits for a snapshot that is using the handle.
+ */
+void capture_telemetry_detach(capture_telemetry_session_t *session);
+
+/**
+ * @brief Starts serving snapshots of sessions on the endpoint described by spec
+ *
+ * @param[in] spec     - `unix:<path>`
+ * @param[in] test     - Test named in the records
+ * @param[in] sessions - Sessions reported, up to CAPTURE_TELEMETRY_SESSIONS_MAX, which must outlive the server
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for a bad spec, RMF_INVALID_STATE if already serving,
+ *         RMF_ERROR if the socket could not be opened
+ */
+rmf_Error capture_telemetry_start(const char *spec, const char *test, capture_telemetry_session_t *const *sessions, uint32_t count);
+
+/**
+ * @brief Stops serving and removes the socket
+ */
+void capture_telemetry_stop(void);
+
+#endif // CAPTURE_TELEMETRY_H
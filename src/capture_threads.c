@@ -0,0 +1,252 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_threads.c
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "capture_threads.h"
+
+#define THREADS_PROC_LINE_MAX 512
+
+static __thread pid_t gCallerTid;
+
+static uint64_t nowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static pid_t callerTid(void)
+{
+    if (gCallerTid == 0)
+    {
+        gCallerTid = (pid_t)syscall(SYS_gettid);
+    }
+    return gCallerTid;
+}
+
+/* Reads utime and stime, fields 14 and 15 of stat. The command name may hold spaces, so count from its closing bracket */
+static bool readStat(pid_t tid, capture_threads_sample_t *sample)
+{
+    char path[64];
+    char line[THREADS_PROC_LINE_MAX];
+    char *fields;
+    FILE *file;
+    bool ok = false;
+
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", (int)tid);
+    file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    if ((fgets(line, sizeof(line), file) != NULL) && ((fields = strrchr(line, ')')) != NULL))
+    {
+        unsigned long long user;
+        unsigned long long system;
+
+        /* Skip state, ppid, pgrp, session, tty_nr, tpgid, flags, minflt, cminflt, majflt and cmajflt */
+        ok = (sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &user, &system) == 2);
+        sample->user_ticks = user;
+        sample->system_ticks = system;
+    }
+    fclose(file);
+    return ok;
+}
+
+static bool readStatus(pid_t tid, capture_threads_sample_t *sample)
+{
+    char path[64];
+    char line[THREADS_PROC_LINE_MAX];
+    unsigned long long value;
+    FILE *file;
+    int found = 0;
+
+    snprintf(path, sizeof(path), "/proc/self/task/%d/status", (int)tid);
+    file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1)
+        {
+            sample->voluntary_switches = value;
+            found++;
+        }
+        else if (sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1)
+        {
+            sample->involuntary_switches = value;
+            found++;
+        }
+    }
+    fclose(file);
+    return found == 2;
+}
+
+static bool readSchedstat(pid_t tid, capture_threads_sample_t *sample)
+{
+    char path[64];
+    unsigned long long run;
+    unsigned long long wait;
+    unsigned long long slices;
+    FILE *file;
+    bool ok;
+
+    snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", (int)tid);
+    file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    ok = (fscanf(file, "%llu %llu %llu", &run, &wait, &slices) == 3);
+    fclose(file);
+    if (ok)
+    {
+        sample->run_ns = run;
+        sample->wait_ns = wait;
+        sample->timeslices = slices;
+    }
+    return ok;
+}
+
+void capture_threads_init(capture_threads_t *threads)
+{
+    if (threads != NULL)
+    {
+        memset(threads, 0, sizeof(*threads));
+    }
+}
+
+void capture_threads_record(capture_threads_t *threads)
+{
+    pid_t tid = callerTid();
+    uint32_t count;
+    uint32_t slot;
+
+    if (threads == NULL)
+    {
+        return;
+    }
+    count = __atomic_load_n(&threads->count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; (i < count) && (i < CAPTURE_THREADS_MAX); i++)
+    {
+        if (__atomic_load_n(&threads->tids[i], __ATOMIC_ACQUIRE) == tid)
+        {
+            return;
+        }
+    }
+    if (count >= CAPTURE_THREADS_MAX)
+    {
+        return;
+    }
+    slot = __atomic_fetch_add(&threads->count, 1, __ATOMIC_ACQ_REL);
+    if (slot < CAPTURE_THREADS_MAX)
+    {
+        __atomic_store_n(&threads->tids[slot], tid, __ATOMIC_RELEASE);
+    }
+}
+
+rmf_Error capture_threads_sample(pid_t tid, capture_threads_sample_t *sample)
+{
+    if ((sample == NULL) || (tid <= 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(sample, 0, sizeof(*sample));
+    sample->valid = readStat(tid, sample) && readStatus(tid, sample);
+    sample->have_schedstat = sample->valid && readSchedstat(tid, sample);
+    return sample->valid ? RMF_SUCCESS : RMF_ERROR;
+}
+
+void capture_threads_begin(capture_threads_t *threads)
+{
+    if (threads == NULL)
+    {
+        return;
+    }
+    memset(threads->start, 0, sizeof(threads->start));
+    for (uint32_t i = 0; i < CAPTURE_THREADS_MAX; i++)
+    {
+        pid_t tid = __atomic_load_n(&threads->tids[i], __ATOMIC_ACQUIRE);
+        if (tid > 0)
+        {
+            capture_threads_sample(tid, &threads->start[i]);
+        }
+    }
+    threads->window_start_ns = nowNs();
+}
+
+uint32_t capture_threads_end(capture_threads_t *threads, capture_threads_usage_t *usage, uint32_t max_usage)
+{
+    double tickMs;
+    double windowMs;
+    uint32_t reported = 0;
+
+    if ((threads == NULL) || (usage == NULL))
+    {
+        return 0;
+    }
+    tickMs = 1000.0 / (double)sysconf(_SC_CLK_TCK);
+    windowMs = (double)(nowNs() - threads->window_start_ns) / 1e6;
+
+    for (uint32_t i = 0; (i < CAPTURE_THREADS_MAX) && (reported < max_usage); i++)
+    {
+        pid_t tid = __atomic_load_n(&threads->tids[i], __ATOMIC_ACQUIRE);
+        capture_threads_sample_t end;
+        capture_threads_sample_t start = threads->start[i];
+        capture_threads_usage_t *out = &usage[reported];
+
+        if ((tid <= 0) || (capture_threads_sample(tid, &end) != RMF_SUCCESS))
+        {
+            continue; // Not recorded, or the thread has already exited
+        }
+        memset(out, 0, sizeof(*out));
+        out->tid = tid;
+        out->whole_life = !start.valid;
+        if (!start.valid)
+        {
+            memset(&start, 0, sizeof(start));
+        }
+        out->user_ms = (double)(end.user_ticks - start.user_ticks) * tickMs;
+        out->system_ms = (double)(end.system_ticks - start.system_ticks) * tickMs;
+        out->cpu_percent = (windowMs > 0.0) ? (out->user_ms + out->system_ms) * 100.0 / windowMs : 0.0;
+        out->voluntary_switches = end.voluntary_switches - start.voluntary_switches;
+        out->involuntary_switches = end.involuntary_switches - start.involuntary_switches;
+        out->have_schedstat = end.have_schedstat && (start.have_schedstat || !start.valid);
+        if (out->have_schedstat)
+        {
+            out->run_ms = (double)(end.run_ns - start.run_ns) / 1e6;
+            out->wait_ms = (double)(end.wait_ns - start.wait_ns) / 1e6;
+            out->timeslices = end.timeslices - start.timeslices;
+        }
+        reported++;
+    }
+    return reported;
+}
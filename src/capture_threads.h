@@ -0,0 +1,108 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_threads.h
+*
+* CPU and scheduling accounting for the HAL threads that deliver audio.
+*
+* The buffer ready callback calls capture_threads_record(), which notes the calling
+* thread id the first time it is seen. capture_threads_begin() and capture_threads_end()
+* read /proc/self/task/<tid>/stat, status and schedstat for every recorded thread and
+* report the difference over the window: user and system CPU time, voluntary and
+* involuntary context switches, and time spent waiting on a run queue.
+*/
+
+#ifndef CAPTURE_THREADS_H
+#define CAPTURE_THREADS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_THREADS_MAX 8   // Delivery threads tracked per capture
+
+/**
+ * @brief Counters read from /proc for one thread
+ */
+typedef struct
+{
+    bool valid;                 // stat and status could be read
+    bool have_schedstat;        // schedstat could be read, the kernel may be built without it
+    uint64_t user_ticks;
+    uint64_t system_ticks;
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+    uint64_t run_ns;            // Time on a CPU
+    uint64_t wait_ns;           // Time runnable but waiting on a run queue
+    uint64_t timeslices;
+} capture_threads_sample_t;
+
+/**
+ * @brief Usage of one thread over a window
+ */
+typedef struct
+{
+    pid_t tid;
+    bool whole_life;            // The thread was first seen after the window began, values cover its whole life
+    bool have_schedstat;
+    double user_ms;
+    double system_ms;
+    double cpu_percent;         // User and system time as a percentage of the window
+    uint64_t voluntary_switches;
+    uint64_t involuntary_switches;
+    double run_ms;
+    double wait_ms;             // Run queue delay
+    uint64_t timeslices;
+} capture_threads_usage_t;
+
+typedef struct
+{
+    pid_t tids[CAPTURE_THREADS_MAX];            // Written once by the callback that records the thread
+    uint32_t count;                             // Slots claimed, may briefly exceed the tids written
+    capture_threads_sample_t start[CAPTURE_THREADS_MAX];
+    uint64_t window_start_ns;
+} capture_threads_t;
+
+void capture_threads_init(capture_threads_t *threads);
+
+/**
+ * @brief Records the calling thread, call from the buffer ready callback
+ */
+void capture_threads_record(capture_threads_t *threads);
+
+/**
+ * @brief Reads the counters of one thread of this process
+ */
+rmf_Error capture_threads_sample(pid_t tid, capture_threads_sample_t *sample);
+
+/**
+ * @brief Starts a window, sampling every thread recorded so far
+ */
+void capture_threads_begin(capture_threads_t *threads);
+
+/**
+ * @brief Ends the window and reports the usage of each recorded thread that could still be read
+ *
+ * @return number of entries written to usage
+ */
+uint32_t capture_threads_end(capture_threads_t *threads, capture_threads_usage_t *usage, uint32_t max_usage);
+
+#endif // CAPTURE_THREADS_H
@@ -0,0 +1,255 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_wav.c
+*
+*/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "capture_wav.h"
+#include "capture_timeline.h"
+
+#define WAV_FORMAT_PCM          1
+#define WAV_FORMAT_EXTENSIBLE   0xFFFE
+#define WAV_READ_BLOCK_BYTES    8192
+
+static uint32_t readLE32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t readLE16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void writeLE32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static void writeLE16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+void capture_wav_pcm_to_mono(const uint8_t *pcm, size_t frames, uint16_t channels, uint16_t bits_per_sample, float *out)
+{
+    size_t bytesPerSample = bits_per_sample / 8;
+    float scale = 1.0f / (2147483648.0f * (float)channels);
+
+    for (size_t f = 0; f < frames; f++)
+    {
+        float sum = 0.0f;
+
+        for (uint16_t c = 0; c < channels; c++, pcm += bytesPerSample)
+        {
+            int32_t value;
+            switch (bytesPerSample)
+            {
+            case 2:
+                value = (int32_t)((uint32_t)readLE16(pcm) << 16);
+                break;
+            case 3:
+                value = (int32_t)(((uint32_t)pcm[0] << 8) | ((uint32_t)pcm[1] << 16) | ((uint32_t)pcm[2] << 24));
+                break;
+            default:
+                value = (int32_t)readLE32(pcm);
+                break;
+            }
+            sum += (float)value;
+        }
+        out[f] = sum * scale;
+    }
+}
+
+rmf_Error capture_wav_write(const char *path, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample, const void *pcm, uint32_t bytes)
+{
+    uint8_t header[44];
+    uint16_t blockAlign = (uint16_t)(channels * bits_per_sample / 8);
+    FILE *file;
+    bool ok;
+
+    if ((path == NULL) || ((pcm == NULL) && (bytes > 0)) || (channels == 0) || (sampling_rate == 0) ||
+        ((bits_per_sample != 16) && (bits_per_sample != 24) && (bits_per_sample != 32)) || (bytes > UINT32_MAX - 36))
+    {
+        return RMF_INVALID_PARM;
+    }
+
+    memcpy(header, "RIFF", 4);
+    writeLE32(header + 4, 36 + bytes);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "fmt ", 4);
+    writeLE32(header + 16, 16);
+    writeLE16(header + 20, WAV_FORMAT_PCM);
+    writeLE16(header + 22, channels);
+    writeLE32(header + 24, sampling_rate);
+    writeLE32(header + 28, sampling_rate * blockAlign);
+    writeLE16(header + 32, blockAlign);
+    writeLE16(header + 34, bits_per_sample);
+    memcpy(header + 36, "data", 4);
+    writeLE32(header + 40, bytes);
+
+    CAPTURE_TIMELINE_SCOPE("wav_write", "bytes", sizeof(header) + bytes);
+    file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return RMF_ERROR;
+    }
+    ok = (fwrite(header, 1, sizeof(header), file) == sizeof(header)) && (fwrite(pcm, 1, bytes, file) == bytes);
+    ok = (fclose(file) == 0) && ok;
+    return ok ? RMF_SUCCESS : RMF_ERROR;
+}
+
+rmf_Error capture_wav_open(capture_wav_reader_t *reader, const char *path)
+{
+    uint8_t header[12];
+    uint8_t chunk[8];
+    bool haveFormat = false;
+
+    if ((reader == NULL) || (path == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(reader, 0, sizeof(*reader));
+
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL)
+    {
+        return RMF_ERROR;
+    }
+
+    if ((fread(header, 1, sizeof(header), reader->file) != sizeof(header)) ||
+        (memcmp(header, "RIFF", 4) != 0) || (memcmp(header + 8, "WAVE", 4) != 0))
+    {
+        capture_wav_close(reader);
+        return RMF_INVALID_PARM;
+    }
+
+    /* Walk the chunk list, skipping anything other than "fmt " and "data" */
+    while (fread(chunk, 1, sizeof(chunk), reader->file) == sizeof(chunk))
+    {
+        uint32_t chunkSize = readLE32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0)
+        {
+            uint8_t format[16];
+            uint16_t formatTag;
+
+            if ((chunkSize < sizeof(format)) || (fread(format, 1, sizeof(format), reader->file) != sizeof(format)))
+            {
+                break;
+            }
+            formatTag = readLE16(format);
+            reader->channels = readLE16(format + 2);
+            reader->sampling_rate = readLE32(format + 4);
+            reader->bits_per_sample = readLE16(format + 14);
+            if (((formatTag != WAV_FORMAT_PCM) && (formatTag != WAV_FORMAT_EXTENSIBLE)) ||
+                (reader->channels == 0) || (reader->sampling_rate == 0) ||
+                ((reader->bits_per_sample != 16) && (reader->bits_per_sample != 24) && (reader->bits_per_sample != 32)))
+            {
+                break;
+            }
+            haveFormat = true;
+            chunkSize -= sizeof(format);
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            if (!haveFormat)
+            {
+                break;
+            }
+            reader->data_bytes = chunkSize;
+            return RMF_SUCCESS;
+        }
+
+        /* Chunks are word aligned */
+        if (fseek(reader->file, (long)(chunkSize + (chunkSize & 1)), SEEK_CUR) != 0)
+        {
+            break;
+        }
+    }
+
+    capture_wav_close(reader);
+    return RMF_INVALID_PARM;
+}
+
+size_t capture_wav_read_mono(capture_wav_reader_t *reader, float *out, size_t max_frames)
+{
+    uint8_t block[WAV_READ_BLOCK_BYTES];
+    size_t bytesPerSample;
+    size_t frameBytes;
+    size_t framesDone = 0;
+
+    if ((reader == NULL) || (reader->file == NULL) || (out == NULL))
+    {
+        return 0;
+    }
+    bytesPerSample = reader->bits_per_sample / 8;
+    frameBytes = bytesPerSample * reader->channels;
+    if (frameBytes > sizeof(block))
+    {
+        return 0;
+    }
+
+    while (framesDone < max_frames)
+    {
+        size_t remaining = (reader->data_bytes - reader->bytes_read) / frameBytes;
+        size_t frames = sizeof(block) / frameBytes;
+        size_t got;
+
+        if (frames > max_frames - framesDone)
+        {
+            frames = max_frames - framesDone;
+        }
+        if (frames > remaining)
+        {
+            frames = remaining;
+        }
+        if (frames == 0)
+        {
+            break;
+        }
+
+        got = fread(block, frameBytes, frames, reader->file);
+        capture_wav_pcm_to_mono(block, got, reader->channels, reader->bits_per_sample, out + framesDone);
+        framesDone += got;
+        reader->bytes_read += (uint32_t)(got * frameBytes);
+        if (got < frames)
+        {
+            break;
+        }
+    }
+    return framesDone;
+}
+
+void capture_wav_close(capture_wav_reader_t *reader)
+{
+    if ((reader != NULL) && (reader->file != NULL))
+    {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+}
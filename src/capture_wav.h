@@ -0,0 +1,74 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_wav.h
+*
+* Streaming reader and writer for the PCM WAV files used as test references and written by the L3 tests.
+*/
+
+#ifndef CAPTURE_WAV_H
+#define CAPTURE_WAV_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rmfAudioCapture.h"
+
+typedef struct
+{
+    FILE *file;
+    uint16_t channels;
+    uint16_t bits_per_sample;   // 16, 24 or 32 bit integer PCM
+    uint32_t sampling_rate;
+    uint32_t data_bytes;        // Size of the data chunk
+    uint32_t bytes_read;        // Bytes of the data chunk consumed so far
+} capture_wav_reader_t;
+
+/**
+ * @brief Opens a PCM WAV file and positions the reader at the start of the sample data
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM if the file is not integer PCM, RMF_ERROR if it cannot be read
+ */
+rmf_Error capture_wav_open(capture_wav_reader_t *reader, const char *path);
+
+/**
+ * @brief Reads up to max_frames frames, down-mixed to mono and scaled to [-1.0, 1.0)
+ *
+ * @return number of frames read, 0 at the end of the data
+ */
+size_t capture_wav_read_mono(capture_wav_reader_t *reader, float *out, size_t max_frames);
+
+void capture_wav_close(capture_wav_reader_t *reader);
+
+/**
+ * @brief Converts interleaved little endian integer PCM frames to mono, down-mixed and scaled to [-1.0, 1.0)
+ *
+ * @param[in] bits_per_sample - 16, 24 or 32
+ */
+void capture_wav_pcm_to_mono(const uint8_t *pcm, size_t frames, uint16_t channels, uint16_t bits_per_sample, float *out);
+
+/**
+ * @brief Writes interleaved little endian integer PCM samples as a WAV file
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for an unsupported format, RMF_ERROR if the file cannot be written
+ */
+rmf_Error capture_wav_write(const char *path, uint16_t channels, uint32_t sampling_rate, uint16_t bits_per_sample, const void *pcm, uint32_t bytes);
+
+#endif // CAPTURE_WAV_H
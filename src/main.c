@@ -16,13 +16,20 @@
 * limitations under the License.
 */
 
+#include <stdlib.h>
+
 #include <ut.h>
 
+#include "capture_control.h"
+#include "capture_telemetry.h"
+
 #ifndef HALIF_TEST_TAG_VERSION
 #define HALIF_TEST_TAG_VERSION "Not Defined"
 #endif
 
 extern int UT_register_tests( void );
+extern int test_rmfAudioCapture_l3_control_run( const char *spec );
+extern int test_rmfAudioCapture_l3_telemetry_start( const char *spec );
 
 int main(int argc, char** argv)
 {
@@ -39,8 +46,25 @@ int main(int argc, char** argv)
         UT_FAIL(" Failed to register hal tests");
         return -1;
     }
-    
+
+    /* Live counters of the L3 captures are served while the tests run */
+    const char *telemetrySpec = getenv(CAPTURE_TELEMETRY_ENV);
+    if (telemetrySpec != NULL && *telemetrySpec != '\0')
+    {
+        test_rmfAudioCapture_l3_telemetry_start(telemetrySpec);
+    }
+
+    /* When a control channel is configured the L3 steps are driven from it instead of the menu */
+    const char *controlSpec = getenv(CAPTURE_CONTROL_ENV);
+    if (controlSpec != NULL && *controlSpec != '\0')
+    {
+        int controlFailed = test_rmfAudioCapture_l3_control_run(controlSpec);
+        capture_telemetry_stop();
+        return controlFailed;
+    }
+
     /* Begin test executions */
     UT_run_tests();
+    capture_telemetry_stop();
     return 0;
 }
@@ -73,19 +73,47 @@
 #include <ut_cunit.h>
 #include <ut_kvp_profile.h>
 #include <unistd.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
 #include <stdatomic.h>
 #include "rmfAudioCapture.h"
+#include "capture_meter.h"
+#include "capture_drift.h"
+#include "capture_threads.h"
+#include "capture_alloc.h"
+#include "capture_metrics.h"
+#include "capture_async.h"
+#include "capture_clock.h"
+#include "capture_timeline.h"
+#include "rmfAudioCapture_timestamp.h"
 
 
 #define MEASUREMENT_WINDOW_SECONDS 10
+#define THREAD_SETTLE_SECONDS 1 // Callback threads are sampled once they have delivered for this long
+#define DISPATCH_PHASE_SECONDS 5 // Capture time with the consumer called directly, then through the asynchronous adapter
+#define DISPATCH_CONSUMER_US 10000 // Processing time of the simulated slow consumer, per buffer
+#define TIMESTAMP_PHASE_SECONDS 5 // Capture time with the timestamped data callback
+#define TIMESTAMP_MAX_BUFFERS 4096 // Callback delays kept for the percentiles
+#define TIMESTAMP_CLOCK_TOLERANCE_US 5000 // Largest disagreement of the capture times with the sample positions
+#define INTERFERENCE_PHASE_SECONDS 5 // Capture time of each solo run, and of each capture alone and together in the combined run
+#define INTERFERENCE_TRANSITION_SECONDS 1 // After the second capture starts, time the first is watched for a disturbance
+#define INTERFERENCE_MAX_BUFFERS 4096 // Callback arrivals kept per capture
 
 static int gTestGroup = 2;
 static int gTestID = 1;
+static const char *gTestName = ""; // Test named in the metrics records
 
 typedef struct
 {
     uint64_t bytes_received;
     atomic_int cookie;
+    capture_meter_t meter;
+    bool meter_active;
+    capture_drift_t drift;
+    bool drift_active;
+    capture_threads_t threads;
+    const char *capture; // "primary" or "auxiliary", names the capture in the metrics records
 } capture_session_context_t;
 
 static bool g_aux_capture_supported = false;
@@ -93,24 +121,29 @@ static bool g_aux_capture_supported = false;
 static rmf_Error test_l2_counting_data_cb(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
 {
     capture_session_context_t *ctx = (capture_session_context_t *)context_blob;
+    CAPTURE_TIMELINE_SCOPE("callback", "bytes", AudioCaptureBufferSize);
 
     UT_ASSERT_PTR_NOT_NULL(AudioCaptureBuffer);
     UT_ASSERT_PTR_NOT_NULL_FATAL(context_blob);
     UT_ASSERT_TRUE(AudioCaptureBufferSize > 0);
 
+    capture_alloc_callback_enter();
+    capture_threads_record(&ctx->threads);
+    if (ctx->meter_active)
+    {
+        capture_meter_process(&ctx->meter, AudioCaptureBuffer, AudioCaptureBufferSize);
+    }
+    if (ctx->drift_active)
+    {
+        capture_drift_process(&ctx->drift, AudioCaptureBufferSize);
+    }
     ctx->bytes_received += AudioCaptureBufferSize;
     ctx->cookie = 1;
+    capture_alloc_callback_leave();
     return RMF_SUCCESS;
 }
 
-static void test_l2_prepare_start_settings_for_data_tracking(RMF_AudioCapture_Settings *settings, void *context_blob)
-{
-    settings->cbBufferReady = test_l2_counting_data_cb;
-    settings->cbStatusChange = NULL;
-    settings->cbBufferReadyParm = context_blob;
-}
-
-static rmf_Error test_l2_validate_bytes_received(RMF_AudioCapture_Settings *settings, uint32_t seconds, uint64_t bytes_received)
+static rmf_Error test_l2_get_format_values(RMF_AudioCapture_Settings *settings, uint8_t *num_channels_out, uint32_t *sampling_rate_out, uint8_t *bits_per_sample_out)
 {
     uint8_t num_channels = 0;
     uint32_t sampling_rate = 0;
@@ -165,10 +198,208 @@ static rmf_Error test_l2_validate_bytes_received(RMF_AudioCapture_Settings *sett
         return RMF_ERROR;
     }
 
+    *num_channels_out = num_channels;
+    *sampling_rate_out = sampling_rate;
+    *bits_per_sample_out = bits_per_sample;
+    return RMF_SUCCESS;
+}
+
+static void test_l2_prepare_start_settings_for_data_tracking(RMF_AudioCapture_Settings *settings, void *context_blob)
+{
+    capture_session_context_t *ctx = (capture_session_context_t *)context_blob;
+    uint8_t num_channels = 0;
+    uint32_t sampling_rate = 0;
+    uint8_t bits_per_sample = 0;
+
+    settings->cbBufferReady = test_l2_counting_data_cb;
+    settings->cbStatusChange = NULL;
+    settings->cbBufferReadyParm = context_blob;
+
+    ctx->meter_active = (RMF_SUCCESS == test_l2_get_format_values(settings, &num_channels, &sampling_rate, &bits_per_sample)) &&
+                        (RMF_SUCCESS == capture_meter_init(&ctx->meter, num_channels, sampling_rate, bits_per_sample, CAPTURE_METER_WINDOW_MS));
+    ctx->drift_active = (RMF_SUCCESS == test_l2_get_format_values(settings, &num_channels, &sampling_rate, &bits_per_sample)) &&
+                        (RMF_SUCCESS == capture_drift_init(&ctx->drift, num_channels, sampling_rate, bits_per_sample));
+    capture_threads_init(&ctx->threads);
+}
+
+/**
+ * @brief Emits the levels of every channel and the metering cost as metrics records
+ */
+static void test_l2_emit_levels(capture_session_context_t *ctx, const capture_meter_snapshot_t *levels)
+{
+    capture_metrics_record_t record;
+
+    if (!capture_metrics_enabled())
+    {
+        return;
+    }
+    for (uint16_t c = 0; c < levels->channels; c++)
+    {
+        capture_metrics_begin(&record, "level", gTestName, ctx->capture);
+        capture_json_add_uint(&record.writer, "channel", c);
+        capture_json_add_double(&record.writer, "rms_dbfs", capture_meter_dbfs(levels->channel[c].rms));
+        capture_json_add_double(&record.writer, "peak_dbfs", capture_meter_dbfs(levels->channel[c].peak));
+        capture_json_add_double(&record.writer, "dc_offset", levels->channel[c].dc_offset);
+        capture_json_add_uint(&record.writer, "clipped", levels->channel[c].clipped_total);
+        capture_metrics_emit(&record);
+    }
+    capture_metrics_begin(&record, "meter", gTestName, ctx->capture);
+    capture_json_add_uint(&record.writer, "buffers", levels->buffers);
+    capture_json_add_double(&record.writer, "load", levels->load);
+    capture_json_add_double(&record.writer, "max_load", levels->max_load);
+    capture_metrics_emit(&record);
+}
+
+/**
+ * @brief Logs the captured levels and checks metering stayed within its share of the callback period
+ */
+static void test_l2_check_levels(capture_session_context_t *ctx)
+{
+    capture_meter_snapshot_t levels;
+
+    UT_ASSERT_TRUE_FATAL(ctx->meter_active);
+    capture_meter_snapshot(&ctx->meter, &levels);
+    for (uint16_t c = 0; c < levels.channels; c++)
+    {
+        UT_LOG_DEBUG("Channel %u: RMS %.1f dBFS, peak %.1f dBFS, DC offset %.5f, clipped samples %" PRIu64 "\n",
+                     c, capture_meter_dbfs(levels.channel[c].rms), capture_meter_dbfs(levels.channel[c].peak),
+                     levels.channel[c].dc_offset, levels.channel[c].clipped_total);
+    }
+    UT_LOG_DEBUG("Metering cost: %" PRIu64 " buffers, mean load %.5f, max load %.5f\n", levels.buffers, levels.load, levels.max_load);
+    test_l2_emit_levels(ctx, &levels);
+    UT_ASSERT_TRUE(levels.load < CAPTURE_METER_MAX_LOAD);
+}
+
+/**
+ * @brief Logs the drift of the capture clock against CLOCK_MONOTONIC
+ */
+static void test_l2_check_drift(capture_session_context_t *ctx, const char *name, capture_drift_estimate_t *estimate)
+{
+    rmf_Error result;
+
+    UT_ASSERT_TRUE_FATAL(ctx->drift_active);
+    result = capture_drift_estimate(&ctx->drift, estimate);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    if (RMF_SUCCESS == result)
+    {
+        UT_LOG_INFO("%s capture clock: %.3f Hz, drift %.1f ppm (95%% CI +/- %.1f ppm) over %" PRIu64 " callbacks in %.1f s\n",
+                    name, estimate->rate_hz, estimate->ppm, estimate->ci_ppm, estimate->points, estimate->seconds);
+        if (capture_metrics_enabled())
+        {
+            capture_metrics_record_t record;
+
+            capture_metrics_begin(&record, "drift", gTestName, ctx->capture);
+            capture_json_add_double(&record.writer, "rate_hz", estimate->rate_hz);
+            capture_json_add_double(&record.writer, "ppm", estimate->ppm);
+            capture_json_add_double(&record.writer, "ci_ppm", estimate->ci_ppm);
+            capture_json_add_uint(&record.writer, "points", estimate->points);
+            capture_json_add_double(&record.writer, "seconds", estimate->seconds);
+            capture_metrics_emit(&record);
+        }
+    }
+}
+
+/**
+ * @brief Logs the CPU time and scheduling of the threads that invoked the callback since capture_threads_begin()
+ */
+static void test_l2_report_threads(capture_session_context_t *ctx, const char *name)
+{
+    capture_threads_usage_t usage[CAPTURE_THREADS_MAX];
+    uint32_t count;
+
+    UT_ASSERT_TRUE(__atomic_load_n(&ctx->threads.count, __ATOMIC_ACQUIRE) > 0);
+    count = capture_threads_end(&ctx->threads, usage, CAPTURE_THREADS_MAX);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        UT_LOG_INFO("%s callback thread %d%s: user %.0f ms, system %.0f ms, CPU %.2f%%, context switches %" PRIu64 " voluntary %" PRIu64 " involuntary\n",
+                    name, (int)usage[i].tid, usage[i].whole_life ? " (whole life)" : "", usage[i].user_ms, usage[i].system_ms,
+                    usage[i].cpu_percent, usage[i].voluntary_switches, usage[i].involuntary_switches);
+        if (usage[i].have_schedstat)
+        {
+            UT_LOG_INFO("%s callback thread %d: on CPU %.3f ms, run queue delay %.3f ms over %" PRIu64 " timeslices\n",
+                        name, (int)usage[i].tid, usage[i].run_ms, usage[i].wait_ms, usage[i].timeslices);
+        }
+        if (capture_metrics_enabled())
+        {
+            capture_metrics_record_t record;
+
+            capture_metrics_begin(&record, "thread", gTestName, ctx->capture);
+            capture_json_add_int(&record.writer, "tid", usage[i].tid);
+            capture_json_add_bool(&record.writer, "whole_life", usage[i].whole_life);
+            capture_json_add_double(&record.writer, "user_ms", usage[i].user_ms);
+            capture_json_add_double(&record.writer, "system_ms", usage[i].system_ms);
+            capture_json_add_double(&record.writer, "cpu_percent", usage[i].cpu_percent);
+            capture_json_add_uint(&record.writer, "voluntary_switches", usage[i].voluntary_switches);
+            capture_json_add_uint(&record.writer, "involuntary_switches", usage[i].involuntary_switches);
+            if (usage[i].have_schedstat)
+            {
+                capture_json_add_double(&record.writer, "run_ms", usage[i].run_ms);
+                capture_json_add_double(&record.writer, "wait_ms", usage[i].wait_ms);
+                capture_json_add_uint(&record.writer, "timeslices", usage[i].timeslices);
+            }
+            capture_metrics_emit(&record);
+        }
+    }
+}
+
+/**
+ * @brief Logs the allocations and memory footprint of a test phase
+ */
+static void test_l2_log_allocations(const char *phase, const capture_alloc_stats_t *stats)
+{
+    UT_LOG_INFO("%s: %" PRIu64 " allocations (%" PRIu64 " bytes), %" PRIu64 " frees (%" PRIu64 " bytes), live bytes %+" PRId64 "\n",
+                phase, stats->counts.allocations, stats->counts.bytes_allocated, stats->counts.frees, stats->counts.bytes_freed, stats->live_bytes);
+    UT_LOG_INFO("%s: %" PRIu64 " allocations in the callback, %" PRIu64 " on the callback thread outside it, RSS %" PRIu64 " kB (%+" PRId64 " kB), peak RSS %" PRIu64 " kB%s\n",
+                phase, stats->counts.callback_allocations, stats->counts.delivery_allocations, stats->rss_kb, stats->rss_change_kb,
+                stats->peak_rss_kb, stats->peak_rss_reset ? "" : " (not limited to this phase)");
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "allocations", gTestName, "primary");
+        capture_json_add_string(&record.writer, "phase", phase);
+        capture_json_add_uint(&record.writer, "allocations", stats->counts.allocations);
+        capture_json_add_uint(&record.writer, "bytes_allocated", stats->counts.bytes_allocated);
+        capture_json_add_uint(&record.writer, "frees", stats->counts.frees);
+        capture_json_add_uint(&record.writer, "bytes_freed", stats->counts.bytes_freed);
+        capture_json_add_int(&record.writer, "live_bytes", stats->live_bytes);
+        capture_json_add_uint(&record.writer, "callback_allocations", stats->counts.callback_allocations);
+        capture_json_add_uint(&record.writer, "delivery_allocations", stats->counts.delivery_allocations);
+        capture_json_add_uint(&record.writer, "rss_kb", stats->rss_kb);
+        capture_json_add_uint(&record.writer, "peak_rss_kb", stats->peak_rss_kb);
+        capture_json_add_bool(&record.writer, "peak_rss_reset", stats->peak_rss_reset);
+        capture_metrics_emit(&record);
+    }
+}
+
+static rmf_Error test_l2_validate_bytes_received(capture_session_context_t *ctx, RMF_AudioCapture_Settings *settings, uint32_t seconds)
+{
+    uint64_t bytes_received = ctx->bytes_received;
+    uint8_t num_channels = 0;
+    uint32_t sampling_rate = 0;
+    uint8_t bits_per_sample = 0;
+
+    if (RMF_SUCCESS != test_l2_get_format_values(settings, &num_channels, &sampling_rate, &bits_per_sample))
+    {
+        return RMF_ERROR;
+    }
+
     uint64_t computed_bytes_received = seconds * num_channels * sampling_rate * bits_per_sample / 8;
     double percentage_received = (double)bytes_received / (double)computed_bytes_received * 100;
     UT_LOG_DEBUG("Actual bytes received: %" PRIu64 ", Expected bytes received: %" PRIu64 ", Computed percentage: %f\n",
                  bytes_received, computed_bytes_received, percentage_received);
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "bytes", gTestName, ctx->capture);
+        capture_json_add_uint(&record.writer, "seconds", seconds);
+        capture_json_add_uint(&record.writer, "bytes_received", bytes_received);
+        capture_json_add_uint(&record.writer, "bytes_expected", computed_bytes_received);
+        capture_json_add_double(&record.writer, "percentage", percentage_received);
+        capture_json_add_bool(&record.writer, "within_tolerance", (90.0 <= percentage_received) && (110.0 >= percentage_received));
+        capture_metrics_emit(&record);
+    }
     if ((90.0 <= percentage_received) && (110.0 >= percentage_received))
         return RMF_SUCCESS;
     else
@@ -196,9 +427,11 @@ void test_l2_rmfAudioCapture_primary_data_check(void)
 {
     RMF_AudioCaptureHandle handle;
     RMF_AudioCapture_Settings settings;
+    capture_drift_estimate_t drift;
     rmf_Error result = RMF_SUCCESS;
 
     gTestID = 1;
+    gTestName = "l2_rmf_primary_data_check";
     UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
 
     result = RMF_AudioCapture_Open(&handle);
@@ -212,7 +445,7 @@ void test_l2_rmfAudioCapture_primary_data_check(void)
     result = RMF_AudioCapture_GetDefaultSettings(&settings);
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
 
-    capture_session_context_t ctx = {0, 0};
+    capture_session_context_t ctx = {.capture = "primary"};
     test_l2_prepare_start_settings_for_data_tracking(&settings, (void *)&ctx);
 
     result = RMF_AudioCapture_Start(handle, &settings);
@@ -223,16 +456,21 @@ void test_l2_rmfAudioCapture_primary_data_check(void)
         UT_FAIL_FATAL("Aborting test - unable to start capture.");
     }
 
-    sleep(MEASUREMENT_WINDOW_SECONDS);
+    capture_clock_sleep_ns(THREAD_SETTLE_SECONDS * 1000000000ull);
+    capture_threads_begin(&ctx.threads);
+    capture_clock_sleep_ns((MEASUREMENT_WINDOW_SECONDS - THREAD_SETTLE_SECONDS) * 1000000000ull);
+    test_l2_report_threads(&ctx, "Primary");
     result = RMF_AudioCapture_Stop(handle);
     ctx.cookie = 0; // Note: Doesn't account for all possible race conditions
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
 
-    sleep(1); // Wait for the last callback to be processed
+    capture_clock_sleep_ns(1000000000ull); // Wait for the last callback to be processed
     UT_ASSERT_EQUAL(ctx.cookie, 0);
 
-    result = test_l2_validate_bytes_received(&settings, MEASUREMENT_WINDOW_SECONDS, ctx.bytes_received);
+    result = test_l2_validate_bytes_received(&ctx, &settings, MEASUREMENT_WINDOW_SECONDS);
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    test_l2_check_levels(&ctx);
+    test_l2_check_drift(&ctx, "Primary", &drift);
 
     result = RMF_AudioCapture_Close(handle);
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
@@ -257,9 +495,11 @@ void test_l2_rmfAudioCapture_auxiliary_data_check(void)
 {
     RMF_AudioCaptureHandle handle;
     RMF_AudioCapture_Settings settings;
+    capture_drift_estimate_t drift;
     rmf_Error result = RMF_SUCCESS;
 
     gTestID = 2;
+    gTestName = "l2_rmf_auxiliary_data_check";
     UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
 
     result = RMF_AudioCapture_Open_Type(&handle, RMF_AC_TYPE_AUXILIARY);
@@ -272,7 +512,7 @@ void test_l2_rmfAudioCapture_auxiliary_data_check(void)
     result = RMF_AudioCapture_GetDefaultSettings(&settings);
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
 
-    capture_session_context_t ctx = {0, 0};
+    capture_session_context_t ctx = {.capture = "auxiliary"};
     test_l2_prepare_start_settings_for_data_tracking(&settings, (void *)&ctx);
 
     result = RMF_AudioCapture_Start(handle, &settings);
@@ -282,16 +522,21 @@ void test_l2_rmfAudioCapture_auxiliary_data_check(void)
         result = RMF_AudioCapture_Close(handle);
         UT_FAIL_FATAL("Aborting test - unable to start capture.");
     }
-    sleep(MEASUREMENT_WINDOW_SECONDS);
+    capture_clock_sleep_ns(THREAD_SETTLE_SECONDS * 1000000000ull);
+    capture_threads_begin(&ctx.threads);
+    capture_clock_sleep_ns((MEASUREMENT_WINDOW_SECONDS - THREAD_SETTLE_SECONDS) * 1000000000ull);
+    test_l2_report_threads(&ctx, "Auxiliary");
     result = RMF_AudioCapture_Stop(handle);
     ctx.cookie = 0; // Note: Doesn't account for all possible race conditions
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
 
-    sleep(1); // Wait for the last callback to be processed
+    capture_clock_sleep_ns(1000000000ull); // Wait for the last callback to be processed
     UT_ASSERT_EQUAL(ctx.cookie, 0);
 
-    result = test_l2_validate_bytes_received(&settings, MEASUREMENT_WINDOW_SECONDS, ctx.bytes_received);
+    result = test_l2_validate_bytes_received(&ctx, &settings, MEASUREMENT_WINDOW_SECONDS);
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    test_l2_check_levels(&ctx);
+    test_l2_check_drift(&ctx, "Auxiliary", &drift);
 
     result = RMF_AudioCapture_Close(handle);
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
@@ -314,9 +559,11 @@ void test_l2_rmfAudioCapture_combined_data_check(void)
 {
     RMF_AudioCaptureHandle aux_handle, prim_handle;
     RMF_AudioCapture_Settings aux_settings, prim_settings;
+    capture_drift_estimate_t aux_drift, prim_drift;
     rmf_Error result = RMF_SUCCESS;
 
     gTestID = 3;
+    gTestName = "l2_rmf_combined_data_check";
     UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
 
     result = RMF_AudioCapture_Open_Type(&aux_handle, RMF_AC_TYPE_AUXILIARY);
@@ -330,8 +577,8 @@ void test_l2_rmfAudioCapture_combined_data_check(void)
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
 
     prim_settings = aux_settings;
-    capture_session_context_t prim_ctx = {0, 0};
-    capture_session_context_t aux_ctx = {0, 0};
+    capture_session_context_t prim_ctx = {.capture = "primary"};
+    capture_session_context_t aux_ctx = {.capture = "auxiliary"};
     test_l2_prepare_start_settings_for_data_tracking(&aux_settings, (void *)&aux_ctx);
     test_l2_prepare_start_settings_for_data_tracking(&prim_settings, (void *)&prim_ctx);
 
@@ -361,7 +608,12 @@ void test_l2_rmfAudioCapture_combined_data_check(void)
         result = RMF_AudioCapture_Close(prim_handle);
         UT_FAIL_FATAL("Aborting test - unable to start primary capture.");
     }
-    sleep(MEASUREMENT_WINDOW_SECONDS);
+    capture_clock_sleep_ns(THREAD_SETTLE_SECONDS * 1000000000ull);
+    capture_threads_begin(&aux_ctx.threads);
+    capture_threads_begin(&prim_ctx.threads);
+    capture_clock_sleep_ns((MEASUREMENT_WINDOW_SECONDS - THREAD_SETTLE_SECONDS) * 1000000000ull);
+    test_l2_report_threads(&aux_ctx, "Auxiliary");
+    test_l2_report_threads(&prim_ctx, "Primary");
 
     result = RMF_AudioCapture_Stop(prim_handle);
     prim_ctx.cookie = 0;
@@ -370,14 +622,29 @@ void test_l2_rmfAudioCapture_combined_data_check(void)
     aux_ctx.cookie = 0;
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
 
-    sleep(1); // Wait for the last callback to be processed
+    capture_clock_sleep_ns(1000000000ull); // Wait for the last callback to be processed
     UT_ASSERT_EQUAL(prim_ctx.cookie, 0);
     UT_ASSERT_EQUAL(aux_ctx.cookie, 0);
 
-    result = test_l2_validate_bytes_received(&aux_settings, MEASUREMENT_WINDOW_SECONDS, aux_ctx.bytes_received);
+    result = test_l2_validate_bytes_received(&aux_ctx, &aux_settings, MEASUREMENT_WINDOW_SECONDS);
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
-    result = test_l2_validate_bytes_received(&prim_settings, MEASUREMENT_WINDOW_SECONDS, prim_ctx.bytes_received);
+    result = test_l2_validate_bytes_received(&prim_ctx, &prim_settings, MEASUREMENT_WINDOW_SECONDS);
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    test_l2_check_levels(&aux_ctx);
+    test_l2_check_levels(&prim_ctx);
+    test_l2_check_drift(&aux_ctx, "Auxiliary", &aux_drift);
+    test_l2_check_drift(&prim_ctx, "Primary", &prim_drift);
+    UT_LOG_INFO("Primary clock relative to auxiliary clock: %.1f ppm (95%% CI +/- %.1f ppm)\n",
+                prim_drift.ppm - aux_drift.ppm, sqrt(prim_drift.ci_ppm * prim_drift.ci_ppm + aux_drift.ci_ppm * aux_drift.ci_ppm));
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "relative_drift", gTestName, NULL);
+        capture_json_add_double(&record.writer, "ppm", prim_drift.ppm - aux_drift.ppm);
+        capture_json_add_double(&record.writer, "ci_ppm", sqrt(prim_drift.ci_ppm * prim_drift.ci_ppm + aux_drift.ci_ppm * aux_drift.ci_ppm));
+        capture_metrics_emit(&record);
+    }
 
     result = RMF_AudioCapture_Close(prim_handle);
     UT_ASSERT_EQUAL(result, RMF_SUCCESS);
@@ -387,6 +654,758 @@ void test_l2_rmfAudioCapture_combined_data_check(void)
     UT_LOG_INFO("Out %s\n", __FUNCTION__);
 }
 
+/**
+* @brief Test that steady state primary capture is allocation free
+*
+* This test counts the allocations and measures the memory footprint of each phase of a primary
+* capture session: opening and starting, steady state capture, and stopping and closing. Once
+* capture has settled, neither the data callback nor the HAL thread that invokes it may allocate.
+*
+* **Test Group ID:** 02@n
+* **Test Case ID:** 004@n
+*
+* **Test Procedure:**
+* Refer to UT specification documentation [rmf-audio-capture_L2-Low-Level_TestSpecification.md](../docs/pages/rmf-audio-capture_L2-Low-Level_TestSpecification.md)
+*/
+void test_l2_rmfAudioCapture_allocation_check(void)
+{
+    RMF_AudioCaptureHandle handle;
+    RMF_AudioCapture_Settings settings;
+    capture_alloc_phase_t session, phase;
+    capture_alloc_stats_t stats;
+    rmf_Error result = RMF_SUCCESS;
+
+    gTestID = 4;
+    gTestName = "l2_rmf_allocation_check";
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    if (!capture_alloc_available())
+    {
+        UT_LOG_INFO("Allocation tracking is not available in this build, skipping\n");
+        UT_LOG_INFO("Out %s\n", __FUNCTION__);
+        return;
+    }
+
+    capture_session_context_t ctx = {.capture = "primary"};
+    capture_alloc_begin(&session);
+    capture_alloc_begin(&phase);
+
+    result = RMF_AudioCapture_Open(&handle);
+    if (RMF_SUCCESS != result)
+    {
+        UT_FAIL_FATAL("Aborting test - unable to open capture.");
+    }
+    UT_ASSERT_PTR_NOT_NULL_FATAL(handle);
+
+    result = RMF_AudioCapture_GetDefaultSettings(&settings);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    test_l2_prepare_start_settings_for_data_tracking(&settings, (void *)&ctx);
+
+    result = RMF_AudioCapture_Start(handle, &settings);
+    if (RMF_SUCCESS != result)
+    {
+        UT_LOG_DEBUG("Capture start failed with error code: %d", result);
+        result = RMF_AudioCapture_Close(handle);
+        UT_FAIL_FATAL("Aborting test - unable to start capture.");
+    }
+    capture_clock_sleep_ns(THREAD_SETTLE_SECONDS * 1000000000ull);
+    capture_alloc_end(&phase, &stats);
+    test_l2_log_allocations("Open and start", &stats);
+
+    capture_alloc_begin(&phase);
+    capture_clock_sleep_ns((MEASUREMENT_WINDOW_SECONDS - THREAD_SETTLE_SECONDS) * 1000000000ull);
+    capture_alloc_end(&phase, &stats);
+    test_l2_log_allocations("Steady state capture", &stats);
+    UT_ASSERT_TRUE(ctx.bytes_received > 0);
+    UT_ASSERT_EQUAL(stats.counts.callback_allocations, 0);
+    UT_ASSERT_EQUAL(stats.counts.delivery_allocations, 0);
+
+    capture_alloc_begin(&phase);
+    result = RMF_AudioCapture_Stop(handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    result = RMF_AudioCapture_Close(handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    capture_clock_sleep_ns(1000000000ull); // Let the HAL threads release their resources
+    capture_alloc_end(&phase, &stats);
+    test_l2_log_allocations("Stop and close", &stats);
+
+    capture_alloc_end(&session, &stats); // The phases reset the peak RSS, so this one reports the last of them
+    test_l2_log_allocations("Whole session", &stats);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/**
+ * @brief Data callback of a consumer doing slow processing, such as a DSP stage
+ */
+static rmf_Error test_l2_slow_consumer_cb(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    rmf_Error result = test_l2_counting_data_cb(context_blob, AudioCaptureBuffer, AudioCaptureBufferSize);
+
+    usleep(DISPATCH_CONSUMER_US);
+    return result;
+}
+
+/**
+ * @brief Runs one capture with the slow consumer, dispatched through a queue of the given depth
+ */
+static void test_l2_run_dispatch_phase(RMF_AudioCaptureHandle handle, RMF_AudioCapture_Settings *settings, uint32_t depth, capture_async_stats_t *stats)
+{
+    const char *mode = (depth == 0) ? "direct" : "async";
+    capture_session_context_t ctx = {.capture = "primary"};
+    capture_async_t *async = NULL;
+    rmf_Error result;
+
+    test_l2_prepare_start_settings_for_data_tracking(settings, (void *)&ctx);
+    settings->cbBufferReady = test_l2_slow_consumer_cb;
+
+    result = capture_async_start(&async, handle, settings, depth);
+    if (RMF_SUCCESS != result)
+    {
+        UT_LOG_DEBUG("Capture start failed with error code: %d", result);
+        result = RMF_AudioCapture_Close(handle);
+        UT_FAIL_FATAL("Aborting test - unable to start capture.");
+    }
+    capture_clock_sleep_ns(DISPATCH_PHASE_SECONDS * 1000000000ull);
+    result = capture_async_stop(async);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    capture_clock_sleep_ns(1000000000ull); // Wait for the last callback to be processed
+    capture_async_stats(async, stats);
+
+    UT_LOG_INFO("Dispatch %s: HAL thread hold mean %.3f ms max %.3f ms, consumer mean %.3f ms max %.3f ms, buffers %" PRIu64 " dispatched %" PRIu64,
+                mode, stats->hold_mean_ns / 1e6, stats->hold_max_ns / 1e6, stats->consumer_mean_ns / 1e6, stats->consumer_max_ns / 1e6,
+                stats->buffers, stats->dispatched);
+    UT_LOG_INFO("Dispatch %s: queue full %" PRIu64 ", pool exhausted %" PRIu64 ", queue high water %u of %u, pool high water %u",
+                mode, stats->queue_full, stats->pool_exhausted, stats->queue_high_water, stats->depth, stats->pool_high_water);
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "dispatch", gTestName, ctx.capture);
+        capture_json_add_string(&record.writer, "mode", mode);
+        capture_json_add_uint(&record.writer, "depth", stats->depth);
+        capture_json_add_uint(&record.writer, "buffers", stats->buffers);
+        capture_json_add_uint(&record.writer, "dispatched", stats->dispatched);
+        capture_json_add_double(&record.writer, "hold_mean_ns", stats->hold_mean_ns);
+        capture_json_add_uint(&record.writer, "hold_max_ns", stats->hold_max_ns);
+        capture_json_add_double(&record.writer, "consumer_mean_ns", stats->consumer_mean_ns);
+        capture_json_add_uint(&record.writer, "consumer_max_ns", stats->consumer_max_ns);
+        capture_json_add_uint(&record.writer, "queue_full", stats->queue_full);
+        capture_json_add_uint(&record.writer, "pool_exhausted", stats->pool_exhausted);
+        capture_json_add_uint(&record.writer, "truncated", stats->truncated);
+        capture_json_add_uint(&record.writer, "queue_high_water", stats->queue_high_water);
+        capture_json_add_uint(&record.writer, "pool_high_water", stats->pool_high_water);
+        capture_metrics_emit(&record);
+    }
+
+    result = test_l2_validate_bytes_received(&ctx, settings, DISPATCH_PHASE_SECONDS);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+
+    result = RMF_AudioCapture_Close(handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    capture_async_destroy(async);
+}
+
+/**
+* @brief Test that asynchronous dispatch keeps a slow consumer off the HAL thread
+*
+* This test runs primary capture with a consumer that takes 10 ms per buffer, first called directly
+* on the HAL thread and then through the asynchronous dispatch adapter. It measures how long the HAL
+* thread is held in the callback in each case and verifies that, with the adapter, it is held for
+* less time than the consumer takes, no buffer is dropped and all data still reaches the consumer.
+*
+* **Test Group ID:** 02@n
+* **Test Case ID:** 005@n
+*
+* **Test Procedure:**
+* Refer to UT specification documentation [rmf-audio-capture_L2-Low-Level_TestSpecification.md](../docs/pages/rmf-audio-capture_L2-Low-Level_TestSpecification.md)
+*/
+void test_l2_rmfAudioCapture_async_dispatch_check(void)
+{
+    RMF_AudioCaptureHandle handle;
+    RMF_AudioCapture_Settings settings;
+    capture_async_stats_t direct, async;
+    rmf_Error result = RMF_SUCCESS;
+
+    gTestID = 5;
+    gTestName = "l2_rmf_async_dispatch_check";
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    if (capture_clock_virtual())
+    {
+        // The HAL thread hold and consumer times are wall clock measurements, the virtual clock stands still while they run
+        UT_LOG_INFO("Dispatch timings need the real clock, skipping on the virtual clock\n");
+        UT_LOG_INFO("Out %s\n", __FUNCTION__);
+        return;
+    }
+
+    result = RMF_AudioCapture_Open(&handle);
+    if (RMF_SUCCESS != result)
+    {
+        UT_FAIL_FATAL("Aborting test - unable to open capture.");
+    }
+    UT_ASSERT_PTR_NOT_NULL_FATAL(handle);
+    result = RMF_AudioCapture_GetDefaultSettings(&settings);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    test_l2_run_dispatch_phase(handle, &settings, 0, &direct);
+
+    result = RMF_AudioCapture_Open(&handle);
+    if (RMF_SUCCESS != result)
+    {
+        UT_FAIL_FATAL("Aborting test - unable to open capture.");
+    }
+    UT_ASSERT_PTR_NOT_NULL_FATAL(handle);
+    result = RMF_AudioCapture_GetDefaultSettings(&settings);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    test_l2_run_dispatch_phase(handle, &settings, CAPTURE_ASYNC_DEPTH_DEFAULT, &async);
+
+    UT_ASSERT_TRUE(async.dispatched > 0);
+    UT_ASSERT_EQUAL(async.dispatched, async.buffers);
+    UT_ASSERT_EQUAL(async.queue_full, 0);
+    UT_ASSERT_EQUAL(async.pool_exhausted, 0);
+    UT_ASSERT_TRUE(async.hold_mean_ns < async.consumer_mean_ns);
+    UT_ASSERT_TRUE(async.hold_mean_ns < direct.hold_mean_ns);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+typedef struct
+{
+    capture_session_context_t session; // First, so the counting callback can take the tracker
+    uint32_t frame_bytes;
+    uint32_t sampling_rate;
+    uint64_t buffers;
+    uint64_t first_time_ns;
+    uint64_t first_position;
+    uint64_t last_time_ns;
+    uint64_t next_position;
+    uint64_t discontinuities;   // Buffers not starting at the frame after the previous one
+    uint64_t non_monotonic;     // Capture times not after the previous one
+    uint64_t future;            // Capture times after the callback entry
+    double clock_error_max_us;
+    uint32_t delays_count;
+    double delays_ns[TIMESTAMP_MAX_BUFFERS]; // Callback entry minus capture time
+} test_l2_timestamp_track_t;
+
+static int test_l2_compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Timestamped data callback, checks the timing of each buffer against the previous one
+ */
+static rmf_Error test_l2_timestamped_data_cb(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize, const RMF_AudioCapture_BufferInfo *info)
+{
+    test_l2_timestamp_track_t *track = (test_l2_timestamp_track_t *)context_blob;
+    uint64_t entry = capture_clock_now_ns();
+    double error;
+    CAPTURE_TIMELINE_SCOPE("callback", "bytes", AudioCaptureBufferSize);
+
+    UT_ASSERT_PTR_NOT_NULL_FATAL(info);
+
+    if (info->captureTimeNs > entry)
+    {
+        track->future++;
+    }
+    else if (track->delays_count < TIMESTAMP_MAX_BUFFERS)
+    {
+        track->delays_ns[track->delays_count++] = (double)(entry - info->captureTimeNs);
+    }
+    if (track->buffers == 0)
+    {
+        track->first_time_ns = info->captureTimeNs;
+        track->first_position = info->samplePosition;
+    }
+    else
+    {
+        track->discontinuities += (info->samplePosition != track->next_position);
+        track->non_monotonic += (info->captureTimeNs <= track->last_time_ns);
+    }
+    error = fabs((double)(info->captureTimeNs - track->first_time_ns) -
+                 (double)(info->samplePosition - track->first_position) * 1e9 / track->sampling_rate) / 1e3;
+    track->clock_error_max_us = (error > track->clock_error_max_us) ? error : track->clock_error_max_us;
+    track->next_position = info->samplePosition + AudioCaptureBufferSize / track->frame_bytes;
+    track->last_time_ns = info->captureTimeNs;
+    track->buffers++;
+
+    return test_l2_counting_data_cb(context_blob, AudioCaptureBuffer, AudioCaptureBufferSize);
+}
+
+/**
+* @brief Test the per buffer capture timestamps of the timestamped data callback
+*
+* This test registers the timestamped data callback of rmfAudioCapture_timestamp.h, and is skipped
+* when the HAL does not implement it. It runs primary capture and verifies that every buffer is
+* timestamped before the callback is entered, that the capture times increase, that the sample
+* positions follow on without gaps and that the two agree with the sampling rate. The delay from
+* the capture time to the callback entry is measured and reported.
+*
+* **Test Group ID:** 02@n
+* **Test Case ID:** 006@n
+*
+* **Test Procedure:**
+* Refer to UT specification documentation [rmf-audio-capture_L2-Low-Level_TestSpecification.md](../docs/pages/rmf-audio-capture_L2-Low-Level_TestSpecification.md)
+*/
+void test_l2_rmfAudioCapture_buffer_timestamp_check(void)
+{
+    RMF_AudioCaptureHandle handle;
+    RMF_AudioCapture_Settings settings;
+    RMF_AudioCapture_Status status = {0};
+    test_l2_timestamp_track_t *track;
+    uint8_t num_channels = 0;
+    uint8_t bits_per_sample = 0;
+    double mean = 0.0;
+    rmf_Error result = RMF_SUCCESS;
+
+    gTestID = 6;
+    gTestName = "l2_rmf_buffer_timestamp_check";
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    result = RMF_AudioCapture_Open(&handle);
+    if (RMF_SUCCESS != result)
+    {
+        UT_FAIL_FATAL("Aborting test - unable to open capture.");
+    }
+    UT_ASSERT_PTR_NOT_NULL_FATAL(handle);
+
+    result = (RMF_AudioCapture_SetTimestampedBufferReadyCb != NULL) ? RMF_AudioCapture_SetTimestampedBufferReadyCb(handle, test_l2_timestamped_data_cb) : RMF_ERROR;
+    if (RMF_ERROR == result)
+    {
+        UT_LOG_INFO("The HAL does not timestamp the captured buffers, test skipped");
+        result = RMF_AudioCapture_Close(handle);
+        UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+        UT_LOG_INFO("Out %s\n", __FUNCTION__);
+        return;
+    }
+    UT_ASSERT_EQUAL_FATAL(result, RMF_SUCCESS);
+
+    track = (test_l2_timestamp_track_t *)calloc(1, sizeof(*track));
+    UT_ASSERT_PTR_NOT_NULL_FATAL(track);
+    track->session.capture = "primary";
+    result = RMF_AudioCapture_GetDefaultSettings(&settings);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    result = test_l2_get_format_values(&settings, &num_channels, &track->sampling_rate, &bits_per_sample);
+    UT_ASSERT_EQUAL_FATAL(result, RMF_SUCCESS);
+    track->frame_bytes = num_channels * bits_per_sample / 8;
+    test_l2_prepare_start_settings_for_data_tracking(&settings, (void *)track);
+
+    result = RMF_AudioCapture_Start(handle, &settings);
+    if (RMF_SUCCESS != result)
+    {
+        UT_LOG_DEBUG("Capture start failed with error code: %d", result);
+        result = RMF_AudioCapture_Close(handle);
+        free(track);
+        UT_FAIL_FATAL("Aborting test - unable to start capture.");
+    }
+    // The callback is fixed for the session once started
+    result = RMF_AudioCapture_SetTimestampedBufferReadyCb(handle, NULL);
+    UT_ASSERT_EQUAL(result, RMF_INVALID_STATE);
+
+    capture_clock_sleep_ns(TIMESTAMP_PHASE_SECONDS * 1000000000ull);
+    result = RMF_AudioCapture_GetStatus(handle, &status);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    result = RMF_AudioCapture_Stop(handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    capture_clock_sleep_ns(1000000000ull); // Wait for the last callback to be processed
+
+    qsort(track->delays_ns, track->delays_count, sizeof(double), test_l2_compare_double);
+    for (uint32_t i = 0; i < track->delays_count; i++)
+    {
+        mean += track->delays_ns[i] / track->delays_count;
+    }
+    if (track->delays_count > 0)
+    {
+        UT_LOG_INFO("Capture time to callback entry: min %.3f ms, mean %.3f ms, 99th percentile %.3f ms, max %.3f ms over %u buffers",
+                    track->delays_ns[0] / 1e6, mean / 1e6, track->delays_ns[(track->delays_count - 1) * 99 / 100] / 1e6,
+                    track->delays_ns[track->delays_count - 1] / 1e6, track->delays_count);
+    }
+    UT_LOG_INFO("Timestamps: %" PRIu64 " buffers, %" PRIu64 " discontinuities, %" PRIu64 " not increasing, %" PRIu64 " in the future, clock error max %.1f us, overflows %u",
+                track->buffers, track->discontinuities, track->non_monotonic, track->future, track->clock_error_max_us, status.overflows);
+    if (capture_metrics_enabled() && (track->delays_count > 0))
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "timestamp", gTestName, track->session.capture);
+        capture_json_add_uint(&record.writer, "buffers", track->buffers);
+        capture_json_add_double(&record.writer, "delay_min_ns", track->delays_ns[0]);
+        capture_json_add_double(&record.writer, "delay_mean_ns", mean);
+        capture_json_add_double(&record.writer, "delay_p99_ns", track->delays_ns[(track->delays_count - 1) * 99 / 100]);
+        capture_json_add_double(&record.writer, "delay_max_ns", track->delays_ns[track->delays_count - 1]);
+        capture_json_add_double(&record.writer, "clock_error_max_us", track->clock_error_max_us);
+        capture_json_add_uint(&record.writer, "discontinuities", track->discontinuities);
+        capture_json_add_uint(&record.writer, "non_monotonic", track->non_monotonic);
+        capture_json_add_uint(&record.writer, "future", track->future);
+        capture_metrics_emit(&record);
+    }
+
+    UT_ASSERT_TRUE(track->buffers > 0);
+    UT_ASSERT_EQUAL(track->future, 0);
+    UT_ASSERT_EQUAL(track->non_monotonic, 0);
+    UT_ASSERT_TRUE((track->discontinuities == 0) || (status.overflows > 0)); // Dropped audio leaves a gap in the positions
+    UT_ASSERT_TRUE(track->clock_error_max_us < TIMESTAMP_CLOCK_TOLERANCE_US);
+    result = test_l2_validate_bytes_received(&track->session, &settings, TIMESTAMP_PHASE_SECONDS);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+
+    result = RMF_AudioCapture_Close(handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    free(track);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+typedef struct
+{
+    capture_session_context_t session; // First, so the counting callback can take the tracker
+    uint64_t start_ns;          // Clock time of the RMF_AudioCapture_Start() call
+    uint32_t count;
+    uint64_t arrivals_ns[INTERFERENCE_MAX_BUFFERS]; // Callback entries
+    double delays_ns[INTERFERENCE_MAX_BUFFERS];     // Capture time to callback entry, NAN without a timestamp
+} test_l2_interference_track_t;
+
+typedef struct
+{
+    double startup_ms;          // Start call to the first callback
+    uint32_t intervals;
+    double interval_mean_ms;
+    double interval_max_ms;
+    double jitter_p99_ms;       // 99th percentile of the distance of an interval from the mean
+    double latency_mean_ms;     // Capture time to callback entry, NAN when the HAL does not timestamp its buffers
+    double latency_p99_ms;
+} test_l2_timing_profile_t;
+
+static void test_l2_interference_record(test_l2_interference_track_t *track, uint64_t entry_ns, double delay_ns)
+{
+    if (track->count < INTERFERENCE_MAX_BUFFERS)
+    {
+        track->arrivals_ns[track->count] = entry_ns;
+        track->delays_ns[track->count] = delay_ns;
+        track->count++;
+    }
+}
+
+static rmf_Error test_l2_interference_data_cb(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
+{
+    test_l2_interference_record((test_l2_interference_track_t *)context_blob, capture_clock_now_ns(), NAN);
+    return test_l2_counting_data_cb(context_blob, AudioCaptureBuffer, AudioCaptureBufferSize);
+}
+
+static rmf_Error test_l2_interference_timestamped_cb(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize, const RMF_AudioCapture_BufferInfo *info)
+{
+    uint64_t entry = capture_clock_now_ns();
+
+    test_l2_interference_record((test_l2_interference_track_t *)context_blob, entry,
+                                ((info != NULL) && (info->captureTimeNs <= entry)) ? (double)(entry - info->captureTimeNs) : NAN);
+    return test_l2_counting_data_cb(context_blob, AudioCaptureBuffer, AudioCaptureBufferSize);
+}
+
+/**
+ * @brief Measures the timing of the callbacks of a capture that arrived between from_ns and to_ns
+ */
+static void test_l2_timing_profile(const test_l2_interference_track_t *track, uint64_t from_ns, uint64_t to_ns, test_l2_timing_profile_t *profile)
+{
+    double values[INTERFERENCE_MAX_BUFFERS];
+    uint32_t count = 0;
+    double sum = 0.0;
+
+    profile->startup_ms = (track->count > 0) ? (double)(track->arrivals_ns[0] - track->start_ns) / 1e6 : NAN;
+    profile->interval_mean_ms = NAN;
+    profile->interval_max_ms = NAN;
+    profile->jitter_p99_ms = NAN;
+    profile->latency_mean_ms = NAN;
+    profile->latency_p99_ms = NAN;
+
+    for (uint32_t i = 1; i < track->count; i++)
+    {
+        if ((track->arrivals_ns[i - 1] >= from_ns) && (track->arrivals_ns[i] < to_ns))
+        {
+            values[count] = (double)(track->arrivals_ns[i] - track->arrivals_ns[i - 1]);
+            sum += values[count++];
+        }
+    }
+    profile->intervals = count;
+    if (count > 0)
+    {
+        double mean = sum / count;
+
+        qsort(values, count, sizeof(double), test_l2_compare_double);
+        profile->interval_mean_ms = mean / 1e6;
+        profile->interval_max_ms = values[count - 1] / 1e6;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            values[i] = fabs(values[i] - mean);
+        }
+        qsort(values, count, sizeof(double), test_l2_compare_double);
+        profile->jitter_p99_ms = values[(count - 1) * 99 / 100] / 1e6;
+    }
+
+    count = 0;
+    sum = 0.0;
+    for (uint32_t i = 0; i < track->count; i++)
+    {
+        if ((track->arrivals_ns[i] >= from_ns) && (track->arrivals_ns[i] < to_ns) && !isnan(track->delays_ns[i]))
+        {
+            values[count] = track->delays_ns[i];
+            sum += values[count++];
+        }
+    }
+    if (count > 0)
+    {
+        qsort(values, count, sizeof(double), test_l2_compare_double);
+        profile->latency_mean_ms = sum / count / 1e6;
+        profile->latency_p99_ms = values[(count - 1) * 99 / 100] / 1e6;
+    }
+}
+
+/**
+ * @brief Logs a timing profile and emits it as an interference metrics record
+ */
+static void test_l2_report_profile(const char *capture, const char *phase, const test_l2_timing_profile_t *profile)
+{
+    UT_LOG_INFO("%s %s: startup %.3f ms, %u intervals, mean %.3f ms, max %.3f ms, jitter p99 %.3f ms, latency mean %.3f ms, p99 %.3f ms",
+                capture, phase, profile->startup_ms, profile->intervals, profile->interval_mean_ms, profile->interval_max_ms,
+                profile->jitter_p99_ms, profile->latency_mean_ms, profile->latency_p99_ms);
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "interference", gTestName, capture);
+        capture_json_add_string(&record.writer, "phase", phase);
+        capture_json_add_double(&record.writer, "startup_ms", profile->startup_ms);
+        capture_json_add_uint(&record.writer, "intervals", profile->intervals);
+        capture_json_add_double(&record.writer, "interval_mean_ms", profile->interval_mean_ms);
+        capture_json_add_double(&record.writer, "interval_max_ms", profile->interval_max_ms);
+        capture_json_add_double(&record.writer, "jitter_p99_ms", profile->jitter_p99_ms);
+        capture_json_add_double(&record.writer, "latency_mean_ms", profile->latency_mean_ms);
+        capture_json_add_double(&record.writer, "latency_p99_ms", profile->latency_p99_ms);
+        capture_metrics_emit(&record);
+    }
+}
+
+/**
+ * @brief Opens a capture for the interference check, timestamping its buffers when the HAL can
+ */
+static rmf_Error test_l2_interference_open(RMF_AudioCaptureType type, test_l2_interference_track_t *track, RMF_AudioCaptureHandle *handle, RMF_AudioCapture_Settings *settings)
+{
+    rmf_Error result = RMF_AudioCapture_Open_Type(handle, type);
+
+    if ((RMF_SUCCESS != result) || (*handle == NULL))
+    {
+        return (RMF_SUCCESS != result) ? result : RMF_ERROR;
+    }
+    result = RMF_AudioCapture_GetDefaultSettings(settings);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    test_l2_prepare_start_settings_for_data_tracking(settings, (void *)track);
+    settings->cbBufferReady = test_l2_interference_data_cb;
+    if (RMF_AudioCapture_SetTimestampedBufferReadyCb != NULL)
+    {
+        // Replaces the data callback when the HAL implements it, see rmfAudioCapture_timestamp.h
+        RMF_AudioCapture_SetTimestampedBufferReadyCb(*handle, test_l2_interference_timestamped_cb);
+    }
+    return RMF_SUCCESS;
+}
+
+static rmf_Error test_l2_interference_start(RMF_AudioCaptureHandle handle, RMF_AudioCapture_Settings *settings, test_l2_interference_track_t *track)
+{
+    track->start_ns = capture_clock_now_ns();
+    return RMF_AudioCapture_Start(handle, settings);
+}
+
+/**
+ * @brief Runs one capture alone and measures its timing, the baseline of the interference check
+ */
+static void test_l2_interference_solo(RMF_AudioCaptureType type, test_l2_interference_track_t *track, test_l2_timing_profile_t *profile)
+{
+    RMF_AudioCaptureHandle handle = NULL;
+    RMF_AudioCapture_Settings settings;
+    RMF_AudioCapture_Status status = {0};
+    uint64_t stop_ns;
+    rmf_Error result;
+
+    result = test_l2_interference_open(type, track, &handle, &settings);
+    if (RMF_SUCCESS != result)
+    {
+        UT_FAIL_FATAL("Aborting test - unable to open capture.");
+    }
+    result = test_l2_interference_start(handle, &settings, track);
+    if (RMF_SUCCESS != result)
+    {
+        UT_LOG_DEBUG("Capture start failed with error code: %d", result);
+        result = RMF_AudioCapture_Close(handle);
+        UT_FAIL_FATAL("Aborting test - unable to start capture.");
+    }
+    capture_clock_sleep_ns(INTERFERENCE_PHASE_SECONDS * 1000000000ull);
+    result = RMF_AudioCapture_GetStatus(handle, &status);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    stop_ns = capture_clock_now_ns();
+    result = RMF_AudioCapture_Stop(handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    capture_clock_sleep_ns(1000000000ull); // Wait for the last callback to be processed
+
+    test_l2_timing_profile(track, track->start_ns + THREAD_SETTLE_SECONDS * 1000000000ull, stop_ns, profile);
+    test_l2_report_profile(track->session.capture, "solo", profile);
+    UT_ASSERT_EQUAL(status.overflows, 0);
+    result = test_l2_validate_bytes_received(&track->session, &settings, INTERFERENCE_PHASE_SECONDS);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+
+    result = RMF_AudioCapture_Close(handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+}
+
+/**
+ * @brief Logs how much running together changed the timing of a capture, and emits it as a metrics record
+ */
+static void test_l2_report_interference(const char *capture, const test_l2_timing_profile_t *solo, const test_l2_timing_profile_t *together,
+                                        const test_l2_timing_profile_t *transition)
+{
+    double startup = together->startup_ms - solo->startup_ms;
+    double jitter = together->jitter_p99_ms - solo->jitter_p99_ms;
+    double latency = together->latency_mean_ms - solo->latency_mean_ms;
+    double disturbance = (transition != NULL) ? transition->interval_max_ms - solo->interval_max_ms : NAN;
+
+    if (transition != NULL)
+    {
+        UT_LOG_INFO("%s change from running alone: jitter p99 %+.3f ms, latency mean %+.3f ms, longest interval while the other capture starts %+.3f ms",
+                    capture, jitter, latency, disturbance);
+    }
+    else
+    {
+        UT_LOG_INFO("%s change from running alone: jitter p99 %+.3f ms, latency mean %+.3f ms, startup %+.3f ms",
+                    capture, jitter, latency, startup);
+    }
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "interference_delta", gTestName, capture);
+        capture_json_add_double(&record.writer, "jitter_p99_ms", jitter);
+        capture_json_add_double(&record.writer, "latency_mean_ms", latency);
+        capture_json_add_double(&record.writer, "startup_ms", (transition != NULL) ? NAN : startup);
+        capture_json_add_double(&record.writer, "start_interval_max_ms", disturbance);
+        capture_metrics_emit(&record);
+    }
+}
+
+/**
+* @brief Test how much running primary and auxiliary capture together changes the timing of each
+*
+* This test first runs primary and then auxiliary capture alone and measures the startup time,
+* the callback intervals and jitter, and, when the HAL timestamps its buffers, the latency from
+* capture to callback of each. It then runs primary capture and starts auxiliary capture halfway
+* through. The timing of primary capture while auxiliary capture starts and while both run, and
+* the startup and timing of auxiliary capture with primary capture running, are compared with the
+* solo runs and reported. Both captures must keep their data rate and not overflow.
+*
+* **Test Group ID:** 02@n
+* **Test Case ID:** 007@n
+*
+* **Test Procedure:**
+* Refer to UT specification documentation [rmf-audio-capture_L2-Low-Level_TestSpecification.md](../docs/pages/rmf-audio-capture_L2-Low-Level_TestSpecification.md)
+*/
+void test_l2_rmfAudioCapture_cross_interference_check(void)
+{
+    RMF_AudioCaptureHandle prim_handle = NULL, aux_handle = NULL;
+    RMF_AudioCapture_Settings prim_settings, aux_settings;
+    RMF_AudioCapture_Status prim_status = {0}, aux_status = {0};
+    test_l2_interference_track_t *tracks;
+    test_l2_timing_profile_t prim_solo, aux_solo, prim_before, prim_transition, prim_together, aux_together;
+    uint64_t aux_start_ns, stop_ns;
+    rmf_Error result = RMF_SUCCESS;
+
+    gTestID = 7;
+    gTestName = "l2_rmf_cross_interference_check";
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    // Solo primary, solo auxiliary, then primary and auxiliary together
+    tracks = (test_l2_interference_track_t *)calloc(4, sizeof(*tracks));
+    UT_ASSERT_PTR_NOT_NULL_FATAL(tracks);
+    tracks[0].session.capture = "primary";
+    tracks[1].session.capture = "auxiliary";
+    tracks[2].session.capture = "primary";
+    tracks[3].session.capture = "auxiliary";
+
+    test_l2_interference_solo(RMF_AC_TYPE_PRIMARY, &tracks[0], &prim_solo);
+    test_l2_interference_solo(RMF_AC_TYPE_AUXILIARY, &tracks[1], &aux_solo);
+
+    result = test_l2_interference_open(RMF_AC_TYPE_PRIMARY, &tracks[2], &prim_handle, &prim_settings);
+    if (RMF_SUCCESS != result)
+    {
+        free(tracks);
+        UT_FAIL_FATAL("Aborting test - unable to open primary capture interface.");
+    }
+    result = test_l2_interference_open(RMF_AC_TYPE_AUXILIARY, &tracks[3], &aux_handle, &aux_settings);
+    if (RMF_SUCCESS != result)
+    {
+        result = RMF_AudioCapture_Close(prim_handle);
+        free(tracks);
+        UT_FAIL_FATAL("Aborting test - unable to open auxiliary capture interface.");
+    }
+    result = test_l2_interference_start(prim_handle, &prim_settings, &tracks[2]);
+    if (RMF_SUCCESS != result)
+    {
+        UT_LOG_DEBUG("Aborting test - unable to start primary capture. Error code: %d", result);
+        result = RMF_AudioCapture_Close(aux_handle);
+        result = RMF_AudioCapture_Close(prim_handle);
+        free(tracks);
+        UT_FAIL_FATAL("Aborting test - unable to start primary capture.");
+    }
+    capture_clock_sleep_ns(INTERFERENCE_PHASE_SECONDS * 1000000000ull);
+
+    aux_start_ns = capture_clock_now_ns();
+    result = test_l2_interference_start(aux_handle, &aux_settings, &tracks[3]);
+    if (RMF_SUCCESS != result)
+    {
+        UT_LOG_DEBUG("Aborting test - unable to start auxiliary capture. Error code: %d", result);
+        result = RMF_AudioCapture_Stop(prim_handle);
+        result = RMF_AudioCapture_Close(aux_handle);
+        result = RMF_AudioCapture_Close(prim_handle);
+        free(tracks);
+        UT_FAIL_FATAL("Aborting test - unable to start auxiliary capture.");
+    }
+    capture_clock_sleep_ns((INTERFERENCE_TRANSITION_SECONDS + INTERFERENCE_PHASE_SECONDS) * 1000000000ull);
+    result = RMF_AudioCapture_GetStatus(prim_handle, &prim_status);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    result = RMF_AudioCapture_GetStatus(aux_handle, &aux_status);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+
+    stop_ns = capture_clock_now_ns();
+    result = RMF_AudioCapture_Stop(aux_handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    result = RMF_AudioCapture_Stop(prim_handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    capture_clock_sleep_ns(1000000000ull); // Wait for the last callback to be processed
+
+    test_l2_timing_profile(&tracks[2], tracks[2].start_ns + THREAD_SETTLE_SECONDS * 1000000000ull, aux_start_ns, &prim_before);
+    test_l2_timing_profile(&tracks[2], aux_start_ns, aux_start_ns + INTERFERENCE_TRANSITION_SECONDS * 1000000000ull, &prim_transition);
+    test_l2_timing_profile(&tracks[2], aux_start_ns + INTERFERENCE_TRANSITION_SECONDS * 1000000000ull, stop_ns, &prim_together);
+    test_l2_timing_profile(&tracks[3], aux_start_ns + INTERFERENCE_TRANSITION_SECONDS * 1000000000ull, stop_ns, &aux_together);
+    test_l2_report_profile("primary", "before", &prim_before);
+    test_l2_report_profile("primary", "transition", &prim_transition);
+    test_l2_report_profile("primary", "together", &prim_together);
+    test_l2_report_profile("auxiliary", "together", &aux_together);
+    test_l2_report_interference("primary", &prim_solo, &prim_together, &prim_transition);
+    test_l2_report_interference("auxiliary", &aux_solo, &aux_together, NULL);
+
+    UT_ASSERT_FALSE(isnan(aux_together.startup_ms));
+    UT_ASSERT_EQUAL(prim_status.overflows, 0);
+    UT_ASSERT_EQUAL(aux_status.overflows, 0);
+    result = test_l2_validate_bytes_received(&tracks[2].session, &prim_settings, 2 * INTERFERENCE_PHASE_SECONDS + INTERFERENCE_TRANSITION_SECONDS);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    result = test_l2_validate_bytes_received(&tracks[3].session, &aux_settings, INTERFERENCE_PHASE_SECONDS + INTERFERENCE_TRANSITION_SECONDS);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+
+    result = RMF_AudioCapture_Close(aux_handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    result = RMF_AudioCapture_Close(prim_handle);
+    UT_ASSERT_EQUAL(result, RMF_SUCCESS);
+    free(tracks);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
 static UT_test_suite_t * pSuite = NULL;
 
 /**
@@ -405,11 +1424,15 @@ int test_rmfAudioCapture_l2_register(void)
     }
     // List of test function names and strings
     UT_add_test(pSuite, "l2_rmf_primary_data_check", test_l2_rmfAudioCapture_primary_data_check);
+    UT_add_test(pSuite, "l2_rmf_allocation_check", test_l2_rmfAudioCapture_allocation_check);
+    UT_add_test(pSuite, "l2_rmf_async_dispatch_check", test_l2_rmfAudioCapture_async_dispatch_check);
+    UT_add_test(pSuite, "l2_rmf_buffer_timestamp_check", test_l2_rmfAudioCapture_buffer_timestamp_check);
     g_aux_capture_supported = ut_kvp_getBoolField(ut_kvp_profile_getInstance(), "rmfaudiocapture/features/auxsupport");
     if (true == g_aux_capture_supported)
     {
         UT_add_test(pSuite, "l2_rmf_auxiliary_data_check", test_l2_rmfAudioCapture_auxiliary_data_check);
         UT_add_test(pSuite, "l2_rmf_combined_data_check", test_l2_rmfAudioCapture_combined_data_check);
+        UT_add_test(pSuite, "l2_rmf_cross_interference_check", test_l2_rmfAudioCapture_cross_interference_check);
     }
 
     return 0;
@@ -72,7 +72,11 @@
 #include <stdatomic.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
 #include <time.h>
+#include <math.h>
+#include <libgen.h>
+#include <limits.h>
 
 #include <ut.h>
 #include <ut_kvp_profile.h>
@@ -80,6 +84,19 @@
 #include <ut_kvp.h>
 
 #include "rmfAudioCapture.h"
+#include "capture_control.h"
+#include "capture_analysis.h"
+#include "capture_wav.h"
+#include "capture_flac.h"
+#include "capture_meter.h"
+#include "capture_glitch.h"
+#include "capture_drift.h"
+#include "capture_metrics.h"
+#include "capture_shm.h"
+#include "capture_clock.h"
+#include "capture_trace.h"
+#include "capture_timeline.h"
+#include "capture_telemetry.h"
 
 #define RMF_ASSERT assert
 #define UT_LOG_MENU_INFO UT_LOG_INFO
@@ -88,6 +105,7 @@
 #define MEASUREMENT_WINDOW_2MINUTES 120 // Default duration for jitter test
 #define MONITOR_JITTER_MICROSECONDS 100000 //Default sleep interval to check jitter
 #define DATA_RATE 192000    // Bytes per second
+#define METRICS_TEST "L3 rmfAudioCapture" // Test named in the metrics records
 
 static int gTestGroup = 3;
 static int gTestID = 1;
@@ -141,6 +159,20 @@ typedef struct
     uint8_t data_capture_test_duration; // Time for data capture
     uint8_t jitter_test_duration; // How long to test jitter levels
     unsigned char *data_buffer;
+    bool flac_requested; // Data capture was set up for .flac output, the encoder only runs when set
+    capture_flac_encoder_t *flac_encoder; // Lossless encoder following data_buffer while it is filled
+    capture_flac_stream_t flac_stream;
+    capture_meter_t meter; // Levels of the audio received in the callback
+    bool meter_active;
+    capture_glitch_t glitch; // Discontinuities, silence and repeated buffers found in the captured audio
+    bool glitch_active;
+    capture_drift_t drift; // Capture clock against CLOCK_MONOTONIC
+    bool drift_active;
+    capture_shm_t *shm; // Shared memory ring the callback buffers are exported to, NULL when not exported
+    uint32_t shm_users; // Callbacks publishing to shm, the ring is destroyed only once none are
+    capture_trace_t trace; // Arrival time and size of every callback, for the mock to replay
+    bool trace_active;
+    capture_telemetry_session_t telemetry; // Live counters served on the telemetry socket
 } RMF_audio_capture_struct;
 
 RMF_audio_capture_struct gAudioCaptureData[2]; // 0 - primary, 1 - auxiliary
@@ -162,6 +194,29 @@ static void readInt(int32_t *choice)
     readAndDiscardRestOfLine(stdin);
 }
 
+/**
+ * @brief Reads a file path from stdin, falling back to def when nothing is entered
+ */
+static void readPath(char *path, size_t size, const char *def)
+{
+    if (fgets(path, size, stdin) != NULL)
+    {
+        size_t len = strlen(path);
+        if (len > 0 && path[len - 1] == '\n')
+        {
+            path[len - 1] = '\0';
+        }
+    }
+    else
+    {
+        path[0] = '\0';
+    }
+    if (path[0] == '\0')
+    {
+        snprintf(path, size, "%s", def);
+    }
+}
+
 /**
  * @brief Function to extract values from RMF_AudioCapture_Settings
  *
@@ -221,6 +276,25 @@ static rmf_Error getValuesFromSettings(RMF_AudioCapture_Settings *settings, uint
     return RMF_SUCCESS;
 }
 
+/**
+ * @brief Publishes a callback buffer to the shared memory ring, when the capture is exported
+ */
+static void test_l3_export_buffer(RMF_audio_capture_struct *ctx_data, const void *buffer, unsigned int size)
+{
+    struct timespec now;
+    capture_shm_t *shm;
+
+    /* Counted before shm is loaded, so test_l3_close_capture() either sees this callback or it sees NULL */
+    __atomic_add_fetch(&ctx_data->shm_users, 1, __ATOMIC_SEQ_CST);
+    shm = __atomic_load_n(&ctx_data->shm, __ATOMIC_SEQ_CST);
+    if (shm != NULL)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        capture_shm_publish(shm, buffer, size, (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec);
+    }
+    __atomic_sub_fetch(&ctx_data->shm_users, 1, __ATOMIC_RELEASE);
+}
+
 /**
  * @brief Callback function for buffer ready
  *
@@ -229,6 +303,7 @@ static rmf_Error getValuesFromSettings(RMF_AudioCapture_Settings *settings, uint
 static rmf_Error test_l3_counting_data_cb(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
 {
     RMF_audio_capture_struct *ctx_data = (RMF_audio_capture_struct *)context_blob;
+    CAPTURE_TIMELINE_SCOPE("callback", "bytes", AudioCaptureBufferSize);
 
     bool result = (AudioCaptureBuffer == NULL) || (context_blob == NULL) || (AudioCaptureBufferSize <= 0);
     if (result == true)
@@ -237,6 +312,20 @@ static rmf_Error test_l3_counting_data_cb(void *context_blob, void *AudioCapture
     }
     RMF_ASSERT(result == false);
 
+    if (ctx_data->meter_active)
+    {
+        capture_meter_process(&ctx_data->meter, AudioCaptureBuffer, AudioCaptureBufferSize);
+    }
+    if (ctx_data->drift_active)
+    {
+        capture_drift_process(&ctx_data->drift, AudioCaptureBufferSize);
+    }
+    if (ctx_data->trace_active)
+    {
+        capture_trace_record(&ctx_data->trace, AudioCaptureBufferSize);
+    }
+    capture_telemetry_callback(&ctx_data->telemetry, AudioCaptureBufferSize);
+    test_l3_export_buffer(ctx_data, AudioCaptureBuffer, AudioCaptureBufferSize);
     ctx_data->bytes_received += AudioCaptureBufferSize;
     ctx_data->cookie = 1;
 
@@ -260,6 +349,7 @@ static void test_l3_prepare_start_settings_for_data_counting(void *context_blob)
     
     ctx_data->buffer_size = 0;
     ctx_data->bytes_received = 0;
+    ctx_data->flac_requested = false;
 }
 
 /**
@@ -270,6 +360,7 @@ static void test_l3_prepare_start_settings_for_data_counting(void *context_blob)
 static rmf_Error test_l3_tracking_data_cb(void *context_blob, void *AudioCaptureBuffer, unsigned int AudioCaptureBufferSize)
 {
     RMF_audio_capture_struct *ctx_data = (RMF_audio_capture_struct *)context_blob;
+    CAPTURE_TIMELINE_SCOPE("callback", "bytes", AudioCaptureBufferSize);
 
     bool result = (AudioCaptureBuffer == NULL) || (context_blob == NULL) || (AudioCaptureBufferSize <= 0);
     if (result == true)
@@ -279,6 +370,24 @@ static rmf_Error test_l3_tracking_data_cb(void *context_blob, void *AudioCapture
     RMF_ASSERT(result == false);
 
     ctx_data->cookie = 1;
+    if (ctx_data->meter_active)
+    {
+        capture_meter_process(&ctx_data->meter, AudioCaptureBuffer, AudioCaptureBufferSize);
+    }
+    if (ctx_data->drift_active)
+    {
+        capture_drift_process(&ctx_data->drift, AudioCaptureBufferSize);
+    }
+    if (ctx_data->glitch_active)
+    {
+        capture_glitch_process(&ctx_data->glitch, AudioCaptureBuffer, AudioCaptureBufferSize);
+    }
+    if (ctx_data->trace_active)
+    {
+        capture_trace_record(&ctx_data->trace, AudioCaptureBufferSize);
+    }
+    capture_telemetry_callback(&ctx_data->telemetry, AudioCaptureBufferSize);
+    test_l3_export_buffer(ctx_data, AudioCaptureBuffer, AudioCaptureBufferSize);
 
     if ( ctx_data->bytes_received + AudioCaptureBufferSize > ctx_data->buffer_size)
     {
@@ -291,17 +400,70 @@ static rmf_Error test_l3_tracking_data_cb(void *context_blob, void *AudioCapture
     }
     // Copy data into the global buffer
     memcpy(ctx_data->data_buffer + ctx_data->bytes_received, AudioCaptureBuffer, AudioCaptureBufferSize);
-    ctx_data->bytes_received += AudioCaptureBufferSize;
+    /* Publish after the copy, the lossless encoder thread reads up to bytes_received */
+    __atomic_store_n(&ctx_data->bytes_received, ctx_data->bytes_received + AudioCaptureBufferSize, __ATOMIC_RELEASE);
     
     return RMF_SUCCESS;
 }
 
+/**
+ * @brief Stops the lossless encoder, if one is running, and frees it
+ *
+ * Must be called before data_buffer is freed as the encoder thread reads from it.
+ */
+static void test_l3_release_flac_encoder(RMF_audio_capture_struct *ctx_data)
+{
+    if (ctx_data->flac_encoder == NULL)
+    {
+        return;
+    }
+    if (ctx_data->flac_stream.running)
+    {
+        capture_flac_stream_finish(&ctx_data->flac_stream);
+    }
+    capture_flac_encoder_close(ctx_data->flac_encoder);
+    ctx_data->flac_encoder = NULL;
+}
+
+/**
+ * @brief Starts compressing data_buffer on a background thread while audio is captured
+ *
+ * A .flac output file is then ready as soon as the capture stops. Failure is not fatal,
+ * only .wav output will be available for this capture.
+ */
+static void test_l3_start_flac_encoder(RMF_audio_capture_struct *ctx_data)
+{
+    uint16_t num_channels = 0;
+    uint32_t sampling_rate = 0;
+    uint16_t bits_per_sample = 0;
+
+    test_l3_release_flac_encoder(ctx_data);
+    if (RMF_SUCCESS != getValuesFromSettings(&ctx_data->settings, &num_channels, &sampling_rate, &bits_per_sample))
+    {
+        UT_LOG_DEBUG("Lossless encoding not available for the current settings");
+        return;
+    }
+    if (RMF_SUCCESS != capture_flac_encoder_open(&ctx_data->flac_encoder, num_channels, sampling_rate, bits_per_sample))
+    {
+        UT_LOG_ERROR("Error creating lossless encoder, .flac output will not be available");
+        ctx_data->flac_encoder = NULL;
+        return;
+    }
+    if (RMF_SUCCESS != capture_flac_stream_start(&ctx_data->flac_stream, ctx_data->flac_encoder, ctx_data->data_buffer, &ctx_data->bytes_received))
+    {
+        UT_LOG_ERROR("Error starting lossless encoder thread, .flac output will not be available");
+        capture_flac_encoder_close(ctx_data->flac_encoder);
+        ctx_data->flac_encoder = NULL;
+    }
+}
+
 /**
  * @brief Function to set RMF_AudioCapture_Settings as required for the tests.
  *
  * This function is called to set buffer ready callback and caller context data.
+ * When lossless is set the captured audio is also compressed during capture for .flac output.
  */
-static void test_l3_prepare_start_settings_for_data_tracking(void *context_blob)
+static rmf_Error test_l3_prepare_start_settings_for_data_tracking(void *context_blob, int32_t duration, bool lossless)
 {
     UT_LOG_INFO("Setting buffer saving cb buffer ready and caller context data");
     RMF_audio_capture_struct *ctx_data = (RMF_audio_capture_struct *)context_blob;
@@ -313,16 +475,17 @@ static void test_l3_prepare_start_settings_for_data_tracking(void *context_blob)
     uint16_t num_channels = 0;
     uint32_t sampling_rate = 0;
     uint16_t bits_per_sample = 0;
+    test_l3_release_flac_encoder(ctx_data);
+    if (ctx_data->data_buffer)
+    {
+        free(ctx_data->data_buffer);
+    }
     ctx_data->data_buffer = NULL;
     ctx_data->buffer_size = 0;
+    ctx_data->flac_requested = lossless;
 
-    int32_t choice;
-    UT_LOG_MENU_INFO("------------------------------------------");
-    UT_LOG_MENU_INFO("Enter test duration in seconds for data capture test :");
-    UT_LOG_MENU_INFO("------------------------------------------");
-    readInt(&choice);
-    ctx_data->data_capture_test_duration = choice;
-    if (choice <= 0) 
+    ctx_data->data_capture_test_duration = duration;
+    if (duration <= 0) 
     {
         UT_LOG_ERROR("Invalid test duration, choosing default of %d seconds", MEASUREMENT_WINDOW_SECONDS);
         ctx_data->data_capture_test_duration = MEASUREMENT_WINDOW_SECONDS;
@@ -338,13 +501,21 @@ static void test_l3_prepare_start_settings_for_data_tracking(void *context_blob)
     }
     /* Allocate buffer to store audio data */
     ctx_data->data_buffer = (unsigned char *)malloc(ctx_data->buffer_size);
+    ctx_data->bytes_received = 0;
     if (ctx_data->data_buffer == NULL)
     {
         UT_LOG_ERROR("Aborting test - Error allocating buffer to store audio data");
+        return RMF_ERROR;
     }
-    RMF_ASSERT(ctx_data->data_buffer != NULL);
-    
-    ctx_data->bytes_received = 0;
+    return RMF_SUCCESS;
+}
+
+/**
+ * @brief Names the capture of a context in the metrics records
+ */
+static const char *captureName(const RMF_audio_capture_struct *ctx_data)
+{
+    return (ctx_data == &gAudioCaptureData[0]) ? "primary" : "auxiliary";
 }
 
 /**
@@ -374,6 +545,18 @@ static rmf_Error validateBytesReceived(void *context_blob, int testedTime)
     double percentage_received = (double)ctx_data->bytes_received / (double)computed_bytes_received * 100;
     UT_LOG_DEBUG("Actual bytes received: %" PRIu32 ", Expected bytes received: %" PRIu64 ", Computed percentage: %f\n",
                  ctx_data->bytes_received, computed_bytes_received, percentage_received);
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "bytes", METRICS_TEST, captureName(ctx_data));
+        capture_json_add_uint(&record.writer, "seconds", (uint64_t)testedTime);
+        capture_json_add_uint(&record.writer, "bytes_received", ctx_data->bytes_received);
+        capture_json_add_uint(&record.writer, "bytes_expected", computed_bytes_received);
+        capture_json_add_double(&record.writer, "percentage", percentage_received);
+        capture_json_add_bool(&record.writer, "within_tolerance", (percentage_received > 90.0) && (percentage_received < 110.0));
+        capture_metrics_emit(&record);
+    }
     if ((percentage_received <= 90.0) || (percentage_received >= 110.0))
     {
         UT_LOG_DEBUG("Error: data delivery does not meet tolerance!");
@@ -396,7 +579,8 @@ static rmf_Error test_l3_write_wav_file(void *context_blob, const char *filename
     uint16_t num_channels = 0;
     uint32_t sampling_rate = 0;
     uint16_t bits_per_sample = 0;
-    uint32_t data_rate = 0;
+
+    test_l3_release_flac_encoder(ctx_data);
 
     /* Validate if acceptable level of bytes received first */
     if (RMF_SUCCESS != validateBytesReceived((void *)context_blob, ctx_data->data_capture_test_duration) )
@@ -416,11 +600,10 @@ static rmf_Error test_l3_write_wav_file(void *context_blob, const char *filename
         return RMF_ERROR;
     }
 
-    /* Start writing wav file  */
-    FILE *file = fopen(filename, "wb");
-    if (file == NULL) 
+    /* Write the WAV header and PCM data */
+    if (RMF_SUCCESS != capture_wav_write(filename, num_channels, sampling_rate, bits_per_sample, ctx_data->data_buffer, ctx_data->bytes_received))
     {
-        UT_LOG_ERROR("Error with fopen for output wav file");
+        UT_LOG_ERROR("Error writing output wav file");
         if(ctx_data->data_buffer) 
         {
             free(ctx_data->data_buffer);
@@ -428,32 +611,6 @@ static rmf_Error test_l3_write_wav_file(void *context_blob, const char *filename
         }
         return RMF_ERROR;
     }
-    uint32_t fmt_chunk_size = 16; // Size of the fmt chunk
-    uint16_t audio_format = 1;  // PCM format
-    
-    /* Write WAV Header first */
-    fwrite("RIFF", 1, 4, file);
-    uint32_t fileSize = 36 + ctx_data->bytes_received;
-    fwrite(&fileSize, 4, 1, file);
-    fwrite("WAVE", 1, 4, file);
-    fwrite("fmt ", 1, 4, file);
-    fwrite(&fmt_chunk_size, 4, 1, file);
-    fwrite(&audio_format, 2, 1, file);
-
-    data_rate = sampling_rate * num_channels * bits_per_sample / 8;
-    uint16_t block_align = num_channels * bits_per_sample / 8;
-    fwrite(&num_channels, 2, 1, file);
-    fwrite(&sampling_rate, 4, 1, file);
-    fwrite(&data_rate, 4, 1, file);
-    fwrite(&block_align, 2, 1, file);
-    fwrite(&bits_per_sample, 2, 1, file);
-    fwrite("data", 1, 4, file);
-    fwrite(&ctx_data->bytes_received, 4, 1, file);
-
-    /* Write PCM Data */
-    fwrite(ctx_data->data_buffer, 1, ctx_data->bytes_received, file);
-
-    fclose(file);
     if(ctx_data->data_buffer) 
     {
         free(ctx_data->data_buffer);
@@ -463,6 +620,85 @@ static rmf_Error test_l3_write_wav_file(void *context_blob, const char *filename
     return RMF_SUCCESS;
 }
 
+/**
+ * @brief Function to write captured audio data to a lossless FLAC file
+ *
+ * The audio was compressed while it was captured, this function finishes the stream,
+ * writes it and decodes it again to confirm it reproduces the captured samples exactly.
+ */
+static rmf_Error test_l3_write_flac_file(void *context_blob, const char *filename)
+{
+    UT_LOG_INFO("Called test_l3_write_flac_file with output file name %s", filename);
+    RMF_audio_capture_struct *ctx_data = (RMF_audio_capture_struct *)context_blob;
+    rmf_Error result = RMF_SUCCESS;
+    uint64_t pcm_bytes = 0;
+    uint64_t flac_bytes = 0;
+
+    /* Validate if acceptable level of bytes received first */
+    if (RMF_SUCCESS != validateBytesReceived((void *)context_blob, ctx_data->data_capture_test_duration) )
+    {
+        UT_LOG_ERROR ("Bytes received is not in acceptable levels. Output file will not be created !");
+        result = RMF_ERROR;
+    }
+    else if (ctx_data->flac_encoder == NULL)
+    {
+        UT_LOG_ERROR("Lossless encoder was not running for this capture, select data capture with lossless output. Output file will not be created !");
+        result = RMF_ERROR;
+    }
+    else
+    {
+        result = capture_flac_stream_finish(&ctx_data->flac_stream);
+        if (RMF_SUCCESS == result)
+        {
+            result = capture_flac_encoder_save(ctx_data->flac_encoder, filename);
+        }
+        if (RMF_SUCCESS != result)
+        {
+            UT_LOG_ERROR("Error writing output flac file");
+        }
+    }
+
+    if (RMF_SUCCESS == result)
+    {
+        capture_flac_encoder_sizes(ctx_data->flac_encoder, &pcm_bytes, &flac_bytes);
+        UT_LOG_INFO("Result flac.pcm_bytes:[%" PRIu64 "] flac.flac_bytes:[%" PRIu64 "] flac.ratio:[%.3f]",
+                    pcm_bytes, flac_bytes, (pcm_bytes > 0) ? (double)flac_bytes / (double)pcm_bytes : 0.0);
+
+        /* The encoder only consumes whole PCM frames, verify against what it was given */
+        result = capture_flac_verify(filename, ctx_data->data_buffer, (size_t)pcm_bytes);
+        if (RMF_SUCCESS != result)
+        {
+            UT_LOG_ERROR("Decoded %s does not match the captured audio", filename);
+        }
+    }
+
+    test_l3_release_flac_encoder(ctx_data);
+    if(ctx_data->data_buffer)
+    {
+        free(ctx_data->data_buffer);
+        ctx_data->data_buffer = NULL;
+    }
+    if (RMF_SUCCESS == result)
+    {
+        UT_LOG_INFO("test_l3_write_flac_file created output file : %s", filename);
+    }
+    return result;
+}
+
+/**
+ * @brief Writes the captured audio as FLAC when filename ends with .flac, otherwise as WAV
+ */
+static rmf_Error test_l3_write_capture_file(void *context_blob, const char *filename)
+{
+    const char *ext = strrchr(filename, '.');
+
+    if ((ext != NULL) && (strcmp(ext, ".flac") == 0))
+    {
+        return test_l3_write_flac_file(context_blob, filename);
+    }
+    return test_l3_write_wav_file(context_blob, filename);
+}
+
 /**
  * @brief Function to monitor bytes received to detect jitter
  *
@@ -475,8 +711,11 @@ static void* monitorBufferCount(void* context_blob)
 
     uint32_t bytes_received = 0;
     uint32_t difference_in_bytes = 0;
-    time_t start_time = time(NULL);
-    time_t end_time = start_time + ctx_data->jitter_test_duration;
+    uint32_t min_bytes = UINT32_MAX;
+    uint64_t windows = 0;
+    bool jitter = false;
+    uint64_t end_ns = capture_clock_now_ns() + (uint64_t)ctx_data->jitter_test_duration * 1000000000ull;
+    capture_metrics_record_t record;
 
     rmf_Error *result = malloc (sizeof(rmf_Error));
     if (result == NULL)
@@ -484,21 +723,51 @@ static void* monitorBufferCount(void* context_blob)
         UT_LOG_ERROR ("malloc for storing rmf_Error failed, refer prints to confirm if jitter test passed");
     }
 
-    while ((ctx_data->cookie == 1) && (time(NULL) < end_time))
+    while ((ctx_data->cookie == 1) && (capture_clock_now_ns() < end_ns))
     {
         difference_in_bytes = ctx_data->bytes_received - bytes_received;
+        if (difference_in_bytes < min_bytes)
+        {
+            min_bytes = difference_in_bytes;
+        }
+        if (capture_metrics_enabled())
+        {
+            capture_metrics_begin(&record, "window", METRICS_TEST, captureName(ctx_data));
+            capture_json_add_uint(&record.writer, "window", windows);
+            capture_json_add_uint(&record.writer, "bytes", difference_in_bytes);
+            capture_json_add_int(&record.writer, "threshold", ctx_data->jitter_threshold);
+            capture_json_add_int(&record.writer, "interval_us", ctx_data->jitter_monitor_sleep_interval);
+            capture_metrics_emit(&record);
+        }
+        windows++;
         if (difference_in_bytes < ctx_data->jitter_threshold) 
         {
             UT_LOG_INFO ("Bytes received in last iteration : %d. This is less than threshold level of %d bytes.\n", difference_in_bytes, ctx_data->jitter_threshold);
             UT_LOG_ERROR ("Jitter detected !");
-            *result = RMF_ERROR;
-            return (void *)result;
+            jitter = true;
+            break;
         }
         bytes_received = ctx_data->bytes_received;
-        usleep (ctx_data->jitter_monitor_sleep_interval);
+        capture_clock_sleep_ns((uint64_t)ctx_data->jitter_monitor_sleep_interval * 1000ull);
+    }
+    if (!jitter)
+    {
+        UT_LOG_INFO("No jitter detected");
+    }
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_begin(&record, "jitter", METRICS_TEST, captureName(ctx_data));
+        capture_json_add_uint(&record.writer, "windows", windows);
+        capture_json_add_uint(&record.writer, "min_bytes", (windows > 0) ? min_bytes : 0);
+        capture_json_add_int(&record.writer, "threshold", ctx_data->jitter_threshold);
+        capture_json_add_int(&record.writer, "interval_us", ctx_data->jitter_monitor_sleep_interval);
+        capture_json_add_bool(&record.writer, "jitter", jitter);
+        capture_metrics_emit(&record);
+    }
+    if (result != NULL)
+    {
+        *result = jitter ? RMF_ERROR : RMF_SUCCESS;
     }
-    UT_LOG_INFO("No jitter detected");
-    *result = RMF_SUCCESS;
     return (void *)result;
 }
 
@@ -530,42 +799,14 @@ static int getAudioCaptureType(void)
 }
 
 /**
-* @brief This test opens the audio capture interface
-*
-* This test function opens the audio capture interface and gets a handle.
-*
-* **Test Group ID:** 03@n
-* **Test Case ID:** 001@n
-*
-* **Test Procedure:**
-* Refer to UT specification documentation [rmf-audio-capture_L3-Low-Level_TestSpecification.md](../docs/pages/rmf-audio-capture_L3-Low-Level_TestSpecification.md)
-*/
-void test_l3_rmfAudioCapture_open_handle(void)
+ * @brief Opens the audio capture interface for the given capture index
+ *
+ * Shared by the interactive menu and the control channel.
+ */
+static rmf_Error test_l3_open_capture(int audioCaptureIndex)
 {
-    gTestID = 1;
-
-    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
-
     rmf_Error result = RMF_SUCCESS;
-    RMF_AudioCaptureType rmfAcType = RMF_AC_TYPE_PRIMARY;
-    int32_t choice = getAudioCaptureType();
-    int audioCaptureIndex = choice - 1; //0 - primary, 1 - auxiliary
-
-    switch(choice)
-    {
-        case 1:
-        {
-            rmfAcType = RMF_AC_TYPE_PRIMARY;
-            break;
-        }
-        case 2:
-        {
-            rmfAcType = RMF_AC_TYPE_AUXILIARY;
-            break;
-        }
-        default :
-            UT_LOG_ERROR("Invalid handle choice\n");
-    }
+    RMF_AudioCaptureType rmfAcType = (audioCaptureIndex == 0) ? RMF_AC_TYPE_PRIMARY : RMF_AC_TYPE_AUXILIARY;
 
     UT_LOG_INFO("Calling RMF_AudioCapture_Open_Type(IN:captureType:[%s] OUT:handle:[])", rmfAcType);
     result = RMF_AudioCapture_Open_Type(&gAudioCaptureData[audioCaptureIndex].handle, rmfAcType);
@@ -573,81 +814,573 @@ void test_l3_rmfAudioCapture_open_handle(void)
     if ((RMF_SUCCESS != result) || (gAudioCaptureData[audioCaptureIndex].handle == NULL))
     {
         UT_LOG_ERROR("Aborting test - unable to open capture.");
+        return (RMF_SUCCESS != result) ? result : RMF_ERROR;
     }
-    RMF_ASSERT(RMF_SUCCESS == result);
-    RMF_ASSERT(NULL != gAudioCaptureData[audioCaptureIndex].handle);
-
-    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+    return RMF_SUCCESS;
 }
 
 /**
-* @brief This test gets default values of RMF_AudioCapture_Settings and allows values to be updated.
-*
-* This test function gets default values of RMF_AudioCapture_Settings and allows values to be updated.
-*
-* **Test Group ID:** 03@n
-* **Test Case ID:** 002@n
-*
-* **Test Procedure:**
-* Refer to UT specification documentation [rmf-audio-capture_L3-Low-Level_TestSpecification.md](../docs/pages/rmf-audio-capture_L3-Low-Level_TestSpecification.md)
-*/
-void test_l3_rmfAudioCapture_update_settings(void)
+ * @brief Loads default settings for the given capture index
+ */
+static rmf_Error test_l3_load_default_settings(int audioCaptureIndex)
 {
-    gTestID = 2;
-
-    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
-
     rmf_Error result = RMF_SUCCESS;
-    int32_t choice = getAudioCaptureType();
-    int audioCaptureIndex = choice - 1; //0 - primary, 1 - auxiliary
 
     UT_LOG_INFO("Calling RMF_AudioCapture_GetDefaultSettings(OUT:settings:[])");
     result = RMF_AudioCapture_GetDefaultSettings(&gAudioCaptureData[audioCaptureIndex].settings);
     UT_LOG_INFO("Result RMF_AudioCapture_GetDefaultSettings(OUT:settings:[0x%0X]) rmf_error:[%s]", &gAudioCaptureData[audioCaptureIndex].settings, UT_Control_GetMapString(rmfError_mapTable, result));
-    RMF_ASSERT(result == RMF_SUCCESS);
+    return result;
+}
 
-    UT_LOG_MENU_INFO("------------------------------------------");
-    UT_LOG_MENU_INFO("Current values in settings :");
-    UT_LOG_MENU_INFO("------------------------------------------");
-    UT_LOG_MENU_INFO("\t#   %-20s  %s","Settings", "Default Values");
-    UT_LOG_MENU_INFO("\t1.  %-20s  %s","Capture Format", UT_Control_GetMapString(racFormatMappingTable, gAudioCaptureData[audioCaptureIndex].settings.format));
-    UT_LOG_MENU_INFO("\t2.  %-20s  %s","Sampling Frequency", UT_Control_GetMapString(racFreqMappingTable, gAudioCaptureData[audioCaptureIndex].settings.samplingFreq));
-    UT_LOG_MENU_INFO("\t3.  %-20s  %d","FIFO size", gAudioCaptureData[audioCaptureIndex].settings.fifoSize);
-    UT_LOG_MENU_INFO("\t4.  %-20s  %d","Threshold", gAudioCaptureData[audioCaptureIndex].settings.threshold);
-    UT_LOG_MENU_INFO("------------------------------------------");
-    UT_LOG_MENU_INFO(" Do you want to update default settings ? (0 for No, 1 for Yes)");
-    readInt(&choice);
+/**
+ * @brief Updates settings for the given capture index, -1 retains the current value
+ *
+ * All values are validated before any of them is applied.
+ */
+static rmf_Error test_l3_apply_settings(int audioCaptureIndex, int32_t format, int32_t samplingFreq, int32_t fifoSize, int32_t threshold)
+{
+    RMF_AudioCapture_Settings *settings = &gAudioCaptureData[audioCaptureIndex].settings;
 
-    switch(choice)
+    if ((format != -1) && (format < racFormat_e16BitStereo || format >= racFormat_eMax))
+    {
+        UT_LOG_ERROR("Invalid Capture format %d", format);
+        return RMF_INVALID_PARM;
+    }
+    if ((samplingFreq != -1) && (samplingFreq < racFreq_e16000 || samplingFreq >= racFreq_eMax))
+    {
+        UT_LOG_ERROR("Invalid Sampling Rate %d", samplingFreq);
+        return RMF_INVALID_PARM;
+    }
+    if ((fifoSize != -1) && (fifoSize <= 0))
+    {
+        UT_LOG_ERROR("Invalid FIFO size %d", fifoSize);
+        return RMF_INVALID_PARM;
+    }
+    if ((threshold != -1) && (threshold <= 0))
+    {
+        UT_LOG_ERROR("Invalid threshold size %d", threshold);
+        return RMF_INVALID_PARM;
+    }
+
+    if (format != -1)
+    {
+        settings->format = format;
+    }
+    if (samplingFreq != -1)
+    {
+        settings->samplingFreq = samplingFreq;
+    }
+    if (fifoSize != -1)
+    {
+        settings->fifoSize = fifoSize;
+    }
+    if (threshold != -1)
+    {
+        settings->threshold = threshold;
+    }
+    return RMF_SUCCESS;
+}
+
+/**
+ * @brief Sets up the buffer ready callback for the type of test (1 - byte counting, 2 - data capture, 3 - data capture with .flac output)
+ */
+static rmf_Error test_l3_setup_test_type(int audioCaptureIndex, int32_t testType, int32_t duration)
+{
+    switch(testType)
     {
-        case 0:
-        {
-            UT_LOG_INFO("Using above default values for settings");
-            break;
-        }
         case 1:
-        {
-            UT_LOG_MENU_INFO("------------------------------------------");
-            UT_LOG_MENU_INFO("\t\t Supported RMF Audio Capture Formats ");
-            UT_LOG_MENU_INFO("------------------------------------------");
-            UT_LOG_MENU_INFO("\t#   %-30s","Capture format");
-            for(int32_t i = racFormat_e16BitStereo; i < racFormat_eMax; i++)
-            {
-                UT_LOG_MENU_INFO("\t%d.  %-30s", i, UT_Control_GetMapString(racFormatMappingTable, i));
-            }
-            UT_LOG_MENU_INFO("------------------------------------------");
-            UT_LOG_MENU_INFO(" Select the capture format to update, use -1 to retain default value :");
-            readInt(&choice);
+            test_l3_prepare_start_settings_for_data_counting(&gAudioCaptureData[audioCaptureIndex]);
+            return RMF_SUCCESS;
+        case 2:
+            return test_l3_prepare_start_settings_for_data_tracking(&gAudioCaptureData[audioCaptureIndex], duration, false);
+        case 3:
+            return test_l3_prepare_start_settings_for_data_tracking(&gAudioCaptureData[audioCaptureIndex], duration, true);
+        default :
+            UT_LOG_ERROR("Invalid callback type choice, callback not set up\n");
+            return RMF_INVALID_PARM;
+    }
+}
 
-            if (choice != -1)
-            {
-                if(choice < racFormat_e16BitStereo || choice >= racFormat_eMax)
-                {
-                    UT_LOG_ERROR("Invalid Capture format, try again");
-                    break;
-                }
-                gAudioCaptureData[audioCaptureIndex].settings.format = choice;
+/**
+ * @brief Resets the level meter for the current settings, metering is skipped for unsupported formats
+ */
+static void test_l3_start_meter(RMF_audio_capture_struct *ctx_data)
+{
+    uint16_t num_channels = 0;
+    uint32_t sampling_rate = 0;
+    uint16_t bits_per_sample = 0;
+
+    ctx_data->meter_active = false;
+    if ((RMF_SUCCESS == getValuesFromSettings(&ctx_data->settings, &num_channels, &sampling_rate, &bits_per_sample)) &&
+        (RMF_SUCCESS == capture_meter_init(&ctx_data->meter, num_channels, sampling_rate, bits_per_sample, CAPTURE_METER_WINDOW_MS)))
+    {
+        ctx_data->meter_active = true;
+    }
+}
+
+/**
+ * @brief Resets the clock drift estimator for the current settings
+ */
+static void test_l3_start_drift_estimator(RMF_audio_capture_struct *ctx_data)
+{
+    uint16_t num_channels = 0;
+    uint32_t sampling_rate = 0;
+    uint16_t bits_per_sample = 0;
+
+    ctx_data->drift_active = false;
+    if ((RMF_SUCCESS == getValuesFromSettings(&ctx_data->settings, &num_channels, &sampling_rate, &bits_per_sample)) &&
+        (RMF_SUCCESS == capture_drift_init(&ctx_data->drift, num_channels, sampling_rate, bits_per_sample)))
+    {
+        ctx_data->drift_active = true;
+    }
+}
+
+/**
+ * @brief Logs the drift of the capture clock, and of the two capture clocks relative to each other when both have run
+ */
+static void test_l3_log_drift(int audioCaptureIndex)
+{
+    capture_drift_estimate_t estimate;
+    capture_drift_estimate_t other;
+    int otherIndex = 1 - audioCaptureIndex;
+    capture_metrics_record_t record;
+
+    if (!gAudioCaptureData[audioCaptureIndex].drift_active ||
+        (RMF_SUCCESS != capture_drift_estimate(&gAudioCaptureData[audioCaptureIndex].drift, &estimate)))
+    {
+        return;
+    }
+    UT_LOG_INFO("Result drift.rate_hz:[%.3f] drift.ppm:[%.2f] drift.ci_ppm:[%.2f] drift.points:[%" PRIu64 "] drift.seconds:[%.1f]",
+                estimate.rate_hz, estimate.ppm, estimate.ci_ppm, estimate.points, estimate.seconds);
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_begin(&record, "drift", METRICS_TEST, captureName(&gAudioCaptureData[audioCaptureIndex]));
+        capture_json_add_double(&record.writer, "rate_hz", estimate.rate_hz);
+        capture_json_add_double(&record.writer, "ppm", estimate.ppm);
+        capture_json_add_double(&record.writer, "ci_ppm", estimate.ci_ppm);
+        capture_json_add_uint(&record.writer, "points", estimate.points);
+        capture_json_add_double(&record.writer, "seconds", estimate.seconds);
+        capture_metrics_emit(&record);
+    }
+    if (gAudioCaptureData[otherIndex].drift_active &&
+        (RMF_SUCCESS == capture_drift_estimate(&gAudioCaptureData[otherIndex].drift, &other)))
+    {
+        UT_LOG_INFO("Result drift.relative_ppm:[%.2f] drift.relative_ci_ppm:[%.2f]",
+                    estimate.ppm - other.ppm, sqrt(estimate.ci_ppm * estimate.ci_ppm + other.ci_ppm * other.ci_ppm));
+        if (capture_metrics_enabled())
+        {
+            capture_metrics_begin(&record, "relative_drift", METRICS_TEST, captureName(&gAudioCaptureData[audioCaptureIndex]));
+            capture_json_add_double(&record.writer, "ppm", estimate.ppm - other.ppm);
+            capture_json_add_double(&record.writer, "ci_ppm", sqrt(estimate.ci_ppm * estimate.ci_ppm + other.ci_ppm * other.ci_ppm));
+            capture_metrics_emit(&record);
+        }
+    }
+}
+
+/**
+ * @brief Logs the levels of the last window and the metering cost
+ */
+static void test_l3_log_levels(int audioCaptureIndex)
+{
+    capture_meter_snapshot_t levels;
+    capture_metrics_record_t record;
+
+    if (!gAudioCaptureData[audioCaptureIndex].meter_active)
+    {
+        return;
+    }
+    capture_meter_snapshot(&gAudioCaptureData[audioCaptureIndex].meter, &levels);
+    for (uint16_t c = 0; c < levels.channels; c++)
+    {
+        UT_LOG_INFO("Result meter.channel:[%u] meter.rms_dbfs:[%.1f] meter.peak_dbfs:[%.1f] meter.dc_offset:[%.5f] meter.clipped:[%" PRIu64 "]",
+                    c, capture_meter_dbfs(levels.channel[c].rms), capture_meter_dbfs(levels.channel[c].peak),
+                    levels.channel[c].dc_offset, levels.channel[c].clipped_total);
+        if (capture_metrics_enabled())
+        {
+            capture_metrics_begin(&record, "level", METRICS_TEST, captureName(&gAudioCaptureData[audioCaptureIndex]));
+            capture_json_add_uint(&record.writer, "channel", c);
+            capture_json_add_double(&record.writer, "rms_dbfs", capture_meter_dbfs(levels.channel[c].rms));
+            capture_json_add_double(&record.writer, "peak_dbfs", capture_meter_dbfs(levels.channel[c].peak));
+            capture_json_add_double(&record.writer, "dc_offset", levels.channel[c].dc_offset);
+            capture_json_add_uint(&record.writer, "clipped", levels.channel[c].clipped_total);
+            capture_metrics_emit(&record);
+        }
+    }
+    UT_LOG_INFO("Result meter.buffers:[%" PRIu64 "] meter.load:[%.5f] meter.max_load:[%.5f]", levels.buffers, levels.load, levels.max_load);
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_begin(&record, "meter", METRICS_TEST, captureName(&gAudioCaptureData[audioCaptureIndex]));
+        capture_json_add_uint(&record.writer, "buffers", levels.buffers);
+        capture_json_add_double(&record.writer, "load", levels.load);
+        capture_json_add_double(&record.writer, "max_load", levels.max_load);
+        capture_metrics_emit(&record);
+    }
+    if (levels.load > CAPTURE_METER_MAX_LOAD)
+    {
+        UT_LOG_ERROR("Level metering used %.2f%% of the callback period, limit is %.2f%%", levels.load * 100.0, CAPTURE_METER_MAX_LOAD * 100.0);
+    }
+}
+
+/**
+ * @brief Resets the glitch detector for the current settings, detection is skipped for unsupported formats
+ */
+static void test_l3_start_glitch_detector(RMF_audio_capture_struct *ctx_data)
+{
+    uint16_t num_channels = 0;
+    uint32_t sampling_rate = 0;
+    uint16_t bits_per_sample = 0;
+
+    ctx_data->glitch_active = false;
+    if ((RMF_SUCCESS == getValuesFromSettings(&ctx_data->settings, &num_channels, &sampling_rate, &bits_per_sample)) &&
+        (RMF_SUCCESS == capture_glitch_init(&ctx_data->glitch, num_channels, sampling_rate, bits_per_sample)))
+    {
+        ctx_data->glitch_active = true;
+    }
+}
+
+/**
+ * @brief Closes any open glitch and logs the glitches found during capture
+ */
+static void test_l3_log_glitches(int audioCaptureIndex)
+{
+    RMF_audio_capture_struct *ctx_data = &gAudioCaptureData[audioCaptureIndex];
+    capture_glitch_event_t events[CAPTURE_GLITCH_MAX_EVENTS];
+    size_t count;
+
+    if (!ctx_data->glitch_active)
+    {
+        return;
+    }
+    capture_glitch_finish(&ctx_data->glitch);
+    count = capture_glitch_events(&ctx_data->glitch, events, CAPTURE_GLITCH_MAX_EVENTS);
+    for (size_t i = 0; i < count; i++)
+    {
+        UT_LOG_INFO("Glitch %s at frame %" PRIu64 " (buffer %" PRIu64 ", %.3f s): channel %u, length %" PRIu64 ", lag %u, magnitude %.3f",
+                    capture_glitch_type_name(events[i].type), events[i].frame, events[i].buffer, (double)events[i].time_ns / 1e9,
+                    events[i].channel, events[i].length, events[i].lag, events[i].magnitude);
+    }
+    UT_LOG_INFO("Result glitch.discontinuities:[%" PRIu64 "] glitch.silences:[%" PRIu64 "] glitch.repeats:[%" PRIu64 "]",
+                capture_glitch_count(&ctx_data->glitch, CAPTURE_GLITCH_DISCONTINUITY),
+                capture_glitch_count(&ctx_data->glitch, CAPTURE_GLITCH_SILENCE),
+                capture_glitch_count(&ctx_data->glitch, CAPTURE_GLITCH_REPEAT));
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "glitches", METRICS_TEST, captureName(ctx_data));
+        capture_json_add_uint(&record.writer, "discontinuities", capture_glitch_count(&ctx_data->glitch, CAPTURE_GLITCH_DISCONTINUITY));
+        capture_json_add_uint(&record.writer, "silences", capture_glitch_count(&ctx_data->glitch, CAPTURE_GLITCH_SILENCE));
+        capture_json_add_uint(&record.writer, "repeats", capture_glitch_count(&ctx_data->glitch, CAPTURE_GLITCH_REPEAT));
+        capture_metrics_emit(&record);
+    }
+}
+
+/**
+ * @brief Starts audio capture for the given capture index, closing the handle on failure
+ */
+static rmf_Error test_l3_start_capture(int audioCaptureIndex)
+{
+    rmf_Error result = RMF_SUCCESS;
+
+    test_l3_start_meter(&gAudioCaptureData[audioCaptureIndex]);
+    test_l3_start_drift_estimator(&gAudioCaptureData[audioCaptureIndex]);
+    gAudioCaptureData[audioCaptureIndex].glitch_active = false;
+    if ((gAudioCaptureData[audioCaptureIndex].settings.cbBufferReady == test_l3_tracking_data_cb) &&
+        (gAudioCaptureData[audioCaptureIndex].data_buffer != NULL))
+    {
+        test_l3_start_glitch_detector(&gAudioCaptureData[audioCaptureIndex]);
+        if (gAudioCaptureData[audioCaptureIndex].flac_requested)
+        {
+            test_l3_start_flac_encoder(&gAudioCaptureData[audioCaptureIndex]);
+        }
+    }
+    capture_telemetry_reset(&gAudioCaptureData[audioCaptureIndex].telemetry);
+
+    UT_LOG_INFO("Calling RMF_AudioCapture_Start(IN:handle[0x%0X] settings:[0x%0X])", &gAudioCaptureData[audioCaptureIndex].handle, &gAudioCaptureData[audioCaptureIndex].settings);
+    result = RMF_AudioCapture_Start(gAudioCaptureData[audioCaptureIndex].handle, &gAudioCaptureData[audioCaptureIndex].settings);
+    UT_LOG_INFO("Result RMF_AudioCapture_Start(IN:handle[0x%0X] settings:[0x%0X] OUT:rmf_error:[%s]", &gAudioCaptureData[audioCaptureIndex].handle, &gAudioCaptureData[audioCaptureIndex].settings, UT_Control_GetMapString(rmfError_mapTable, result));
+    if (RMF_SUCCESS != result)
+    {
+        UT_LOG_DEBUG("Capture start failed with error code: %d", result);
+        RMF_AudioCapture_Close(gAudioCaptureData[audioCaptureIndex].handle);
+        test_l3_release_flac_encoder(&gAudioCaptureData[audioCaptureIndex]);
+        if(gAudioCaptureData[audioCaptureIndex].data_buffer)
+        {
+            free(gAudioCaptureData[audioCaptureIndex].data_buffer);
+            gAudioCaptureData[audioCaptureIndex].data_buffer = NULL;
+        }
+        UT_LOG_ERROR("Aborting test - unable to start capture.");
+        return result;
+    }
+    capture_telemetry_attach(&gAudioCaptureData[audioCaptureIndex].telemetry, gAudioCaptureData[audioCaptureIndex].handle);
+    return result;
+}
+
+/**
+ * @brief Starts the jitter monitor thread, values <= 0 select the defaults
+ */
+static rmf_Error test_l3_start_jitter_monitor(int audioCaptureIndex, int32_t threshold, int32_t interval, int32_t duration)
+{
+    RMF_audio_capture_struct *ctx_data = &gAudioCaptureData[audioCaptureIndex];
+
+    if(threshold <= 0)
+    {
+        UT_LOG_ERROR("Invalid threshold size, retaining value : %d", ctx_data->jitter_threshold);
+    }
+    else
+    {
+        ctx_data->jitter_threshold = threshold;
+    }
+
+    ctx_data->jitter_monitor_sleep_interval = interval;
+    if(interval <= 0)
+    {
+        ctx_data->jitter_monitor_sleep_interval = MONITOR_JITTER_MICROSECONDS;
+        UT_LOG_ERROR("Invalid sleep interval, setting a default value of %d microseconds", ctx_data->jitter_monitor_sleep_interval);
+    }
+
+    ctx_data->jitter_test_duration = duration;
+    if(duration <= 0)
+    {
+        ctx_data->jitter_test_duration = MEASUREMENT_WINDOW_2MINUTES;
+        UT_LOG_ERROR("Invalid test duration, setting a default value of %d seconds", ctx_data->jitter_test_duration);
+    }
+
+    if (pthread_create(&ctx_data->jitter_thread_id, NULL, monitorBufferCount, (void *)ctx_data) != 0)
+    {
+        UT_LOG_ERROR("Aborting test - Failed to create monitor thread");
+        return RMF_ERROR;
+    }
+    return RMF_SUCCESS;
+}
+
+/**
+ * @brief Waits for the jitter monitor thread and returns its verdict in jitter_result
+ *
+ * @return RMF_ERROR if the thread could not be joined or returned no verdict
+ */
+static rmf_Error test_l3_get_jitter_result(int audioCaptureIndex, rmf_Error *jitter_result)
+{
+    void *ret_value = NULL;
+
+    if (pthread_join(gAudioCaptureData[audioCaptureIndex].jitter_thread_id, &ret_value) != 0)
+    {
+        UT_LOG_INFO("Error joining monitor thread");
+        return RMF_ERROR;
+    }
+    if (ret_value == NULL)
+    {
+        UT_LOG_INFO("Thread ret_value NULL, unable to assert for jitter check. Refer prints to confirm if test passed");
+        return RMF_ERROR;
+    }
+    *jitter_result = *(rmf_Error *)ret_value;
+    if (*jitter_result != RMF_SUCCESS)
+    {
+        UT_LOG_ERROR("Jitter Detected !");
+    }
+    free(ret_value);
+    return RMF_SUCCESS;
+}
+
+/**
+ * @brief Stops audio capture and checks that no callbacks arrive afterwards
+ */
+static rmf_Error test_l3_stop_capture(int audioCaptureIndex)
+{
+    rmf_Error result = RMF_SUCCESS;
+
+    capture_telemetry_detach(&gAudioCaptureData[audioCaptureIndex].telemetry);
+    UT_LOG_INFO("Calling RMF_AudioCapture_Stop(IN:handle:[0x%0X])", &gAudioCaptureData[audioCaptureIndex].handle);
+    result = RMF_AudioCapture_Stop(gAudioCaptureData[audioCaptureIndex].handle);
+    UT_LOG_INFO("Result RMF_AudioCapture_Stop(IN:handle:[0x%0X] OUT:rmf_error:[%s]", &gAudioCaptureData[audioCaptureIndex].handle, UT_Control_GetMapString(rmfError_mapTable, result));
+    gAudioCaptureData[audioCaptureIndex].cookie = 0;
+    if (result != RMF_SUCCESS)
+    {
+        return result;
+    }
+
+    capture_clock_sleep_ns(1000000000ull); // Wait for the last callback to be processed
+    if (gAudioCaptureData[audioCaptureIndex].cookie != 0)
+    {
+        UT_LOG_ERROR("Callback received after RMF_AudioCapture_Stop returned");
+        return RMF_ERROR;
+    }
+    test_l3_log_levels(audioCaptureIndex);
+    test_l3_log_glitches(audioCaptureIndex);
+    test_l3_log_drift(audioCaptureIndex);
+    return RMF_SUCCESS;
+}
+
+/**
+ * @brief Closes the audio capture interface for the given capture index
+ */
+static rmf_Error test_l3_close_capture(int audioCaptureIndex)
+{
+    rmf_Error result = RMF_SUCCESS;
+    capture_shm_t *shm;
+
+    UT_LOG_INFO("Calling RMF_AudioCapture_Close(IN:handle:[0x%0X])", &gAudioCaptureData[audioCaptureIndex].handle);
+    result = RMF_AudioCapture_Close(gAudioCaptureData[audioCaptureIndex].handle);
+    UT_LOG_INFO("Result RMF_AudioCapture_Close(IN:handle:[0x%0X] OUT:rmf_error:[%s]", &gAudioCaptureData[audioCaptureIndex].handle, UT_Control_GetMapString(rmfError_mapTable, result));
+    /* A HAL may still be returning from a last callback, it no longer sees the ring once it is cleared */
+    shm = __atomic_exchange_n(&gAudioCaptureData[audioCaptureIndex].shm, NULL, __ATOMIC_SEQ_CST);
+    if (shm != NULL)
+    {
+        while (__atomic_load_n(&gAudioCaptureData[audioCaptureIndex].shm_users, __ATOMIC_ACQUIRE) != 0)
+        {
+            sched_yield();
+        }
+        UT_LOG_INFO("Exported %llu buffers through shared memory", (unsigned long long)capture_shm_published(shm));
+        capture_shm_destroy(shm);
+    }
+    if (gAudioCaptureData[audioCaptureIndex].trace_active)
+    {
+        gAudioCaptureData[audioCaptureIndex].trace_active = false;
+        capture_trace_release(&gAudioCaptureData[audioCaptureIndex].trace);
+    }
+    return result;
+}
+
+/**
+ * @brief Compares a captured wav file with its reference and logs the result
+ */
+static rmf_Error test_l3_analyse_wav_files(const char *reference, const char *capture, double min_pitch_agreement, double min_spectral_similarity, capture_analysis_result_t *analysis)
+{
+    const char *cacheDir = getenv(CAPTURE_ANALYSIS_CACHE_ENV);
+    char referenceDir[PATH_MAX];
+    struct timespec begin, end;
+    rmf_Error result;
+
+    /* Reference features are cached next to the reference streams unless a cache directory is given */
+    if (cacheDir == NULL)
+    {
+        snprintf(referenceDir, sizeof(referenceDir), "%s", reference);
+        cacheDir = dirname(referenceDir);
+    }
+
+    UT_LOG_INFO("Comparing captured file [%s] with reference [%s]", capture, reference);
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    result = capture_analysis_compare_files(reference, capture, cacheDir, min_pitch_agreement, min_spectral_similarity, analysis);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (result != RMF_SUCCESS)
+    {
+        UT_LOG_ERROR("Unable to analyse wav files rmf_error:[%s]", UT_Control_GetMapString(rmfError_mapTable, result));
+        return result;
+    }
+    UT_LOG_INFO("Result analysis.reference_cached:[%s] analysis.elapsed_ms:[%.0f]", analysis->reference_cached ? "true" : "false",
+                (double)(end.tv_sec - begin.tv_sec) * 1e3 + (double)(end.tv_nsec - begin.tv_nsec) / 1e6);
+    UT_LOG_INFO("Result analysis.frames:[%zu] analysis.delay_samples:[%lld] analysis.xcorr_peak:[%.3f]", analysis->frames, (long long)analysis->delay_samples, analysis->xcorr_peak);
+    UT_LOG_INFO("Result analysis.reference_hz:[%.1f] analysis.capture_hz:[%.1f] analysis.pitch_correlation:[%.3f]", analysis->reference_hz, analysis->capture_hz, analysis->pitch_correlation);
+    UT_LOG_INFO("Result analysis.pitch_agreement:[%.3f] analysis.spectral_similarity:[%.3f]", analysis->pitch_agreement, analysis->spectral_similarity);
+    UT_LOG_INFO("Result analysis.match:[%s]", analysis->match ? "true" : "false");
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        capture_metrics_begin(&record, "analysis", METRICS_TEST, NULL);
+        capture_json_add_string(&record.writer, "reference", reference);
+        capture_json_add_double(&record.writer, "pitch_agreement", analysis->pitch_agreement);
+        capture_json_add_double(&record.writer, "spectral_similarity", analysis->spectral_similarity);
+        capture_json_add_int(&record.writer, "delay_samples", analysis->delay_samples);
+        capture_json_add_double(&record.writer, "reference_hz", analysis->reference_hz);
+        capture_json_add_double(&record.writer, "capture_hz", analysis->capture_hz);
+        capture_json_add_bool(&record.writer, "reference_cached", analysis->reference_cached);
+        capture_json_add_double(&record.writer, "elapsed_ms", (double)(end.tv_sec - begin.tv_sec) * 1e3 + (double)(end.tv_nsec - begin.tv_nsec) / 1e6);
+        capture_json_add_bool(&record.writer, "match", analysis->match);
+        capture_metrics_emit(&record);
+    }
+    return RMF_SUCCESS;
+}
+
+/**
+* @brief This test opens the audio capture interface
+*
+* This test function opens the audio capture interface and gets a handle.
+*
+* **Test Group ID:** 03@n
+* **Test Case ID:** 001@n
+*
+* **Test Procedure:**
+* Refer to UT specification documentation [rmf-audio-capture_L3-Low-Level_TestSpecification.md](../docs/pages/rmf-audio-capture_L3-Low-Level_TestSpecification.md)
+*/
+void test_l3_rmfAudioCapture_open_handle(void)
+{
+    gTestID = 1;
+
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    rmf_Error result = RMF_SUCCESS;
+    int32_t choice = getAudioCaptureType();
+    int audioCaptureIndex = choice - 1; //0 - primary, 1 - auxiliary
+
+    result = test_l3_open_capture(audioCaptureIndex);
+    RMF_ASSERT(RMF_SUCCESS == result);
+    RMF_ASSERT(NULL != gAudioCaptureData[audioCaptureIndex].handle);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/**
+* @brief This test gets default values of RMF_AudioCapture_Settings and allows values to be updated.
+*
+* This test function gets default values of RMF_AudioCapture_Settings and allows values to be updated.
+*
+* **Test Group ID:** 03@n
+* **Test Case ID:** 002@n
+*
+* **Test Procedure:**
+* Refer to UT specification documentation [rmf-audio-capture_L3-Low-Level_TestSpecification.md](../docs/pages/rmf-audio-capture_L3-Low-Level_TestSpecification.md)
+*/
+void test_l3_rmfAudioCapture_update_settings(void)
+{
+    gTestID = 2;
+
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+
+    rmf_Error result = RMF_SUCCESS;
+    int32_t choice = getAudioCaptureType();
+    int audioCaptureIndex = choice - 1; //0 - primary, 1 - auxiliary
+
+    result = test_l3_load_default_settings(audioCaptureIndex);
+    RMF_ASSERT(result == RMF_SUCCESS);
+
+    UT_LOG_MENU_INFO("------------------------------------------");
+    UT_LOG_MENU_INFO("Current values in settings :");
+    UT_LOG_MENU_INFO("------------------------------------------");
+    UT_LOG_MENU_INFO("\t#   %-20s  %s","Settings", "Default Values");
+    UT_LOG_MENU_INFO("\t1.  %-20s  %s","Capture Format", UT_Control_GetMapString(racFormatMappingTable, gAudioCaptureData[audioCaptureIndex].settings.format));
+    UT_LOG_MENU_INFO("\t2.  %-20s  %s","Sampling Frequency", UT_Control_GetMapString(racFreqMappingTable, gAudioCaptureData[audioCaptureIndex].settings.samplingFreq));
+    UT_LOG_MENU_INFO("\t3.  %-20s  %d","FIFO size", gAudioCaptureData[audioCaptureIndex].settings.fifoSize);
+    UT_LOG_MENU_INFO("\t4.  %-20s  %d","Threshold", gAudioCaptureData[audioCaptureIndex].settings.threshold);
+    UT_LOG_MENU_INFO("------------------------------------------");
+    UT_LOG_MENU_INFO(" Do you want to update default settings ? (0 for No, 1 for Yes)");
+    readInt(&choice);
+
+    switch(choice)
+    {
+        case 0:
+        {
+            UT_LOG_INFO("Using above default values for settings");
+            break;
+        }
+        case 1:
+        {
+            int32_t format = -1;
+            int32_t samplingFreq = -1;
+            int32_t fifoSize = -1;
+            int32_t threshold = -1;
+
+            UT_LOG_MENU_INFO("------------------------------------------");
+            UT_LOG_MENU_INFO("\t\t Supported RMF Audio Capture Formats ");
+            UT_LOG_MENU_INFO("------------------------------------------");
+            UT_LOG_MENU_INFO("\t#   %-30s","Capture format");
+            for(int32_t i = racFormat_e16BitStereo; i < racFormat_eMax; i++)
+            {
+                UT_LOG_MENU_INFO("\t%d.  %-30s", i, UT_Control_GetMapString(racFormatMappingTable, i));
             }
+            UT_LOG_MENU_INFO("------------------------------------------");
+            UT_LOG_MENU_INFO(" Select the capture format to update, use -1 to retain default value :");
+            readInt(&format);
             
             UT_LOG_MENU_INFO("------------------------------------------");
             UT_LOG_MENU_INFO("\t\t Supported RMF Audio Capture Sampling Rates ");
@@ -659,44 +1392,19 @@ void test_l3_rmfAudioCapture_update_settings(void)
             }
             UT_LOG_MENU_INFO("------------------------------------------");
             UT_LOG_MENU_INFO(" Select the Sampling Rate, use -1 to retain default value :");
-            readInt(&choice);
-
-            if (choice != -1)
-            {
-                if(choice < racFreq_e16000 || choice >= racFreq_eMax)
-                {
-                    UT_LOG_ERROR("Invalid Sampling Rate, try again");
-                    break;
-                }
-                gAudioCaptureData[audioCaptureIndex].settings.samplingFreq = choice;
-            }
+            readInt(&samplingFreq);
             
             UT_LOG_MENU_INFO(" Enter FIFO size in bytes, use -1 to retain default value :");
-            readInt(&choice);
-
-            if (choice != -1)
-            {
-                if(choice <= 0 )
-                {
-                    UT_LOG_ERROR("Invalid FIFO size, try again");
-                    break;
-                }
-                gAudioCaptureData[audioCaptureIndex].settings.fifoSize = choice;
-            }
+            readInt(&fifoSize);
 
             UT_LOG_MENU_INFO(" Enter data callback threshold in bytes, used to check jitter (max 1/4th of FIFO), use -1 to retain default value :");
-            readInt(&choice);
+            readInt(&threshold);
 
-            if (choice != -1)
+            // Validated and applied as the settings command does, nothing is applied if any value is invalid
+            if (test_l3_apply_settings(audioCaptureIndex, format, samplingFreq, fifoSize, threshold) != RMF_SUCCESS)
             {
-                if(choice <= 0)
-                {
-                    UT_LOG_ERROR("Invalid threshold size, try again");
-                    break;
-                }
-                gAudioCaptureData[audioCaptureIndex].settings.threshold = choice;
-            }            
-
+                UT_LOG_ERROR("Settings not updated, try again");
+            }
             break;
         }
         default :
@@ -729,28 +1437,28 @@ void test_l3_rmfAudioCapture_setup_callbacks(void)
     UT_LOG_MENU_INFO("Choose the type of test :");
     UT_LOG_MENU_INFO("------------------------------------------");
     UT_LOG_MENU_INFO("\t#   %-20s","Supported types of test");
-    UT_LOG_MENU_INFO("\t1.  %-20s","Byte counting tests (only bytes received is checked)");
-    UT_LOG_MENU_INFO("\t2.  %-20s","Data capture tests (audio data is captured) ");
-    UT_LOG_MENU_INFO("------------------------------------------");
-    UT_LOG_MENU_INFO("Select the type of test: ");
-    readInt(&choice);
-
-    switch(choice)
-    {
-        case 1:
-        {
-            test_l3_prepare_start_settings_for_data_counting(&gAudioCaptureData[audioCaptureIndex]);
-            break;
-        }
-        case 2:
-        {
-            test_l3_prepare_start_settings_for_data_tracking(&gAudioCaptureData[audioCaptureIndex]);
-            break;
-        }
-        default :
-            UT_LOG_ERROR("Invalid callback type choice, callback not set up\n");
+    UT_LOG_MENU_INFO("\t1.  %-20s","Byte counting tests (only bytes received is checked)");
+    UT_LOG_MENU_INFO("\t2.  %-20s","Data capture tests (audio data is captured) ");
+    UT_LOG_MENU_INFO("\t3.  %-20s","Data capture tests with lossless output (audio data is also compressed for a .flac file) ");
+    UT_LOG_MENU_INFO("------------------------------------------");
+    UT_LOG_MENU_INFO("Select the type of test: ");
+    readInt(&choice);
+
+    int32_t duration = 0;
+    if ((choice == 2) || (choice == 3))
+    {
+        UT_LOG_MENU_INFO("------------------------------------------");
+        UT_LOG_MENU_INFO("Enter test duration in seconds for data capture test :");
+        UT_LOG_MENU_INFO("------------------------------------------");
+        readInt(&duration);
     }
-    
+
+    rmf_Error result = test_l3_setup_test_type(audioCaptureIndex, choice, duration);
+    if ((choice == 2) || (choice == 3))
+    {
+        RMF_ASSERT(result == RMF_SUCCESS);
+    }
+
     UT_LOG_INFO("Out %s\n", __FUNCTION__);
 }
 
@@ -774,20 +1482,7 @@ void test_l3_rmfAudioCapture_start(void)
     int32_t choice = getAudioCaptureType();
     int audioCaptureIndex = choice - 1; //0 - primary, 1 - auxiliary
 
-    UT_LOG_INFO("Calling RMF_AudioCapture_Start(IN:handle[0x%0X] settings:[0x%0X])", &gAudioCaptureData[audioCaptureIndex].handle, &gAudioCaptureData[audioCaptureIndex].settings);
-    result = RMF_AudioCapture_Start(gAudioCaptureData[audioCaptureIndex].handle, &gAudioCaptureData[audioCaptureIndex].settings);
-    UT_LOG_INFO("Result RMF_AudioCapture_Start(IN:handle[0x%0X] settings:[0x%0X] OUT:rmf_error:[%s]", &gAudioCaptureData[audioCaptureIndex].handle, &gAudioCaptureData[audioCaptureIndex].settings, UT_Control_GetMapString(rmfError_mapTable, result));
-    if (RMF_SUCCESS != result)
-    {
-        UT_LOG_DEBUG("Capture start failed with error code: %d", result);
-        result = RMF_AudioCapture_Close(gAudioCaptureData[audioCaptureIndex].handle);
-        if(gAudioCaptureData[audioCaptureIndex].data_buffer) 
-        {
-            free(gAudioCaptureData[audioCaptureIndex].data_buffer);
-            gAudioCaptureData[audioCaptureIndex].data_buffer = NULL;
-        }
-        UT_LOG_ERROR("Aborting test - unable to start capture.");
-    }
+    result = test_l3_start_capture(audioCaptureIndex);
     RMF_ASSERT(result == RMF_SUCCESS);
     
     UT_LOG_INFO("Out %s\n", __FUNCTION__);
@@ -812,6 +1507,17 @@ void test_l3_rmfAudioCapture_bytes_received(void)
 
     UT_LOG_INFO("Bytes Received for PRIMARY capture %d\n", gAudioCaptureData[0].bytes_received);
     UT_LOG_INFO("Bytes Received for AUXILIARY capture %d\n", gAudioCaptureData[1].bytes_received);
+    if (capture_metrics_enabled())
+    {
+        capture_metrics_record_t record;
+
+        for (int i = 0; i < 2; i++)
+        {
+            capture_metrics_begin(&record, "received", METRICS_TEST, captureName(&gAudioCaptureData[i]));
+            capture_json_add_uint(&record.writer, "bytes_received", gAudioCaptureData[i].bytes_received);
+            capture_metrics_emit(&record);
+        }
+    }
 
     UT_LOG_INFO("Out %s\n", __FUNCTION__);
 }
@@ -851,14 +1557,14 @@ void test_l3_write_output_file(void)
         UT_LOG_ERROR("Error reading input, choosing default file path and location : /tmp/output.wav\n");
         strcpy(filepath, "/tmp/output.wav");
     }
-    // Check if the filename ends with .wav
+    // Check if the filename ends with .wav or .flac
     const char *ext = strrchr(filepath, '.');
-    if (ext == NULL || strcmp(ext, ".wav") != 0) {
-        UT_LOG_ERROR("Provided file name is not a .wav file, choosing default file path and location : /tmp/output.wav\n");
+    if (ext == NULL || (strcmp(ext, ".wav") != 0 && strcmp(ext, ".flac") != 0)) {
+        UT_LOG_ERROR("Provided file name is not a .wav or .flac file, choosing default file path and location : /tmp/output.wav\n");
         strcpy(filepath, "/tmp/output.wav");
     }
 
-    result = test_l3_write_wav_file((void *)&gAudioCaptureData[audioCaptureIndex], filepath);
+    result = test_l3_write_capture_file((void *)&gAudioCaptureData[audioCaptureIndex], filepath);
     RMF_ASSERT(result == RMF_SUCCESS);
 
     UT_LOG_INFO("Out %s\n", __FUNCTION__);
@@ -882,46 +1588,22 @@ void test_l3_jitter_monitor(void)
     UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
     int32_t choice = getAudioCaptureType();
     int audioCaptureIndex = choice - 1; //0 - primary, 1 - auxiliary
-    int result = 0;
+    rmf_Error result = RMF_SUCCESS;
+    int32_t threshold = 0;
+    int32_t interval = 0;
+    int32_t duration = 0;
 
     UT_LOG_MENU_INFO("Enter minimum threshold in bytes to check jitter : ");
-    readInt(&choice);
-
-    if(choice <= 0)
-    {
-        UT_LOG_ERROR("Invalid threshold size, retaining value : %d", gAudioCaptureData[audioCaptureIndex].jitter_threshold);
-    } 
-    else 
-    {
-        gAudioCaptureData[audioCaptureIndex].jitter_threshold = choice;
-    }
+    readInt(&threshold);
 
     UT_LOG_MENU_INFO("Enter interval in microseconds to monitor buffer for jitter : ");
-    readInt(&choice);
-    gAudioCaptureData[audioCaptureIndex].jitter_monitor_sleep_interval = choice;
-
-    if(choice <= 0)
-    {
-        gAudioCaptureData[audioCaptureIndex].jitter_monitor_sleep_interval = MONITOR_JITTER_MICROSECONDS;
-        UT_LOG_ERROR("Invalid sleep interval, setting a default value of %d microseconds", gAudioCaptureData[audioCaptureIndex].jitter_monitor_sleep_interval);
-    }
+    readInt(&interval);
 
     UT_LOG_MENU_INFO("Enter test duration in seconds for jitter test : ");
-    readInt(&choice);
-    gAudioCaptureData[audioCaptureIndex].jitter_test_duration = choice;
+    readInt(&duration);
 
-    if(choice <= 0)
-    {
-        gAudioCaptureData[audioCaptureIndex].jitter_test_duration = MEASUREMENT_WINDOW_2MINUTES;
-        UT_LOG_ERROR("Invalid test duration, setting a default value of %d seconds", gAudioCaptureData[audioCaptureIndex].jitter_test_duration);
-    }
-
-    result = pthread_create(&gAudioCaptureData[audioCaptureIndex].jitter_thread_id, NULL, monitorBufferCount, (void *)&gAudioCaptureData[audioCaptureIndex]);
-    if (result != 0)
-    {
-        UT_LOG_ERROR("Aborting test - Failed to create monitor thread");
-    }
-    RMF_ASSERT (result == 0);
+    result = test_l3_start_jitter_monitor(audioCaptureIndex, threshold, interval, duration);
+    RMF_ASSERT (result == RMF_SUCCESS);
 
     UT_LOG_INFO("Out %s\n", __FUNCTION__);
 }
@@ -945,24 +1627,12 @@ void test_l3_jitter_result(void)
     rmf_Error result = RMF_SUCCESS;
     int32_t choice = getAudioCaptureType();
     int audioCaptureIndex = choice - 1; //0 - primary, 1 - auxiliary
-    void *ret_value;
+    rmf_Error jitter_result = RMF_SUCCESS;
 
-    if (pthread_join(gAudioCaptureData[audioCaptureIndex].jitter_thread_id, &ret_value) != 0) 
-    {
-        UT_LOG_INFO("Error joining monitor thread");
-    }
-    if (ret_value != NULL) 
-    {
-        result = *(rmf_Error *)ret_value;
-        if (result != RMF_SUCCESS)
-        {
-            UT_LOG_ERROR("Jitter Detected !");
-        }
-    
-        free(ret_value);
-    } else 
+    result = test_l3_get_jitter_result(audioCaptureIndex, &jitter_result);
+    if (result == RMF_SUCCESS)
     {
-        UT_LOG_INFO("Thread ret_value NULL, unable to assert for jitter check. Refer prints to confirm if test passed");
+        result = jitter_result;
     }
 
     UT_LOG_INFO("Out %s\n", __FUNCTION__);
@@ -1051,15 +1721,9 @@ void test_l3_rmfAudioCapture_stop(void)
     int32_t choice = getAudioCaptureType();
     int audioCaptureIndex = choice - 1; //0 - primary, 1 - auxiliary
 
-    UT_LOG_INFO("Calling RMF_AudioCapture_Stop(IN:handle:[0x%0X])", &gAudioCaptureData[audioCaptureIndex].handle);
-    result = RMF_AudioCapture_Stop(gAudioCaptureData[audioCaptureIndex].handle);
-    UT_LOG_INFO("Result RMF_AudioCapture_Stop(IN:handle:[0x%0X] OUT:rmf_error:[%s]", &gAudioCaptureData[audioCaptureIndex].handle, UT_Control_GetMapString(rmfError_mapTable, result));
-    gAudioCaptureData[audioCaptureIndex].cookie = 0;
+    result = test_l3_stop_capture(audioCaptureIndex);
     RMF_ASSERT(result == RMF_SUCCESS);
 
-    sleep(1); // Wait for the last callback to be processed
-    RMF_ASSERT(gAudioCaptureData[audioCaptureIndex].cookie == 0);
-    
     UT_LOG_INFO("Out %s\n", __FUNCTION__);
 }
 
@@ -1083,14 +1747,482 @@ void test_l3_rmfAudioCapture_close(void)
     int32_t choice = getAudioCaptureType();
     int audioCaptureIndex = choice - 1; //0 - primary, 1 - auxiliary
 
-    UT_LOG_INFO("Calling RMF_AudioCapture_Close(IN:handle:[0x%0X])", &gAudioCaptureData[audioCaptureIndex].handle);
-    result = RMF_AudioCapture_Close(gAudioCaptureData[audioCaptureIndex].handle);
-    UT_LOG_INFO("Result RMF_AudioCapture_Close(IN:handle:[0x%0X] OUT:rmf_error:[%s]", &gAudioCaptureData[audioCaptureIndex].handle, UT_Control_GetMapString(rmfError_mapTable, result));
+    result = test_l3_close_capture(audioCaptureIndex);
     RMF_ASSERT(result == RMF_SUCCESS);
-    
+
     UT_LOG_INFO("Out %s\n", __FUNCTION__);
 }
 
+/**
+* @brief This test compares a captured wav file against its reference on the device
+*
+* This test extracts the dominant-frequency track and spectral fingerprint of both files,
+* aligns them by cross-correlation and logs the comparison result
+*
+* **Test Group ID:** 03@n
+* **Test Case ID:** 0013@n
+*
+* **Test Procedure:**
+* Refer to UT specification documentation [rmf-audio-capture_L3-Low-Level_TestSpecification.md](../docs/pages/rmf-audio-capture_L3-Low-Level_TestSpecification.md)
+*/
+void test_l3_compare_wav_files(void)
+{
+    gTestID = 13;
+
+    UT_LOG_INFO("In %s [%02d%03d]\n", __FUNCTION__, gTestGroup, gTestID);
+    rmf_Error result = RMF_SUCCESS;
+    capture_analysis_result_t analysis;
+    char reference[256];
+    char capture[256];
+
+    UT_LOG_MENU_INFO("------------------------------------------");
+    UT_LOG_MENU_INFO("Enter reference wav file name and location :");
+    UT_LOG_MENU_INFO("------------------------------------------");
+    readPath(reference, sizeof(reference), "");
+    UT_LOG_MENU_INFO("------------------------------------------");
+    UT_LOG_MENU_INFO("Enter captured wav file name and location (example - /tmp/output.wav) :");
+    UT_LOG_MENU_INFO("------------------------------------------");
+    readPath(capture, sizeof(capture), "/tmp/output.wav");
+
+    result = test_l3_analyse_wav_files(reference, capture, CAPTURE_ANALYSIS_MIN_PITCH_AGREEMENT, CAPTURE_ANALYSIS_MIN_SPECTRAL_SIMILARITY, &analysis);
+    RMF_ASSERT(result == RMF_SUCCESS);
+
+    UT_LOG_INFO("Out %s\n", __FUNCTION__);
+}
+
+/* Control channel commands, see capture_control.h for the transport */
+typedef rmf_Error (*test_l3_control_cmd_t)(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response);
+
+static rmf_Error test_l3_cmd_open(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    return test_l3_open_capture(audioCaptureIndex);
+}
+
+static rmf_Error test_l3_cmd_settings(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    rmf_Error result = test_l3_load_default_settings(audioCaptureIndex);
+    if (result != RMF_SUCCESS)
+    {
+        return result;
+    }
+    result = test_l3_apply_settings(audioCaptureIndex,
+                                    (int32_t)capture_json_get_int(request, "format", -1),
+                                    (int32_t)capture_json_get_int(request, "samplingFreq", -1),
+                                    (int32_t)capture_json_get_int(request, "fifoSize", -1),
+                                    (int32_t)capture_json_get_int(request, "threshold", -1));
+    capture_json_add_string(response, "format", UT_Control_GetMapString(racFormatMappingTable, gAudioCaptureData[audioCaptureIndex].settings.format));
+    capture_json_add_string(response, "samplingFreq", UT_Control_GetMapString(racFreqMappingTable, gAudioCaptureData[audioCaptureIndex].settings.samplingFreq));
+    capture_json_add_uint(response, "fifoSize", gAudioCaptureData[audioCaptureIndex].settings.fifoSize);
+    capture_json_add_uint(response, "threshold", gAudioCaptureData[audioCaptureIndex].settings.threshold);
+    return result;
+}
+
+static rmf_Error test_l3_cmd_setup(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    return test_l3_setup_test_type(audioCaptureIndex,
+                                   (int32_t)capture_json_get_int(request, "test", 1),
+                                   (int32_t)capture_json_get_int(request, "duration", MEASUREMENT_WINDOW_SECONDS));
+}
+
+static rmf_Error test_l3_cmd_start(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    return test_l3_start_capture(audioCaptureIndex);
+}
+
+static rmf_Error test_l3_cmd_bytes(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    capture_json_add_uint(response, "primary", gAudioCaptureData[0].bytes_received);
+    capture_json_add_uint(response, "auxiliary", gAudioCaptureData[1].bytes_received);
+    return RMF_SUCCESS;
+}
+
+static rmf_Error test_l3_cmd_write(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    const char *path = capture_json_get_string(request, "path", "/tmp/output.wav");
+    capture_json_add_string(response, "path", path);
+    return test_l3_write_capture_file((void *)&gAudioCaptureData[audioCaptureIndex], path);
+}
+
+static rmf_Error test_l3_cmd_jitter_start(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    return test_l3_start_jitter_monitor(audioCaptureIndex,
+                                        (int32_t)capture_json_get_int(request, "threshold", 0),
+                                        (int32_t)capture_json_get_int(request, "interval", 0),
+                                        (int32_t)capture_json_get_int(request, "duration", 0));
+}
+
+static rmf_Error test_l3_cmd_jitter_result(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    rmf_Error jitter_result = RMF_ERROR;
+    rmf_Error result = test_l3_get_jitter_result(audioCaptureIndex, &jitter_result);
+    if (result == RMF_SUCCESS)
+    {
+        capture_json_add_bool(response, "jitter", jitter_result != RMF_SUCCESS);
+    }
+    return result;
+}
+
+static rmf_Error test_l3_cmd_current_settings(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    RMF_AudioCapture_Settings current_settings;
+    rmf_Error result;
+
+    memset(&current_settings, 0, sizeof(current_settings));
+    result = RMF_AudioCapture_GetCurrentSettings(gAudioCaptureData[audioCaptureIndex].handle, &current_settings);
+    capture_json_add_uint(response, "fifoSize", current_settings.fifoSize);
+    capture_json_add_uint(response, "threshold", current_settings.threshold);
+    capture_json_add_string(response, "format", UT_Control_GetMapString(racFormatMappingTable, current_settings.format));
+    capture_json_add_string(response, "samplingFreq", UT_Control_GetMapString(racFreqMappingTable, current_settings.samplingFreq));
+    capture_json_add_uint(response, "delayCompensation_ms", current_settings.delayCompensation_ms);
+    return result;
+}
+
+static rmf_Error test_l3_cmd_status(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    RMF_AudioCapture_Status status;
+    rmf_Error result;
+
+    memset(&status, 0, sizeof(status));
+    result = RMF_AudioCapture_GetStatus(gAudioCaptureData[audioCaptureIndex].handle, &status);
+    capture_json_add_int(response, "started", status.started);
+    capture_json_add_string(response, "format", UT_Control_GetMapString(racFormatMappingTable, status.format));
+    capture_json_add_string(response, "samplingFreq", UT_Control_GetMapString(racFreqMappingTable, status.samplingFreq));
+    capture_json_add_uint(response, "fifoDepth", status.fifoDepth);
+    capture_json_add_uint(response, "overflows", status.overflows);
+    capture_json_add_uint(response, "underflows", status.underflows);
+    return result;
+}
+
+static rmf_Error test_l3_cmd_levels(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    capture_meter_snapshot_t levels;
+    char key[32];
+
+    if (!gAudioCaptureData[audioCaptureIndex].meter_active)
+    {
+        return RMF_INVALID_STATE;
+    }
+    capture_meter_snapshot(&gAudioCaptureData[audioCaptureIndex].meter, &levels);
+    capture_json_add_uint(response, "channels", levels.channels);
+    capture_json_add_uint(response, "window_frames", levels.window_frames);
+    capture_json_add_uint(response, "buffers", levels.buffers);
+    capture_json_add_double(response, "load", levels.load);
+    capture_json_add_double(response, "max_load", levels.max_load);
+    for (uint16_t c = 0; c < levels.channels; c++)
+    {
+        snprintf(key, sizeof(key), "rms_dbfs_%u", c);
+        capture_json_add_double(response, key, capture_meter_dbfs(levels.channel[c].rms));
+        snprintf(key, sizeof(key), "peak_dbfs_%u", c);
+        capture_json_add_double(response, key, capture_meter_dbfs(levels.channel[c].peak));
+        snprintf(key, sizeof(key), "dc_offset_%u", c);
+        capture_json_add_double(response, key, levels.channel[c].dc_offset);
+        snprintf(key, sizeof(key), "clipped_%u", c);
+        capture_json_add_uint(response, key, levels.channel[c].clipped);
+        snprintf(key, sizeof(key), "clipped_total_%u", c);
+        capture_json_add_uint(response, key, levels.channel[c].clipped_total);
+    }
+    return RMF_SUCCESS;
+}
+
+static rmf_Error test_l3_cmd_glitches(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    RMF_audio_capture_struct *ctx_data = &gAudioCaptureData[audioCaptureIndex];
+
+    if (!ctx_data->glitch_active)
+    {
+        return RMF_INVALID_STATE;
+    }
+    capture_json_add_uint(response, "discontinuities", capture_glitch_count(&ctx_data->glitch, CAPTURE_GLITCH_DISCONTINUITY));
+    capture_json_add_uint(response, "silences", capture_glitch_count(&ctx_data->glitch, CAPTURE_GLITCH_SILENCE));
+    capture_json_add_uint(response, "repeats", capture_glitch_count(&ctx_data->glitch, CAPTURE_GLITCH_REPEAT));
+    return RMF_SUCCESS;
+}
+
+static rmf_Error test_l3_cmd_drift(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    capture_drift_estimate_t estimate;
+    rmf_Error result;
+
+    if (!gAudioCaptureData[audioCaptureIndex].drift_active)
+    {
+        return RMF_INVALID_STATE;
+    }
+    result = capture_drift_estimate(&gAudioCaptureData[audioCaptureIndex].drift, &estimate);
+    if (result == RMF_SUCCESS)
+    {
+        capture_json_add_double(response, "rate_hz", estimate.rate_hz);
+        capture_json_add_double(response, "ppm", estimate.ppm);
+        capture_json_add_double(response, "ci_ppm", estimate.ci_ppm);
+        capture_json_add_uint(response, "points", estimate.points);
+        capture_json_add_double(response, "seconds", estimate.seconds);
+    }
+    return result;
+}
+
+/* Exports the callback buffers of the capture through a shared memory ring until it is closed, before it is started */
+static rmf_Error test_l3_cmd_export(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    RMF_audio_capture_struct *ctx_data = &gAudioCaptureData[audioCaptureIndex];
+    int64_t slots = capture_json_get_int(request, "slots", CAPTURE_SHM_SLOTS_DEFAULT);
+    uint32_t slot_bytes = (ctx_data->settings.fifoSize > 0) ? ctx_data->settings.fifoSize : ctx_data->settings.threshold;
+    capture_shm_t *shm = NULL;
+    char path[64];
+    rmf_Error result;
+
+    if (__atomic_load_n(&ctx_data->shm, __ATOMIC_SEQ_CST) != NULL)
+    {
+        return RMF_INVALID_STATE;
+    }
+    if ((slots <= 0) || (slots > UINT16_MAX) || (slot_bytes == 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+    /* The callback never delivers more than the FIFO holds */
+    result = capture_shm_create(&shm, slot_bytes, (uint32_t)slots);
+    if (result != RMF_SUCCESS)
+    {
+        UT_LOG_ERROR("Unable to create the shared memory ring");
+        return result;
+    }
+    __atomic_store_n(&ctx_data->shm, shm, __ATOMIC_SEQ_CST);
+    snprintf(path, sizeof(path), "/proc/%d/fd/%d", (int)getpid(), capture_shm_fd(shm));
+    UT_LOG_INFO("Exporting %s capture buffers through %s", captureName(ctx_data), path);
+    capture_json_add_string(response, "path", path);
+    capture_json_add_uint(response, "slot_bytes", slot_bytes);
+    capture_json_add_uint(response, "slots", (uint64_t)slots);
+    return RMF_SUCCESS;
+}
+
+/* Records the timing of every callback of the capture until it is closed, after settings and before start */
+static rmf_Error test_l3_cmd_trace(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    RMF_audio_capture_struct *ctx_data = &gAudioCaptureData[audioCaptureIndex];
+    int64_t max = capture_json_get_int(request, "max", CAPTURE_TRACE_EVENTS_DEFAULT);
+    uint16_t num_channels = 0;
+    uint32_t sampling_rate = 0;
+    uint16_t bits_per_sample = 0;
+    uint32_t bytes_per_second = 0;
+    rmf_Error result;
+
+    if (ctx_data->trace_active)
+    {
+        return RMF_INVALID_STATE;
+    }
+    if ((max <= 0) || (max > UINT32_MAX))
+    {
+        return RMF_INVALID_PARM;
+    }
+    if (RMF_SUCCESS == getValuesFromSettings(&ctx_data->settings, &num_channels, &sampling_rate, &bits_per_sample))
+    {
+        bytes_per_second = sampling_rate * num_channels * bits_per_sample / 8;
+    }
+    result = capture_trace_init(&ctx_data->trace, (uint32_t)max, bytes_per_second);
+    if (result != RMF_SUCCESS)
+    {
+        UT_LOG_ERROR("Unable to allocate the callback timing trace");
+        return result;
+    }
+    ctx_data->trace_active = true;
+    UT_LOG_INFO("Tracing the timing of up to %lld %s callbacks", (long long)max, captureName(ctx_data));
+    capture_json_add_uint(response, "max", (uint64_t)max);
+    return RMF_SUCCESS;
+}
+
+/* Writes the callback timing trace, once the capture has stopped */
+static rmf_Error test_l3_cmd_trace_save(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    RMF_audio_capture_struct *ctx_data = &gAudioCaptureData[audioCaptureIndex];
+    const char *path = capture_json_get_string(request, "path", "/tmp/rmfAudioCapture.trace");
+    size_t file_bytes = 0;
+    rmf_Error result;
+
+    if (!ctx_data->trace_active)
+    {
+        return RMF_INVALID_STATE;
+    }
+    result = capture_trace_save(&ctx_data->trace, path, &file_bytes);
+    if (result != RMF_SUCCESS)
+    {
+        UT_LOG_ERROR("Unable to write the callback timing trace to %s rmf_error:[%s]", path, UT_Control_GetMapString(rmfError_mapTable, result));
+        return result;
+    }
+    UT_LOG_INFO("Result trace.path:[%s] trace.events:[%u] trace.dropped:[%llu] trace.seconds:[%.3f] trace.file_bytes:[%zu]", path,
+                ctx_data->trace.count, (unsigned long long)ctx_data->trace.dropped, capture_trace_duration_ns(&ctx_data->trace) / 1e9, file_bytes);
+    capture_json_add_string(response, "path", path);
+    capture_json_add_uint(response, "events", ctx_data->trace.count);
+    capture_json_add_uint(response, "dropped", ctx_data->trace.dropped);
+    capture_json_add_double(response, "seconds", capture_trace_duration_ns(&ctx_data->trace) / 1e9);
+    capture_json_add_uint(response, "file_bytes", file_bytes);
+    return RMF_SUCCESS;
+}
+
+static rmf_Error test_l3_cmd_stop(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    return test_l3_stop_capture(audioCaptureIndex);
+}
+
+static rmf_Error test_l3_cmd_close(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    return test_l3_close_capture(audioCaptureIndex);
+}
+
+static rmf_Error test_l3_cmd_wait(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    int64_t milliseconds = capture_json_get_int(request, "ms", capture_json_get_int(request, "seconds", 0) * 1000);
+    if (milliseconds < 0)
+    {
+        return RMF_INVALID_PARM;
+    }
+    capture_clock_sleep_ns((uint64_t)milliseconds * 1000000ull);
+    return RMF_SUCCESS;
+}
+
+static rmf_Error test_l3_cmd_analyse(int audioCaptureIndex, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    capture_analysis_result_t analysis;
+    rmf_Error result;
+
+    result = test_l3_analyse_wav_files(capture_json_get_string(request, "reference", ""),
+                                       capture_json_get_string(request, "path", "/tmp/output.wav"),
+                                       capture_json_get_double(request, "min_pitch_agreement", CAPTURE_ANALYSIS_MIN_PITCH_AGREEMENT),
+                                       capture_json_get_double(request, "min_spectral_similarity", CAPTURE_ANALYSIS_MIN_SPECTRAL_SIMILARITY),
+                                       &analysis);
+    if (result == RMF_SUCCESS)
+    {
+        capture_json_add_bool(response, "match", analysis.match);
+        capture_json_add_uint(response, "frames", analysis.frames);
+        capture_json_add_int(response, "delay_samples", analysis.delay_samples);
+        capture_json_add_double(response, "xcorr_peak", analysis.xcorr_peak);
+        capture_json_add_double(response, "pitch_agreement", analysis.pitch_agreement);
+        capture_json_add_double(response, "pitch_correlation", analysis.pitch_correlation);
+        capture_json_add_double(response, "spectral_similarity", analysis.spectral_similarity);
+        capture_json_add_double(response, "reference_hz", analysis.reference_hz);
+        capture_json_add_double(response, "capture_hz", analysis.capture_hz);
+        capture_json_add_bool(response, "reference_cached", analysis.reference_cached);
+    }
+    return result;
+}
+
+static const struct
+{
+    const char *name;
+    test_l3_control_cmd_t cmd;
+} test_l3_control_commands[] = {
+    { "open",             test_l3_cmd_open             },
+    { "settings",         test_l3_cmd_settings         },
+    { "setup",            test_l3_cmd_setup            },
+    { "start",            test_l3_cmd_start            },
+    { "bytes",            test_l3_cmd_bytes            },
+    { "write",            test_l3_cmd_write            },
+    { "jitter_start",     test_l3_cmd_jitter_start     },
+    { "jitter_result",    test_l3_cmd_jitter_result    },
+    { "current_settings", test_l3_cmd_current_settings },
+    { "status",           test_l3_cmd_status           },
+    { "stop",             test_l3_cmd_stop             },
+    { "close",            test_l3_cmd_close            },
+    { "wait",             test_l3_cmd_wait             },
+    { "analyse",          test_l3_cmd_analyse          },
+    { "levels",           test_l3_cmd_levels           },
+    { "glitches",         test_l3_cmd_glitches         },
+    { "drift",            test_l3_cmd_drift            },
+    { "export",           test_l3_cmd_export           },
+    { "trace",            test_l3_cmd_trace            },
+    { "trace_save",       test_l3_cmd_trace_save       },
+    { NULL,               NULL                         }
+};
+
+/**
+ * @brief Dispatches one control channel request to the matching L3 step
+ *
+ * "type" selects the capture (1 or "primary", 2 or "auxiliary") and defaults to primary.
+ */
+static bool test_l3_control_handler(void *ctx, const capture_json_object_t *request, capture_json_writer_t *response)
+{
+    const char *name = capture_json_get_string(request, "cmd", "");
+    const char *type = capture_json_get_string(request, "type", "1");
+    int audioCaptureIndex = 0;
+    rmf_Error result = RMF_INVALID_PARM;
+
+    capture_json_add_string(response, "cmd", name);
+
+    if (strcmp(name, "quit") == 0)
+    {
+        capture_json_add_string(response, "result", UT_Control_GetMapString(rmfError_mapTable, RMF_SUCCESS));
+        return false;
+    }
+
+    if ((strcmp(type, "2") == 0) || (strcmp(type, RMF_AC_TYPE_AUXILIARY) == 0))
+    {
+        audioCaptureIndex = 1;
+    }
+    else if ((strcmp(type, "1") != 0) && (strcmp(type, RMF_AC_TYPE_PRIMARY) != 0))
+    {
+        capture_json_add_string(response, "result", UT_Control_GetMapString(rmfError_mapTable, RMF_INVALID_PARM));
+        capture_json_add_string(response, "error", "unknown capture type");
+        return true;
+    }
+    capture_json_add_int(response, "type", audioCaptureIndex + 1);
+
+    for (int i = 0; test_l3_control_commands[i].name != NULL; i++)
+    {
+        if (strcmp(name, test_l3_control_commands[i].name) == 0)
+        {
+            result = test_l3_control_commands[i].cmd(audioCaptureIndex, request, response);
+            capture_json_add_string(response, "result", UT_Control_GetMapString(rmfError_mapTable, result));
+            return true;
+        }
+    }
+
+    capture_json_add_string(response, "result", UT_Control_GetMapString(rmfError_mapTable, RMF_INVALID_PARM));
+    capture_json_add_string(response, "error", "unknown command");
+    return true;
+}
+
+/**
+ * @brief Runs the L3 steps from the control channel instead of the interactive menu
+ *
+ * @param spec - channel description, see capture_control.h
+ *
+ * @return int - 0 on success, otherwise failure
+ */
+int test_rmfAudioCapture_l3_control_run(const char *spec)
+{
+    rmf_Error result;
+
+    UT_LOG_INFO("Serving L3 control channel [%s]", spec);
+    result = capture_control_serve(spec, test_l3_control_handler, NULL);
+    if (result != RMF_SUCCESS)
+    {
+        UT_LOG_ERROR("Unable to serve control channel [%s] rmf_error:[%s]", spec, UT_Control_GetMapString(rmfError_mapTable, result));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Serves the live counters of the captures while the tests run
+ *
+ * @param spec - endpoint description, see capture_telemetry.h
+ *
+ * @return int - 0 on success, otherwise failure
+ */
+int test_rmfAudioCapture_l3_telemetry_start(const char *spec)
+{
+    static capture_telemetry_session_t *const sessions[] = { &gAudioCaptureData[0].telemetry, &gAudioCaptureData[1].telemetry };
+    rmf_Error result;
+
+    gAudioCaptureData[0].telemetry.capture = "primary";
+    gAudioCaptureData[1].telemetry.capture = "auxiliary";
+    result = capture_telemetry_start(spec, METRICS_TEST, sessions, sizeof(sessions) / sizeof(sessions[0]));
+    if (result != RMF_SUCCESS)
+    {
+        UT_LOG_ERROR("Unable to serve telemetry on [%s] rmf_error:[%s]", spec, UT_Control_GetMapString(rmfError_mapTable, result));
+        return -1;
+    }
+    UT_LOG_INFO("Serving L3 telemetry on [%s]", spec);
+    return 0;
+}
+
 static UT_test_suite_t * pSuite = NULL;
 
 /**
@@ -1120,6 +2252,7 @@ int test_rmfAudioCapture_l3_register(void)
     UT_add_test(pSuite, "Get RMF Audio Capture status", test_l3_rmfAudioCapture_get_status);
     UT_add_test(pSuite, "Stop RMF Audio Capture", test_l3_rmfAudioCapture_stop);
     UT_add_test(pSuite, "Close RMF Audio Capture Handle", test_l3_rmfAudioCapture_close);
+    UT_add_test(pSuite, "Compare output wav with reference", test_l3_compare_wav_files);
     
     return 0;
 }
@@ -0,0 +1,251 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_clock.c
+*
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "capture_clock.h"
+
+#define CLOCK_POLL_MS 100   // Longest wait before the waiters check the holds again
+
+/* A thread waiting on the virtual clock, linked from its stack while it waits */
+typedef struct clock_waiter
+{
+    uint64_t deadline_ns;
+    struct clock_waiter *next;
+} clock_waiter_t;
+
+static pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+static bool gVirtual;
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gChanged;     // Signalled when the time, the waiters, the attached threads or the holds change
+static uint64_t gNowNs;
+static clock_waiter_t *gWaiters;
+static uint32_t gAttached;          // Threads driving the clock, counted from their reservation
+static uint32_t gAttachedWaiting;   // Of those, the ones waiting on it
+static uint32_t gHolds;             // Woken threads not attached that have not waited again
+static uint32_t gHoldGeneration = 1; // Bumped when the holds expire, so the threads holding then no longer count
+static uint64_t gHoldExpiryNs;      // Wall time the holds expire
+
+static __thread bool tAttached;
+static __thread uint32_t tHoldGeneration;
+
+static uint64_t wallNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static struct timespec toTimespec(uint64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)(ns / 1000000000ull);
+    ts.tv_nsec = (long)(ns % 1000000000ull);
+    return ts;
+}
+
+static void init(void)
+{
+    const char *spec = getenv(CAPTURE_CLOCK_ENV);
+    pthread_condattr_t attr;
+
+    gVirtual = (spec != NULL) && (spec[0] != '\0') && (strcmp(spec, "0") != 0);
+    gNowNs = wallNs();
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&gChanged, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/* The callers hold gLock */
+static void releaseHold(void)
+{
+    if (tHoldGeneration == gHoldGeneration)
+    {
+        gHolds--;
+        tHoldGeneration = 0;
+        pthread_cond_broadcast(&gChanged);
+    }
+}
+
+static void takeHold(void)
+{
+    if (tHoldGeneration != gHoldGeneration)
+    {
+        gHolds++;
+        tHoldGeneration = gHoldGeneration;
+    }
+    gHoldExpiryNs = wallNs() + (uint64_t)CAPTURE_CLOCK_HOLD_MS * 1000000ull;
+}
+
+static void expireHolds(void)
+{
+    if ((gHolds > 0) && (wallNs() >= gHoldExpiryNs))
+    {
+        gHolds = 0;
+        gHoldGeneration = (gHoldGeneration == UINT32_MAX) ? 1 : gHoldGeneration + 1;
+        pthread_cond_broadcast(&gChanged);
+    }
+}
+
+/* Moves the clock to the earliest deadline once nothing timed by it is running, returns true if it moved */
+static bool advance(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    if ((gHolds > 0) || (gAttachedWaiting < gAttached) || (gWaiters == NULL))
+    {
+        return false;
+    }
+    for (clock_waiter_t *waiter = gWaiters; waiter != NULL; waiter = waiter->next)
+    {
+        next = (waiter->deadline_ns < next) ? waiter->deadline_ns : next;
+    }
+    if (next <= gNowNs)
+    {
+        // A waiter is already due and has not run yet
+        return false;
+    }
+    gNowNs = next;
+    pthread_cond_broadcast(&gChanged);
+    return true;
+}
+
+bool capture_clock_virtual(void)
+{
+    pthread_once(&gOnce, init);
+    return gVirtual;
+}
+
+uint64_t capture_clock_now_ns(void)
+{
+    uint64_t now;
+
+    if (!capture_clock_virtual())
+    {
+        return wallNs();
+    }
+    pthread_mutex_lock(&gLock);
+    now = gNowNs;
+    pthread_mutex_unlock(&gLock);
+    return now;
+}
+
+void capture_clock_sleep_until_ns(uint64_t deadline_ns)
+{
+    clock_waiter_t self;
+    clock_waiter_t **link;
+
+    if (!capture_clock_virtual())
+    {
+        struct timespec deadline = toTimespec(deadline_ns);
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        {
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&gLock);
+    releaseHold();
+    if (deadline_ns > gNowNs)
+    {
+        self.deadline_ns = deadline_ns;
+        self.next = gWaiters;
+        gWaiters = &self;
+        gAttachedWaiting += tAttached ? 1 : 0;
+        while (gNowNs < deadline_ns)
+        {
+            struct timespec wake;
+
+            if (advance())
+            {
+                continue;
+            }
+            wake = toTimespec(wallNs() + (uint64_t)CLOCK_POLL_MS * 1000000ull);
+            if ((gHolds > 0) && (gHoldExpiryNs < wallNs() + (uint64_t)CLOCK_POLL_MS * 1000000ull))
+            {
+                wake = toTimespec(gHoldExpiryNs);
+            }
+            pthread_cond_timedwait(&gChanged, &gLock, &wake);
+            expireHolds();
+        }
+        for (link = &gWaiters; *link != &self; link = &(*link)->next)
+        {
+        }
+        *link = self.next;
+        gAttachedWaiting -= tAttached ? 1 : 0;
+        pthread_cond_broadcast(&gChanged);
+    }
+    if (!tAttached)
+    {
+        takeHold();
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+void capture_clock_sleep_ns(uint64_t ns)
+{
+    capture_clock_sleep_until_ns(capture_clock_now_ns() + ns);
+}
+
+void capture_clock_reserve(void)
+{
+    if (!capture_clock_virtual())
+    {
+        return;
+    }
+    pthread_mutex_lock(&gLock);
+    gAttached++;
+    pthread_mutex_unlock(&gLock);
+}
+
+void capture_clock_attach(void)
+{
+    if (!capture_clock_virtual())
+    {
+        return;
+    }
+    pthread_mutex_lock(&gLock);
+    releaseHold();
+    tAttached = true;
+    pthread_mutex_unlock(&gLock);
+}
+
+void capture_clock_detach(void)
+{
+    if (!capture_clock_virtual())
+    {
+        return;
+    }
+    pthread_mutex_lock(&gLock);
+    tAttached = false;
+    gAttached--;
+    pthread_cond_broadcast(&gChanged);
+    pthread_mutex_unlock(&gLock);
+}
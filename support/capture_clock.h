@@ -0,0 +1,92 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_clock.h
+*
+* Clock shared by the mock HAL and the timing of the tests.
+*
+* By default it is CLOCK_MONOTONIC and its sleeps are real. With RMF_AUDIOCAPTURE_VIRTUAL_CLOCK=1
+* in the environment it is a virtual clock, which only moves when every thread it times is
+* waiting on it. The mock's delivery threads attach to it: each delivers a buffer, then waits
+* for the time of the next one. A test waits for the end of its measurement window on the
+* same clock. Once every attached thread waits, the clock jumps to the earliest time any
+* thread waits for. The audio is then delivered as fast as the consumer takes it, while the
+* capture times, the simulated FIFO and the measurement windows advance in simulated time,
+* so a two minute jitter run completes in about a second.
+*
+* A thread that is not attached, woken by the clock, holds it still until it waits on it
+* again, so the audio does not run ahead while the test stops the capture at the end of its
+* window. A thread that goes on to block elsewhere releases the clock after CAPTURE_CLOCK_HOLD_MS.
+*
+* Only the mock follows the virtual clock, a real HAL must be tested in real time. The live
+* sources of the mock are fed in real time and cannot keep up with it either.
+*/
+
+#ifndef CAPTURE_CLOCK_H
+#define CAPTURE_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CAPTURE_CLOCK_ENV       "RMF_AUDIOCAPTURE_VIRTUAL_CLOCK" // Set to 1 to run the mock and the tests on the virtual clock
+#define CAPTURE_CLOCK_HOLD_MS   10      // Wall time a woken thread may hold the virtual clock without waiting on it again
+
+/**
+ * @brief Whether the clock is virtual, read from CAPTURE_CLOCK_ENV on first use
+ */
+bool capture_clock_virtual(void);
+
+/**
+ * @brief Current time in nanoseconds, CLOCK_MONOTONIC unless the clock is virtual
+ *
+ * The virtual clock starts at the CLOCK_MONOTONIC time of its first use.
+ */
+uint64_t capture_clock_now_ns(void);
+
+/**
+ * @brief Waits until the clock reaches deadline_ns, returns at once if it has
+ */
+void capture_clock_sleep_until_ns(uint64_t deadline_ns);
+
+/**
+ * @brief Waits for ns nanoseconds of the clock
+ */
+void capture_clock_sleep_ns(uint64_t ns);
+
+/**
+ * @brief Counts one more thread driving the clock, such as a delivery thread of the mock
+ *
+ * Called before the thread is created, so the virtual clock cannot move before it runs. The
+ * virtual clock does not move while an attached thread is running, only when it waits on the
+ * clock. Nothing on the real clock.
+ */
+void capture_clock_reserve(void);
+
+/**
+ * @brief Takes a reservation of capture_clock_reserve() for the calling thread
+ */
+void capture_clock_attach(void);
+
+/**
+ * @brief Gives up the reservation, from the attached thread before it exits, or from the thread
+ * that reserved it when the attached thread could not be created
+ */
+void capture_clock_detach(void);
+
+#endif // CAPTURE_CLOCK_H
@@ -0,0 +1,261 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_timeline.c
+*
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+
+#include "capture_timeline.h"
+#include "capture_clock.h"
+
+typedef struct
+{
+    uint64_t time_ns;
+    const char *name;
+    const char *arg;            // NULL for no argument
+    uint64_t value;
+    char phase;                 // 'B', 'E' or 'i' of the trace event format
+} timeline_event_t;
+
+/* Events of one thread, written by that thread only and published by count */
+typedef struct timeline_buffer
+{
+    timeline_event_t events[CAPTURE_TIMELINE_EVENTS];
+    uint32_t count;
+    uint64_t dropped;
+    const char *name;           // From capture_timeline_thread_name(), NULL for the system name
+    char system_name[17];
+    pid_t tid;
+    struct timeline_buffer *next;
+} timeline_buffer_t;
+
+static pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static bool gEnabled;
+static const char *gPath;       // Written at exit, set once
+static uint64_t gStartNs;       // The timeline starts at 0 from here
+static timeline_buffer_t *gBuffers;
+
+static __thread timeline_buffer_t *tBuffer;
+
+static void writeAtExit(void)
+{
+    if (capture_timeline_write(gPath) != RMF_SUCCESS)
+    {
+        fprintf(stderr, "Unable to write the timeline to %s\n", gPath);
+    }
+}
+
+/* The callers hold gLock */
+static void setPath(const char *path)
+{
+    if ((path != NULL) && (gPath == NULL))
+    {
+        gPath = path;
+        atexit(writeAtExit);
+    }
+}
+
+static void init(void)
+{
+    const char *path = getenv(CAPTURE_TIMELINE_ENV);
+
+    gStartNs = capture_clock_now_ns();
+    if ((path != NULL) && (path[0] != '\0'))
+    {
+        pthread_mutex_lock(&gLock);
+        setPath(path);
+        pthread_mutex_unlock(&gLock);
+        __atomic_store_n(&gEnabled, true, __ATOMIC_RELEASE);
+    }
+}
+
+/* Allocates the buffer of the calling thread and links it, without a lock, for the writer to find */
+static timeline_buffer_t *threadBuffer(void)
+{
+    timeline_buffer_t *buffer = (timeline_buffer_t *)malloc(sizeof(timeline_buffer_t));
+
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
+    buffer->count = 0;
+    buffer->dropped = 0;
+    buffer->name = NULL;
+    memset(buffer->system_name, 0, sizeof(buffer->system_name));
+    prctl(PR_GET_NAME, buffer->system_name, 0, 0, 0);
+    buffer->tid = (pid_t)syscall(SYS_gettid);
+    buffer->next = __atomic_load_n(&gBuffers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&gBuffers, &buffer->next, buffer, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+    tBuffer = buffer;
+    return buffer;
+}
+
+static void record(char phase, const char *name, const char *arg, uint64_t value)
+{
+    timeline_buffer_t *buffer = tBuffer;
+    timeline_event_t *event;
+    uint32_t count;
+
+    if (!capture_timeline_enabled())
+    {
+        return;
+    }
+    if ((buffer == NULL) && ((buffer = threadBuffer()) == NULL))
+    {
+        return;
+    }
+    count = buffer->count;
+    if (count == CAPTURE_TIMELINE_EVENTS)
+    {
+        __atomic_store_n(&buffer->dropped, buffer->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+    event = &buffer->events[count];
+    event->time_ns = capture_clock_now_ns();
+    event->name = name;
+    event->arg = arg;
+    event->value = value;
+    event->phase = phase;
+    __atomic_store_n(&buffer->count, count + 1, __ATOMIC_RELEASE);
+}
+
+bool capture_timeline_enabled(void)
+{
+    pthread_once(&gOnce, init);
+    return __atomic_load_n(&gEnabled, __ATOMIC_ACQUIRE);
+}
+
+void capture_timeline_open(const char *path)
+{
+    pthread_once(&gOnce, init);
+    pthread_mutex_lock(&gLock);
+    setPath(path);
+    pthread_mutex_unlock(&gLock);
+    __atomic_store_n(&gEnabled, true, __ATOMIC_RELEASE);
+}
+
+void capture_timeline_thread_name(const char *name)
+{
+    if (!capture_timeline_enabled())
+    {
+        return;
+    }
+    if ((tBuffer != NULL) || (threadBuffer() != NULL))
+    {
+        __atomic_store_n(&tBuffer->name, name, __ATOMIC_RELAXED);
+    }
+}
+
+void capture_timeline_begin(const char *name, const char *arg, uint64_t value)
+{
+    record('B', name, arg, value);
+}
+
+void capture_timeline_end(const char *name)
+{
+    record('E', name, NULL, 0);
+}
+
+void capture_timeline_instant(const char *name, const char *arg, uint64_t value)
+{
+    record('i', name, arg, value);
+}
+
+capture_timeline_scope_t capture_timeline_scope_begin(const char *name, const char *arg, uint64_t value)
+{
+    capture_timeline_scope_t scope = { name };
+
+    record('B', name, arg, value);
+    return scope;
+}
+
+void capture_timeline_scope_end(capture_timeline_scope_t *scope)
+{
+    record('E', scope->name, NULL, 0);
+}
+
+void capture_timeline_discard(void)
+{
+    if (tBuffer != NULL)
+    {
+        __atomic_store_n(&tBuffer->count, 0, __ATOMIC_RELEASE);
+    }
+}
+
+rmf_Error capture_timeline_write(const char *path)
+{
+    const char *separator = "";
+    uint64_t dropped = 0;
+    int pid = (int)getpid();
+    FILE *file;
+    bool ok;
+
+    if (path == NULL)
+    {
+        return RMF_INVALID_PARM;
+    }
+    file = fopen(path, "w");
+    if (file == NULL)
+    {
+        return RMF_ERROR;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (timeline_buffer_t *buffer = __atomic_load_n(&gBuffers, __ATOMIC_ACQUIRE); buffer != NULL; buffer = buffer->next)
+    {
+        uint32_t count = __atomic_load_n(&buffer->count, __ATOMIC_ACQUIRE);
+        const char *name = __atomic_load_n(&buffer->name, __ATOMIC_RELAXED);
+
+        dropped += __atomic_load_n(&buffer->dropped, __ATOMIC_RELAXED);
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                separator, pid, (int)buffer->tid, (name != NULL) ? name : buffer->system_name);
+        separator = ",";
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const timeline_event_t *event = &buffer->events[i];
+            uint64_t time = (event->time_ns > gStartNs) ? event->time_ns - gStartNs : 0;
+
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"rmf\",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":%d,\"tid\":%d",
+                    event->name, event->phase, (unsigned long long)(time / 1000), (unsigned)(time % 1000), pid, (int)buffer->tid);
+            if (event->phase == 'i')
+            {
+                fprintf(file, ",\"s\":\"t\"");
+            }
+            if (event->arg != NULL)
+            {
+                fprintf(file, ",\"args\":{\"%s\":%llu}", event->arg, (unsigned long long)event->value);
+            }
+            fprintf(file, "}");
+        }
+    }
+    fprintf(file, "\n],\"otherData\":{\"dropped_events\":%llu}}\n", (unsigned long long)dropped);
+    ok = (ferror(file) == 0);
+    ok = (fclose(file) == 0) && ok;
+    return ok ? RMF_SUCCESS : RMF_ERROR;
+}
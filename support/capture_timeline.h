@@ -0,0 +1,113 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_timeline.h
+*
+* Timeline of a capture session in the Chrome trace event format, for chrome://tracing
+* or https://ui.perfetto.dev.
+*
+* With RMF_AUDIOCAPTURE_TIMELINE=<path> in the environment, the mock HAL records the
+* entry and exit of every RMF_AudioCapture_* call, the creation and wakeups of its
+* delivery threads, the tests record every buffer ready callback with its size, and the
+* metrics, WAV and FLAC writers record their writes. The events are written to path as
+* JSON when the process exits.
+*
+* Each thread records into its own buffer of CAPTURE_TIMELINE_EVENTS events, allocated on
+* its first event and never freed, so recording takes no lock: it reads the clock and
+* stores the event. Events past the capacity are counted and dropped. When the timeline
+* is off, recording is one test of a flag. `make bench` measures both (`timeline_event`).
+*
+* Names and argument names are not copied: they must be string literals, or otherwise
+* outlive the process, and need no JSON escaping.
+*/
+
+#ifndef CAPTURE_TIMELINE_H
+#define CAPTURE_TIMELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_TIMELINE_ENV        "RMF_AUDIOCAPTURE_TIMELINE" // Path the timeline is written to at exit
+#define CAPTURE_TIMELINE_EVENTS     65536   // Events each thread may record, 40 bytes each
+
+/* Span of the enclosing scope, ended when the scope is left (see CAPTURE_TIMELINE_SCOPE) */
+typedef struct
+{
+    const char *name;
+} capture_timeline_scope_t;
+
+/**
+ * @brief Whether events are recorded, read from CAPTURE_TIMELINE_ENV on first use
+ */
+bool capture_timeline_enabled(void);
+
+/**
+ * @brief Starts recording, writing the timeline to path at exit, or not at all if path is NULL
+ *
+ * Used by programs that record without the environment variable, such as the benchmarks.
+ */
+void capture_timeline_open(const char *path);
+
+/**
+ * @brief Names the calling thread in the timeline, in place of its system name
+ */
+void capture_timeline_thread_name(const char *name);
+
+/**
+ * @brief Starts a span on the calling thread, with one argument if arg is not NULL
+ */
+void capture_timeline_begin(const char *name, const char *arg, uint64_t value);
+
+/**
+ * @brief Ends the latest span started on the calling thread
+ */
+void capture_timeline_end(const char *name);
+
+/**
+ * @brief Records an instant event on the calling thread, with one argument if arg is not NULL
+ */
+void capture_timeline_instant(const char *name, const char *arg, uint64_t value);
+
+capture_timeline_scope_t capture_timeline_scope_begin(const char *name, const char *arg, uint64_t value);
+void capture_timeline_scope_end(capture_timeline_scope_t *scope);
+
+/**
+ * @brief Records a span from here to the end of the enclosing scope, whichever way it is left
+ */
+#define CAPTURE_TIMELINE_SCOPE(name, arg, value) \
+    capture_timeline_scope_t capture_timeline_scope_ __attribute__((cleanup(capture_timeline_scope_end))) = capture_timeline_scope_begin(name, arg, value)
+
+/**
+ * @brief Empties the buffer of the calling thread, so a benchmark can record without filling it
+ */
+void capture_timeline_discard(void);
+
+/**
+ * @brief Writes every event recorded so far to path
+ *
+ * Called at exit for the path opened. Threads may keep recording while it runs; their
+ * later events are left out.
+ *
+ * @return RMF_SUCCESS, RMF_ERROR if the file could not be written
+ */
+rmf_Error capture_timeline_write(const char *path);
+
+#endif // CAPTURE_TIMELINE_H
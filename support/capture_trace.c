@@ -0,0 +1,275 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_trace.c
+*
+*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture_trace.h"
+#include "capture_clock.h"
+#include "capture_timeline.h"
+
+#define TRACE_HEADER_BYTES  16
+#define TRACE_VARINT_MAX    10      // Bytes of a 64 bit LEB128 integer
+
+static uint32_t readLE32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t readLE16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static void writeLE32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static void writeLE16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static size_t writeVarint(uint8_t *p, uint64_t value)
+{
+    size_t n = 0;
+
+    while (value >= 0x80)
+    {
+        p[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (uint8_t)value;
+    return n;
+}
+
+/* Returns false when the integer runs past end or over 64 bits */
+static bool readVarint(const uint8_t **p, const uint8_t *end, uint64_t *value)
+{
+    uint64_t result = 0;
+
+    for (unsigned shift = 0; (shift < 64) && (*p < end); shift += 7)
+    {
+        uint8_t byte = *(*p)++;
+
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+rmf_Error capture_trace_init(capture_trace_t *trace, uint32_t capacity, uint32_t bytes_per_second)
+{
+    if ((trace == NULL) || (capacity == 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(trace, 0, sizeof(*trace));
+    trace->events = (capture_trace_event_t *)malloc((size_t)capacity * sizeof(capture_trace_event_t));
+    if (trace->events == NULL)
+    {
+        return RMF_ERROR;
+    }
+    trace->capacity = capacity;
+    trace->bytes_per_second = bytes_per_second;
+    return RMF_SUCCESS;
+}
+
+void capture_trace_record(capture_trace_t *trace, size_t bytes)
+{
+    capture_trace_record_at(trace, bytes, capture_clock_now_ns());
+}
+
+void capture_trace_record_at(capture_trace_t *trace, size_t bytes, uint64_t now_ns)
+{
+    capture_trace_event_t *event;
+
+    if ((trace == NULL) || (trace->events == NULL))
+    {
+        return;
+    }
+    if (trace->count == trace->capacity)
+    {
+        trace->dropped++;
+        return;
+    }
+    if (trace->count == 0)
+    {
+        trace->first_ns = now_ns;
+    }
+    event = &trace->events[trace->count];
+    event->time_ns = (now_ns > trace->first_ns) ? now_ns - trace->first_ns : 0;
+    event->bytes = (bytes > UINT32_MAX) ? UINT32_MAX : (uint32_t)bytes;
+    trace->max_bytes = (event->bytes > trace->max_bytes) ? event->bytes : trace->max_bytes;
+    trace->count++;
+}
+
+uint64_t capture_trace_duration_ns(const capture_trace_t *trace)
+{
+    if ((trace == NULL) || (trace->count == 0))
+    {
+        return 0;
+    }
+    return trace->events[trace->count - 1].time_ns;
+}
+
+rmf_Error capture_trace_save(const capture_trace_t *trace, const char *path, size_t *file_bytes)
+{
+    uint8_t *data;
+    size_t size = TRACE_HEADER_BYTES;
+    uint64_t previous = 0;
+    FILE *file;
+    bool ok;
+
+    if ((trace == NULL) || (path == NULL) || (trace->count == 0))
+    {
+        return RMF_INVALID_PARM;
+    }
+    data = (uint8_t *)malloc(TRACE_HEADER_BYTES + (size_t)trace->count * 2 * TRACE_VARINT_MAX);
+    if (data == NULL)
+    {
+        return RMF_ERROR;
+    }
+    writeLE32(data, CAPTURE_TRACE_MAGIC);
+    writeLE16(data + 4, CAPTURE_TRACE_VERSION);
+    writeLE16(data + 6, 0);
+    writeLE32(data + 8, trace->count);
+    writeLE32(data + 12, trace->bytes_per_second);
+    for (uint32_t i = 0; i < trace->count; i++)
+    {
+        size += writeVarint(data + size, trace->events[i].time_ns - previous);
+        size += writeVarint(data + size, trace->events[i].bytes);
+        previous = trace->events[i].time_ns;
+    }
+
+    CAPTURE_TIMELINE_SCOPE("trace_write", "bytes", size);
+    file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        free(data);
+        return RMF_ERROR;
+    }
+    ok = (fwrite(data, 1, size, file) == size);
+    ok = (fclose(file) == 0) && ok;
+    free(data);
+    if (ok && (file_bytes != NULL))
+    {
+        *file_bytes = size;
+    }
+    return ok ? RMF_SUCCESS : RMF_ERROR;
+}
+
+rmf_Error capture_trace_load(capture_trace_t *trace, const char *path)
+{
+    uint8_t *data;
+    const uint8_t *p;
+    const uint8_t *end;
+    long size;
+    uint32_t count;
+    uint64_t time = 0;
+    FILE *file;
+    rmf_Error result;
+
+    if ((trace == NULL) || (path == NULL))
+    {
+        return RMF_INVALID_PARM;
+    }
+    memset(trace, 0, sizeof(*trace));
+    file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return RMF_ERROR;
+    }
+    if ((fseek(file, 0, SEEK_END) != 0) || ((size = ftell(file)) < 0) || (fseek(file, 0, SEEK_SET) != 0))
+    {
+        fclose(file);
+        return RMF_ERROR;
+    }
+    if (size < TRACE_HEADER_BYTES)
+    {
+        fclose(file);
+        return RMF_INVALID_PARM;
+    }
+    data = (uint8_t *)malloc((size_t)size);
+    if ((data == NULL) || (fread(data, 1, (size_t)size, file) != (size_t)size))
+    {
+        free(data);
+        fclose(file);
+        return RMF_ERROR;
+    }
+    fclose(file);
+
+    count = readLE32(data + 8);
+    if ((readLE32(data) != CAPTURE_TRACE_MAGIC) || (readLE16(data + 4) != CAPTURE_TRACE_VERSION) || (count == 0) ||
+        (count > (uint64_t)(size - TRACE_HEADER_BYTES) / 2))
+    {
+        free(data);
+        return RMF_INVALID_PARM;
+    }
+    result = capture_trace_init(trace, count, readLE32(data + 12));
+    if (result != RMF_SUCCESS)
+    {
+        free(data);
+        return result;
+    }
+
+    p = data + TRACE_HEADER_BYTES;
+    end = data + size;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t delta;
+        uint64_t bytes;
+
+        if (!readVarint(&p, end, &delta) || !readVarint(&p, end, &bytes) || (bytes > CAPTURE_TRACE_BYTES_MAX))
+        {
+            capture_trace_release(trace);
+            free(data);
+            return RMF_INVALID_PARM;
+        }
+        time += delta;
+        capture_trace_record_at(trace, (size_t)bytes, time);
+    }
+    free(data);
+    return RMF_SUCCESS;
+}
+
+void capture_trace_release(capture_trace_t *trace)
+{
+    if (trace == NULL)
+    {
+        return;
+    }
+    free(trace->events);
+    memset(trace, 0, sizeof(*trace));
+}
@@ -0,0 +1,112 @@
+/*
+* If not stated otherwise in this file or this component's LICENSE file the
+* following copyright and licenses apply:*
+* Copyright 2024 RDK Management
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/**
+* @file capture_trace.h
+*
+* Callback timing traces: when each buffer ready callback arrived and how many bytes it delivered.
+*
+* A trace recorded from a real HAL keeps its timing pattern, such as periodic bursts from DMA
+* or long gaps while HDMI renegotiates, so the mock can replay it on a development machine
+* (INPUT_PRIMARY_TRACE / INPUT_AUXILIARY_TRACE, see the L3 test procedure).
+*
+* The callback only appends an event to memory allocated beforehand; events past the capacity
+* are counted and dropped. The trace is written out once capture has stopped.
+*
+* The file starts with a 16 byte little endian header: magic "RACT", version (16 bit), flags
+* (16 bit, 0), event count (32 bit) and the bytes per second of the audio traced (32 bit, 0 if
+* unknown). Each event follows as two LEB128 unsigned integers: the nanoseconds since the
+* previous callback, or since the first one for the first event, and the bytes delivered.
+* A steady 8 KB callback takes about 6 bytes.
+*/
+
+#ifndef CAPTURE_TRACE_H
+#define CAPTURE_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "rmfAudioCapture.h"
+
+#define CAPTURE_TRACE_MAGIC             0x54434152u     // "RACT"
+#define CAPTURE_TRACE_VERSION           1
+#define CAPTURE_TRACE_EVENTS_DEFAULT    65536           // About 47 minutes of 8 KB callbacks at 48 kHz 16 bit stereo
+#define CAPTURE_TRACE_BYTES_MAX         (1024 * 1024)   // Largest callback a trace may hold
+
+typedef struct
+{
+    uint64_t time_ns;           // Arrival of the callback, from the first one
+    uint32_t bytes;             // Bytes it delivered
+} capture_trace_event_t;
+
+typedef struct
+{
+    capture_trace_event_t *events;
+    uint32_t capacity;
+    uint32_t count;
+    uint64_t dropped;           // Callbacks past the capacity, not recorded
+    uint64_t first_ns;          // Clock time of the first callback
+    uint32_t bytes_per_second;  // Of the audio traced, 0 if unknown
+    uint32_t max_bytes;         // Largest callback recorded
+} capture_trace_t;
+
+/**
+ * @brief Allocates room for capacity events
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for no room, RMF_ERROR if the memory could not be allocated
+ */
+rmf_Error capture_trace_init(capture_trace_t *trace, uint32_t capacity, uint32_t bytes_per_second);
+
+/**
+ * @brief Adds a callback that delivered bytes, timed with capture_clock_now_ns()
+ */
+void capture_trace_record(capture_trace_t *trace, size_t bytes);
+
+/**
+ * @brief Adds a callback that delivered bytes at a given clock time in nanoseconds
+ */
+void capture_trace_record_at(capture_trace_t *trace, size_t bytes, uint64_t now_ns);
+
+/**
+ * @brief Duration of the trace in nanoseconds, from the first callback to the last
+ */
+uint64_t capture_trace_duration_ns(const capture_trace_t *trace);
+
+/**
+ * @brief Writes the recorded events to path
+ *
+ * @param[out] file_bytes - Size of the file written, may be NULL
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for no events, RMF_ERROR if the file could not be written
+ */
+rmf_Error capture_trace_save(const capture_trace_t *trace, const char *path, size_t *file_bytes);
+
+/**
+ * @brief Reads a trace written by capture_trace_save(), allocating its events
+ *
+ * @return RMF_SUCCESS, RMF_INVALID_PARM for a file that is not a trace, holds no events or a
+ * callback over CAPTURE_TRACE_BYTES_MAX, RMF_ERROR if it could not be read
+ */
+rmf_Error capture_trace_load(capture_trace_t *trace, const char *path);
+
+/**
+ * @brief Frees the events
+ */
+void capture_trace_release(capture_trace_t *trace);
+
+#endif // CAPTURE_TRACE_H